@@ -368,6 +368,9 @@ void _sys_k_event_logger_context_switch(void);
 #ifdef CONFIG_CPU_LOAD_STAT
 void _sys_cpuload_context_switch(struct k_thread *from, struct k_thread *to);
 #endif
+#ifdef CONFIG_CPU_SCHED_HIST
+void _sys_cpuload_isr_stat(u32_t start_time);
+#endif
 
 void _enter_syscall_exception(NANO_ESF *esf)
 {
@@ -402,6 +405,10 @@ extern void __cli(void);
 
 __ramfunc void _enter_interrupt_exception(NANO_ESF *esf)
 {
+#ifdef CONFIG_CPU_SCHED_HIST
+	u32_t isr_start_time = k_cycle_get_32();
+#endif
+
 #ifdef CONFIG_STACK_MONITOR
 	check_stack_overlow((unsigned long)esf, esf);
 #endif
@@ -412,6 +419,10 @@ __ramfunc void _enter_interrupt_exception(NANO_ESF *esf)
 
 	_enter_irq();
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	_sys_cpuload_isr_stat(isr_start_time);
+#endif
+
 #ifdef CONFIG_PREEMPT_ENABLED
 //	if(_kernel.nested == 0 && (mips32_getstatus() & 0x3c00) && _kernel.current->base.preempt < _NON_PREEMPT_THRESHOLD && _kernel.ready_q.cache != _kernel.current) {
 	if(_kernel.nested == 0 && _kernel.current->base.preempt < _NON_PREEMPT_THRESHOLD && _kernel.ready_q.cache != _kernel.current) {
@@ -134,6 +134,9 @@ static int acts_hci_send(struct net_buf *buf)
 
 	case BT_BUF_ACL_OUT:
 	case BT_BUF_ACL_IN:
+		/* copied to the controller before return, BT_CONN_TX_SLICE
+		 * relies on it
+		 */
 		ret = btdrv_send(buf->data, buf->len, HCIT_ACLDATA);
 		break;
 	case BT_BUF_SCO_OUT:
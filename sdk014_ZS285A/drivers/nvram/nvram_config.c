@@ -63,6 +63,15 @@ struct __packed nvram_item {
 	char data[0];
 };
 
+#ifdef CONFIG_NVRAM_HASH_INDEX
+/* valid item of current segment, offset 0 is the header so means empty */
+struct item_index_entry
+{
+	u16_t hash;
+	u16_t offset;
+};
+#endif
+
 struct region_info
 {
 	struct device *storage;
@@ -85,6 +94,32 @@ struct region_info
 	u32_t *seg_item_map;
 	int seg_item_map_size;
 #endif
+
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	struct item_index_entry *item_index;
+	int item_index_size;
+	int item_index_cnt;
+	/* index is full, lookups fall back to scan until rebuilt */
+	u8_t item_index_overflow;
+#endif
+
+	/* bytes of obsolete items in current segment, reclaimed by purge */
+	u32_t seg_obsolete_size;
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	/* erase count of each segment, saved as NVRAM_ERASE_CNT_NAME item */
+	u32_t *seg_erase_cnt;
+	int seg_erase_cnt_num;
+	u8_t seg_erase_cnt_dirty;
+	/* segment erased ahead of purge, total_size if none */
+	u32_t seg_erased;
+#endif
+
+	/* statistics */
+	u32_t app_write_bytes;
+	u32_t flash_write_bytes;
+	u32_t erase_cnt;
+	u32_t purge_cnt;
 };
 
 /* region segment magic: 'NVRS' */
@@ -104,11 +139,36 @@ struct region_info
 
 #define NVRAM_SEG_ITEM_START_OFFSET	(ROUND_UP(sizeof(struct region_seg_header), NVRAM_ITEM_ALIGN_SIZE))
 
+#ifdef CONFIG_NVRAM_HASH_INDEX
+#define ITEM_INDEX_OFFSET_TO_SLOT(offset)	((offset) / NVRAM_ITEM_ALIGN_SIZE)
+#define ITEM_INDEX_SLOT_TO_OFFSET(slot)		((slot) * NVRAM_ITEM_ALIGN_SIZE)
+
+#if (CONFIG_NVRAM_USER_HASH_INDEX_SIZE & (CONFIG_NVRAM_USER_HASH_INDEX_SIZE - 1)) || \
+    (CONFIG_NVRAM_FACTORY_HASH_INDEX_SIZE & (CONFIG_NVRAM_FACTORY_HASH_INDEX_SIZE - 1))
+#error "NVRAM hash index size must be power of 2"
+#endif
+#endif
+
 
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 u32_t user_region_item_map[CONFIG_NVRAM_USER_REGION_SEGMENT_SIZE / NVRAM_ITEM_ALIGN_SIZE / 32];
 #endif
 
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+/* config item holding the erase counters of user region segments */
+#define NVRAM_ERASE_CNT_NAME		"NVRAM_SEG_ERASE_CNT"
+
+static u32_t user_region_seg_erase_cnt[CONFIG_NVRAM_GC_MAX_SEGMENTS];
+#endif
+
+#ifdef CONFIG_NVRAM_HASH_INDEX
+static struct item_index_entry user_region_item_index[CONFIG_NVRAM_USER_HASH_INDEX_SIZE];
+static struct item_index_entry factory_region_item_index[CONFIG_NVRAM_FACTORY_HASH_INDEX_SIZE];
+#ifdef CONFIG_NVRAM_STORAGE_FACTORY_RW_REGION
+static struct item_index_entry factory_rw_region_item_index[CONFIG_NVRAM_FACTORY_HASH_INDEX_SIZE];
+#endif
+#endif
+
 /* user config region */
 struct region_info user_nvram_region = {
 	.name = "User Config",
@@ -120,6 +180,14 @@ struct region_info user_nvram_region = {
 	.seg_item_map = user_region_item_map,
 	.seg_item_map_size = sizeof(user_region_item_map),
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	.item_index = user_region_item_index,
+	.item_index_size = ARRAY_SIZE(user_region_item_index),
+#endif
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	.seg_erase_cnt = user_region_seg_erase_cnt,
+	.seg_erase_cnt_num = ARRAY_SIZE(user_region_seg_erase_cnt),
+#endif
 };
 
 /* factory config region */
@@ -132,6 +200,10 @@ struct region_info factory_nvram_region = {
 	.seg_item_map = NULL,
 	.seg_item_map_size = 0,
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	.item_index = factory_region_item_index,
+	.item_index_size = ARRAY_SIZE(factory_region_item_index),
+#endif
 };
 
 #ifdef CONFIG_NVRAM_STORAGE_FACTORY_RW_REGION
@@ -147,6 +219,10 @@ struct region_info factory_rw_nvram_region = {
 	.seg_item_map = NULL,
 	.seg_item_map_size = 0,
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	.item_index = factory_rw_region_item_index,
+	.item_index_size = ARRAY_SIZE(factory_rw_region_item_index),
+#endif
 };
 #endif
 
@@ -158,6 +234,10 @@ static int region_write(struct region_info *region, u32_t offset, const u8_t *bu
 static int region_erase(struct region_info *region, u32_t offset, int size);
 static int region_copy(struct region_info *region, u32_t src_offset, u32_t dest_offset, int len);
 static int region_is_empy(struct region_info *region, u32_t offset, s32_t size);
+static int region_set(struct region_info *region, const char *name,
+	const void *data, int len);
+static int region_get(struct region_info *region, const char *name,
+	void *data, int max_len);
 
 static u8_t calc_hash(const u8_t *key, int len)
 {
@@ -223,6 +303,8 @@ static int region_write(struct region_info *region, u32_t offset,
 		return -EINVAL;
 	}
 
+	region->flash_write_bytes += len;
+
 	return nvram_storage_write(region->storage, region->base_addr + offset,
 		buf, len);
 }
@@ -301,6 +383,15 @@ static int region_erase(struct region_info *region, u32_t offset, int size)
 		if (!region_is_empy(region, offset, NVRAM_ERASE_ALIGN_SIZE)) {
 			nvram_storage_erase(region->storage, region->base_addr + offset,
 				NVRAM_ERASE_ALIGN_SIZE);
+
+			region->erase_cnt++;
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+			if (region->seg_erase_cnt &&
+			    offset / region->seg_size < region->seg_erase_cnt_num) {
+				region->seg_erase_cnt[offset / region->seg_size]++;
+				region->seg_erase_cnt_dirty = 1;
+			}
+#endif
 		}
 
 		offset += NVRAM_ERASE_ALIGN_SIZE;
@@ -463,6 +554,108 @@ static void item_bitmap_clear_all(unsigned int *seg_item_map, int item_map_size)
 }
 #endif
 
+#ifdef CONFIG_NVRAM_HASH_INDEX
+/*
+ * The 8-bit calc_hash() in item header is too weak to tell hundreds of
+ * names apart, index buckets use a 16-bit FNV-1a of the name instead.
+ */
+static u16_t calc_index_hash(const u8_t *key, int len)
+{
+	u32_t hash = 2166136261u;
+
+	while (len--) {
+		hash ^= *key++;
+		hash *= 16777619u;
+	}
+
+	return (u16_t)(hash ^ (hash >> 16));
+}
+
+static void item_index_clear_all(struct region_info *region)
+{
+	if (!region->item_index)
+		return;
+
+	memset(region->item_index, 0, region->item_index_size * sizeof(struct item_index_entry));
+	region->item_index_cnt = 0;
+	region->item_index_overflow = 0;
+}
+
+/* linear probing, item_index_size is power of 2 */
+static void item_index_add(struct region_info *region, u16_t hash, int offset)
+{
+	struct item_index_entry *entry;
+	int mask, i;
+
+	if (!region->item_index || region->item_index_overflow)
+		return;
+
+	/* keep load factor below 3/4 */
+	if ((region->item_index_cnt + 1) * 4 > region->item_index_size * 3) {
+		SYS_LOG_WRN("%s: item index full, fall back to scan", region->name);
+		region->item_index_overflow = 1;
+		return;
+	}
+
+	mask = region->item_index_size - 1;
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		entry = &region->item_index[i];
+		if (!entry->offset)
+			break;
+	}
+
+	entry->hash = hash;
+	entry->offset = ITEM_INDEX_OFFSET_TO_SLOT(offset);
+	region->item_index_cnt++;
+}
+
+static void item_index_del(struct region_info *region, u16_t hash, int offset)
+{
+	struct item_index_entry *entry;
+	int mask, i, j, home;
+	u16_t slot;
+
+	if (!region->item_index || region->item_index_overflow)
+		return;
+
+	mask = region->item_index_size - 1;
+	slot = ITEM_INDEX_OFFSET_TO_SLOT(offset);
+
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		entry = &region->item_index[i];
+		if (!entry->offset)
+			return;
+		if (entry->offset == slot)
+			break;
+	}
+
+	/* shift back later entries of the cluster, no tombstone needed */
+	for (j = (i + 1) & mask; region->item_index[j].offset; j = (j + 1) & mask) {
+		home = region->item_index[j].hash & mask;
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			region->item_index[i] = region->item_index[j];
+			i = j;
+		}
+	}
+
+	region->item_index[i].offset = 0;
+	region->item_index_cnt--;
+}
+
+/* index the valid item at offset of current segment, name is read again */
+static void item_index_add_item(struct region_info *region, int offset,
+				 struct nvram_item *item)
+{
+	if (!region->item_index || region->item_index_overflow)
+		return;
+
+	region_read(region, region->seg_offset + offset + sizeof(struct nvram_item),
+		nvram_buf, item->name_size);
+
+	item_index_add(region, calc_index_hash(nvram_buf, item->name_size), offset);
+}
+#endif
+
 
 static int item_is_empty(struct nvram_item *item)
 {
@@ -581,6 +774,48 @@ static int item_check_validity(struct region_info *region, int item_offs, struct
 	return ITEM_STATUS_VALID;
 }
 
+#ifdef CONFIG_NVRAM_HASH_INDEX
+static int region_find_item_indexed(struct region_info *region, const char *name,
+				struct nvram_item *item)
+{
+	struct item_index_entry *entry;
+	int name_size, mask, i;
+	u32_t item_offs;
+	u16_t hash;
+
+	name_size = strlen(name) + 1;
+	hash = calc_index_hash((const u8_t *)name, name_size);
+	mask = region->item_index_size - 1;
+
+	for (i = hash & mask; region->item_index[i].offset; i = (i + 1) & mask) {
+		entry = &region->item_index[i];
+		if (entry->hash != hash)
+			continue;
+
+		item_offs = region->seg_offset + ITEM_INDEX_SLOT_TO_OFFSET(entry->offset);
+
+		/* read item header */
+		region_read(region, item_offs, (u8_t *)item, sizeof(struct nvram_item));
+
+		if (item->magic != NVRAM_REGION_ITEM_MAGIC ||
+		    item->state != NVRAM_ITEM_STATE_VALID ||
+		    item->name_size != name_size)
+			continue;
+
+		/* read config name */
+		region_read(region, item_offs + sizeof(struct nvram_item),
+			nvram_buf, item->name_size);
+
+		if (!memcmp(name, (const char *)nvram_buf, item->name_size)) {
+			/* founded! */
+			return item_offs;
+		}
+	}
+
+	return -ENOENT;
+}
+#endif
+
 static int region_find_item(struct region_info *region, const char *name,
 				struct nvram_item *item)
 {
@@ -593,6 +828,11 @@ static int region_find_item(struct region_info *region, const char *name,
 
 	hash = calc_hash(name, strlen(name) + 1);
 
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	if (region->item_index && !region->item_index_overflow)
+		return region_find_item_indexed(region, name, item);
+#endif
+
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 	offs = item_bitmap_first_offset(region->seg_item_map, region->seg_size);
 #else
@@ -728,6 +968,9 @@ int region_copy_seg(struct region_info *region, u32_t new_seg_offset,
 	/* clear item bitmap for new segment */
 	item_bitmap_clear_all(region->seg_item_map, region->seg_item_map_size);
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	item_index_clear_all(region);
+#endif
 
 	item_offs = old_seg_offset + NVRAM_SEG_ITEM_START_OFFSET;
 	new_item_offs = new_seg_offset + NVRAM_SEG_ITEM_START_OFFSET;
@@ -758,6 +1001,9 @@ int region_copy_seg(struct region_info *region, u32_t new_seg_offset,
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 			item_bitmap_update(region->seg_item_map,
 				new_item_offs - new_seg_offset, 1);
+#endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+			item_index_add_item(region, new_item_offs - new_seg_offset, &item);
 #endif
 			new_item_offs += item_total_size;
 		}
@@ -792,25 +1038,140 @@ static int region_init_new_seg(struct region_info *region, u32_t seg_offset)
 	region->seg_seq_id = seg_hdr.seq_id;
 	region->seg_offset = seg_offset;
 	region->seg_write_offset = region->seg_offset + NVRAM_SEG_ITEM_START_OFFSET;
+	region->seg_obsolete_size = 0;
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	if (region->seg_erased == seg_offset)
+		region->seg_erased = region->total_size;
+#endif
 
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 	item_bitmap_clear_all(region->seg_item_map, region->seg_item_map_size);
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	item_index_clear_all(region);
+#endif
 
 	return 0;
 }
 
+static u32_t region_next_seg(struct region_info *region)
+{
+	u32_t offset = region->seg_offset + region->seg_size;
+
+	/* wrap to begin of region */
+	return (offset >= region->total_size) ? 0 : offset;
+}
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+static int region_seg_num(struct region_info *region)
+{
+	int seg_num = region->total_size / region->seg_size;
+
+	return min(seg_num, region->seg_erase_cnt_num);
+}
+
+/* counters must cover every segment, otherwise segments go in ring order */
+static bool region_wear_leveled(struct region_info *region)
+{
+	return region->seg_erase_cnt &&
+	       region->total_size / region->seg_size <= region->seg_erase_cnt_num;
+}
+
+/* erase count after use, one more unless it was erased ahead */
+static u32_t region_seg_cost(struct region_info *region, u32_t offset)
+{
+	return region->seg_erase_cnt[offset / region->seg_size] +
+	       (offset != region->seg_erased);
+}
+
+/* cheapest segment other than current one, erased ahead or next in ring if same */
+static u32_t region_pick_new_seg(struct region_info *region, u32_t next_seg_offset)
+{
+	u32_t offset, best, cost, best_cost;
+	int i, seg_num;
+
+	if (!region_wear_leveled(region))
+		return next_seg_offset;
+
+	seg_num = region_seg_num(region);
+	best = next_seg_offset;
+	best_cost = region_seg_cost(region, best);
+
+	for (i = 2; i < seg_num; i++) {
+		offset = (region->seg_offset + i * region->seg_size) % (seg_num * region->seg_size);
+		cost = region_seg_cost(region, offset);
+		if (cost < best_cost ||
+		    (cost == best_cost && offset == region->seg_erased)) {
+			best = offset;
+			best_cost = cost;
+		}
+	}
+
+	return best;
+}
+
+static void region_load_erase_cnt(struct region_info *region)
+{
+	if (!region->seg_erase_cnt)
+		return;
+
+	memset(region->seg_erase_cnt, 0, region->seg_erase_cnt_num * sizeof(u32_t));
+	region->seg_erase_cnt_dirty = 0;
+
+	if (!region_wear_leveled(region)) {
+		SYS_LOG_WRN("%s: %d segments, only %d erase counters, no wear leveling",
+			region->name, region->total_size / region->seg_size,
+			region->seg_erase_cnt_num);
+		return;
+	}
+
+	region_get(region, NVRAM_ERASE_CNT_NAME, region->seg_erase_cnt,
+		region_seg_num(region) * sizeof(u32_t));
+}
+
+/* outside of the write path, a purge for the counter item only dirties them again */
+static int region_save_erase_cnt(struct region_info *region)
+{
+	int err;
+
+	if (!region_wear_leveled(region) || !region->seg_erase_cnt_dirty)
+		return 0;
+
+	err = region_set(region, NVRAM_ERASE_CNT_NAME, region->seg_erase_cnt,
+		region_seg_num(region) * sizeof(u32_t));
+	if (!err)
+		region->seg_erase_cnt_dirty = 0;
+
+	return err;
+}
+
+/* erase ahead the segment next purge picks, to avoid erasing in system */
+static void region_erase_next_seg(struct region_info *region)
+{
+	u32_t offset;
+
+	if (!region_wear_leveled(region)) {
+		region_clear(region, region->total_size / 2);
+		return;
+	}
+
+	offset = region_pick_new_seg(region, region_next_seg(region));
+	region_erase(region, offset, region->seg_size);
+	region->seg_erased = offset;
+}
+#endif
+
 static int region_purge_seg(struct region_info *region, int check_crc)
 {
 	u32_t new_seg_offset, old_seg_offset, seg_copy_size;
 
 	SYS_LOG_DBG("purge seg offset 0x%x\n", region->seg_offset);
 
-	new_seg_offset = region->seg_offset + region->seg_size;
-	if (new_seg_offset >= region->total_size) {
-		/* wrap to begin of region */
-		new_seg_offset = 0;
-	}
+	new_seg_offset = region_next_seg(region);
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	new_seg_offset = region_pick_new_seg(region, new_seg_offset);
+#endif
 
 	/* check new seg */
 	if (!region_is_empy(region, new_seg_offset, region->seg_size)) {
@@ -831,6 +1192,8 @@ static int region_purge_seg(struct region_info *region, int check_crc)
 	/* current seg set to obsolete */
 	region_seg_update_state(region, old_seg_offset, NVRAM_REGION_SEG_STATE_OBSOLETE);
 
+	region->purge_cnt++;
+
 	return 0;
 }
 
@@ -838,6 +1201,12 @@ static int region_prepare_write_item(struct region_info *region, int item_size)
 {
 	if ((region->seg_write_offset + item_size) > (region->seg_offset + region->seg_size)) {
 		region_purge_seg(region, 0);
+
+		/* valid items alone fill the segment */
+		if ((region->seg_write_offset + item_size) > (region->seg_offset + region->seg_size)) {
+			SYS_LOG_ERR("no space for item size 0x%x\n", item_size);
+			return -ENOSPC;
+		}
 	}
 
 	return 0;
@@ -886,7 +1255,7 @@ static int region_set(struct region_info *region, const char *name,
 {
 	struct nvram_item item;
 	int32_t name_len, new_item_size, item_len;
-	int old_item_offs;
+	int old_item_offs, err;
 
 	if (!name || (!data && len) || len > NVRAM_MAX_DATA_SIZE)
 		return -EINVAL;
@@ -905,7 +1274,9 @@ static int region_set(struct region_info *region, const char *name,
 		/* write new config */
 		new_item_size = item_calc_aligned_size(name_len, len);
 
-		region_prepare_write_item(region, new_item_size);
+		err = region_prepare_write_item(region, new_item_size);
+		if (err)
+			return err;
 
 		old_item_offs = region_find_item(region, name, &item);
 
@@ -917,6 +1288,10 @@ static int region_set(struct region_info *region, const char *name,
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 		item_bitmap_update(region->seg_item_map,
 			region->seg_write_offset - region->seg_offset, 1);
+#endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+		item_index_add(region, calc_index_hash((const u8_t *)name, name_len),
+			region->seg_write_offset - region->seg_offset);
 #endif
 		region->seg_write_offset += new_item_size;
 	}
@@ -929,9 +1304,14 @@ static int region_set(struct region_info *region, const char *name,
 	if (old_item_offs > 0) {
 		/* set the old item state to obsolete */
 		item_update_state(region, old_item_offs, NVRAM_ITEM_STATE_OBSOLETE);
+		region->seg_obsolete_size += item_get_aligned_size(&item);
 
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 		item_bitmap_update(region->seg_item_map, old_item_offs - region->seg_offset, 0);
+#endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+		item_index_del(region, calc_index_hash((const u8_t *)name, name_len),
+			old_item_offs - region->seg_offset);
 #endif
 	}
 
@@ -1001,6 +1381,24 @@ static void region_dump(struct region_info *region, int detailed)
 		region->seg_offset, region->seg_size, region->seg_seq_id,
 		region->seg_write_offset);
 
+	printk("region obsolete 0x%x, erase %d, purge %d, app write 0x%x, flash write 0x%x",
+		region->seg_obsolete_size, region->erase_cnt, region->purge_cnt,
+		region->app_write_bytes, region->flash_write_bytes);
+	if (region->app_write_bytes) {
+		i = (u64_t)region->flash_write_bytes * 100 / region->app_write_bytes;
+		printk(", write amplification %d.%02d", i / 100, i % 100);
+	}
+	printk("\n");
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	if (region->seg_erase_cnt) {
+		printk("region segment erase count:");
+		for (i = 0; i < region_seg_num(region); i++)
+			printk(" %d", region->seg_erase_cnt[i]);
+		printk("\n");
+	}
+#endif
+
 	if (!detailed)
 		return;
 
@@ -1077,6 +1475,11 @@ static int region_seg_scan(struct region_info *region)
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 	item_bitmap_clear_all(region->seg_item_map, region->seg_item_map_size);
 #endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+	item_index_clear_all(region);
+#endif
+
+	region->seg_obsolete_size = 0;
 
 	offs = NVRAM_SEG_ITEM_START_OFFSET;
 	item_offs = region->seg_offset + offs;
@@ -1096,10 +1499,15 @@ static int region_seg_scan(struct region_info *region)
 		if (status == ITEM_STATUS_VALID) {
 #ifdef CONFIG_NVRAM_FAST_SEARCH
 			item_bitmap_update(region->seg_item_map, offs, 1);
+#endif
+#ifdef CONFIG_NVRAM_HASH_INDEX
+			item_index_add_item(region, offs, &item);
 #endif
 		} else if (status == ITEM_STATUS_EMPTY) {
 			break;
-		} else if (status != ITEM_STATUS_OBSOLETE) {
+		} else if (status == ITEM_STATUS_OBSOLETE) {
+			region->seg_obsolete_size += item_get_aligned_size(&item);
+		} else {
 			/* invalid */
 			SYS_LOG_ERR("found invalid item, need purge, item_offs 0x%x status %d",
 				    item_offs, status);
@@ -1126,6 +1534,10 @@ static int region_seg_scan(struct region_info *region)
 		}
 	}
 
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	region_load_erase_cnt(region);
+#endif
+
 	if (need_purge) {
 		region_purge_seg(region, 1);
 	}
@@ -1139,6 +1551,10 @@ static int region_scan(struct region_info *region)
 	u32_t offs = 0;
 	int err, found = 0;
 
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	region->seg_erased = region->total_size;
+#endif
+
 	while (offs < region->total_size) {
 		err = region_read(region, offs, (u8_t *)&hdr, sizeof(struct region_seg_header));
 		if (err) {
@@ -1171,11 +1587,209 @@ static int region_scan(struct region_info *region)
 	return 0;
 }
 
+#if defined(CONFIG_NVRAM_WRITE_BACK) || defined(CONFIG_NVRAM_BACKGROUND_GC)
+static struct k_delayed_work nvram_work;
+#endif
+
+#ifdef CONFIG_NVRAM_WRITE_BACK
+/*
+ * Deferred write journal of user region, one entry per key: a repeated
+ * set replaces the pending entry, data_size 0 means deleted.
+ */
+struct __packed wb_entry {
+	u8_t name_size;
+	u8_t reserved;
+	u16_t data_size;
+	char data[0];
+};
+
+static u8_t wb_buf[CONFIG_NVRAM_WRITE_BACK_BUF_SIZE] __aligned(4);
+static int wb_used;
+static u32_t wb_coalesce_cnt;
+static u32_t wb_flush_cnt;
+
+static int wb_entry_size(int name_size, int data_size)
+{
+	return ROUND_UP(sizeof(struct wb_entry) + name_size + data_size, 4);
+}
+
+static struct wb_entry *wb_find(const char *name, int name_size)
+{
+	struct wb_entry *entry;
+	int offs;
+
+	for (offs = 0; offs < wb_used; offs += wb_entry_size(entry->name_size, entry->data_size)) {
+		entry = (struct wb_entry *)&wb_buf[offs];
+		if (entry->name_size == name_size && !memcmp(entry->data, name, name_size))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void wb_remove(struct wb_entry *entry)
+{
+	int offs = (u8_t *)entry - wb_buf;
+	int size = wb_entry_size(entry->name_size, entry->data_size);
+
+	memmove(&wb_buf[offs], &wb_buf[offs + size], wb_used - offs - size);
+	wb_used -= size;
+}
+
+/* failed entries stay in the journal, returns the first error */
+static int wb_flush(void)
+{
+	struct wb_entry *entry;
+	int offs, size, kept = 0;
+	int err, ret = 0;
+
+	for (offs = 0; offs < wb_used; offs += size) {
+		entry = (struct wb_entry *)&wb_buf[offs];
+		size = wb_entry_size(entry->name_size, entry->data_size);
+
+		err = region_set(&user_nvram_region, entry->data,
+			entry->data + entry->name_size, entry->data_size);
+		if (err) {
+			SYS_LOG_ERR("flush '%s' failed %d", entry->data, err);
+			if (!ret)
+				ret = err;
+			memmove(&wb_buf[kept], entry, size);
+			kept += size;
+		}
+	}
+
+	if (wb_used)
+		wb_flush_cnt++;
+
+	wb_used = kept;
+
+	return ret;
+}
+
+static int wb_set(const char *name, const void *data, int len)
+{
+	struct wb_entry *entry;
+	int name_size, size, err;
+
+	if (!name || (!data && len) || len > NVRAM_MAX_DATA_SIZE)
+		return -EINVAL;
+
+	name_size = strlen(name) + 1;
+	if (name_size > NVRAM_MAX_NAME_SIZE)
+		return -EINVAL;
+
+	entry = wb_find(name, name_size);
+	if (entry) {
+		wb_remove(entry);
+		wb_coalesce_cnt++;
+	}
+
+	size = wb_entry_size(name_size, len);
+	if (size > sizeof(wb_buf) - wb_used) {
+		err = wb_flush();
+
+		/* no room left by failed entries, or larger than the journal */
+		if (size > sizeof(wb_buf) - wb_used)
+			return err ? err : region_set(&user_nvram_region, name, data, len);
+	}
+
+	entry = (struct wb_entry *)&wb_buf[wb_used];
+	entry->name_size = name_size;
+	entry->reserved = 0;
+	entry->data_size = len;
+	memcpy(entry->data, name, name_size);
+	memcpy(entry->data + name_size, data, len);
+	wb_used += size;
+
+	if (!k_delayed_work_remaining_get(&nvram_work))
+		k_delayed_work_submit(&nvram_work, CONFIG_NVRAM_WRITE_BACK_DELAY);
+
+	return 0;
+}
+
+/* -ENOENT if deleted, -EAGAIN if not in journal */
+static int wb_get(const char *name, void *data, int max_len)
+{
+	struct wb_entry *entry;
+
+	entry = wb_find(name, strlen(name) + 1);
+	if (!entry)
+		return -EAGAIN;
+
+	if (!entry->data_size)
+		return -ENOENT;
+
+	if (max_len > entry->data_size)
+		max_len = entry->data_size;
+
+	memcpy(data, entry->data + entry->name_size, max_len);
+
+	return max_len;
+}
+#endif
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+/* purge current segment early if free space is low and enough is obsolete */
+static bool region_need_gc(struct region_info *region)
+{
+	u32_t free_size, threshold;
+
+	free_size = region->seg_offset + region->seg_size - region->seg_write_offset;
+	threshold = region->seg_size * CONFIG_NVRAM_GC_FREE_PERCENT / 100;
+
+	return (free_size < threshold && region->seg_obsolete_size >= threshold);
+}
+#endif
+
+#if defined(CONFIG_NVRAM_WRITE_BACK) || defined(CONFIG_NVRAM_BACKGROUND_GC)
+static void nvram_work_handler(struct k_work *work)
+{
+	k_sem_take(&nvram_lock, K_FOREVER);
+
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	wb_flush();
+#endif
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	if (region_need_gc(&user_nvram_region)) {
+		SYS_LOG_INF("gc seg offset 0x%x, obsolete 0x%x",
+			user_nvram_region.seg_offset, user_nvram_region.seg_obsolete_size);
+		region_purge_seg(&user_nvram_region, 0);
+	}
+
+	region_save_erase_cnt(&user_nvram_region);
+#endif
+
+	k_sem_give(&nvram_lock);
+}
+#endif
+
+int nvram_config_sync(void)
+{
+	int ret = 0;
+
+	k_sem_take(&nvram_lock, K_FOREVER);
+
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	ret = wb_flush();
+#endif
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	if (!ret)
+		ret = region_save_erase_cnt(&user_nvram_region);
+#endif
+
+	k_sem_give(&nvram_lock);
+
+	return ret;
+}
+
 int nvram_config_set_factory(const char *name, const void *data, int len)
 {
 #ifdef CONFIG_NVRAM_STORAGE_FACTORY_RW_REGION
+	factory_rw_nvram_region.app_write_bytes += len;
 	return region_set(&factory_rw_nvram_region, name ,data, len);
 #else
+	factory_nvram_region.app_write_bytes += len;
 	return region_set(&factory_nvram_region, name ,data, len);
 #endif
 }
@@ -1186,8 +1800,21 @@ int nvram_config_set(const char *name, const void *data, int len)
 
 	k_sem_take(&nvram_lock, K_FOREVER);
 
+	user_nvram_region.app_write_bytes += len;
+
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	ret = wb_set(name, data, len);
+#else
 	ret = region_set(&user_nvram_region, name, data, len);
-	
+#endif
+
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	/* gc, or save the counters of a purge done by this set */
+	if ((region_need_gc(&user_nvram_region) || user_nvram_region.seg_erase_cnt_dirty) &&
+	    !k_delayed_work_remaining_get(&nvram_work))
+		k_delayed_work_submit(&nvram_work, 0);
+#endif
+
 	k_sem_give(&nvram_lock);
 
 	return ret;
@@ -1212,8 +1839,15 @@ int nvram_config_get(const char *name, void *data, int max_len)
 	k_sem_take(&nvram_lock, K_FOREVER);
 
 	/* config priority: user > factory rw >  factory ro */
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	/* pending write first, deleted one falls back to factory */
+	ret = wb_get(name, data, max_len);
+	if (ret == -EAGAIN)
+		ret = region_get(&user_nvram_region, name, data, max_len);
+#else
 	/* search user nvram region */
 	ret = region_get(&user_nvram_region, name, data, max_len);
+#endif
 	if (ret >= 0){
 		k_sem_give(&nvram_lock);
 		return ret;
@@ -1243,6 +1877,11 @@ void nvram_config_dump(void)
 #endif
 	region_dump(&factory_nvram_region, 1);
 	region_dump(&user_nvram_region, 1);
+
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	printk("write back: pending 0x%x bytes, coalesced %d, flushed %d\n",
+		wb_used, wb_coalesce_cnt, wb_flush_cnt);
+#endif
 }
 
 int nvram_config_clear(int len)
@@ -1258,6 +1897,10 @@ int nvram_config_clear_all(void)
 
 	k_sem_take(&nvram_lock, K_FOREVER);
 
+#ifdef CONFIG_NVRAM_WRITE_BACK
+	wb_used = 0;
+#endif
+
 	/* erase region */
 	region_erase(region, 0, region->total_size);
 
@@ -1321,7 +1964,15 @@ int nvram_config_init(struct device *dev)
 	region_scan(&user_nvram_region);
 
 	/* clear next write regtion to avoid erasing in system */
+#ifdef CONFIG_NVRAM_BACKGROUND_GC
+	region_erase_next_seg(&user_nvram_region);
+#else
 	region_clear(&user_nvram_region, user_nvram_region.total_size / 2);
+#endif
+
+#if defined(CONFIG_NVRAM_WRITE_BACK) || defined(CONFIG_NVRAM_BACKGROUND_GC)
+	k_delayed_work_init(&nvram_work, nvram_work_handler);
+#endif
 
 	return 0;
 }
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <misc/dlist.h>
 #include <mem_manager.h>
 #include <property_inner.h>
 #define SYS_LOG_DOMAIN "property"
@@ -20,82 +21,183 @@
 #endif
 #include <logging/sys_log.h>
 
-#define MAX_NVRAM_ITEM_CACHE_NUM 10
+/* power of 2 */
+#define PROPERTY_CACHE_HASH_SIZE 32
 
+/*
+ * One allocation per item: header, name and data. Items are in a hash
+ * chain, in the lru list (least recently used first) and, when dirty,
+ * in the dirty list, oldest write first.
+ */
 struct cahce_item_data {
-	char *name;
-	char *data;
+	sys_dnode_t lru_node;
+	sys_dnode_t dirty_node;
+	struct cahce_item_data *hash_next;
+	u32_t hash;
 	u32_t data_len:16;
-	u32_t used_flag:2;
+	u32_t dirty:1;
 	u32_t flush_req:1;
+	char name[0];
 };
 
-OS_MUTEX_DEFINE(nvram_cache_mutex);
+struct property_cache_stat {
+	u32_t hit_cnt;
+	u32_t miss_cnt;
+	u32_t evict_cnt;
+	u32_t write_back_cnt;
+};
 
-static struct cahce_item_data globle_property_cache[MAX_NVRAM_ITEM_CACHE_NUM];
+OS_MUTEX_DEFINE(nvram_cache_mutex);
 
+static struct cahce_item_data *property_cache_hash[PROPERTY_CACHE_HASH_SIZE];
+static sys_dlist_t property_cache_lru;
+static sys_dlist_t property_cache_dirty;
+static int property_cache_size;
+static struct property_cache_stat property_cache_stat;
 
-static struct cahce_item_data *find_property_cache(const char *name)
+static u32_t property_name_hash(const char *name)
 {
-	int i;
-	struct cahce_item_data *item = NULL;
+	u32_t hash = 2166136261u;
 
-	for (i = 0; i < MAX_NVRAM_ITEM_CACHE_NUM; i++) {
-		item = &globle_property_cache[i];
-		if (item->used_flag && !memcmp(item->name, name, strlen(name))) {
-			SYS_LOG_INF(" %d %s\n", i, item->name);
-			return item;
-		}
+	while (*name) {
+		hash ^= (u8_t)*name++;
+		hash *= 16777619u;
 	}
-	return NULL;
+
+	return hash;
 }
 
-static struct cahce_item_data *get_property_cache(const char *name, int len)
+static int property_item_size(int name_len, int data_len)
 {
-	int i;
-	struct cahce_item_data *item = NULL;
+	return sizeof(struct cahce_item_data) + name_len + 1 + data_len;
+}
 
-	for (i = 0; i < MAX_NVRAM_ITEM_CACHE_NUM; i++) {
-		item = &globle_property_cache[i];
-		if (!item->used_flag) {
-			item->name = mem_malloc(strlen(name) + 1);
-			if (!item->name) {
-				item = NULL;
-				goto exit;
-			}
-			memset(item->name, 0, strlen(name) + 1);
-			item->data = mem_malloc(len);
-			if (!item->data) {
-				mem_free(item->name);
-				item = NULL;
-				goto exit;
-			}
-			memset(item->data, 0, len);
-exit:
-			return item;
-		}
+static char *property_item_data(struct cahce_item_data *item)
+{
+	return item->name + strlen(item->name) + 1;
+}
+
+static struct cahce_item_data **find_property_slot(const char *name, u32_t hash)
+{
+	struct cahce_item_data **slot;
+
+	slot = &property_cache_hash[hash & (PROPERTY_CACHE_HASH_SIZE - 1)];
+	for (; *slot; slot = &(*slot)->hash_next) {
+		if ((*slot)->hash == hash && !strcmp((*slot)->name, name))
+			break;
 	}
-	return NULL;
+
+	return slot;
 }
 
-static int put_property_cache(struct cahce_item_data *item)
+static struct cahce_item_data *find_property_cache(const char *name)
 {
+	struct cahce_item_data *item;
+
+	item = *find_property_slot(name, property_name_hash(name));
 	if (item) {
-		if (item->data) {
-			mem_free(item->data);
-		}
-		if (item->name) {
-			mem_free(item->name);
-		}
-		item->data = NULL;
-		item->name = NULL;
-		item->used_flag = 0;
-		item->data_len = 0;
-		item->flush_req = 0;
+		/* move to most recently used */
+		sys_dlist_remove(&item->lru_node);
+		sys_dlist_append(&property_cache_lru, &item->lru_node);
 	}
+
+	return item;
+}
+
+static void set_property_dirty(struct cahce_item_data *item, bool dirty)
+{
+	if (item->dirty)
+		sys_dlist_remove(&item->dirty_node);
+
+	item->dirty = dirty;
+	item->flush_req = 0;
+
+	if (dirty)
+		sys_dlist_append(&property_cache_dirty, &item->dirty_node);
+}
+
+static int put_property_cache(struct cahce_item_data *item)
+{
+	struct cahce_item_data **slot;
+
+	slot = find_property_slot(item->name, item->hash);
+	*slot = item->hash_next;
+
+	set_property_dirty(item, false);
+	sys_dlist_remove(&item->lru_node);
+
+	property_cache_size -= property_item_size(strlen(item->name), item->data_len);
+	mem_free(item);
+
 	return 0;
 }
 
+static int write_back_property_cache(struct cahce_item_data *item)
+{
+	int ret;
+
+	ret = nvram_config_set(item->name, property_item_data(item), item->data_len);
+	if (!ret) {
+		set_property_dirty(item, false);
+		property_cache_stat.write_back_cnt++;
+	}
+
+	return ret;
+}
+
+/* evict least recently used items, dirty ones are written back first */
+static int shrink_property_cache(int size)
+{
+	struct cahce_item_data *item, *next;
+
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&property_cache_lru, item, next, lru_node) {
+		if (property_cache_size + size <= CONFIG_PROPERTY_CACHE_SIZE)
+			break;
+
+		if (item->dirty && write_back_property_cache(item))
+			continue;
+
+		put_property_cache(item);
+		property_cache_stat.evict_cnt++;
+	}
+
+	return (property_cache_size + size <= CONFIG_PROPERTY_CACHE_SIZE) ? 0 : -ENOMEM;
+}
+
+static struct cahce_item_data *get_property_cache(const char *name, const void *data, int len)
+{
+	struct cahce_item_data *item;
+	struct cahce_item_data **slot;
+	int name_len = strlen(name);
+	int size = property_item_size(name_len, len);
+
+	/* never fits, keep the cache as it is */
+	if (size > CONFIG_PROPERTY_CACHE_SIZE)
+		return NULL;
+
+	if (shrink_property_cache(size))
+		return NULL;
+
+	item = mem_malloc(size);
+	if (!item)
+		return NULL;
+
+	memset(item, 0, sizeof(struct cahce_item_data));
+	memcpy(item->name, name, name_len + 1);
+	memcpy(property_item_data(item), data, len);
+	item->data_len = len;
+	item->hash = property_name_hash(name);
+
+	slot = find_property_slot(name, item->hash);
+	item->hash_next = *slot;
+	*slot = item;
+
+	sys_dlist_append(&property_cache_lru, &item->lru_node);
+	property_cache_size += size;
+
+	return item;
+}
+
 int property_cache_get(const char *name, void *data, int len)
 {
 	int read_len = 0;
@@ -112,10 +214,16 @@ int property_cache_get(const char *name, void *data, int len)
 		} else {
 			read_len = item->data_len;
 		}
-		memcpy(data, item->data, read_len);
+		memcpy(data, property_item_data(item), read_len);
+		property_cache_stat.hit_cnt++;
 	} else {
 		/** read from nvram*/
 		read_len = nvram_config_get(name, data, len);
+		property_cache_stat.miss_cnt++;
+
+		/* only a value shorter than buffer is known to be complete */
+		if (read_len > 0 && read_len < len)
+			get_property_cache(name, data, read_len);
 	}
 
 	os_mutex_unlock(&nvram_cache_mutex);
@@ -132,33 +240,24 @@ int property_cache_set(const char *name, const void *data, int len)
 
 	item = find_property_cache(name);
 	/**write to old nvram cache */
-	if (item) {
-		if (item->data_len == len) {
-			memcpy(item->data, data, len);
-			ret = 0;
-		} else {
-			void *old_data = item->data;
-
-			item->data = mem_malloc(len);
-			memcpy(item->data, data, len);
-			item->data_len = len;
-			ret = 0;
-			if (old_data)
-				mem_free(old_data);
+	if (item && item->data_len == len && len > 0) {
+		if (memcmp(property_item_data(item), data, len)) {
+			memcpy(property_item_data(item), data, len);
+			set_property_dirty(item, true);
 		}
 		goto exit;
 	}
 
-	/**write to new nvram cache */
-	item = get_property_cache(name, len);
-	if (item) {
-		/** new item */
-		memcpy(item->name, name, strlen(name));
-		memcpy(item->data, data, len);
-		item->data_len = len;
-		item->used_flag = 1;
-		ret = 0;
-		goto exit;
+	if (item)
+		put_property_cache(item);
+
+	/**write to new nvram cache, delete goes to nvram directly */
+	if (len > 0) {
+		item = get_property_cache(name, data, len);
+		if (item) {
+			set_property_dirty(item, true);
+			goto exit;
+		}
 	}
 
 	/** direct write to nvram*/
@@ -172,19 +271,17 @@ exit:
 
 int property_cache_flush(const char *name)
 {
-	int i;
-	struct cahce_item_data *item = NULL;
+	struct cahce_item_data *item, *next;
 
 	os_mutex_lock(&nvram_cache_mutex, OS_FOREVER);
 
-	for (i = 0; i < MAX_NVRAM_ITEM_CACHE_NUM; i++) {
-		item = &globle_property_cache[i];
-		if (item->used_flag &&
-	     ((!name) || memcmp(item->name, name, strlen(name)) == 0)) {
-			if (!nvram_config_set(item->name, item->data, item->data_len)) {
-				put_property_cache(item);
-				item->flush_req = false;
-			}
+	if (name) {
+		item = *find_property_slot(name, property_name_hash(name));
+		if (item && item->dirty)
+			write_back_property_cache(item);
+	} else {
+		SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&property_cache_dirty, item, next, dirty_node) {
+			write_back_property_cache(item);
 		}
 	}
 
@@ -196,15 +293,16 @@ int property_cache_flush(const char *name)
 
 int property_cache_flush_req(const char *name)
 {
-	int i;
-	struct cahce_item_data *item = NULL;
+	struct cahce_item_data *item;
 
 	os_mutex_lock(&nvram_cache_mutex, OS_FOREVER);
 
-	for (i = 0; i < MAX_NVRAM_ITEM_CACHE_NUM; i++) {
-		item = &globle_property_cache[i];
-		if (item->used_flag &&
-	     ((!name) || memcmp(item->name, name, strlen(name)) == 0)) {
+	if (name) {
+		item = *find_property_slot(name, property_name_hash(name));
+		if (item && item->dirty)
+			item->flush_req = true;
+	} else {
+		SYS_DLIST_FOR_EACH_CONTAINER(&property_cache_dirty, item, dirty_node) {
 			item->flush_req = true;
 		}
 	}
@@ -215,31 +313,55 @@ int property_cache_flush_req(const char *name)
 	return 0;
 }
 
+/* write requested dirty items as one batch */
 int property_cache_flush_req_deal(void)
 {
-	int i;
-	struct cahce_item_data *item = NULL;
+	struct cahce_item_data *item, *next;
+	int cnt = 0;
 
 	os_mutex_lock(&nvram_cache_mutex, OS_FOREVER);
 
-	for (i = 0; i < MAX_NVRAM_ITEM_CACHE_NUM; i++) {
-		item = &globle_property_cache[i];
-		if (item->used_flag && item->flush_req) {
-			if (!nvram_config_set(item->name, item->data, item->data_len)) {
-				put_property_cache(item);
-			}
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&property_cache_dirty, item, next, dirty_node) {
+		if (item->flush_req) {
+			write_back_property_cache(item);
 			item->flush_req = false;
+			cnt++;
 		}
 	}
 
 	os_mutex_unlock(&nvram_cache_mutex);
 
-	SYS_LOG_INF("flush ok\n");
+	SYS_LOG_INF("flush %d ok\n", cnt);
 	return 0;
 }
 
+void property_cache_dump(void)
+{
+	struct cahce_item_data *item;
+	int cnt = 0, dirty_cnt = 0;
+
+	os_mutex_lock(&nvram_cache_mutex, OS_FOREVER);
+
+	SYS_DLIST_FOR_EACH_CONTAINER(&property_cache_lru, item, lru_node) {
+		cnt++;
+		dirty_cnt += item->dirty;
+	}
+
+	printk("property cache: %d items, %d dirty, %d/%d bytes\n", cnt, dirty_cnt,
+		property_cache_size, CONFIG_PROPERTY_CACHE_SIZE);
+	printk("property cache: hit %d miss %d evict %d write back %d\n",
+		property_cache_stat.hit_cnt, property_cache_stat.miss_cnt,
+		property_cache_stat.evict_cnt, property_cache_stat.write_back_cnt);
+
+	os_mutex_unlock(&nvram_cache_mutex);
+}
+
 int property_cache_init(void)
 {
-	memset(globle_property_cache, 0, sizeof(globle_property_cache));
+	memset(property_cache_hash, 0, sizeof(property_cache_hash));
+	memset(&property_cache_stat, 0, sizeof(property_cache_stat));
+	sys_dlist_init(&property_cache_lru);
+	sys_dlist_init(&property_cache_dirty);
+	property_cache_size = 0;
 	return 0;
 }
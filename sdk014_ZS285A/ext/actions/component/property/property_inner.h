@@ -29,6 +29,8 @@ int property_cache_flush_req_deal(void);
 
 int property_cache_init(void);
 
+void property_cache_dump(void);
+
 #endif
 
 #endif
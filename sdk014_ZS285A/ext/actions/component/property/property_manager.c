@@ -175,6 +175,9 @@ int property_flush(const char *key)
 {
 #ifdef CONFIG_PROPERTY_CACHE
 	property_cache_flush(key);
+#endif
+#ifdef CONFIG_NVRAM_CONFIG
+	nvram_config_sync();
 #endif
 	return 0;
 }
@@ -160,6 +160,10 @@ static bool app_manager_init_app(struct app_entry_t *app, bool create_thread)
 
 	sys_slist_append(&global_app_list, (sys_snode_t *)appinfo);
 
+	if (create_thread) {
+		mem_magazine_attach(appinfo->tid);
+	}
+
 	if (!msg_manager_add_listener(appinfo->name, appinfo->tid)) {
 		SYS_LOG_ERR("%s add listener failed\n", appinfo->name);
 		goto exit_failed;
@@ -241,6 +245,9 @@ bool app_manager_thread_exit(char *app_name)
 
 	sys_slist_find_and_remove(&global_app_list, (sys_snode_t *)appinfo);
 
+	/* the app thread is stopping or gone, give its cached blocks back */
+	mem_magazine_detach(appinfo->tid);
+
 	if (!msg_manager_remove_listener(appinfo->name)) {
 		SYS_LOG_ERR("%s remove listener failed\n", appinfo->name);
 		goto exit;
@@ -111,6 +111,9 @@ static bool srv_manager_init_service(struct service_entry_t *srv)
 
 		sys_slist_append(&global_srv_list, (sys_snode_t *)srvinfo);
 
+		/* services are hot mem_malloc users, recycle blocks per thread */
+		mem_magazine_attach(srvinfo->tid);
+
 		if (!msg_manager_add_listener(srvinfo->name, srvinfo->tid)) {
 			SYS_LOG_ERR(" %s add listener failed\n",
 							srvinfo->name);
@@ -172,6 +175,8 @@ bool srv_manager_thread_exit(char *srv_name)
 
 	sys_slist_find_and_remove(&global_srv_list, (sys_snode_t *)srvinfo);
 
+	mem_magazine_detach(srvinfo->tid);
+
 	if (!msg_manager_remove_listener(srvinfo->name)) {
 		SYS_LOG_ERR(" %s remove listener failed\n", srvinfo->name);
 		goto exit;
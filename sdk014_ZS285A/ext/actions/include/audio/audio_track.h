@@ -100,6 +100,29 @@ int audio_track_resume(struct audio_track_t *handle);
  * @return len of write datas
  */
 int audio_track_write(struct audio_track_t *handle, unsigned char *buf, int num);
+/**
+ * @brief Claim space of audio track to write data in place
+ *
+ * This routine claim free space of audio track pcm stream, so decoder can
+ * output pcm directly into track without copy. Data must be published by
+ * audio_track_write_commit.
+ *
+ * @param handle handle of track
+ * @param buf store pointer to the claimed space
+ * @param num number of bytes want to write
+ *
+ * @return len of claimed space, may be less than num
+ */
+int audio_track_write_claim(struct audio_track_t *handle, unsigned char **buf, int num);
+/**
+ * @brief Commit data written to claimed space of audio track
+ *
+ * @param handle handle of track
+ * @param num number of bytes written to the claimed space
+ *
+ * @return len of committed datas
+ */
+int audio_track_write_commit(struct audio_track_t *handle, int num);
 /**
  * @brief flush Audio Track data
  *
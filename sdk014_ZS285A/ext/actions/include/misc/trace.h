@@ -25,6 +25,8 @@ int trace_irq_print_set(unsigned int irq_enable);
 
 int trace_dma_print_set(unsigned int dma_enable);
 
+int trace_binary_log_set(unsigned int binary_enable);
+
 #ifdef CONFIG_TRACE_EVENT
 
 /* task trace function */
@@ -35,6 +37,8 @@ extern void _trace_malloc(uint32_t address, uint32_t malloc_size, uint32_t calle
 
 extern void _trace_free(uint32_t address, uint32_t caller);
 
+extern void _trace_buddy(uint32_t info, uint32_t address, uint32_t size, uint32_t caller, uint32_t thread);
+
 /* task trace */
 #define TRACE_TASK_SWITCH(from, to)                    _trace_task_switch(from, to)
 
@@ -44,6 +48,9 @@ extern void _trace_free(uint32_t address, uint32_t caller);
 
 #define TRACE_FREE(address, caller)                    _trace_free(address, caller) 
 
+/* heap alloc trace, info is type | buddy_no << 8 | prio << 16 */
+#define TRACE_BUDDY(info, address, size, caller, thread) _trace_buddy(info, address, size, caller, thread)
+
 #else
 
 /* task trace */
@@ -54,6 +61,8 @@ extern void _trace_free(uint32_t address, uint32_t caller);
 
 #define TRACE_FREE(address, caller)  
 
+#define TRACE_BUDDY(info, address, size, caller, thread)
+
 #endif
 
 
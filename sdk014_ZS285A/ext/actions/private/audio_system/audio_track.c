@@ -678,6 +678,27 @@ int audio_track_write(struct audio_track_t *handle, unsigned char *buf, int num)
 	return ret;
 }
 
+int audio_track_write_claim(struct audio_track_t *handle, unsigned char **buf, int num)
+{
+	assert(handle && handle->audio_stream);
+
+	return stream_write_claim(handle->audio_stream, buf, num);
+}
+
+int audio_track_write_commit(struct audio_track_t *handle, int num)
+{
+	int ret = 0;
+
+	assert(handle && handle->audio_stream);
+
+	ret = stream_write_commit(handle->audio_stream, num);
+	if (ret != num) {
+		SYS_LOG_WRN(" %d %d\n", ret, num);
+	}
+
+	return ret;
+}
+
 int audio_track_flush(struct audio_track_t *handle)
 {
 	int try_cnt = 0;
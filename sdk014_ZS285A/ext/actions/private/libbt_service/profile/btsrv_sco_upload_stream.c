@@ -165,6 +165,66 @@ static int sco_upload_stream_send_direct(io_stream_t handle, unsigned char *buf,
 
 	return len;
 }
+
+static int sco_upload_stream_write_claim(io_stream_t handle, unsigned char **buf, int len)
+{
+	sco_upload_info_t *info = (sco_upload_info_t *)handle->data;
+	u8_t *p_buf;
+
+	if (!info)
+		return -EACCES;
+
+	p_buf = info->payload;
+
+	/**encoder output directly into payload, skip msbc head flag */
+	if (info->codec_type == MSBC_TYPE) {
+		*buf = &p_buf[2];
+		return min(len, info->payload_size - 1);
+	}
+
+	*buf = &p_buf[info->payload_offset];
+	return min(len, info->payload_size - info->payload_offset);
+}
+
+static int sco_upload_stream_write_commit(io_stream_t handle, int len)
+{
+	struct bt_conn *conn = btsrv_sco_get_conn();
+	sco_upload_info_t *info = (sco_upload_info_t *)handle->data;
+	int ret = 0;
+	u8_t *p_buf;
+
+	if (!info)
+		return -EACCES;
+
+	if (system_check_low_latencey_mode()) {
+		if(info->drop_cnt < 3) {
+			info->drop_cnt++;
+			return len;
+		}
+	}
+
+	p_buf = info->payload;
+
+	if (info->codec_type == MSBC_TYPE) {
+		p_buf[0] = 0x01;
+		p_buf[1] = _sco_upload_get_msbc_seq_num(info);
+		/**pending data*/
+		p_buf[2 + len] = 0;
+		info->payload_offset = 2 + len + 1;
+	} else {
+		info->payload_offset += len;
+	}
+
+	if (info->codec_type == MSBC_TYPE || info->payload_offset == info->payload_size) {
+		ret = hostif_bt_conn_send_sco_data(conn, p_buf, info->payload_offset);
+		if (ret) {
+			SYS_LOG_WRN("sco send failed ret %d\n", ret);
+		}
+		info->payload_offset = 0;
+	}
+
+	return len;
+}
 #endif
 
 int sco_upload_stream_write(io_stream_t handle, unsigned char *buf, int len)
@@ -328,6 +388,10 @@ const stream_ops_t sco_upload_stream_ops = {
 	.write = sco_upload_stream_write,
 	.close = sco_upload_stream_close,
 	.destroy = sco_upload_stream_destroy,
+#ifndef SCO_SEND_USED_WORKQUEUE
+	.write_claim = sco_upload_stream_write_claim,
+	.write_commit = sco_upload_stream_write_commit,
+#endif
 };
 
 io_stream_t sco_upload_stream_create(u8_t hfp_codec_id)
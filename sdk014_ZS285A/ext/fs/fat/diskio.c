@@ -222,6 +222,33 @@ DRESULT disk_ioctl (
 	return ret;
 }
 
+#ifdef CONFIG_DISKIO_CACHE
+/*-----------------------------------------------------------------------*/
+/* Tell the cache where FAT and data area of a mounted volume are       */
+/*-----------------------------------------------------------------------*/
+
+void disk_cache_layout (
+	BYTE pdrv,		/* Physical drive nmuber to identify the drive */
+	DWORD fatbase,		/* FAT start sector */
+	DWORD fatsize,		/* Number of sectors of all FATs */
+	DWORD database,		/* Data start sector */
+	WORD csize		/* Cluster size in sectors */
+)
+{
+	struct disk_info *disk;
+
+	if (pdrv >= DISK_MAX_PHY_DRV)
+		return;
+
+	disk = system_disks[pdrv];
+	if (!disk)
+		return;
+
+	diskio_cache_set_layout(disk, disk->sector_offset + fatbase, fatsize,
+		disk->sector_offset + database, csize);
+}
+#endif
+
 static int vol_name_to_pdrv(const char *vol_name)
 {
 	const char *tp;
@@ -12,27 +12,71 @@
 #include <logging/sys_log.h>
 
 #define DISKIO_TIMEOUT OS_FOREVER
-#define DISKIO_CACHE_POOL_NUM 1
-#define DISKIO_CACHE_POOL_SIZE 2048
+#define DISKIO_CACHE_POOL_SIZE CONFIG_DISKIO_CACHE_LINE_SIZE
+#define DISKIO_CACHE_SETS CONFIG_DISKIO_CACHE_SETS
+#define DISKIO_CACHE_WAYS CONFIG_DISKIO_CACHE_WAYS
+#define DISKIO_CACHE_POOL_NUM (DISKIO_CACHE_SETS * DISKIO_CACHE_WAYS)
+#define DISKIO_CACHE_DISK_NUM _VOLUMES
+
+#if (DISKIO_CACHE_SETS & (DISKIO_CACHE_SETS - 1)) != 0
+#error "CONFIG_DISKIO_CACHE_SETS must be power of 2"
+#endif
+
+/* accesses a line survives in addition for each class above data */
+#define DISKIO_CACHE_CLASS_AGE 64
 
 static char __in_section_unique(diskio.cache.stack) __aligned(STACK_ALIGN) diskio_cache_thread_stack[1152];
 
 OS_MUTEX_DEFINE(diskio_cache_mutex);
 
+/* eviction priority, lines of the lowest class go first */
+enum {
+	CACHE_CLASS_DATA,
+	CACHE_CLASS_DIR,
+	CACHE_CLASS_FAT,
+	CACHE_CLASS_NUM,
+};
+
 struct  diskio_cache_item {
 	u32_t cache_valid:1;
 	u32_t busy_flag:1;
 	u32_t write_valid:1;
 	u32_t err_flag:1;
 	u32_t disk_type:8;
+	u32_t cache_class:2;
+	u32_t prefetch:1;
 	u32_t cache_sector;
+	u32_t last_use;
+	struct disk_info *disk;
+	u8_t  *cache_data;
+};
+
+/* volume layout told by FatFs and sequential read state */
+struct  diskio_cache_disk {
 	struct disk_info *disk;
-	u8_t  cache_data[DISKIO_CACHE_POOL_SIZE];
+	u32_t fat_sector;
+	u32_t fat_count;
+	u32_t data_sector;
+	u32_t cluster_size;
+	u32_t next_sector;
+	u32_t ra_sector;
+	u8_t  seq_cnt;
+};
+
+struct  diskio_cache_stat {
+	u32_t hit_cnt[CACHE_CLASS_NUM];
+	u32_t miss_cnt[CACHE_CLASS_NUM];
+	u32_t bypass_cnt;
+	u32_t prefetch_cnt;
+	u32_t prefetch_hit_cnt;
+	u32_t write_back_cnt;
+	u32_t write_req_cnt;
 };
 
 enum {
 	REQ_FLUSH,
 	REQ_LOAD,
+	REQ_PREFETCH,
 };
 
 
@@ -41,7 +85,9 @@ struct  diskio_cache_req {
 	struct disk_info *req_disk;
 	u8_t  req_type;
 	u8_t  req_need_free;
+	u8_t  req_class;
 	u32_t req_sector;
+	u32_t req_count;
 	os_sem req_sem;
 };
 
@@ -49,81 +95,230 @@ struct  diskio_cache_context {
 	os_fifo cache_req_fifo;
 	u8_t terminal:1;
 	u8_t inited:1;
-	u8_t cache_index;
 	u32_t thread_id;
+	u32_t access_tick;
+	struct  diskio_cache_stat stat;
+	struct  diskio_cache_disk disks[DISKIO_CACHE_DISK_NUM];
 	struct  diskio_cache_item cache_pool[DISKIO_CACHE_POOL_NUM];
+	/* way major, neighbour lines filled in order are contiguous for merged write back */
+	u8_t  cache_data[DISKIO_CACHE_WAYS][DISKIO_CACHE_SETS][DISKIO_CACHE_POOL_SIZE];
 };
 
 struct  diskio_cache_context diskio_cache __in_section_unique(diskio.cache.pool);
 
-static struct  diskio_cache_item *_diskio_find_cache_item(struct disk_info *disk, DWORD sector, UINT count)
+static inline u32_t _diskio_line_sectors(struct disk_info *disk)
 {
-	struct  diskio_cache_item *cache_item = NULL;
-	u8_t cace_sector_cnt = DISKIO_CACHE_POOL_SIZE / disk->sector_size;
+	return DISKIO_CACHE_POOL_SIZE / disk->sector_size;
+}
 
-	for (int i = 0; i < DISKIO_CACHE_POOL_NUM; i++) {
-		if (diskio_cache.cache_pool[i].cache_sector <= sector
-			&& diskio_cache.cache_pool[i].disk == disk
-			&& diskio_cache.cache_pool[i].cache_sector + cace_sector_cnt >= sector + count
-			&& diskio_cache.cache_pool[i].cache_valid == 1){
-			cache_item = &diskio_cache.cache_pool[i];
+static struct  diskio_cache_item *_diskio_cache_set(struct disk_info *disk, DWORD line_sector)
+{
+	u32_t set = (line_sector / _diskio_line_sectors(disk)) & (DISKIO_CACHE_SETS - 1);
+
+	return &diskio_cache.cache_pool[set * DISKIO_CACHE_WAYS];
+}
+
+static struct  diskio_cache_item *_diskio_find_cache_item(struct disk_info *disk, DWORD line_sector)
+{
+	struct  diskio_cache_item *set = _diskio_cache_set(disk, line_sector);
+
+	for (int i = 0; i < DISKIO_CACHE_WAYS; i++) {
+		if (set[i].cache_sector == line_sector
+			&& set[i].disk == disk
+			&& set[i].cache_valid == 1) {
+			return &set[i];
 		}
 	}
 
-	return cache_item;
+	return NULL;
 }
 
-static void _diskio_cache_invalid(struct disk_info *disk, DWORD sector, UINT count)
+static struct  diskio_cache_disk *_diskio_cache_disk(struct disk_info *disk)
 {
-	struct  diskio_cache_item *cache_item = NULL;
-	u8_t cace_sector_cnt = DISKIO_CACHE_POOL_SIZE / disk->sector_size;
+	struct  diskio_cache_disk *cache_disk = NULL;
 
-	for (int i = 0; i < DISKIO_CACHE_POOL_NUM; i++) {
-		if (diskio_cache.cache_pool[i].cache_sector  +  cace_sector_cnt >= sector
-			&& diskio_cache.cache_pool[i].cache_sector < sector + count
-			&& diskio_cache.cache_pool[i].disk == disk
-			&& diskio_cache.cache_pool[i].cache_valid == 1){
-			cache_item = &diskio_cache.cache_pool[i];
-			if (cache_item->write_valid) {
-				if (cache_item->disk->op->write(cache_item->disk, cache_item->cache_data, cache_item->cache_sector,
-							cace_sector_cnt)) {
-					SYS_LOG_ERR("sector %d len %d\n", cache_item->cache_sector, cace_sector_cnt);
-				}
+	for (int i = 0; i < DISKIO_CACHE_DISK_NUM; i++) {
+		if (diskio_cache.disks[i].disk == disk) {
+			return &diskio_cache.disks[i];
+		}
+		if (!diskio_cache.disks[i].disk && !cache_disk) {
+			cache_disk = &diskio_cache.disks[i];
+		}
+	}
+
+	if (cache_disk) {
+		memset(cache_disk, 0, sizeof(struct  diskio_cache_disk));
+		cache_disk->disk = disk;
+	}
+
+	return cache_disk;
+}
+
+/* file data reads in sequence, FAT and directory reads in between do not break it */
+static void _diskio_cache_track(struct  diskio_cache_disk *cache_disk, DWORD sector, UINT count)
+{
+	if (!cache_disk || sector < cache_disk->data_sector) {
+		return;
+	}
+
+	if (sector == cache_disk->next_sector) {
+		if (cache_disk->seq_cnt < 0xff) {
+			cache_disk->seq_cnt++;
+		}
+	} else {
+		cache_disk->seq_cnt = 0;
+		cache_disk->ra_sector = 0;
+	}
+
+	cache_disk->next_sector = sector + count;
+}
+
+/* FatFs moves its window over FAT and directories one sector at a time,
+ * file data comes in multi sector reads or as a sequential stream.
+ */
+static u8_t _diskio_cache_class(struct  diskio_cache_disk *cache_disk, DWORD sector, UINT count)
+{
+	if (!cache_disk || !cache_disk->data_sector) {
+		return CACHE_CLASS_DIR;
+	}
+
+	if (sector - cache_disk->fat_sector < cache_disk->fat_count) {
+		return CACHE_CLASS_FAT;
+	}
+
+	if (sector < cache_disk->data_sector || (count == 1 && !cache_disk->seq_cnt)) {
+		return CACHE_CLASS_DIR;
+	}
+
+	return CACHE_CLASS_DATA;
+}
+
+static void _diskio_cache_touch(struct  diskio_cache_item *cache_item, u8_t cache_class)
+{
+	cache_item->last_use = ++diskio_cache.access_tick;
+	if (cache_item->cache_class < cache_class) {
+		cache_item->cache_class = cache_class;
+	}
+	if (cache_item->prefetch) {
+		cache_item->prefetch = 0;
+		diskio_cache.stat.prefetch_hit_cnt++;
+	}
+}
+
+/* write dirty lines of disk in sector order, neighbours contiguous in pool go in one request */
+static void _diskio_cache_write_back(struct disk_info *disk)
+{
+	struct  diskio_cache_item *dirty[DISKIO_CACHE_POOL_NUM];
+	struct  diskio_cache_item *cache_item;
+	u32_t line_sectors = _diskio_line_sectors(disk);
+	int num = 0;
+	int i, j;
+
+	for (i = 0; i < DISKIO_CACHE_POOL_NUM; i++) {
+		cache_item = &diskio_cache.cache_pool[i];
+		if (cache_item->disk != disk || !cache_item->cache_valid || !cache_item->write_valid) {
+			continue;
+		}
+
+		for (j = num; j > 0 && dirty[j - 1]->cache_sector > cache_item->cache_sector; j--) {
+			dirty[j] = dirty[j - 1];
+		}
+		dirty[j] = cache_item;
+		num++;
+	}
+
+	for (i = 0; i < num; i = j) {
+		for (j = i + 1; j < num; j++) {
+			if (dirty[j]->cache_sector != dirty[j - 1]->cache_sector + line_sectors
+				|| dirty[j]->cache_data != dirty[j - 1]->cache_data + DISKIO_CACHE_POOL_SIZE) {
+				break;
 			}
-			cache_item->cache_valid = 0;
-			cache_item->write_valid = 0;
+		}
+
+		diskio_cache.stat.write_req_cnt++;
+		if (disk->op->write(disk, dirty[i]->cache_data, dirty[i]->cache_sector,
+					(j - i) * line_sectors)) {
+			SYS_LOG_ERR("sector %d len %d\n", dirty[i]->cache_sector, (j - i) * line_sectors);
+			continue;
+		}
+
+		for (int k = i; k < j; k++) {
+			dirty[k]->write_valid = 0;
+			diskio_cache.stat.write_back_cnt++;
 		}
 	}
 }
 
-static struct  diskio_cache_item *_diskio_new_cache_item(struct disk_info *disk, DWORD sector)
+static struct  diskio_cache_item *_diskio_new_cache_item(struct disk_info *disk, DWORD sector, u8_t cache_class)
 {
+	struct  diskio_cache_item *set = _diskio_cache_set(disk, sector);
 	struct  diskio_cache_item *cache_item = NULL;
-	u8_t cace_sector_cnt = DISKIO_CACHE_POOL_SIZE / disk->sector_size;
+	s32_t idle, max_idle = 0;
 
 	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
-	cache_item = &diskio_cache.cache_pool[diskio_cache.cache_index++];
-	diskio_cache.cache_index = diskio_cache.cache_index % DISKIO_CACHE_POOL_NUM;
+	for (int i = 0; i < DISKIO_CACHE_WAYS; i++) {
+		if (!set[i].cache_valid) {
+			cache_item = &set[i];
+			break;
+		}
 
-	if (cache_item->write_valid && cache_item->cache_valid) {
-		if (cache_item->disk->op->write(cache_item->disk, cache_item->cache_data, cache_item->cache_sector,
-					cace_sector_cnt)) {
-			SYS_LOG_ERR("sector %d len %d\n", cache_item->cache_sector, cace_sector_cnt);
+		if (set[i].busy_flag) {
+			continue;
 		}
 
+		/* least recently used, lines of a higher class look younger */
+		idle = (s32_t)(diskio_cache.access_tick - set[i].last_use)
+			- set[i].cache_class * DISKIO_CACHE_CLASS_AGE;
+		if (!cache_item || idle > max_idle) {
+			cache_item = &set[i];
+			max_idle = idle;
+		}
+	}
+
+	if (!cache_item) {
+		os_mutex_unlock(&diskio_cache_mutex);
+		return NULL;
+	}
+
+	if (cache_item->write_valid && cache_item->cache_valid) {
+		_diskio_cache_write_back(cache_item->disk);
 	}
 
 	cache_item->cache_valid = 1;
 	cache_item->cache_sector = sector;
+	cache_item->cache_class = cache_class;
+	cache_item->last_use = ++diskio_cache.access_tick;
 	cache_item->disk = disk;
 	cache_item->write_valid = 0;
 	cache_item->err_flag = 0;
 	cache_item->busy_flag = 0;
+	cache_item->prefetch = 0;
 	os_mutex_unlock(&diskio_cache_mutex);
 	return cache_item;
 }
 
-static int _diskio_load_to_cache_req(struct disk_info *disk, DWORD sector)
+static void _diskio_load_cache_item(struct disk_info *disk, DWORD sector, u8_t cache_class, bool prefetch)
+{
+	struct  diskio_cache_item *cache_item;
+
+	cache_item = _diskio_new_cache_item(disk, sector, cache_class);
+	if (!cache_item) {
+		return;
+	}
+
+	if (disk->op->read(disk, cache_item->cache_data, sector, _diskio_line_sectors(disk))) {
+		/* failed readahead is dropped, nobody asked for it */
+		if (prefetch) {
+			cache_item->cache_valid = 0;
+		} else {
+			cache_item->err_flag = 1;
+		}
+	}
+
+	cache_item->prefetch = prefetch;
+}
+
+static int _diskio_load_to_cache_req(struct disk_info *disk, DWORD sector, u8_t cache_class)
 {
 	struct  diskio_cache_req  *cache_req = mem_malloc(sizeof(struct  diskio_cache_req));
 
@@ -131,7 +326,9 @@ static int _diskio_load_to_cache_req(struct disk_info *disk, DWORD sector)
 
 	cache_req->req_disk = disk;
 	cache_req->req_sector = sector;
+	cache_req->req_class = cache_class;
 	cache_req->req_type = REQ_LOAD;
+	cache_req->req_need_free = 0;
 
 	os_fifo_put(&diskio_cache.cache_req_fifo, cache_req);
 
@@ -157,6 +354,57 @@ static int _diskio_flush_cache_req(struct disk_info *disk)
 	return 0;
 }
 
+#ifdef CONFIG_DISKIO_CACHE_READAHEAD
+/* keep the next cluster of a sequential stream loading on the cache thread */
+static void _diskio_cache_readahead(struct disk_info *disk)
+{
+	struct  diskio_cache_disk *cache_disk;
+	struct  diskio_cache_req  *cache_req;
+	u32_t line_sectors = _diskio_line_sectors(disk);
+	u32_t window, start, end;
+
+	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+
+	cache_disk = _diskio_cache_disk(disk);
+	if (!cache_disk || !cache_disk->seq_cnt) {
+		os_mutex_unlock(&diskio_cache_mutex);
+		return;
+	}
+
+	window = max(cache_disk->cluster_size, line_sectors);
+	window = min(window, CONFIG_DISKIO_CACHE_READAHEAD_LINES * line_sectors);
+
+	start = cache_disk->next_sector - cache_disk->next_sector % line_sectors;
+	start = max(start, cache_disk->ra_sector);
+	end = cache_disk->next_sector + window;
+	end -= end % line_sectors;
+	if (disk->sector_cnt) {
+		end = min(end, disk->sector_offset + disk->sector_cnt);
+	}
+
+	if (start >= end) {
+		os_mutex_unlock(&diskio_cache_mutex);
+		return;
+	}
+
+	cache_disk->ra_sector = end;
+	os_mutex_unlock(&diskio_cache_mutex);
+
+	cache_req = mem_malloc(sizeof(struct  diskio_cache_req));
+	if (!cache_req) {
+		return;
+	}
+
+	cache_req->req_disk = disk;
+	cache_req->req_type = REQ_PREFETCH;
+	cache_req->req_need_free = 1;
+	cache_req->req_sector = start;
+	cache_req->req_count = (end - start) / line_sectors;
+
+	os_fifo_put(&diskio_cache.cache_req_fifo, cache_req);
+}
+#endif
+
 int diskio_cache_read(
 	struct disk_info *disk,
 	/* Physical drive nmuber to identify the drive */
@@ -167,42 +415,90 @@ int diskio_cache_read(
 {
 	int ret = 0;
 	struct  diskio_cache_item *cache_item = NULL;
+	struct  diskio_cache_disk *cache_disk;
+	u32_t line_sectors, line_sector, num;
+	u8_t cache_class;
+	bool loaded;
 
-	if (!diskio_cache.inited
-			|| count * disk->sector_size > DISKIO_CACHE_POOL_SIZE) {
-		if (diskio_cache.inited) {
-			_diskio_cache_invalid(disk, sector, count);
-		}
+	if (!diskio_cache.inited) {
 		return disk->op->read(disk, buff, sector, count);
 	}
 
-try_to_read:
+	line_sectors = _diskio_line_sectors(disk);
+
 	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
-	cache_item = _diskio_find_cache_item(disk, sector, count);
-	/**cache hit */
-	if (cache_item) {
-		cache_item->busy_flag = 1;
-		if (!cache_item->err_flag) {
-			memcpy(buff, cache_item->cache_data
-					+ (sector - cache_item->cache_sector) * disk->sector_size,
-					count * disk->sector_size);
-			ret = 0;
-		} else {
-			cache_item->cache_valid = 0;
-			ret = -EIO;
+	cache_disk = _diskio_cache_disk(disk);
+	_diskio_cache_track(cache_disk, sector, count);
+	cache_class = _diskio_cache_class(cache_disk, sector, count);
+	os_mutex_unlock(&diskio_cache_mutex);
+
+	while (count > 0 && !ret) {
+		line_sector = sector - sector % line_sectors;
+		num = min(count, line_sectors - (sector - line_sector));
+		loaded = false;
+
+try_to_read:
+		os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+		cache_item = _diskio_find_cache_item(disk, line_sector);
+		/**cache hit */
+		if (cache_item) {
+			cache_item->busy_flag = 1;
+			if (!loaded) {
+				diskio_cache.stat.hit_cnt[cache_class]++;
+			}
+			_diskio_cache_touch(cache_item, cache_class);
+			if (!cache_item->err_flag) {
+				memcpy(buff, cache_item->cache_data
+						+ (sector - line_sector) * disk->sector_size,
+						num * disk->sector_size);
+				ret = 0;
+			} else {
+				cache_item->cache_valid = 0;
+				ret = -EIO;
+			}
+			cache_item->busy_flag = 0;
+		} else if (!loaded) {
+			diskio_cache.stat.miss_cnt[cache_class]++;
+		}
+		os_mutex_unlock(&diskio_cache_mutex);
+		/**cache miss, whole lines need not go through the cache */
+		if (!cache_item && num == line_sectors) {
+			diskio_cache.stat.bypass_cnt++;
+			ret = disk->op->read(disk, buff, sector, num);
+		} else if (!cache_item) {
+			_diskio_load_to_cache_req(disk, line_sector, cache_class);
+			loaded = true;
+			goto try_to_read;
 		}
-		cache_item->busy_flag = 0;
+
+		buff += num * disk->sector_size;
+		sector += num;
+		count -= num;
 	}
-	os_mutex_unlock(&diskio_cache_mutex);
-	/**cache miss */
-	if (!cache_item) {
-		_diskio_load_to_cache_req(disk, sector);
-		goto try_to_read;
+
+#ifdef CONFIG_DISKIO_CACHE_READAHEAD
+	if (!ret) {
+		_diskio_cache_readahead(disk);
 	}
+#endif
 
 	return ret;
 }
 
+/* a readahead may have loaded the line while it was written through */
+static void _diskio_cache_drop_line(struct disk_info *disk, DWORD line_sector)
+{
+	struct  diskio_cache_item *cache_item;
+
+	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+	cache_item = _diskio_find_cache_item(disk, line_sector);
+	if (cache_item) {
+		cache_item->cache_valid = 0;
+		cache_item->write_valid = 0;
+	}
+	os_mutex_unlock(&diskio_cache_mutex);
+}
+
 int diskio_cache_write(
 	struct disk_info *disk,
 	/* Physical drive nmuber to identify the drive */
@@ -213,41 +509,67 @@ int diskio_cache_write(
 {
 	int ret = 0;
 	struct  diskio_cache_item *cache_item = NULL;
+	u32_t line_sectors, line_sector, num;
+	u8_t cache_class;
+	bool loaded;
 
-	if (!diskio_cache.inited
-			|| count * disk->sector_size > DISKIO_CACHE_POOL_SIZE) {
-		if (diskio_cache.inited) {
-			_diskio_cache_invalid(disk, sector, count);
-		}
+	if (!diskio_cache.inited) {
 		return disk->op->write(disk, buff, sector, count);
 	}
 
-try_to_write:
+	line_sectors = _diskio_line_sectors(disk);
+
 	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+	cache_class = _diskio_cache_class(_diskio_cache_disk(disk), sector, count);
+	os_mutex_unlock(&diskio_cache_mutex);
 
-	cache_item = _diskio_find_cache_item(disk, sector, count);
-	/**cache hit */
-	if (cache_item) {
-		cache_item->busy_flag = 1;
-		if (!cache_item->err_flag) {
-			memcpy(cache_item->cache_data
-					+ (sector - cache_item->cache_sector) * disk->sector_size,
-					buff, count * disk->sector_size);
-			cache_item->write_valid = 1;
-			ret = 0;
-		} else {
-			cache_item->cache_valid = 0;
-			ret = -EIO;
+	while (count > 0 && !ret) {
+		line_sector = sector - sector % line_sectors;
+		num = min(count, line_sectors - (sector - line_sector));
+		loaded = false;
+
+try_to_write:
+		os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+
+		cache_item = _diskio_find_cache_item(disk, line_sector);
+		/**cache hit */
+		if (cache_item) {
+			cache_item->busy_flag = 1;
+			if (!loaded) {
+				diskio_cache.stat.hit_cnt[cache_class]++;
+			}
+			_diskio_cache_touch(cache_item, cache_class);
+			if (!cache_item->err_flag) {
+				memcpy(cache_item->cache_data
+						+ (sector - line_sector) * disk->sector_size,
+						buff, num * disk->sector_size);
+				cache_item->write_valid = 1;
+				ret = 0;
+			} else {
+				cache_item->cache_valid = 0;
+				ret = -EIO;
+			}
+			cache_item->busy_flag = 0;
+		} else if (!loaded) {
+			diskio_cache.stat.miss_cnt[cache_class]++;
 		}
-		cache_item->busy_flag = 0;
-	}
 
-	os_mutex_unlock(&diskio_cache_mutex);
+		os_mutex_unlock(&diskio_cache_mutex);
 
-	/**cache miss */
-	if (!cache_item) {
-		_diskio_load_to_cache_req(disk, sector);
-		goto try_to_write;
+		/**cache miss, whole lines are written through */
+		if (!cache_item && num == line_sectors) {
+			diskio_cache.stat.bypass_cnt++;
+			ret = disk->op->write(disk, buff, sector, num);
+			_diskio_cache_drop_line(disk, line_sector);
+		} else if (!cache_item) {
+			_diskio_load_to_cache_req(disk, line_sector, cache_class);
+			loaded = true;
+			goto try_to_write;
+		}
+
+		buff += num * disk->sector_size;
+		sector += num;
+		count -= num;
 	}
 
 	return ret;
@@ -270,75 +592,112 @@ int diskio_cache_invalid(struct disk_info *disk)
 			cache_item->write_valid = 0;
 		}
 	}
+	for (int i = 0; i < DISKIO_CACHE_DISK_NUM; i++) {
+		if (diskio_cache.disks[i].disk == disk) {
+			diskio_cache.disks[i].disk = NULL;
+		}
+	}
 	os_mutex_unlock(&diskio_cache_mutex);
 	return 0;
 }
 
+int diskio_cache_set_layout(struct disk_info *disk, u32_t fat_sector, u32_t fat_count,
+		u32_t data_sector, u32_t cluster_size)
+{
+	struct  diskio_cache_disk *cache_disk;
+
+	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+	cache_disk = _diskio_cache_disk(disk);
+	if (cache_disk) {
+		cache_disk->fat_sector = fat_sector;
+		cache_disk->fat_count = fat_count;
+		cache_disk->data_sector = data_sector;
+		cache_disk->cluster_size = cluster_size;
+	}
+	os_mutex_unlock(&diskio_cache_mutex);
+
+	return cache_disk ? 0 : -ENOMEM;
+}
+
+void diskio_cache_dump(void)
+{
+	static const char * const class_name[CACHE_CLASS_NUM] = { "data", "dir", "fat" };
+	struct  diskio_cache_stat *stat = &diskio_cache.stat;
+	u32_t total;
+
+	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+
+	for (int i = 0; i < CACHE_CLASS_NUM; i++) {
+		total = stat->hit_cnt[i] + stat->miss_cnt[i];
+		printk("diskio cache %s: hit %d miss %d, hit rate %d%%\n", class_name[i],
+			stat->hit_cnt[i], stat->miss_cnt[i], total ? stat->hit_cnt[i] * 100 / total : 0);
+	}
+	printk("diskio cache: %d sets %d ways, bypass %d, prefetch %d used %d\n",
+		DISKIO_CACHE_SETS, DISKIO_CACHE_WAYS, stat->bypass_cnt,
+		stat->prefetch_cnt, stat->prefetch_hit_cnt);
+	printk("diskio cache: write back %d lines in %d writes\n",
+		stat->write_back_cnt, stat->write_req_cnt);
+
+	os_mutex_unlock(&diskio_cache_mutex);
+}
+
+static void _diskio_cache_handle_req(struct  diskio_cache_req *cache_req)
+{
+	struct disk_info *disk = cache_req->req_disk;
+	u32_t line_sector;
+
+	os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
+	switch (cache_req->req_type) {
+	case REQ_LOAD:
+	{
+		/* a readahead queued before may have brought it already */
+		if (!_diskio_find_cache_item(disk, cache_req->req_sector)) {
+			_diskio_load_cache_item(disk, cache_req->req_sector, cache_req->req_class, false);
+		}
+		break;
+	}
+	case REQ_PREFETCH:
+	{
+		line_sector = cache_req->req_sector;
+		for (int i = 0; i < cache_req->req_count; i++) {
+			if (!_diskio_find_cache_item(disk, line_sector)) {
+				_diskio_load_cache_item(disk, line_sector, CACHE_CLASS_DATA, true);
+				diskio_cache.stat.prefetch_cnt++;
+			}
+			line_sector += _diskio_line_sectors(disk);
+		}
+		break;
+	}
+	case REQ_FLUSH:
+	{
+		_diskio_cache_write_back(disk);
+		break;
+	}
+	default:
+		break;
+	}
+	os_mutex_unlock(&diskio_cache_mutex);
+
+	if (cache_req->req_need_free) {
+		mem_free(cache_req);
+	} else {
+		os_sem_give(&cache_req->req_sem);
+	}
+}
+
 static void _diskio_cache_thread_loop(void *p1, void *p2, void *p3)
 {
-	int ret = 0;
 	struct  diskio_cache_context *diskio_cache_ctx = (struct  diskio_cache_context *)p1;
 
 	while (!diskio_cache_ctx->terminal) {
 		struct  diskio_cache_req  *cache_req = NULL;
-		struct  diskio_cache_item *cache_item  = NULL;
-		struct disk_info *disk = NULL;
 
 		cache_req = os_fifo_get(&diskio_cache.cache_req_fifo, OS_FOREVER);
 		if (!cache_req) {
 			continue;
 		}
-		os_mutex_lock(&diskio_cache_mutex, OS_FOREVER);
-		switch (cache_req->req_type) {
-		case REQ_LOAD:
-		{
-			cache_item = _diskio_new_cache_item(cache_req->req_disk, cache_req->req_sector);
-			disk = cache_req->req_disk;
-			if (cache_item) {
-				ret = disk->op->read(disk, cache_item->cache_data, cache_req->req_sector,
-									 DISKIO_CACHE_POOL_SIZE / disk->sector_size);
-				if (ret) {
-					cache_item->err_flag = 1;
-				}
-				cache_item->cache_valid = 1;
-			}
 
-			break;
-		}
-		case REQ_FLUSH:
-		{
-			for (int i = 0; i < DISKIO_CACHE_POOL_NUM; i++) {
-				if (diskio_cache.cache_pool[i].disk == cache_req->req_disk
-					&& diskio_cache.cache_pool[i].cache_valid == 1
-					&& diskio_cache.cache_pool[i].write_valid == 1) {
-
-					cache_item = &diskio_cache.cache_pool[i];
-					disk = cache_req->req_disk;
-
-					ret = disk->op->write(disk, cache_item->cache_data,
-								cache_item->cache_sector,
-								DISKIO_CACHE_POOL_SIZE / disk->sector_size);
-
-					if (ret) {
-						SYS_LOG_ERR("sector %d len %d\n", cache_item->cache_sector, DISKIO_CACHE_POOL_SIZE);
-					} else {
-						cache_item->write_valid = 0;
-					}
-				}
-			}
-
-			break;
-		}
-		default:
-			break;
-		}
-		os_mutex_unlock(&diskio_cache_mutex);
-
-		if (cache_req->req_need_free) {
-			mem_free(cache_req);
-		} else {
-			os_sem_give(&cache_req->req_sem);
-		}
+		_diskio_cache_handle_req(cache_req);
 	}
 }
 int diskio_cache_init(struct device *unused)
@@ -347,8 +706,13 @@ int diskio_cache_init(struct device *unused)
 
 	memset(&diskio_cache, 0, sizeof(struct diskio_cache_context));
 
+	for (int i = 0; i < DISKIO_CACHE_POOL_NUM; i++) {
+		diskio_cache.cache_pool[i].cache_data =
+			diskio_cache.cache_data[i % DISKIO_CACHE_WAYS][i / DISKIO_CACHE_WAYS];
+	}
+
 	os_fifo_init(&diskio_cache.cache_req_fifo);
-	
+
 	diskio_cache.thread_id = os_thread_create(diskio_cache_thread_stack,
 											sizeof(diskio_cache_thread_stack),
 											_diskio_cache_thread_loop,
@@ -367,5 +731,3 @@ int diskio_cache_deinit(void)
 }
 
 SYS_INIT(diskio_cache_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
-
-
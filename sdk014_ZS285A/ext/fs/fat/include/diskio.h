@@ -51,6 +51,10 @@ int diskio_cache_write(
 
 int diskio_cache_flush(struct disk_info *disk);
 int diskio_cache_invalid(struct disk_info *disk);
+int diskio_cache_set_layout(struct disk_info *disk, u32_t fat_sector, u32_t fat_count,
+		u32_t data_sector, u32_t cluster_size);
+void diskio_cache_dump(void);
+void disk_cache_layout (BYTE pdrv, DWORD fatbase, DWORD fatsize, DWORD database, WORD csize);
 /* Disk Status Bits (DSTATUS) */
 
 #define STA_NOINIT		0x01	/* Drive not initialized */
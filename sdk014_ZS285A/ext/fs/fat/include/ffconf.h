@@ -43,7 +43,11 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
+#ifdef CONFIG_FAT_FASTSEEK
+#define	_USE_FASTSEEK	1
+#else
 #define	_USE_FASTSEEK	0
+#endif
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
@@ -10924,6 +10924,55 @@ static WCHAR *uni2oem = 0;
 #endif
 
 
+#ifdef CONFIG_FAT_CC936_PAGE_INDEX
+/*
+ * First pair of each high byte page of the sorted tables, built at first
+ * use since the tables may be mapped from sdfs. GBK and CJK pages are
+ * mostly dense, so the low byte finds the pair without a search.
+ */
+static WCHAR oem2uni_page[257];
+static WCHAR uni2oem_page[257];
+
+static WCHAR cc936_page_find (
+	const WCHAR *p,
+	WCHAR *page,
+	WCHAR chr
+)
+{
+	int i, li, hi;
+
+
+	if (!page[256]) {
+		for (i = 0, li = 0; li < 256; li++) {
+			while (i < 0x5520 && (p[i * 2] >> 8) < li) i++;
+			page[li] = i;
+		}
+		page[256] = 0x5520;
+	}
+
+	li = page[chr >> 8];
+	hi = page[(chr >> 8) + 1];
+	if (li == hi) return 0;
+
+	i = li + (int)(chr & 0xFF) - (int)(p[li * 2] & 0xFF);
+	if (i >= hi) i = hi - 1;
+	if (i < li) i = li;
+	if (p[i * 2] > chr && i > li) i--;	/* one hole, as 0x7F in GBK */
+	if (p[i * 2] == chr) return p[i * 2 + 1];
+
+	while (li < hi) {
+		i = li + (hi - li) / 2;
+		if (p[i * 2] == chr) return p[i * 2 + 1];
+		if (p[i * 2] < chr)
+			li = i + 1;
+		else
+			hi = i;
+	}
+
+	return 0;
+}
+#endif
+
 WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 	WCHAR	chr,	/* Character code to be converted */
 	UINT	dir		/* 0: Unicode to OEM code, 1: OEM code to Unicode */
@@ -10931,7 +10980,9 @@ WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 {
 	const WCHAR *p;
 	WCHAR c;
+#ifndef CONFIG_FAT_CC936_PAGE_INDEX
 	int i, n, li, hi;
+#endif
 
 
 	if (chr < 0x80) {	/* ASCII */
@@ -10948,7 +10999,6 @@ WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 			}
 		#endif
 			p = oem2uni;
-			hi = 0x5520;
 		} else {		/* Unicode to OEM code */
 		#ifdef CONFIG_CODE_TABLE_IN_SDFS
 			if(!uni2oem) {
@@ -10959,9 +11009,12 @@ WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 			}
 		#endif
 			p = uni2oem;
-			hi = 0x5520;
 		}
+#ifdef CONFIG_FAT_CC936_PAGE_INDEX
+		c = cc936_page_find(p, dir ? oem2uni_page : uni2oem_page, chr);
+#else
 		li = 0;
+		hi = 0x5520;
 		for (n = 16; n; n--) {
 			i = li + (hi - li) / 2;
 			if (chr == p[i * 2]) break;
@@ -10971,6 +11024,7 @@ WCHAR ff_convert (	/* Converted code, 0 means conversion error */
 				hi = i;
 		}
 		c = n ? p[i * 2 + 1] : 0;
+#endif
 	}
 
 	return c;
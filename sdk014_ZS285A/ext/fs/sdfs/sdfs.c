@@ -11,11 +11,104 @@
 #include <ctype.h>
 
 
+#define SDFS_DIR_SIZE		32
+/* set in reserved[0] of the first entry by build_sdfs.py */
+#define SDFS_DIR_SORTED		0x54524f53
+
+#if CONFIG_SD_FS_LOOKUP_CACHE_NUM > 0
+/* recently opened files, most recently used first */
+struct sd_lookup_cache {
+	char fname[12];
+	int offset;
+	int size;
+};
+
+static struct sd_lookup_cache sd_lookup_cache[CONFIG_SD_FS_LOOKUP_CACHE_NUM];
+static int sd_lookup_cache_num;
+
+static int sd_lookup_cache_get(const char *filename, struct sd_dir *sd_dir)
+{
+	struct sd_lookup_cache item;
+	unsigned int key;
+	int i;
+
+	key = irq_lock();
+
+	for (i = 0; i < sd_lookup_cache_num; i++) {
+		if (strncasecmp(filename, sd_lookup_cache[i].fname, 12) == 0)
+			break;
+	}
+
+	if (i < sd_lookup_cache_num) {
+		item = sd_lookup_cache[i];
+		memmove(&sd_lookup_cache[1], &sd_lookup_cache[0], i * sizeof(item));
+		sd_lookup_cache[0] = item;
+
+		sd_dir->offset = item.offset;
+		sd_dir->size = item.size;
+	}
+
+	irq_unlock(key);
+
+	return (i < sd_lookup_cache_num);
+}
+
+static void sd_lookup_cache_put(struct sd_dir *sd_dir)
+{
+	unsigned int key;
+
+	key = irq_lock();
+
+	if (sd_lookup_cache_num < CONFIG_SD_FS_LOOKUP_CACHE_NUM)
+		sd_lookup_cache_num++;
+
+	memmove(&sd_lookup_cache[1], &sd_lookup_cache[0],
+		(sd_lookup_cache_num - 1) * sizeof(struct sd_lookup_cache));
+	memcpy(sd_lookup_cache[0].fname, sd_dir->fname, 12);
+	sd_lookup_cache[0].offset = sd_dir->offset;
+	sd_lookup_cache[0].size = sd_dir->size;
+
+	irq_unlock(key);
+}
+#endif
+
+/* first entry with the name, entries are sorted like strncasecmp */
+static struct sd_dir * sd_search_dir(const char *filename, void *buf_size_32, int total)
+{
+	struct sd_dir *sd_dir = buf_size_32;
+	int low = 0, high = total, mid;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		memcpy_flash_data(buf_size_32, (void *)(CONFIG_SD_FS_VADDR_START + SDFS_DIR_SIZE * (mid + 1)), SDFS_DIR_SIZE);
+
+		if(strncasecmp(filename, sd_dir->fname, 12) > 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low < total)
+	{
+		memcpy_flash_data(buf_size_32, (void *)(CONFIG_SD_FS_VADDR_START + SDFS_DIR_SIZE * (low + 1)), SDFS_DIR_SIZE);
+		if(strncasecmp(filename, sd_dir->fname, 12) == 0)
+			return sd_dir;
+	}
+
+	return NULL;
+}
+
 static struct sd_dir * sd_find_dir(const char *filename, void *buf_size_32)
 {
 	int num, total, offset;
 	struct sd_dir *sd_dir = buf_size_32;
 
+#if CONFIG_SD_FS_LOOKUP_CACHE_NUM > 0
+	if (sd_lookup_cache_get(filename, sd_dir))
+		return sd_dir;
+#endif
+
 	memcpy_flash_data(buf_size_32, (void *)CONFIG_SD_FS_VADDR_START, sizeof(*sd_dir));
 
 	//printk("sd_dir->fname %s CONFIG_SD_FS_START 0x%x \n",sd_dir->fname,CONFIG_SD_FS_VADDR_START);
@@ -25,18 +118,31 @@ static struct sd_dir * sd_find_dir(const char *filename, void *buf_size_32)
 	}
 	total = sd_dir->offset;
 
+	if (sd_dir->reserved[0] == SDFS_DIR_SORTED)
+	{
+		sd_dir = sd_search_dir(filename, buf_size_32, total);
+		goto exit;
+	}
+
+	/* image of an old packer */
 	for(offset = CONFIG_SD_FS_VADDR_START + sizeof(*sd_dir), num = 0; num < total; offset += 32)
 	{
 		memcpy_flash_data(buf_size_32, (void *)offset, 32);
 
 		if(strncasecmp(filename, sd_dir->fname, 12) == 0)
 		{
-			return sd_dir;
+			goto exit;
 		}
 		num++;
 	}
-
-	return NULL;
+	sd_dir = NULL;
+
+exit:
+#if CONFIG_SD_FS_LOOKUP_CACHE_NUM > 0
+	if (sd_dir)
+		sd_lookup_cache_put(sd_dir);
+#endif
+	return sd_dir;
 }
 
 struct sd_file * sd_fopen (const char *filename)
@@ -73,8 +179,6 @@ void sd_fclose(struct sd_file *sd_file)
 
 int sd_fread(struct sd_file *sd_file, void *buffer, int len)
 {
-	unsigned int size_in_512, read_size;
-
 	if ((sd_file->readptr - sd_file->start + len) > sd_file->size)
 	{
 		len = sd_file->size - (sd_file->readptr - sd_file->start);
@@ -82,27 +186,11 @@ int sd_fread(struct sd_file *sd_file, void *buffer, int len)
 	if(len <= 0)
 		return 0;
 
-	read_size = len;
-
-	size_in_512 = 512 - (sd_file->readptr % 512);
-	size_in_512 = size_in_512 > len ? len : size_in_512;
-	if(size_in_512 > 0)
-	{
-		memcpy_flash_data(buffer, (void *)sd_file->readptr, size_in_512);
-
-		buffer += size_in_512;
-		sd_file->readptr += size_in_512;
-		len -= size_in_512;
-	}
+	/* file is mapped, one copy for any length */
+	memcpy_flash_data(buffer, (void *)sd_file->readptr, len);
+	sd_file->readptr += len;
 
-	for(; len > 0; buffer += size_in_512, sd_file->readptr += size_in_512, len -= size_in_512)
-	{
-		size_in_512 = len > 512 ? 512 : len;
-
-		memcpy_flash_data(buffer, (void *)sd_file->readptr, size_in_512);
-	}
-
-	return read_size;
+	return len;
 }
 
 int sd_ftell(struct sd_file *sd_file)
@@ -147,34 +235,33 @@ int sd_fseek(struct sd_file *sd_file, int offset, unsigned char whence)
 
 int sd_fsize(const char *filename)
 {
-	struct sd_file *fd = sd_fopen(filename);
-	int file_size;
+	struct sd_dir *sd_dir;
+	u8_t buf_size_32[32];
 
-	if (!fd) {
+	sd_dir = sd_find_dir(filename, (void *)buf_size_32);
+	if (!sd_dir) {
 		return -EINVAL;
 	}
 
-	file_size = fd->size;
-
-	sd_fclose(fd);
-
-	return file_size;
+	return sd_dir->size;
 }
 
 int sd_fmap(const char *filename, void** addr, int* len)
 {
-	struct sd_file *fd = sd_fopen(filename);
-	if (!fd) {
+	struct sd_dir *sd_dir;
+	u8_t buf_size_32[32];
+
+	/* no file handle needed */
+	sd_dir = sd_find_dir(filename, (void *)buf_size_32);
+	if (!sd_dir) {
 		return -EINVAL;
 	}
 
 	if (addr)
-		*addr = (void *)fd->start;
+		*addr = (void *)(sd_dir->offset + CONFIG_SD_FS_VADDR_START);
 
 	if (len)
-		*len = fd->size;
-
-	sd_fclose(fd);
+		*len = sd_dir->size;
 
 	return 0;
 }
@@ -501,12 +501,18 @@ ssize_t bt_gatt_attr_read_chrc(struct bt_conn *conn,
  *  @param peer Remote peer address
  *  @param value Configuration value.
  *  @param data Configuration pointer data.
+ *  @param node Internal, entry in the subscriber list of the connection.
+ *  @param conn Internal, connection of the peer while value is set.
+ *  @param attr Internal, CCC attribute of the entry while linked.
  */
 struct bt_gatt_ccc_cfg {
 	u8_t			valid;
 	bt_addr_le_t		peer;
 	u16_t			value;
 	u8_t			data[4] __aligned(4);
+	sys_snode_t		node;
+	struct bt_conn		*conn;
+	const struct bt_gatt_attr *attr;
 };
 
 /* Internal representation of CCC value */
@@ -28,6 +28,41 @@ unsigned int cpuload_debug_log_mask_or(unsigned int log_mask);
 void thread_block_stat_start(int prio, int block_ms);
 void thread_block_stat_stop(void);
 
+#ifdef CONFIG_CPU_SCHED_HIST
+#define CPULOAD_HIST_MAGIC	0x54534853	/* "SHST" */
+
+/* binary dump: head, then thread_cnt thread records */
+struct cpuload_hist_head {
+	u32_t magic;
+	u32_t cycles_per_sec;
+	u16_t buckets;
+	u16_t thread_cnt;
+	u32_t isr_max;
+	u16_t isr[K_SCHED_HIST_BUCKETS];
+};
+
+struct cpuload_hist_thread {
+	u32_t thread;
+	s32_t prio;
+	struct k_sched_hist hist;
+};
+
+void cpuload_hist_start(void);
+void cpuload_hist_stop(void);
+void cpuload_hist_clear(void);
+void cpuload_hist_show(void);
+
+/**
+ * @brief dump histograms in binary
+ *
+ * @param buf buffer to fill, threads not fit in are left out
+ * @param size buffer size
+ *
+ * @return dump length, or -ENOMEM if buffer is smaller than the head
+ */
+int cpuload_hist_dump(void *buf, int size);
+#endif
+
 
 /**
  * @}
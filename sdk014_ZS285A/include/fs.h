@@ -58,6 +58,17 @@ struct fs_dirent {
 	size_t size;
 };
 
+/**
+ * @brief Structure to receive the position of a directory entry
+ *
+ * @param clust Cluster of the directory holding the entry
+ * @param blk_ofs Offset of the entry in the directory
+ */
+struct fs_dirent_pos {
+	unsigned int clust;
+	unsigned int blk_ofs;
+};
+
 /**
  * @brief Structure to receive volume statistics
  *
@@ -345,6 +356,27 @@ int fs_opendir_ofs(fs_dir_t *zdp, const char *path);
  */
 int fs_readdir(fs_dir_t *zdp, struct fs_dirent *entry);
 
+/**
+ * @brief Directory read entries
+ *
+ * Reads up to num directory entries of a open directory in one call. The
+ * file system is entered and locked once for the whole batch, and entries
+ * of a sector are taken from its window in a row. The position of every
+ * entry is returned too if pos is not NULL.
+ *
+ * @param zdp Pointer to the directory object
+ * @param entries Array of num zfs_dirent structures to read the entries into
+ * @param pos Array of num positions or NULL
+ * @param num Max number of entries to read
+ * @param err Set to 0, or -ERRNO errno code of the error that ended the
+ * batch. Entries read before the error are still returned.
+ *
+ * @return Number of entries read, less than num in end-of-dir condition
+ * or on error
+ */
+int fs_readdir_n(fs_dir_t *zdp, struct fs_dirent *entries,
+		 struct fs_dirent_pos *pos, int num, int *err);
+
 /**
  * @brief Directory close
  *
@@ -390,6 +422,23 @@ int fs_opendir_cluster(fs_dir_t *zdp, const char *path, unsigned int cluster, un
 
 int fs_open_cluster(fs_file_t *zfp, char *dir, u32_t cluster, u32_t blk_ofs);
 
+/**
+ * @brief Map the runs of contiguous clusters of a file
+ *
+ * Seeks find the cluster in the map instead of following the cluster
+ * chain, and reads of whole sectors cross contiguous clusters in one
+ * disk read. The file must not grow while it is mapped, the map is
+ * freed by fs_close.
+ *
+ * @param zfp Pointer to the file object
+ * @param max_runs Most runs mapped, a more fragmented file is not mapped
+ *
+ * @retval runs Number of runs in the map
+ * @retval -ENOMEM File has more runs than max_runs, or no memory
+ * @retval -ENOTSUP Fast seek is not enabled
+ */
+int fs_extent_map(fs_file_t *zfp, int max_runs);
+
 /**
  * @}
  */
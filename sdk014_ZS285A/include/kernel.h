@@ -212,6 +212,24 @@ struct _thread_stack_info {
 typedef struct _thread_stack_info _thread_stack_info_t;
 #endif /* CONFIG_THREAD_STACK_INFO */
 
+#ifdef CONFIG_CPU_SCHED_HIST
+/*
+ * Bucket 0 counts times below 1 us, bucket n counts [2^(n-1), 2^n) us,
+ * the last bucket counts everything above.
+ */
+#define K_SCHED_HIST_BUCKETS	16
+
+/* Scheduling histograms of a thread */
+struct k_sched_hist {
+	/* run slice: switch in to switch out */
+	u16_t run[K_SCHED_HIST_BUCKETS];
+	/* ready latency: wake or preempt to switch in */
+	u16_t wait[K_SCHED_HIST_BUCKETS];
+	u32_t run_max;
+	u32_t wait_max;
+};
+#endif /* CONFIG_CPU_SCHED_HIST */
+
 struct k_thread {
 
 	struct _thread_base base;
@@ -258,6 +276,12 @@ struct k_thread {
     u32_t last_time;
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	/* cycle when it became ready, 0 if not waiting for cpu */
+	u32_t ready_time;
+	struct k_sched_hist sched_hist;
+#endif
+
 #ifdef CONFIG_THREAD_TIMER
 	sys_dlist_t thread_timer_q;
 #endif
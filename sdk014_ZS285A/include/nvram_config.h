@@ -22,6 +22,9 @@ int nvram_config_clear(int len);
 int nvram_config_clear_all(void);
 void nvram_config_dump(void);
 
+/* write pending configs of write back journal to flash */
+int nvram_config_sync(void);
+
 int nvram_config_get_factory(const char *name, void *data, int max_len);
 int nvram_config_set_factory(const char *name, const void *data, int len);
 
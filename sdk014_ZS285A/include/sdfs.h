@@ -50,7 +50,9 @@ struct sd_dir
 #define sd_free(x)
 #endif
 
+#ifndef memcpy_flash_data
 #define memcpy_flash_data memcpy
+#endif
 
 struct sd_file * sd_fopen (const char *filename);
 void sd_fclose(struct sd_file *sd_file);
@@ -33,6 +33,57 @@ static uint8_t block_thread_prio = 0xff;
 static uint16_t block_time_ms;
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+static int sched_hist_started;
+static u16_t isr_hist[K_SCHED_HIST_BUCKETS];
+static u32_t isr_hist_max;
+
+/* a power of 2 bucket by microsecond, counters saturate */
+static inline void sched_hist_add(u16_t *hist, u32_t *max_cycles, u32_t cycles)
+{
+	unsigned int i;
+
+	i = find_msb_set(cycles / (sys_clock_hw_cycles_per_sec / 1000000));
+	if (i >= K_SCHED_HIST_BUCKETS)
+		i = K_SCHED_HIST_BUCKETS - 1;
+
+	if (hist[i] != 0xffff)
+		hist[i]++;
+
+	if (cycles > *max_cycles)
+		*max_cycles = cycles;
+}
+
+static void sched_hist_switch(struct k_thread *from, struct k_thread *to)
+{
+	struct k_sched_hist *hist;
+	u32_t curr_time = k_cycle_get_32();
+
+	if (sched_hist_started) {
+		hist = &from->sched_hist;
+		sched_hist_add(hist->run, &hist->run_max,
+			       RUNNING_CYCLES(curr_time, from->start_time));
+
+		hist = &to->sched_hist;
+		if (to->ready_time)
+			sched_hist_add(hist->wait, &hist->wait_max,
+				       RUNNING_CYCLES(curr_time, to->ready_time));
+	}
+
+	/* a preempted thread waits for cpu from now on */
+	from->ready_time = _is_thread_ready(from) ? (curr_time | 1) : 0;
+	to->ready_time = 0;
+	to->start_time = curr_time;
+}
+
+void _sys_cpuload_isr_stat(u32_t start_time)
+{
+	if (sched_hist_started)
+		sched_hist_add(isr_hist, &isr_hist_max,
+			       RUNNING_CYCLES(k_cycle_get_32(), start_time));
+}
+#endif
+
 #ifdef CONFIG_CPU_LOAD_DEBUG
 static u32_t cpuload_high_prio_ivt_cycles;
 static u32_t cpuload_total_cycles;
@@ -84,6 +135,10 @@ void _sys_cpuload_context_switch(struct k_thread *from, struct k_thread *to)
 	TRACE_TASK_SWITCH(from, to);
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	sched_hist_switch(from, to);
+#endif
+
 #ifndef CONFIG_CPU_LOAD_DEBUG
 	if (!cpuload_started)
 		return;
@@ -348,3 +403,125 @@ void thread_block_stat_stop(void)
 }
 #endif
 
+
+#ifdef CONFIG_CPU_SCHED_HIST
+void cpuload_hist_clear(void)
+{
+	struct k_thread *thread_list;
+	unsigned int key;
+
+	key = irq_lock();
+
+	thread_list = (struct k_thread *)(_kernel.threads);
+	while (thread_list != NULL) {
+		memset(&thread_list->sched_hist, 0, sizeof(thread_list->sched_hist));
+		thread_list = (struct k_thread *)thread_list->next_thread;
+	}
+
+	memset(isr_hist, 0, sizeof(isr_hist));
+	isr_hist_max = 0;
+
+	irq_unlock(key);
+}
+
+void cpuload_hist_start(void)
+{
+	cpuload_hist_clear();
+	sched_hist_started = 1;
+}
+
+void cpuload_hist_stop(void)
+{
+	sched_hist_started = 0;
+}
+
+static void cpuload_hist_print(const char *name, const u16_t *hist, u32_t max_cycles)
+{
+	int i;
+
+	printk("  %s", name);
+	for (i = 0; i < K_SCHED_HIST_BUCKETS; i++)
+		printk(" %5d", hist[i]);
+	printk("  max %d\n", SYS_CLOCK_HW_CYCLES_TO_NS_AVG(max_cycles, 1000));
+}
+
+void cpuload_hist_show(void)
+{
+	struct k_thread *thread_list;
+	struct k_sched_hist hist;
+	unsigned int key;
+	int i, curr_prio;
+
+	printk(" us  ");
+	printk(" %5s", "<1");
+	for (i = 1; i < K_SCHED_HIST_BUCKETS; i++) {
+		if (i <= 10)
+			printk(" %5d", 1 << (i - 1));
+		else
+			printk(" %4dk", 1 << (i - 11));
+	}
+	printk("\n");
+
+	key = irq_lock();
+
+	thread_list = (struct k_thread *)(_kernel.threads);
+	while (thread_list != NULL) {
+		hist = thread_list->sched_hist;
+		curr_prio = k_thread_priority_get(thread_list);
+		irq_unlock(key);
+
+		printk("%p: prio %d\n", thread_list, curr_prio);
+		cpuload_hist_print("run ", hist.run, hist.run_max);
+		cpuload_hist_print("wait", hist.wait, hist.wait_max);
+
+		key = irq_lock();
+		thread_list = (struct k_thread *)thread_list->next_thread;
+	}
+
+	irq_unlock(key);
+
+	printk("isr:\n");
+	cpuload_hist_print("run ", isr_hist, isr_hist_max);
+}
+
+int cpuload_hist_dump(void *buf, int size)
+{
+	struct cpuload_hist_head *head = buf;
+	struct cpuload_hist_thread *item;
+	struct k_thread *thread_list;
+	unsigned int key;
+
+	if (size < sizeof(struct cpuload_hist_head))
+		return -ENOMEM;
+
+	head->magic = CPULOAD_HIST_MAGIC;
+	head->cycles_per_sec = sys_clock_hw_cycles_per_sec;
+	head->buckets = K_SCHED_HIST_BUCKETS;
+	head->thread_cnt = 0;
+
+	item = (struct cpuload_hist_thread *)(head + 1);
+
+	key = irq_lock();
+
+	memcpy(head->isr, isr_hist, sizeof(isr_hist));
+	head->isr_max = isr_hist_max;
+
+	thread_list = (struct k_thread *)(_kernel.threads);
+	while (thread_list != NULL) {
+		if ((char *)(item + 1) > (char *)buf + size)
+			break;
+
+		item->thread = (u32_t)thread_list;
+		item->prio = thread_list->base.prio;
+		item->hist = thread_list->sched_hist;
+		item++;
+		head->thread_cnt++;
+
+		thread_list = (struct k_thread *)thread_list->next_thread;
+	}
+
+	irq_unlock(key);
+
+	return (char *)item - (char *)buf;
+}
+#endif
@@ -187,6 +187,11 @@ static ALWAYS_INLINE void _new_thread_init(struct k_thread *thread,
 	thread->start_time = 0;
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	thread->ready_time = 0;
+	memset(&thread->sched_hist, 0, sizeof(thread->sched_hist));
+#endif
+
 #ifdef CONFIG_THREAD_TIMER
 	sys_dlist_init(&thread->thread_timer_q);
 #endif
@@ -450,9 +450,18 @@ static inline void _mark_thread_as_dead(struct k_thread *thread)
 static inline void _thread_priority_set(struct k_thread *thread, int prio)
 {
 	if (_is_thread_ready(thread)) {
+#ifdef CONFIG_CPU_SCHED_HIST
+		u32_t ready_time = thread->ready_time;
+#endif
+
 		_remove_thread_from_ready_q(thread);
 		thread->base.prio = prio;
 		_add_thread_to_ready_q(thread);
+
+#ifdef CONFIG_CPU_SCHED_HIST
+		/* only the priority is changed, keep the wake time */
+		thread->ready_time = ready_time;
+#endif
 	} else {
 		thread->base.prio = prio;
 	}
@@ -3,6 +3,31 @@
 
 #define BUDDYS_SIZE (sizeof(((struct mem_info *)0)->buddys) / sizeof(((struct mem_info *)0)->buddys[0]))
 
+#ifdef CONFIG_BUDDY_ALLOC_TRACE
+
+#define BUDDY_TRACE_MALLOC      (0)
+#define BUDDY_TRACE_FREE        (1)
+#define BUDDY_TRACE_FAIL        (2)
+
+/* buddy_no bit7 set means whole pages, for BUDDY_TRACE_FAIL it is the error ret */
+struct buddy_trace_record
+{
+    uint32_t timestamp;
+    void *caller;
+    void *thread;
+    void *addr;
+    uint32_t size;
+    uint8_t type;
+    uint8_t buddy_no;
+    int8_t prio;
+    uint8_t reserved;
+};
+
+void buddy_trace_add(uint8_t type, void *addr, uint32_t size, void *caller, uint8_t buddy_no);
+void buddy_trace_dump(void);
+
+#endif
+
 #if 0
 
 #include <kernel_structs.h>
@@ -5,6 +5,7 @@
 #include <buddy_inner.h>
 #include <page_inner.h>
 #include <mem_buddy.h>
+#include <alloc_inner.h>
 
 extern void pagepool_use_dump(uint32_t use_size);
 
@@ -218,5 +219,9 @@ void mem_buddy_dump_info(u32_t dump_detail)
         _mem_buddy_thread_heap_dump();
 #endif
     }
+
+#ifdef CONFIG_BUDDY_ALLOC_TRACE
+    buddy_trace_dump();
+#endif
 }
 
@@ -151,8 +151,12 @@ void mem_buddy_free(void *where, struct mem_info *mem_info, void *caller)
 
 	    //printk("pagenum %d free pagenum %d \n", page_num, freepage_num[0]);
 	}
-	
+
 	sys_irq_unlock(&flags);
+
+#ifdef CONFIG_BUDDY_ALLOC_TRACE
+	buddy_trace_add(BUDDY_TRACE_FREE, where, size, caller, buddy_no);
+#endif
 } 
 
 #if 0
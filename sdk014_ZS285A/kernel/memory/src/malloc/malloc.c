@@ -126,6 +126,11 @@ void * mem_buddy_malloc(int size, int need_size, struct mem_info *mem_info, void
 success:
 	sys_irq_unlock(&flags);
 
+#ifdef CONFIG_BUDDY_ALLOC_TRACE
+	buddy_trace_add(BUDDY_TRACE_MALLOC, addr, size, caller,
+		pagepool_convert_addr_to_pageindex(addr) | ((real > get_buddy_max()) ? 0x80 : 0));
+#endif
+
     size = ((size + 3) / 4) * 4;
 	buddy_debug.caller = PTR_DEFLATE(caller);
 	if(_is_in_isr()){
@@ -152,6 +157,9 @@ success:
 err_ret:
 	malloc_err_print(1, size, caller, result);
 	sys_irq_unlock(&flags);	
+#ifdef CONFIG_BUDDY_ALLOC_TRACE
+	buddy_trace_add(BUDDY_TRACE_FAIL, NULL, size, caller, result);
+#endif
     return NULL;
 }
 
@@ -0,0 +1,64 @@
+#include "heap.h"
+#ifdef CONFIG_TRACE_EVENT
+#include <trace.h>
+#endif
+
+#include <kernel.h>
+#include <kernel_structs.h>
+
+static struct buddy_trace_record buddy_trace_ring[CONFIG_BUDDY_ALLOC_TRACE_NUM];
+static uint32_t buddy_trace_cnt;
+
+void buddy_trace_add(uint8_t type, void *addr, uint32_t size, void *caller, uint8_t buddy_no)
+{
+    SYS_IRQ_FLAGS flags;
+    struct buddy_trace_record record;
+
+    record.timestamp = k_cycle_get_32();
+    record.caller = caller;
+    record.addr = addr;
+    record.size = size;
+    record.type = type;
+    record.buddy_no = buddy_no;
+    record.reserved = 0;
+
+    if(_is_in_isr()){
+        record.thread = NULL;
+        record.prio = INVALID_THREAD_PRIO;
+    }else{
+        record.thread = k_current_get();
+        record.prio = k_thread_priority_get(record.thread);
+    }
+
+    sys_irq_lock(&flags);
+    buddy_trace_ring[buddy_trace_cnt % CONFIG_BUDDY_ALLOC_TRACE_NUM] = record;
+    buddy_trace_cnt++;
+    sys_irq_unlock(&flags);
+
+#ifdef CONFIG_TRACE_EVENT
+    TRACE_BUDDY(type | (buddy_no << 8) | ((uint8_t)record.prio << 16),
+        (uint32_t)addr, size, (uint32_t)caller, (uint32_t)record.thread);
+#endif
+}
+
+/* one line per record, parsed by scripts/buddy_replay */
+void buddy_trace_dump(void)
+{
+    static const char type_name[] = { 'a', 'f', 'e' };
+    struct buddy_trace_record *record;
+    uint32_t i, start;
+
+    start = (buddy_trace_cnt > CONFIG_BUDDY_ALLOC_TRACE_NUM) ?
+        (buddy_trace_cnt - CONFIG_BUDDY_ALLOC_TRACE_NUM) : 0;
+
+    printk("buddy trace: %u records, last %u kept\n", buddy_trace_cnt,
+        buddy_trace_cnt - start);
+
+    for(i = start; i < buddy_trace_cnt; i++){
+        record = &buddy_trace_ring[i % CONFIG_BUDDY_ALLOC_TRACE_NUM];
+        printk("buddy_trace %c %u %p %d %p %p %u %d\n",
+            type_name[record->type], record->timestamp, record->thread,
+            record->prio, record->caller, record->addr, record->size,
+            record->buddy_no);
+    }
+}
@@ -86,6 +86,10 @@ void _add_thread_to_ready_q(struct k_thread *thread)
 	_ready_q.cache = thread;
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	thread->ready_time = k_cycle_get_32() | 1;
+#endif
+
 	sys_trace_thread_ready(thread);
 }
 
@@ -116,6 +120,11 @@ void _remove_thread_from_ready_q(struct k_thread *thread)
 	sys_dlist_remove(&thread->base.k_q_node);
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+	/* suspended or pended before it runs, the wait ends here */
+	thread->ready_time = 0;
+#endif
+
 	sys_trace_thread_pend(thread);
 }
 
@@ -0,0 +1,821 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file streaming json tokenizer and encoder
+ *
+ * The tokenizer is pushed chunks of any size as they are received and
+ * reports tokens through a callback, the encoder writes to a stream
+ * through a small buffer. Neither allocates memory.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/types.h>
+
+#include "json_stream.h"
+
+enum {
+	LEX_NONE,
+	LEX_STRING,
+	LEX_STRING_ESC,
+	LEX_STRING_UNICODE,
+	LEX_NUMBER,
+	LEX_LITERAL,
+};
+
+enum {
+	EXPECT_VALUE,
+	EXPECT_VALUE_OR_END,
+	EXPECT_KEY,
+	EXPECT_KEY_OR_END,
+	EXPECT_COLON,
+	EXPECT_COMMA_OR_END,
+	EXPECT_DONE,
+};
+
+static const char *literal_of(u8_t type)
+{
+	switch (type) {
+	case JSON_TOK_TRUE:
+		return "true";
+	case JSON_TOK_FALSE:
+		return "false";
+	default:
+		return "null";
+	}
+}
+
+static bool in_object(struct json_tokenizer *tk)
+{
+	return tk->stack & BIT(tk->depth - 1);
+}
+
+static int tk_error(struct json_tokenizer *tk, int error)
+{
+	tk->error = error;
+	return error;
+}
+
+static int tk_append(struct json_tokenizer *tk, const char *bytes, size_t len)
+{
+	if (len > tk->buf_size - tk->buf_len) {
+		return tk_error(tk, -ENOSPC);
+	}
+
+	memcpy(tk->buf + tk->buf_len, bytes, len);
+	tk->buf_len += len;
+
+	return 0;
+}
+
+static int tk_emit(struct json_tokenizer *tk, enum json_tokens type,
+		   const char *start, size_t len)
+{
+	struct json_stream_token token;
+	int ret;
+
+	token.type = type;
+	token.key = false;
+	token.depth = tk->depth;
+	token.start = start;
+	token.len = len;
+
+	if (type == JSON_TOK_STRING && tk->expect == EXPECT_COLON) {
+		token.key = true;
+	}
+
+	ret = tk->cb(&token, tk->data);
+	if (ret < 0) {
+		return tk_error(tk, ret);
+	}
+
+	return 0;
+}
+
+/* token of a string or number ends, run is its tail in this chunk */
+static int tk_emit_run(struct json_tokenizer *tk, enum json_tokens type,
+		       const char *run, size_t len)
+{
+	int ret;
+
+	if (!tk->copy) {
+		return tk_emit(tk, type, run, len);
+	}
+
+	ret = tk_append(tk, run, len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	len = tk->buf_len;
+	tk->copy = false;
+	tk->buf_len = 0;
+
+	return tk_emit(tk, type, tk->buf, len);
+}
+
+static void after_value(struct json_tokenizer *tk)
+{
+	tk->expect = tk->depth ? EXPECT_COMMA_OR_END : EXPECT_DONE;
+}
+
+static bool value_allowed(struct json_tokenizer *tk)
+{
+	return tk->expect == EXPECT_VALUE || tk->expect == EXPECT_VALUE_OR_END;
+}
+
+static int container_start(struct json_tokenizer *tk, enum json_tokens type)
+{
+	int ret;
+
+	if (!value_allowed(tk)) {
+		return tk_error(tk, -EINVAL);
+	}
+
+	if (tk->depth >= JSON_STREAM_MAX_DEPTH) {
+		return tk_error(tk, -ENOSPC);
+	}
+
+	ret = tk_emit(tk, type, NULL, 0);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (type == JSON_TOK_OBJECT_START) {
+		tk->stack |= BIT(tk->depth);
+		tk->expect = EXPECT_KEY_OR_END;
+	} else {
+		tk->stack &= ~BIT(tk->depth);
+		tk->expect = EXPECT_VALUE_OR_END;
+	}
+	tk->depth++;
+
+	return 0;
+}
+
+static int container_end(struct json_tokenizer *tk, enum json_tokens type)
+{
+	bool object = type == JSON_TOK_OBJECT_END;
+
+	if (!tk->depth || in_object(tk) != object) {
+		return tk_error(tk, -EINVAL);
+	}
+
+	if (tk->expect != EXPECT_COMMA_OR_END &&
+	    tk->expect != (object ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END)) {
+		return tk_error(tk, -EINVAL);
+	}
+
+	tk->depth--;
+	after_value(tk);
+
+	return tk_emit(tk, type, NULL, 0);
+}
+
+static int put_utf8(struct json_tokenizer *tk, u32_t code)
+{
+	char utf8[4];
+	size_t len;
+
+	if (code < 0x80) {
+		utf8[0] = code;
+		len = 1;
+	} else if (code < 0x800) {
+		utf8[0] = 0xc0 | (code >> 6);
+		utf8[1] = 0x80 | (code & 0x3f);
+		len = 2;
+	} else if (code < 0x10000) {
+		utf8[0] = 0xe0 | (code >> 12);
+		utf8[1] = 0x80 | ((code >> 6) & 0x3f);
+		utf8[2] = 0x80 | (code & 0x3f);
+		len = 3;
+	} else {
+		utf8[0] = 0xf0 | (code >> 18);
+		utf8[1] = 0x80 | ((code >> 12) & 0x3f);
+		utf8[2] = 0x80 | ((code >> 6) & 0x3f);
+		utf8[3] = 0x80 | (code & 0x3f);
+		len = 4;
+	}
+
+	return tk_append(tk, utf8, len);
+}
+
+static int unescape(struct json_tokenizer *tk, char chr)
+{
+	switch (chr) {
+	case '"':
+	case '\\':
+	case '/':
+		break;
+	case 'b':
+		chr = '\b';
+		break;
+	case 'f':
+		chr = '\f';
+		break;
+	case 'n':
+		chr = '\n';
+		break;
+	case 'r':
+		chr = '\r';
+		break;
+	case 't':
+		chr = '\t';
+		break;
+	case 'u':
+		tk->lex = LEX_STRING_UNICODE;
+		tk->lit_pos = 0;
+		tk->ucode = 0;
+		return 0;
+	default:
+		return tk_error(tk, -EINVAL);
+	}
+
+	tk->lex = LEX_STRING;
+	return tk_append(tk, &chr, 1);
+}
+
+static int unescape_unicode(struct json_tokenizer *tk, char chr)
+{
+	u32_t code;
+
+	if (chr >= '0' && chr <= '9') {
+		tk->ucode = (tk->ucode << 4) | (chr - '0');
+	} else if ((chr | 0x20) >= 'a' && (chr | 0x20) <= 'f') {
+		tk->ucode = (tk->ucode << 4) | ((chr | 0x20) - 'a' + 10);
+	} else {
+		return tk_error(tk, -EINVAL);
+	}
+
+	if (++tk->lit_pos < 4) {
+		return 0;
+	}
+
+	tk->lex = LEX_STRING;
+	code = tk->ucode;
+
+	/* a surrogate pair is two escapes in a row */
+	if (code >= 0xd800 && code < 0xdc00) {
+		tk->usurrogate = code;
+		return 0;
+	}
+
+	if (code >= 0xdc00 && code < 0xe000 && tk->usurrogate) {
+		code = 0x10000 + ((tk->usurrogate - 0xd800) << 10) + (code - 0xdc00);
+	}
+	tk->usurrogate = 0;
+
+	return put_utf8(tk, code);
+}
+
+static bool is_number_char(char chr)
+{
+	return (chr >= '0' && chr <= '9') || chr == '-' || chr == '+' ||
+	       chr == '.' || chr == 'e' || chr == 'E';
+}
+
+static int lex_value(struct json_tokenizer *tk, char chr)
+{
+	switch (chr) {
+	case '{':
+		return container_start(tk, JSON_TOK_OBJECT_START);
+	case '[':
+		return container_start(tk, JSON_TOK_LIST_START);
+	case '}':
+		return container_end(tk, JSON_TOK_OBJECT_END);
+	case ']':
+		return container_end(tk, JSON_TOK_LIST_END);
+	case ':':
+		if (tk->expect != EXPECT_COLON) {
+			return tk_error(tk, -EINVAL);
+		}
+		tk->expect = EXPECT_VALUE;
+		return 0;
+	case ',':
+		if (tk->expect != EXPECT_COMMA_OR_END) {
+			return tk_error(tk, -EINVAL);
+		}
+		tk->expect = in_object(tk) ? EXPECT_KEY : EXPECT_VALUE;
+		return 0;
+	case '"':
+		if (!value_allowed(tk) && tk->expect != EXPECT_KEY &&
+		    tk->expect != EXPECT_KEY_OR_END) {
+			return tk_error(tk, -EINVAL);
+		}
+		tk->lex = LEX_STRING;
+		return 0;
+	case 't':
+	case 'f':
+	case 'n':
+		if (!value_allowed(tk)) {
+			return tk_error(tk, -EINVAL);
+		}
+		tk->lex = LEX_LITERAL;
+		tk->lit_type = chr;
+		tk->lit_pos = 1;
+		return 0;
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+		return 0;
+	default:
+		if ((chr >= '0' && chr <= '9') || chr == '-') {
+			if (!value_allowed(tk)) {
+				return tk_error(tk, -EINVAL);
+			}
+			tk->lex = LEX_NUMBER;
+			return 0;
+		}
+		return tk_error(tk, -EINVAL);
+	}
+}
+
+static int string_end(struct json_tokenizer *tk, const char *run, size_t len)
+{
+	bool key = tk->expect == EXPECT_KEY || tk->expect == EXPECT_KEY_OR_END;
+	int ret;
+
+	tk->lex = LEX_NONE;
+	tk->usurrogate = 0;
+
+	if (key) {
+		tk->expect = EXPECT_COLON;
+		return tk_emit_run(tk, JSON_TOK_STRING, run, len);
+	}
+
+	ret = tk_emit_run(tk, JSON_TOK_STRING, run, len);
+	after_value(tk);
+
+	return ret;
+}
+
+static int number_end(struct json_tokenizer *tk, const char *run, size_t len)
+{
+	int ret;
+
+	tk->lex = LEX_NONE;
+	ret = tk_emit_run(tk, JSON_TOK_NUMBER, run, len);
+	after_value(tk);
+
+	return ret;
+}
+
+void json_tokenizer_init(struct json_tokenizer *tk, char *buf, size_t buf_size,
+			 json_token_cb_t cb, void *data)
+{
+	memset(tk, 0, sizeof(*tk));
+
+	tk->cb = cb;
+	tk->data = data;
+	tk->buf = buf;
+	tk->buf_size = buf_size;
+	tk->lex = LEX_NONE;
+	tk->expect = EXPECT_VALUE;
+}
+
+int json_tokenizer_feed(struct json_tokenizer *tk, const char *json, size_t len)
+{
+	const char *pos = json;
+	const char *end = json + len;
+	const char *run;
+	const char *literal;
+	int ret = 0;
+
+	if (tk->error) {
+		return tk->error;
+	}
+
+	/* start of the string or number part in this chunk */
+	run = pos;
+
+	while (pos < end && !ret) {
+		char chr = *pos;
+
+		switch (tk->lex) {
+		case LEX_NONE:
+			pos++;
+			if (tk->expect == EXPECT_DONE && chr != ' ' && chr != '\t' &&
+			    chr != '\r' && chr != '\n') {
+				return tk_error(tk, -EINVAL);
+			}
+			ret = lex_value(tk, chr);
+			/* the first digit is part of the number */
+			run = (tk->lex == LEX_NUMBER) ? pos - 1 : pos;
+			break;
+
+		case LEX_STRING:
+			/* plain characters are not looked at one by one */
+			while (pos < end && *pos != '"' && *pos != '\\') {
+				pos++;
+			}
+
+			if (pos == end) {
+				break;
+			}
+
+			if (*pos == '"') {
+				ret = string_end(tk, run, pos - run);
+			} else {
+				tk->copy = true;
+				tk->lex = LEX_STRING_ESC;
+				ret = tk_append(tk, run, pos - run);
+			}
+			pos++;
+			run = pos;
+			break;
+
+		case LEX_STRING_ESC:
+			pos++;
+			ret = unescape(tk, chr);
+			run = pos;
+			break;
+
+		case LEX_STRING_UNICODE:
+			pos++;
+			ret = unescape_unicode(tk, chr);
+			run = pos;
+			break;
+
+		case LEX_NUMBER:
+			while (pos < end && is_number_char(*pos)) {
+				pos++;
+			}
+
+			if (pos < end) {
+				/* the delimiter is parsed as usual */
+				ret = number_end(tk, run, pos - run);
+				run = pos;
+			}
+			break;
+
+		case LEX_LITERAL:
+			pos++;
+			literal = literal_of(tk->lit_type);
+			if (chr != literal[tk->lit_pos]) {
+				return tk_error(tk, -EINVAL);
+			}
+
+			if (!literal[++tk->lit_pos]) {
+				tk->lex = LEX_NONE;
+				ret = tk_emit(tk, tk->lit_type, NULL, 0);
+				after_value(tk);
+			}
+			run = pos;
+			break;
+		}
+	}
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* keep the part of a token cut by the end of the chunk */
+	if (tk->lex == LEX_STRING || tk->lex == LEX_NUMBER) {
+		tk->copy = true;
+		return tk_append(tk, run, end - run);
+	}
+
+	return 0;
+}
+
+int json_tokenizer_finish(struct json_tokenizer *tk)
+{
+	int ret;
+
+	if (tk->error) {
+		return tk->error;
+	}
+
+	/* a number is only ended by a delimiter or by the input end */
+	if (tk->lex == LEX_NUMBER) {
+		ret = number_end(tk, NULL, 0);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (tk->lex != LEX_NONE || tk->expect != EXPECT_DONE) {
+		return tk_error(tk, -EINVAL);
+	}
+
+	return 0;
+}
+
+static int enc_flush(struct json_encoder *enc)
+{
+	int ret;
+
+	if (enc->len) {
+		ret = stream_write(enc->stream, (unsigned char *)enc->buf, enc->len);
+		if (ret != enc->len) {
+			enc->error = -EIO;
+			return enc->error;
+		}
+		enc->len = 0;
+	}
+
+	return 0;
+}
+
+static int enc_write(struct json_encoder *enc, const char *bytes, size_t len)
+{
+	size_t chunk;
+
+	if (enc->error) {
+		return enc->error;
+	}
+
+	while (len) {
+		if (enc->len == sizeof(enc->buf) && enc_flush(enc)) {
+			return enc->error;
+		}
+
+		chunk = min(len, sizeof(enc->buf) - enc->len);
+		memcpy(enc->buf + enc->len, bytes, chunk);
+		enc->len += chunk;
+		bytes += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static int enc_append(const char *bytes, size_t len, void *data)
+{
+	return enc_write(data, bytes, len);
+}
+
+static int enc_error(struct json_encoder *enc, int error)
+{
+	if (!enc->error) {
+		enc->error = error;
+	}
+
+	return enc->error;
+}
+
+static bool enc_in_object(struct json_encoder *enc)
+{
+	return enc->depth && (enc->stack & BIT(enc->depth - 1));
+}
+
+/* comma between elements, nothing between a key and its value */
+static int enc_element(struct json_encoder *enc)
+{
+	u32_t level;
+
+	if (!enc->depth) {
+		return 0;
+	}
+
+	level = BIT(enc->depth - 1);
+
+	if (enc->has_elem & level) {
+		return enc_write(enc, ",", 1);
+	}
+
+	enc->has_elem |= level;
+
+	return 0;
+}
+
+static int enc_value_prefix(struct json_encoder *enc)
+{
+	if (enc->error) {
+		return enc->error;
+	}
+
+	if (enc->after_key) {
+		enc->after_key = false;
+		return 0;
+	}
+
+	/* a value in an object needs a key */
+	if (enc_in_object(enc)) {
+		return enc_error(enc, -EINVAL);
+	}
+
+	return enc_element(enc);
+}
+
+static int enc_string(struct json_encoder *enc, const char *str)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *run;
+	char escaped[6];
+	int ret;
+
+	ret = enc_write(enc, "\"", 1);
+
+	for (run = str; !ret && *str; str++) {
+		unsigned char chr = *str;
+
+		if (chr >= 0x20 && chr != '"' && chr != '\\') {
+			continue;
+		}
+
+		ret = enc_write(enc, run, str - run);
+		run = str + 1;
+
+		escaped[0] = '\\';
+		switch (chr) {
+		case '"':
+		case '\\':
+			escaped[1] = chr;
+			break;
+		case '\b':
+			escaped[1] = 'b';
+			break;
+		case '\f':
+			escaped[1] = 'f';
+			break;
+		case '\n':
+			escaped[1] = 'n';
+			break;
+		case '\r':
+			escaped[1] = 'r';
+			break;
+		case '\t':
+			escaped[1] = 't';
+			break;
+		default:
+			escaped[1] = 'u';
+			escaped[2] = '0';
+			escaped[3] = '0';
+			escaped[4] = hex[chr >> 4];
+			escaped[5] = hex[chr & 0xf];
+			ret = ret ?: enc_write(enc, escaped, 6);
+			continue;
+		}
+
+		ret = ret ?: enc_write(enc, escaped, 2);
+	}
+
+	ret = ret ?: enc_write(enc, run, str - run);
+
+	return ret ?: enc_write(enc, "\"", 1);
+}
+
+static int enc_container_start(struct json_encoder *enc, bool object)
+{
+	int ret;
+
+	ret = enc_value_prefix(enc);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (enc->depth >= JSON_STREAM_MAX_DEPTH) {
+		return enc_error(enc, -ENOSPC);
+	}
+
+	if (object) {
+		enc->stack |= BIT(enc->depth);
+	} else {
+		enc->stack &= ~BIT(enc->depth);
+	}
+	enc->has_elem &= ~BIT(enc->depth);
+	enc->depth++;
+
+	return enc_write(enc, object ? "{" : "[", 1);
+}
+
+static int enc_container_end(struct json_encoder *enc, bool object)
+{
+	if (enc->error) {
+		return enc->error;
+	}
+
+	if (!enc->depth || enc->after_key || enc_in_object(enc) != object) {
+		return enc_error(enc, -EINVAL);
+	}
+
+	enc->depth--;
+
+	return enc_write(enc, object ? "}" : "]", 1);
+}
+
+void json_encoder_init(struct json_encoder *enc, io_stream_t stream)
+{
+	memset(enc, 0, offsetof(struct json_encoder, buf));
+	enc->stream = stream;
+}
+
+int json_encoder_object_start(struct json_encoder *enc)
+{
+	return enc_container_start(enc, true);
+}
+
+int json_encoder_object_end(struct json_encoder *enc)
+{
+	return enc_container_end(enc, true);
+}
+
+int json_encoder_array_start(struct json_encoder *enc)
+{
+	return enc_container_start(enc, false);
+}
+
+int json_encoder_array_end(struct json_encoder *enc)
+{
+	return enc_container_end(enc, false);
+}
+
+int json_encoder_key(struct json_encoder *enc, const char *key)
+{
+	int ret;
+
+	if (enc->error) {
+		return enc->error;
+	}
+
+	if (!enc_in_object(enc) || enc->after_key) {
+		return enc_error(enc, -EINVAL);
+	}
+
+	ret = enc_element(enc);
+	ret = ret ?: enc_string(enc, key);
+	ret = ret ?: enc_write(enc, ":", 1);
+
+	enc->after_key = true;
+
+	return ret;
+}
+
+int json_encoder_string(struct json_encoder *enc, const char *str)
+{
+	return enc_value_prefix(enc) ?: enc_string(enc, str);
+}
+
+int json_encoder_number(struct json_encoder *enc, s32_t num)
+{
+	char buf[12];
+	char *pos = buf + sizeof(buf);
+	u32_t value = num < 0 ? -(u32_t)num : num;
+	int ret;
+
+	ret = enc_value_prefix(enc);
+	if (ret < 0) {
+		return ret;
+	}
+
+	do {
+		*--pos = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	if (num < 0) {
+		*--pos = '-';
+	}
+
+	return enc_write(enc, pos, buf + sizeof(buf) - pos);
+}
+
+int json_encoder_bool(struct json_encoder *enc, bool value)
+{
+	return enc_value_prefix(enc) ?:
+	       (value ? enc_write(enc, "true", 4) : enc_write(enc, "false", 5));
+}
+
+int json_encoder_null(struct json_encoder *enc)
+{
+	return enc_value_prefix(enc) ?: enc_write(enc, "null", 4);
+}
+
+int json_encoder_obj(struct json_encoder *enc,
+		     const struct json_obj_descr *descr, size_t descr_len,
+		     const void *val)
+{
+	int ret;
+
+	ret = enc_value_prefix(enc);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = json_obj_encode(descr, descr_len, val, enc_append, enc);
+
+	return enc->error ?: ret;
+}
+
+int json_encoder_finish(struct json_encoder *enc)
+{
+	if (enc->error) {
+		return enc->error;
+	}
+
+	if (enc_flush(enc)) {
+		return enc->error;
+	}
+
+	if (enc->depth || enc->after_key) {
+		return enc_error(enc, -EINVAL);
+	}
+
+	return 0;
+}
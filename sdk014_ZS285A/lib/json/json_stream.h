@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __JSON_STREAM_H
+#define __JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stream.h>
+#include "json.h"
+
+/* nesting of objects and arrays, one bit each in the container stack */
+#define JSON_STREAM_MAX_DEPTH	32
+
+#define JSON_ENCODER_BUF_SIZE	64
+
+/**
+ * @brief Token reported by the streaming tokenizer
+ *
+ * Strings are unescaped. A token that lies in one chunk and has no
+ * escape points into the chunk, otherwise it points into the scratch
+ * buffer of the tokenizer. Either way it is only valid in the callback
+ * and is not NUL terminated.
+ */
+struct json_stream_token {
+	/* JSON_TOK_OBJECT_START/END, JSON_TOK_LIST_START/END,
+	 * JSON_TOK_STRING, JSON_TOK_NUMBER, JSON_TOK_TRUE,
+	 * JSON_TOK_FALSE or JSON_TOK_NULL
+	 */
+	enum json_tokens type;
+	/* the string is an object key */
+	bool key;
+	/* nesting level, 0 for the top level value */
+	u8_t depth;
+	const char *start;
+	size_t len;
+};
+
+/**
+ * @brief Function pointer type to receive tokens
+ *
+ * @return a negative number to stop the tokenizer, the number is
+ * returned by json_tokenizer_feed(); 0 to continue.
+ */
+typedef int (*json_token_cb_t)(const struct json_stream_token *token,
+			       void *data);
+
+struct json_tokenizer {
+	json_token_cb_t cb;
+	void *data;
+
+	/* scratch for a string or number split across chunks or escaped */
+	char *buf;
+	u16_t buf_size;
+	u16_t buf_len;
+	bool copy;
+
+	u8_t lex;
+	u8_t expect;
+	u8_t depth;
+	u8_t lit_pos;
+	u8_t lit_type;
+	u16_t ucode;
+	u16_t usurrogate;
+	/* bit n set if nesting level n is an object */
+	u32_t stack;
+	int error;
+};
+
+/**
+ * @brief Prepares a tokenizer to parse one JSON value
+ *
+ * @param tk Tokenizer, the caller owns the storage
+ *
+ * @param buf Scratch buffer, must hold the longest string or number
+ *
+ * @param buf_size Size of scratch buffer
+ *
+ * @param cb Function called for every token
+ *
+ * @param data User-provided pointer passed to @param cb
+ */
+void json_tokenizer_init(struct json_tokenizer *tk, char *buf, size_t buf_size,
+			 json_token_cb_t cb, void *data);
+
+/**
+ * @brief Parses the next chunk of input
+ *
+ * Chunks may be split at any byte, the tokenizer keeps its state
+ * between calls.
+ *
+ * @return 0 on success, -EINVAL on a syntax error, -ENOSPC if a token
+ * does not fit in the scratch buffer or nesting is too deep, or the
+ * negative value returned by the callback. Errors are sticky.
+ */
+int json_tokenizer_feed(struct json_tokenizer *tk, const char *json, size_t len);
+
+/**
+ * @brief Ends the input
+ *
+ * @return 0 if one complete value has been parsed, a negative value
+ * otherwise.
+ */
+int json_tokenizer_finish(struct json_tokenizer *tk);
+
+struct json_encoder {
+	io_stream_t stream;
+	u16_t len;
+	u8_t depth;
+	bool after_key;
+	/* bit n set if nesting level n is an object */
+	u32_t stack;
+	/* bit n set if nesting level n has an element already */
+	u32_t has_elem;
+	int error;
+	char buf[JSON_ENCODER_BUF_SIZE];
+};
+
+/**
+ * @brief Prepares an encoder writing to an opened stream
+ *
+ * Output is collected in the encoder and written to the stream
+ * JSON_ENCODER_BUF_SIZE bytes at a time. Commas and colons are added
+ * by the encoder. All functions return 0 on success or a negative
+ * value on error; errors are sticky.
+ */
+void json_encoder_init(struct json_encoder *enc, io_stream_t stream);
+
+int json_encoder_object_start(struct json_encoder *enc);
+int json_encoder_object_end(struct json_encoder *enc);
+int json_encoder_array_start(struct json_encoder *enc);
+int json_encoder_array_end(struct json_encoder *enc);
+int json_encoder_key(struct json_encoder *enc, const char *key);
+int json_encoder_string(struct json_encoder *enc, const char *str);
+int json_encoder_number(struct json_encoder *enc, s32_t num);
+int json_encoder_bool(struct json_encoder *enc, bool value);
+int json_encoder_null(struct json_encoder *enc);
+
+/**
+ * @brief Writes the buffered output to the stream
+ *
+ * @return 0 if a complete value has been written, a negative value
+ * otherwise.
+ */
+int json_encoder_finish(struct json_encoder *enc);
+
+/**
+ * @brief Encodes a described object as a value of the encoder
+ *
+ * Same as json_obj_encode(), the output goes to the encoder, so an
+ * object can be nested in hand-written output.
+ */
+int json_encoder_obj(struct json_encoder *enc,
+		     const struct json_obj_descr *descr, size_t descr_len,
+		     const void *val);
+
+#endif /* __JSON_STREAM_H */
@@ -79,6 +79,31 @@ void * app_mem_malloc(unsigned int num_bytes);
 void app_mem_free(void *ptr);
 
 
+/**
+ * @brief attach a mem magazine to thread.
+ *
+ * Blocks freed by the thread are kept in its magazine and reused by
+ * its next mem_malloc of the same size, without locking the shared slab.
+ *
+ * @param tid thread id.
+ *
+ * @return 0 if successful, -ENOMEM if all magazines are used,
+ * -ENOTSUP if magazine not enabled.
+ */
+int mem_magazine_attach(k_tid_t tid);
+
+/**
+ * @brief detach mem magazine of thread.
+ *
+ * Blocks kept in the magazine are given back to the shared slab. Must be
+ * called by the thread itself or after the thread stopped.
+ *
+ * @param tid thread id.
+ *
+ * @return N/A
+ */
+void mem_magazine_detach(k_tid_t tid);
+
 /**
  * @brief dump mem info.
  *
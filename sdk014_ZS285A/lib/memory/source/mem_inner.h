@@ -44,12 +44,56 @@ struct slab_info
 #endif
 };
 
+#ifdef CONFIG_SLAB_STATISTICS
+#define SLAB_STAT_HIST_NUM 8
+
+struct slab_stat
+{
+	/** allocations served by this slab */
+	uint32_t alloc_cnt;
+	/** sum of block_size - num_bytes of these allocations */
+	uint32_t frag_bytes;
+	/** requests fit this slab first but served by a bigger one */
+	uint16_t spill_cnt;
+	/** dynamic slabs generated for this slab */
+	uint16_t dynamic_cnt;
+	/** requested sizes between previous block size and this block size */
+	uint16_t hist[SLAB_STAT_HIST_NUM];
+};
+
+struct slabs_stat
+{
+	/** requests no slab could serve */
+	uint32_t fail_cnt;
+	struct slab_stat slab[CONFIG_SLAB_TOTAL_NUM];
+};
+#endif
+
+#ifdef CONFIG_SLAB_MAGAZINE
+struct slab_magazine
+{
+	/** thread the magazine attached to, NULL if unused */
+	k_tid_t owner;
+	uint32_t hit_cnt;
+	uint32_t miss_cnt;
+	/** num of blocks kept for each slab */
+	uint8_t rounds[CONFIG_SLAB_TOTAL_NUM];
+	void * blocks[CONFIG_SLAB_TOTAL_NUM][CONFIG_SLAB_MAGAZINE_SIZE];
+};
+#endif
+
 struct slabs_info
 {
 	uint16_t slab_num;
 	uint16_t slab_flag;
 	uint8_t * max_used;
 	uint16_t * max_size;
+#ifdef CONFIG_SLAB_STATISTICS
+	struct slabs_stat * stat;
+#endif
+#ifdef CONFIG_SLAB_MAGAZINE
+	struct slab_magazine * magazines;
+#endif
 	struct slab_info slabs[CONFIG_SLAB_TOTAL_NUM];
 };
 
@@ -59,6 +103,10 @@ void mem_slabs_init(struct slabs_info * slabs);
 void mem_slabs_free(struct slabs_info * slabs, void *ptr);
 void *mem_slabs_malloc(struct slabs_info * slabs, unsigned int num_bytes);
 void mem_slabs_dump(struct slabs_info * slabs,int index);
+#ifdef CONFIG_SLAB_MAGAZINE
+int mem_slabs_magazine_attach(struct slabs_info * slabs, k_tid_t tid);
+void mem_slabs_magazine_detach(struct slabs_info * slabs, k_tid_t tid);
+#endif
 #endif
 
 #ifdef CONFIG_APP_USED_MEM_PAGE
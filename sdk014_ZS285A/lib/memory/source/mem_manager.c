@@ -73,6 +73,22 @@ void mem_free(void *ptr)
 #endif
 }
 
+int mem_magazine_attach(k_tid_t tid)
+{
+#if defined(CONFIG_APP_USED_MEM_SLAB) && defined(CONFIG_SLAB_MAGAZINE)
+	return mem_slabs_magazine_attach((struct slabs_info *)&sys_slab, tid);
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void mem_magazine_detach(k_tid_t tid)
+{
+#if defined(CONFIG_APP_USED_MEM_SLAB) && defined(CONFIG_SLAB_MAGAZINE)
+	mem_slabs_magazine_detach((struct slabs_info *)&sys_slab, tid);
+#endif
+}
+
 void mem_manager_dump(void)
 {
 #ifdef CONFIG_APP_USED_MEM_SLAB
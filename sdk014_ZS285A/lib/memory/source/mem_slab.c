@@ -28,6 +28,14 @@ uint16_t system_max_size[CONFIG_SLAB_TOTAL_NUM];
 sys_slist_t dynamic_slab_list[CONFIG_SLAB_TOTAL_NUM];
 #endif
 
+#ifdef CONFIG_SLAB_STATISTICS
+struct slabs_stat system_slab_stat;
+#endif
+
+#ifdef CONFIG_SLAB_MAGAZINE
+struct slab_magazine system_slab_magazine[CONFIG_SLAB_MAGAZINE_THREADS];
+#endif
+
 #define CONFIG_SLAB_TOTAL_NUM 9
 
 #define SLAB_TOTAL_SIZE (CONFIG_SLAB0_BLOCK_SIZE * CONFIG_SLAB0_NUM_BLOCKS \
@@ -83,6 +91,12 @@ const struct  slabs_info sys_slab =
 	.max_used = system_max_used,
 	.max_size = system_max_size,
 	.slab_flag = SYSTEM_MEM_SLAB,
+#ifdef CONFIG_SLAB_STATISTICS
+	.stat = &system_slab_stat,
+#endif
+#ifdef CONFIG_SLAB_MAGAZINE
+	.magazines = system_slab_magazine,
+#endif
 	.slabs = {
 			 {
 				.slab = &mem_slab[0],
@@ -176,6 +190,71 @@ const struct  slabs_info sys_slab =
 			}
 };
 
+#ifdef CONFIG_SLAB_STATISTICS
+static void slab_stat_record(struct slabs_info *slabs, int slab_index,
+					unsigned int num_bytes)
+{
+	struct slabs_stat *stat = slabs->stat;
+	int first_fit = 0;
+	int lower = 0;
+	int range;
+
+	if (slab_index >= slabs->slab_num) {
+		stat->fail_cnt++;
+		return;
+	}
+
+	while (slabs->slabs[first_fit].block_size < num_bytes) {
+		lower = slabs->slabs[first_fit].block_size;
+		first_fit++;
+	}
+
+	/* bucket the request inside (lower, block_size] of the first fit slab */
+	range = slabs->slabs[first_fit].block_size - lower;
+	if (num_bytes > lower && range > 0) {
+		stat->slab[first_fit].hist[(num_bytes - lower - 1)
+					* SLAB_STAT_HIST_NUM / range]++;
+	} else {
+		stat->slab[first_fit].hist[0]++;
+	}
+
+	if (slab_index != first_fit)
+		stat->slab[first_fit].spill_cnt++;
+
+	stat->slab[slab_index].alloc_cnt++;
+	stat->slab[slab_index].frag_bytes +=
+			slabs->slabs[slab_index].block_size - num_bytes;
+}
+
+static void slab_stat_dump(struct slabs_info *slabs)
+{
+	struct slabs_stat *stat = slabs->stat;
+	struct slab_stat *slab_stat;
+	int i, j;
+
+	printk("slab statistics : failed %d\n", stat->fail_cnt);
+
+	for (i = 0 ; i < slabs->slab_num; i++) {
+		slab_stat = &stat->slab[i];
+		printk(" slab %d :block size %4d : alloc %6d, frag %8d (avg %4d),"
+			" spill %4d, dynamic %4d\n  hist:",
+			i,
+			slabs->slabs[i].block_size,
+			slab_stat->alloc_cnt,
+			slab_stat->frag_bytes,
+			slab_stat->alloc_cnt ?
+				slab_stat->frag_bytes / slab_stat->alloc_cnt : 0,
+			slab_stat->spill_cnt,
+			slab_stat->dynamic_cnt);
+
+		for (j = 0; j < SLAB_STAT_HIST_NUM; j++) {
+			printk(" %5d", slab_stat->hist[j]);
+		}
+		printk("\n");
+	}
+}
+#endif
+
 static int find_slab_by_addr(struct slabs_info * slabs, void * addr)
 {
 	int i = 0;
@@ -399,6 +478,10 @@ static bool generate_dynamic_slab(struct slabs_info *slabs,
 		return false;
 	}
 
+#ifdef CONFIG_SLAB_STATISTICS
+	slabs->stat->slab[son_slab_index].dynamic_cnt++;
+#endif
+
 begin_new_daynamic_slab:
 
 	iteration_index --;
@@ -515,6 +598,154 @@ static int find_slab_index(struct slabs_info *slabs, unsigned int num_bytes)
 	return target_slab_index;
 }
 
+#ifdef CONFIG_SLAB_MAGAZINE
+/*
+ * A magazine is only touched by its owner thread, and never from isr,
+ * so it needs neither irq lock nor atomic access.
+ */
+static struct slab_magazine *find_magazine(struct slabs_info *slabs, k_tid_t tid)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_SLAB_MAGAZINE_THREADS; i++) {
+		if (slabs->magazines[i].owner == tid)
+			return &slabs->magazines[i];
+	}
+
+	return NULL;
+}
+
+static void *malloc_from_magazine(struct slabs_info *slabs, unsigned int num_bytes)
+{
+	struct slab_magazine *magazine;
+	void *block_ptr;
+	unsigned int key;
+	int slab_index;
+
+	if (_is_in_isr())
+		return NULL;
+
+	magazine = find_magazine(slabs, k_current_get());
+	if (!magazine)
+		return NULL;
+
+	for (slab_index = 0; slab_index < slabs->slab_num; slab_index++) {
+		if (slabs->slabs[slab_index].block_size >= num_bytes)
+			break;
+	}
+
+	if (slab_index >= slabs->slab_num || !magazine->rounds[slab_index]) {
+		magazine->miss_cnt++;
+		return NULL;
+	}
+
+	block_ptr = magazine->blocks[slab_index][--magazine->rounds[slab_index]];
+	memset(block_ptr, 0, num_bytes);
+	magazine->hit_cnt++;
+
+	/* the shared statistics still need the lock */
+	key = irq_lock();
+	if (slabs->max_size[slab_index] < num_bytes)
+		slabs->max_size[slab_index] = num_bytes;
+#ifdef CONFIG_SLAB_STATISTICS
+	slab_stat_record(slabs, slab_index, num_bytes);
+#endif
+	irq_unlock(key);
+
+	return block_ptr;
+}
+
+static bool free_to_magazine(struct slabs_info *slabs, void *ptr)
+{
+	struct slab_magazine *magazine;
+	int slab_index;
+
+	if (_is_in_isr())
+		return false;
+
+	magazine = find_magazine(slabs, k_current_get());
+	if (!magazine)
+		return false;
+
+	slab_index = find_slab_by_addr(slabs, ptr);
+	if (slab_index >= slabs->slab_num
+		|| magazine->rounds[slab_index] >= CONFIG_SLAB_MAGAZINE_SIZE)
+		return false;
+
+	magazine->blocks[slab_index][magazine->rounds[slab_index]++] = ptr;
+	return true;
+}
+
+int mem_slabs_magazine_attach(struct slabs_info *slabs, k_tid_t tid)
+{
+	struct slab_magazine *magazine;
+	unsigned int key = irq_lock();
+
+	magazine = find_magazine(slabs, tid);
+	if (!magazine) {
+		magazine = find_magazine(slabs, NULL);
+		if (magazine) {
+			memset(magazine, 0, sizeof(*magazine));
+			magazine->owner = tid;
+		}
+	}
+
+	irq_unlock(key);
+
+	if (!magazine) {
+		SYS_LOG_WRN("no magazine for thread %p", tid);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void mem_slabs_magazine_detach(struct slabs_info *slabs, k_tid_t tid)
+{
+	struct slab_magazine *magazine;
+	unsigned int key;
+	int i;
+
+	if (!tid)
+		return;
+
+	magazine = find_magazine(slabs, tid);
+	if (!magazine)
+		return;
+
+	key = irq_lock();
+
+	magazine->owner = NULL;
+
+	for (i = 0; i < slabs->slab_num; i++) {
+		while (magazine->rounds[i]) {
+			free_to_stable_slab(slabs,
+					magazine->blocks[i][--magazine->rounds[i]]);
+		}
+	}
+
+	irq_unlock(key);
+}
+
+static void magazine_dump(struct slabs_info *slabs)
+{
+	struct slab_magazine *magazine;
+	int i, j, cached;
+
+	for (i = 0; i < CONFIG_SLAB_MAGAZINE_THREADS; i++) {
+		magazine = &slabs->magazines[i];
+		if (!magazine->owner)
+			continue;
+
+		for (j = 0, cached = 0; j < slabs->slab_num; j++)
+			cached += magazine->rounds[j];
+
+		printk(" magazine %d : thread %p hit %d miss %d cached %d\n",
+			i, magazine->owner, magazine->hit_cnt, magazine->miss_cnt, cached);
+	}
+}
+#endif
+
 static void dump_mem_hex(struct slabs_info *slabs, int slab_index)
 {
 	int length= slabs->slabs[slab_index].block_size *
@@ -558,8 +789,21 @@ static void dump_mem_hex(struct slabs_info *slabs, int slab_index)
 void * mem_slabs_malloc(struct slabs_info * slabs, unsigned int num_bytes)
 {
 	void * block_ptr = NULL;
-	unsigned int key = irq_lock();
-	int slab_index = find_slab_index(slabs, num_bytes);
+	unsigned int key;
+	int slab_index;
+
+#ifdef CONFIG_SLAB_MAGAZINE
+	block_ptr = malloc_from_magazine(slabs, num_bytes);
+	if (block_ptr != NULL) {
+	#ifdef CONFIG_SLAB_TRACE
+		printk("slab_trace a %d %p\n", num_bytes, block_ptr);
+	#endif
+		return block_ptr;
+	}
+#endif
+
+	key = irq_lock();
+	slab_index = find_slab_index(slabs, num_bytes);
 
 #ifdef DEBUG
 	SYS_LOG_DBG("Memory mem_malloc  num_bytes %d bytes begin",num_bytes);
@@ -599,18 +843,39 @@ END:
 	{
 //		dump_stack();
 		SYS_LOG_ERR("Memory allocation failed , num_bytes %d ", num_bytes);
+		slab_index = slabs->slab_num;
 	}
+#ifdef CONFIG_SLAB_STATISTICS
+	slab_stat_record(slabs, slab_index, num_bytes);
+#endif
+#ifdef CONFIG_SLAB_TRACE
+	printk("slab_trace a %d %p\n", num_bytes, block_ptr);
+#endif
 	irq_unlock(key);
 	return block_ptr;
 }
 
 void mem_slabs_free(struct slabs_info * slabs, void *ptr)
 {
-	unsigned int key = irq_lock();
+	unsigned int key;
+
+#ifdef CONFIG_SLAB_MAGAZINE
+	if (ptr != NULL && free_to_magazine(slabs, ptr)) {
+	#ifdef CONFIG_SLAB_TRACE
+		printk("slab_trace f %p\n", ptr);
+	#endif
+		return;
+	}
+#endif
+
+	key = irq_lock();
 
 #ifdef DEBUG
 	SYS_LOG_DBG("Memory Free  ptr %p begin",ptr);
 #endif
+#ifdef CONFIG_SLAB_TRACE
+	printk("slab_trace f %p\n", ptr);
+#endif
 
 	if (ptr != NULL)
 	{
@@ -712,6 +977,13 @@ void mem_slabs_dump(struct slabs_info * slabs, int index)
 	}
 #endif
 
+#ifdef CONFIG_SLAB_STATISTICS
+	slab_stat_dump(slabs);
+#endif
+#ifdef CONFIG_SLAB_MAGAZINE
+	magazine_dump(slabs);
+#endif
+
 	if(index >= 0 && index < slabs->slab_num)
 	{
 		dump_mem_hex(slabs, index);
@@ -208,6 +208,21 @@ void acts_ringbuf_free(struct acts_ringbuf *buf);
  */
 uint32_t acts_ringbuf_peek(struct acts_ringbuf *buf, void *data, uint32_t size);
 
+/**
+ * @brief Peek a ring buffer at offset.
+ *
+ * This routine peek data located @a offset elements after the head of
+ * a ring buffer, the head is not moved.
+ *
+ * @param buf Address of ring buffer.
+ * @param offset Offset from head in elements.
+ * @param data Address of data.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements successfully peek.
+ */
+uint32_t acts_ringbuf_peek_ofs(struct acts_ringbuf *buf, uint32_t offset, void *data, uint32_t size);
+
 /**
  * @brief Read a ring buffer.
  *
@@ -262,6 +277,23 @@ int acts_ringbuf_get_finish(struct acts_ringbuf *buf, uint32_t size);
  */
 uint32_t acts_ringbuf_put(struct acts_ringbuf *buf, const void *data, uint32_t size);
 
+/**
+ * @brief Write a ring buffer at offset without committing.
+ *
+ * This routine write data to the free space located @a offset elements
+ * after the tail of a ring buffer, the tail is not moved. Several segments
+ * can be gathered this way and then committed at once by
+ * @ref acts_ringbuf_fill_none or @ref acts_ringbuf_fill_none_n.
+ *
+ * @param buf Address of ring buffer.
+ * @param offset Offset from tail in elements.
+ * @param data Address of data.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements successfully written.
+ */
+uint32_t acts_ringbuf_put_ofs(struct acts_ringbuf *buf, uint32_t offset, const void *data, uint32_t size);
+
 /**
  * @brief Allocate buffer for writing data to a ring buffer.
  *
@@ -299,6 +331,36 @@ uint32_t acts_ringbuf_put_claim(struct acts_ringbuf *buf, void **data, uint32_t
  */
 int acts_ringbuf_put_finish(struct acts_ringbuf *buf, uint32_t size);
 
+/**
+ * @brief Write a single-producer/single-consumer ring buffer.
+ *
+ * Lock-free variant of @ref acts_ringbuf_put for a ring buffer that has
+ * exactly one producer and one consumer (thread, ISR or DSP). The consumer
+ * index is loaded with acquire ordering and the producer index is published
+ * with release ordering once for the whole batch, so no irq lock or mutex
+ * is required around the call.
+ *
+ * @param buf Address of ring buffer.
+ * @param data Address of data.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements successfully written, 0 if not enough space.
+ */
+uint32_t acts_ringbuf_put_n(struct acts_ringbuf *buf, const void *data, uint32_t size);
+
+/**
+ * @brief Read a single-producer/single-consumer ring buffer.
+ *
+ * Lock-free variant of @ref acts_ringbuf_get, see @ref acts_ringbuf_put_n.
+ *
+ * @param buf Address of ring buffer.
+ * @param data Address of data.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements successfully read, 0 if not enough data.
+ */
+uint32_t acts_ringbuf_get_n(struct acts_ringbuf *buf, void *data, uint32_t size);
+
 /**
  * @brief Copy a ring buffer.
  *
@@ -390,6 +452,34 @@ static inline uint32_t acts_ringbuf_space(struct acts_ringbuf *buf)
 	return buf->size - (buf->tail - buf->head);
 }
 
+/**
+ * @brief Determine data length in a single-producer/single-consumer ring buffer.
+ *
+ * Called by the consumer, the producer index is loaded with acquire ordering.
+ *
+ * @param buf Address of ring buffer.
+ *
+ * @return Ring buffer data length in elements.
+ */
+static inline uint32_t acts_ringbuf_length_n(struct acts_ringbuf *buf)
+{
+	return __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE) - buf->head;
+}
+
+/**
+ * @brief Determine free space in a single-producer/single-consumer ring buffer.
+ *
+ * Called by the producer, the consumer index is loaded with acquire ordering.
+ *
+ * @param buf Address of ring buffer.
+ *
+ * @return Ring buffer free space in elements.
+ */
+static inline uint32_t acts_ringbuf_space_n(struct acts_ringbuf *buf)
+{
+	return buf->size - (buf->tail - __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE));
+}
+
 /**
  * @brief Determine if a ring buffer is empty.
  *
@@ -460,6 +550,19 @@ static inline void acts_ringbuf_reset(struct acts_ringbuf *buf)
  */
 uint32_t acts_ringbuf_drop(struct acts_ringbuf *buf, uint32_t size);
 
+/**
+ * @brief Drop data of a single-producer/single-consumer ring buffer
+ *
+ * Lock-free variant of @ref acts_ringbuf_drop called by the consumer, the
+ * new head is published with release ordering, see @ref acts_ringbuf_put_n.
+ *
+ * @param buf Address of ring buffer.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements dropped in elements.
+ */
+uint32_t acts_ringbuf_drop_n(struct acts_ringbuf *buf, uint32_t size);
+
 /**
  * @brief Drop all data of a ring buffer
  *
@@ -489,6 +592,19 @@ uint32_t acts_ringbuf_fill(struct acts_ringbuf *buf, uint8_t c, uint32_t size);
  */
 uint32_t acts_ringbuf_fill_none(struct acts_ringbuf *buf, uint32_t size);
 
+/**
+ * @brief Fill no data of a single-producer/single-consumer ring buffer.
+ *
+ * Lock-free variant of @ref acts_ringbuf_fill_none called by the producer,
+ * the new tail is published with release ordering, see @ref acts_ringbuf_put_n.
+ *
+ * @param buf Address of ring buffer.
+ * @param size Size of data in elements.
+ *
+ * @return number of elements filled.
+ */
+uint32_t acts_ringbuf_fill_none_n(struct acts_ringbuf *buf, uint32_t size);
+
 /**
  * @brief Determine the internal buffer head pointer of a ring buffer
  *
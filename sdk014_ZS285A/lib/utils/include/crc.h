@@ -12,9 +12,55 @@
 #ifndef __UTILS_CRC_H__
 #define __UTILS_CRC_H__
 
+/**
+ * @brief streaming context of utils_crc16
+ */
+struct utils_crc16_ctx {
+	uint16_t crc;
+	uint16_t polynomial;
+};
+
+/**
+ * @brief streaming context of utils_crc32
+ */
+struct utils_crc32_ctx {
+	uint32_t crc;
+};
+
+/**
+ * @brief crc16 of a buffer, msb first
+ *
+ * Polynomial 0x1021 uses the table of the selected engine, others are
+ * computed bit by bit.
+ *
+ * @param pad non-zero to append two implicit zero bytes
+ */
 uint16_t utils_crc16(const uint8_t *src, int len, uint16_t polynomial,
 		     uint16_t initial_value, int pad);
 
+void utils_crc16_init(struct utils_crc16_ctx *ctx, uint16_t polynomial,
+		      uint16_t initial_value);
+
+void utils_crc16_update(struct utils_crc16_ctx *ctx, const uint8_t *src, int len);
+
+/**
+ * @brief get crc16 of all updated data
+ *
+ * @param pad non-zero to append two implicit zero bytes
+ */
+uint16_t utils_crc16_final(struct utils_crc16_ctx *ctx, int pad);
+
+/**
+ * @brief crc32 (IEEE 802.3) of a buffer
+ *
+ * @param crc 0, or crc of the previous data to continue
+ */
 uint32_t utils_crc32(uint32_t crc, const uint8_t *buf, int len);
 
+void utils_crc32_init(struct utils_crc32_ctx *ctx);
+
+void utils_crc32_update(struct utils_crc32_ctx *ctx, const uint8_t *buf, int len);
+
+uint32_t utils_crc32_final(struct utils_crc32_ctx *ctx);
+
 #endif /* __UTILS_CRC_H__ */
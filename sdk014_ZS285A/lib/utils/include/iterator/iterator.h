@@ -44,6 +44,9 @@ typedef struct iterator_ops {
 
 	/* (optional) get plist info in the iteration */
 	int (*get_plist_info)(struct iterator *iter, void *param);
+
+	/* (optional) get the next or previous element without moving to it */
+	const void *(*peek)(struct iterator *iter, bool forward, u16_t *track_no);
 } iterator_ops_t;
 
 /** iterator structure */
@@ -209,4 +212,22 @@ const void *iterator_set_track_no(struct iterator *iter, u16_t track_no);
  * @return 0 if succeed, others failed
  */
 int iterator_get_plist_info(struct iterator *iter, void *param);
+
+/**
+ * @brief get the next or previous element without moving to it.
+ *
+ * This routine provides look ahead in the iteration, the element is
+ * resolved now, so the later iterator_next or iterator_prev returns it
+ * at once. It is valid until the next peek in the same direction.
+ *
+ * @param iter address of the iterator
+ *
+ * @param forward true for the element of iterator_next, false for the
+ * one of iterator_prev
+ *
+ * @param track_no track_no of the element
+ *
+ * @return the element, NULL if there is none or peek is not supported
+ */
+const void *iterator_peek(struct iterator *iter, bool forward, u16_t *track_no);
 #endif /* __ITERATOR_H__ */
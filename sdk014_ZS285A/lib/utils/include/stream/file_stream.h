@@ -35,6 +35,20 @@
  */
  io_stream_t file_stream_create(const char *param);
 
+/**
+ * @brief read the first bytes of file stream into memory
+ *
+ * This routine reads the first size bytes of an opened input file stream,
+ * later reads of them are copied from memory, so the file is opened and
+ * its head is read before the stream is used, e.g. by a decoder.
+ *
+ * @param handle handle of file stream opened in MODE_IN
+ * @param size bytes to read, less if the file is smaller
+ *
+ * @return bytes read if succeed, others failed
+ */
+int file_stream_preload(io_stream_t handle, int size);
+
 /**
  * @} end defgroup file_stream_apis
  */
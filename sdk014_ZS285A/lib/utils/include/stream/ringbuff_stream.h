@@ -33,6 +33,20 @@
  */
 io_stream_t ringbuff_stream_create(struct acts_ringbuf *param);
 
+/**
+ * @brief create lock free ring buffer stream , return stream handle
+ *
+ * Same as @ref ringbuff_stream_create, but the stream must have exactly
+ * one reader and one writer (thread, ISR or DSP). Read and write then
+ * access the ring buffer without lock, see @ref acts_ringbuf_put_n.
+ *
+ * @param param create stream parama
+ *
+ * @return stream handle if create stream success
+ * @return NULL  if create stream failed
+ */
+io_stream_t ringbuff_stream_create_spsc(struct acts_ringbuf *param);
+
 /**
  * @brief create ring buffer stream , return stream handle
  *
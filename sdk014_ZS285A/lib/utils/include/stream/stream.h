@@ -91,6 +91,14 @@ typedef enum {
 	STATE_CLOSE ,
 } stream_state;
 
+/** scatter/gather segment of stream_readv and stream_writev */
+struct stream_iovec {
+	/** base address of segment */
+	unsigned char *base;
+	/** length of segment in bytes */
+	int len;
+};
+
 /** structure of stream*/
 typedef struct {
 	/** stream open operation Function pointer*/
@@ -116,6 +124,18 @@ typedef struct {
 	/** stream destroy operation Function pointer*/
 	int (*destroy)(io_stream_t handle);
 	void *(*get_ringbuffer)(io_stream_t handle);
+	/** stream read claim operation Function pointer, optional*/
+	int (*read_claim)(io_stream_t handle, unsigned char **buf, int num);
+	/** stream read commit operation Function pointer, optional*/
+	int (*read_commit)(io_stream_t handle, int num);
+	/** stream write claim operation Function pointer, optional*/
+	int (*write_claim)(io_stream_t handle, unsigned char **buf, int num);
+	/** stream write commit operation Function pointer, optional*/
+	int (*write_commit)(io_stream_t handle, int num);
+	/** stream scatter read operation Function pointer, optional*/
+	int (*readv)(io_stream_t handle, const struct stream_iovec *iov, int iovcnt);
+	/** stream gather write operation Function pointer, optional*/
+	int (*writev)(io_stream_t handle, const struct stream_iovec *iov, int iovcnt);
 } stream_ops_t;
 
 /**
@@ -178,6 +198,110 @@ int stream_read(io_stream_t handle, unsigned char *buf, int num);
  */
 int stream_write(io_stream_t handle, unsigned char *buf, int num);
 
+/**
+ * @brief scatter read from stream
+ *
+ * This routine provides read data from stream into several segments in
+ * order, like stream_read on one buffer of the total segments length.
+ * Streams with native support fill all segments under one lock, the others
+ * are read segment by segment.
+ *
+ * @param handle handle of stream
+ * @param iov array of segments
+ * @param iovcnt number of segments
+ *
+ * @return >=0 the realy read data length
+ * @return <0  stream read failed
+ */
+int stream_readv(io_stream_t handle, const struct stream_iovec *iov, int iovcnt);
+
+/**
+ * @brief gather write to stream
+ *
+ * This routine provides write several segments to stream in order, like
+ * stream_write on one buffer of the total segments length, so header and
+ * payload need not be assembled in a staging buffer first. Streams with
+ * native support write all segments under one lock and publish them
+ * at once, the others are written segment by segment.
+ *
+ * @param handle handle of stream
+ * @param iov array of segments
+ * @param iovcnt number of segments
+ *
+ * @return >=0 the realy write data length
+ * @return <0  stream write failed
+ */
+int stream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt);
+
+/**
+ * @brief claim stream data for reading in place
+ *
+ * This routine provides direct access to the data of stream without copying
+ * it to a user buffer. The claimed data stays in stream until
+ * stream_read_commit is called. The returned length may be smaller than num
+ * if less data is available or the internal buffer wraps, and this routine
+ * never blocks.
+ *
+ * Streams without native claim support are emulated with an internal bounce
+ * buffer, data claimed but not committed on such streams is returned again
+ * by the next claim, so do not mix stream_read with an outstanding claim.
+ *
+ * @param handle handle of stream
+ * @param buf out put pointer to the claimed data
+ * @param num bytes user want to claim
+ *
+ * @return >=0 the realy claimed data length
+ * @return <0  stream read claim failed
+ */
+int stream_read_claim(io_stream_t handle, unsigned char **buf, int num);
+
+/**
+ * @brief commit data consumed from a read claim
+ *
+ * This routine provides release num of bytes returned by stream_read_claim,
+ * and notify the attached streams and observers like stream_read.
+ * Each claim can only be committed once.
+ *
+ * @param handle handle of stream
+ * @param num bytes consumed, must not exceed the claimed length
+ *
+ * @return >=0 the realy committed data length
+ * @return <0  stream read commit failed
+ */
+int stream_read_commit(io_stream_t handle, int num);
+
+/**
+ * @brief claim stream space for writing in place
+ *
+ * This routine provides direct access to the free space of stream, so
+ * producer can generate data into stream without an intermediate buffer.
+ * The returned length may be smaller than num if less space is available
+ * or the internal buffer wraps, and this routine never blocks.
+ *
+ * @param handle handle of stream
+ * @param buf out put pointer to the claimed space
+ * @param num bytes user want to claim
+ *
+ * @return >=0 the realy claimed space length
+ * @return <0  stream write claim failed
+ */
+int stream_write_claim(io_stream_t handle, unsigned char **buf, int num);
+
+/**
+ * @brief commit data produced into a write claim
+ *
+ * This routine provides publish num of bytes written to the space returned
+ * by stream_write_claim, and notify the attached streams and observers
+ * like stream_write. Each claim can only be committed once.
+ *
+ * @param handle handle of stream
+ * @param num bytes produced, must not exceed the claimed length
+ *
+ * @return >=0 the realy committed data length
+ * @return <0  stream write commit failed
+ */
+int stream_write_commit(io_stream_t handle, int num);
+
 /**
  * @brief seek stream
  *
@@ -381,6 +505,13 @@ struct __stream {
 	/* attach lock */
 	os_mutex attach_lock;
 
+	/** data pointer returned by the last read claim */
+	unsigned char *read_claim_ptr;
+	/** space pointer returned by the last write claim */
+	unsigned char *write_claim_ptr;
+	/** bounce cache of claims for stream without native claim ops */
+	void *claim_cache;
+
 	const stream_ops_t  *ops;
 	void *data;
 };
@@ -17,6 +17,11 @@
 
 #define TRACE_PRINT_BUF_SIZE  (1024)
 
+/* binary log record: sync, length, sequence, checksum, timestamp, format address */
+#define TRACE_LOG_SYNC        0xFF
+#define TRACE_LOG_HEADER_SIZE 12
+#define TRACE_LOG_MAX_SIZE    255
+
 typedef enum
 {
     TRACE_TRANSPORT_UART = (1 << 0),
@@ -48,6 +53,9 @@ typedef struct
     uint8_t in_trace;
     uint8_t nested;
     uint8_t panic;
+#ifdef CONFIG_TRACE_BINARY_LOG
+    uint8_t binary_log;
+#endif
     uint32_t caller;
     cbuf_dma_t dma_setting;
 
@@ -71,4 +79,13 @@ extern uint32_t trace_binary_read(void *buf, int read_len);
 
 void trace_set_panic(void);
 
+#ifdef CONFIG_TRACE_BINARY_LOG
+#include <stdarg.h>
+
+/* returns record length, or -1 if it does not fit in size. Takes the next
+ * sequence number, call it with irq locked until the record is queued.
+ */
+int trace_log_encode(uint8_t *buf, int size, const char *fmt, va_list ap);
+#endif
+
 #endif /* TRACE_IMPL_H_ */
@@ -17,6 +17,30 @@
 
 int gbk_to_utf8(unsigned char *lpGBKStr, unsigned char *lpUTF8Str, int len);
 
+/**
+ * @brief convert at most gbk_len bytes of gbk, or up to terminator
+ *
+ * Output is terminated and never ends with part of a character.
+ *
+ * @param utf8_len size of utf8 buffer, including terminator
+ *
+ * @return length of utf8 without terminator, or -1 on error
+ */
+int gbk_to_utf8_n(const unsigned char *gbk, int gbk_len,
+		  unsigned char *utf8, int utf8_len);
+
+/**
+ * @brief convert at most utf8_len bytes of utf8, or up to terminator
+ *
+ * Output is terminated and never ends with part of a character.
+ *
+ * @param gbk_len size of gbk buffer, including terminator
+ *
+ * @return length of gbk without terminator, or -1 on error
+ */
+int utf8_to_gbk_n(const unsigned char *utf8, int utf8_len,
+		  unsigned char *gbk, int gbk_len);
+
 int gbk_to_unicode(unsigned char *lpGBKStr, unsigned short *unicode, int *punicode_len);
 
 int utf8_to_gbk(unsigned char *lpUTF8Str,unsigned char *lpGBKStr, int len);
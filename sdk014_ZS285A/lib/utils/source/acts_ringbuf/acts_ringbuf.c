@@ -75,13 +75,19 @@ void acts_ringbuf_free(struct acts_ringbuf *buf)
 
 uint32_t acts_ringbuf_peek(struct acts_ringbuf *buf, void *data, uint32_t size)
 {
-	uint32_t offset, len;
+	return acts_ringbuf_peek_ofs(buf, 0, data, size);
+}
+
+uint32_t acts_ringbuf_peek_ofs(struct acts_ringbuf *buf, uint32_t offset, void *data, uint32_t size)
+{
+	uint32_t len;
 
 	len = acts_ringbuf_length(buf);
-	if (size > len)
+	if (offset > len || size > len - offset)
 		return 0;
 
-	offset = buf->mask ? (buf->head & buf->mask) : (buf->head % buf->size);
+	offset += buf->head;
+	offset = buf->mask ? (offset & buf->mask) : (offset % buf->size);
 
 	len = buf->size - offset;
 	if (len >= size) {
@@ -144,6 +150,28 @@ uint32_t acts_ringbuf_put(struct acts_ringbuf *buf, const void *data, uint32_t s
 	return size;
 }
 
+uint32_t acts_ringbuf_put_ofs(struct acts_ringbuf *buf, uint32_t offset, const void *data, uint32_t size)
+{
+	uint32_t len;
+
+	len = acts_ringbuf_space(buf);
+	if (offset > len || size > len - offset)
+		return 0;
+
+	offset += buf->tail;
+	offset = buf->mask ? (offset & buf->mask) : (offset % buf->size);
+
+	len = buf->size - offset;
+	if (len >= size) {
+		memcpy((void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), data, ACTS_RINGBUF_SIZE8(size));
+	} else {
+		memcpy((void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), data, ACTS_RINGBUF_SIZE8(len));
+		memcpy((void *)(buf->cpu_ptr), data + ACTS_RINGBUF_SIZE8(len), ACTS_RINGBUF_SIZE8(size - len));
+	}
+
+	return size;
+}
+
 uint32_t acts_ringbuf_put_claim(struct acts_ringbuf *buf, void **data, uint32_t size)
 {
 	uint32_t offset = buf->mask ? (buf->tail & buf->mask) : (buf->tail % buf->size);
@@ -165,6 +193,56 @@ int acts_ringbuf_put_finish(struct acts_ringbuf *buf, uint32_t size)
 	return 0;
 }
 
+uint32_t acts_ringbuf_put_n(struct acts_ringbuf *buf, const void *data, uint32_t size)
+{
+	/* only producer modifies tail, consumer may modify head concurrently */
+	uint32_t tail = buf->tail;
+	uint32_t head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+	uint32_t offset, len;
+
+	if (size > buf->size - (tail - head))
+		return 0;
+
+	offset = buf->mask ? (tail & buf->mask) : (tail % buf->size);
+
+	len = buf->size - offset;
+	if (len >= size) {
+		memcpy((void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), data, ACTS_RINGBUF_SIZE8(size));
+	} else {
+		memcpy((void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), data, ACTS_RINGBUF_SIZE8(len));
+		memcpy((void *)(buf->cpu_ptr), data + ACTS_RINGBUF_SIZE8(len), ACTS_RINGBUF_SIZE8(size - len));
+	}
+
+	/* publish data before the new tail */
+	__atomic_store_n(&buf->tail, tail + size, __ATOMIC_RELEASE);
+	return size;
+}
+
+uint32_t acts_ringbuf_get_n(struct acts_ringbuf *buf, void *data, uint32_t size)
+{
+	/* only consumer modifies head, producer may modify tail concurrently */
+	uint32_t head = buf->head;
+	uint32_t tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+	uint32_t offset, len;
+
+	if (size > tail - head)
+		return 0;
+
+	offset = buf->mask ? (head & buf->mask) : (head % buf->size);
+
+	len = buf->size - offset;
+	if (len >= size) {
+		memcpy(data, (void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), ACTS_RINGBUF_SIZE8(size));
+	} else {
+		memcpy(data, (void *)(buf->cpu_ptr + ACTS_RINGBUF_SIZE8(offset)), ACTS_RINGBUF_SIZE8(len));
+		memcpy(data + ACTS_RINGBUF_SIZE8(len), (void *)(buf->cpu_ptr), ACTS_RINGBUF_SIZE8(size - len));
+	}
+
+	/* release the space only after data has been read out */
+	__atomic_store_n(&buf->head, head + size, __ATOMIC_RELEASE);
+	return size;
+}
+
 uint32_t acts_ringbuf_copy(struct acts_ringbuf *dst_buf, struct acts_ringbuf *src_buf, uint32_t size)
 {
 	uint32_t src_length = acts_ringbuf_length(src_buf);
@@ -299,6 +377,16 @@ uint32_t acts_ringbuf_drop(struct acts_ringbuf *buf, uint32_t size)
 	return size;
 }
 
+uint32_t acts_ringbuf_drop_n(struct acts_ringbuf *buf, uint32_t size)
+{
+	if (size > acts_ringbuf_length_n(buf))
+		return 0;
+
+	/* release space after data gathered by acts_ringbuf_peek_ofs */
+	__atomic_store_n(&buf->head, buf->head + size, __ATOMIC_RELEASE);
+	return size;
+}
+
 uint32_t acts_ringbuf_drop_all(struct acts_ringbuf *buf)
 {
 	uint32_t length = acts_ringbuf_length(buf);
@@ -340,6 +428,16 @@ uint32_t acts_ringbuf_fill_none(struct acts_ringbuf *buf, uint32_t size)
 	return size;
 }
 
+uint32_t acts_ringbuf_fill_none_n(struct acts_ringbuf *buf, uint32_t size)
+{
+	if (size > acts_ringbuf_space_n(buf))
+		return 0;
+
+	/* publish data gathered by acts_ringbuf_put_ofs before the new tail */
+	__atomic_store_n(&buf->tail, buf->tail + size, __ATOMIC_RELEASE);
+	return size;
+}
+
 void *acts_ringbuf_head_ptr(struct acts_ringbuf *buf, uint32_t *len)
 {
 	void *data = NULL;
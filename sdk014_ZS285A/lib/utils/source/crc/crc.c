@@ -9,50 +9,305 @@
  */
 
 #include <stdint.h>
+#include <misc/byteorder.h>
 #include <crc.h>
 
-uint16_t utils_crc16(const uint8_t *src, int len, uint16_t polynomial,
-		     uint16_t initial_value, int pad)
+#if !defined(CONFIG_UTILS_CRC_ENGINE_BYTE) && !defined(CONFIG_UTILS_CRC_ENGINE_SLICE4) && \
+    !defined(CONFIG_UTILS_CRC_ENGINE_SLICE8)
+#define CONFIG_UTILS_CRC_ENGINE_NIBBLE 1
+#endif
+
+/*
+ * Tables are generated by the preprocessor. A CRC without pre and post
+ * inversion is linear, so table entry i is the xor of the entries of the
+ * bits set in i. The 8 entries of single bits are kept in an enum, one
+ * level per table, to stop the macro expansion from growing exponentially.
+ */
+#define CRC32_POLY          0xedb88320u
+#define CRC16_TABLE_POLY    0x1021
+
+/* reflected crc32, one bit */
+#define CRC32_STEP(c)       (((uint32_t)(c) >> 1) ^ (((c) & 1) ? CRC32_POLY : 0))
+
+/* bit b of level k is crc of (1 << b) followed by k zero bytes */
+#define CRC32_BASIS(k, prev) \
+    CRC32_B##k##_7 = CRC32_STEP(prev), \
+    CRC32_B##k##_6 = CRC32_STEP(CRC32_B##k##_7), \
+    CRC32_B##k##_5 = CRC32_STEP(CRC32_B##k##_6), \
+    CRC32_B##k##_4 = CRC32_STEP(CRC32_B##k##_5), \
+    CRC32_B##k##_3 = CRC32_STEP(CRC32_B##k##_4), \
+    CRC32_B##k##_2 = CRC32_STEP(CRC32_B##k##_3), \
+    CRC32_B##k##_1 = CRC32_STEP(CRC32_B##k##_2), \
+    CRC32_B##k##_0 = CRC32_STEP(CRC32_B##k##_1)
+
+#define CRC32_BIT(k, i, b)  (((i) & (1 << (b))) ? (uint32_t)CRC32_B##k##_##b : 0)
+
+#define CRC32_ENTRY(k, i) \
+    (CRC32_BIT(k, i, 0) ^ CRC32_BIT(k, i, 1) ^ CRC32_BIT(k, i, 2) ^ CRC32_BIT(k, i, 3) ^ \
+     CRC32_BIT(k, i, 4) ^ CRC32_BIT(k, i, 5) ^ CRC32_BIT(k, i, 6) ^ CRC32_BIT(k, i, 7))
+
+#define CRC32_ROW(k, i) \
+    CRC32_ENTRY(k, (i) + 0), CRC32_ENTRY(k, (i) + 1), CRC32_ENTRY(k, (i) + 2), CRC32_ENTRY(k, (i) + 3), \
+    CRC32_ENTRY(k, (i) + 4), CRC32_ENTRY(k, (i) + 5), CRC32_ENTRY(k, (i) + 6), CRC32_ENTRY(k, (i) + 7), \
+    CRC32_ENTRY(k, (i) + 8), CRC32_ENTRY(k, (i) + 9), CRC32_ENTRY(k, (i) + 10), CRC32_ENTRY(k, (i) + 11), \
+    CRC32_ENTRY(k, (i) + 12), CRC32_ENTRY(k, (i) + 13), CRC32_ENTRY(k, (i) + 14), CRC32_ENTRY(k, (i) + 15)
+
+#define CRC32_TABLE(k) { \
+    CRC32_ROW(k, 0x00), CRC32_ROW(k, 0x10), CRC32_ROW(k, 0x20), CRC32_ROW(k, 0x30), \
+    CRC32_ROW(k, 0x40), CRC32_ROW(k, 0x50), CRC32_ROW(k, 0x60), CRC32_ROW(k, 0x70), \
+    CRC32_ROW(k, 0x80), CRC32_ROW(k, 0x90), CRC32_ROW(k, 0xa0), CRC32_ROW(k, 0xb0), \
+    CRC32_ROW(k, 0xc0), CRC32_ROW(k, 0xd0), CRC32_ROW(k, 0xe0), CRC32_ROW(k, 0xf0) }
+
+/* msb first crc16, one bit and one byte */
+#define CRC16_STEP(c)       ((((c) << 1) ^ (((c) & 0x8000) ? CRC16_TABLE_POLY : 0)) & 0xffff)
+#define CRC16_STEP2(c)      CRC16_STEP(CRC16_STEP(c))
+#define CRC16_STEP4(c)      CRC16_STEP2(CRC16_STEP2(c))
+#define CRC16_STEP8(c)      CRC16_STEP4(CRC16_STEP4(c))
+
+#define CRC16_BIT(i, b)     (((i) & (1 << (b))) ? (uint16_t)CRC16_B##b : 0)
+
+#define CRC16_ENTRY(i) \
+    (CRC16_BIT(i, 0) ^ CRC16_BIT(i, 1) ^ CRC16_BIT(i, 2) ^ CRC16_BIT(i, 3) ^ \
+     CRC16_BIT(i, 4) ^ CRC16_BIT(i, 5) ^ CRC16_BIT(i, 6) ^ CRC16_BIT(i, 7))
+
+#define CRC16_ROW(i) \
+    CRC16_ENTRY((i) + 0), CRC16_ENTRY((i) + 1), CRC16_ENTRY((i) + 2), CRC16_ENTRY((i) + 3), \
+    CRC16_ENTRY((i) + 4), CRC16_ENTRY((i) + 5), CRC16_ENTRY((i) + 6), CRC16_ENTRY((i) + 7), \
+    CRC16_ENTRY((i) + 8), CRC16_ENTRY((i) + 9), CRC16_ENTRY((i) + 10), CRC16_ENTRY((i) + 11), \
+    CRC16_ENTRY((i) + 12), CRC16_ENTRY((i) + 13), CRC16_ENTRY((i) + 14), CRC16_ENTRY((i) + 15)
+
+#ifdef CONFIG_UTILS_CRC_ENGINE_NIBBLE
+
+/* reflected nibble table of crc32, 0xedb88320 */
+static const uint32_t s_crc32[16] = { 0, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158,
+        0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
+
+enum crc16_basis {
+    CRC16_B0 = CRC16_STEP4(0x1000),
+    CRC16_B1 = CRC16_STEP4(0x2000),
+    CRC16_B2 = CRC16_STEP4(0x4000),
+    CRC16_B3 = CRC16_STEP4(0x8000),
+};
+
+#define CRC16_NIBBLE(i) \
+    (CRC16_BIT(i, 0) ^ CRC16_BIT(i, 1) ^ CRC16_BIT(i, 2) ^ CRC16_BIT(i, 3))
+
+static const uint16_t s_crc16[16] = {
+    CRC16_NIBBLE(0), CRC16_NIBBLE(1), CRC16_NIBBLE(2), CRC16_NIBBLE(3),
+    CRC16_NIBBLE(4), CRC16_NIBBLE(5), CRC16_NIBBLE(6), CRC16_NIBBLE(7),
+    CRC16_NIBBLE(8), CRC16_NIBBLE(9), CRC16_NIBBLE(10), CRC16_NIBBLE(11),
+    CRC16_NIBBLE(12), CRC16_NIBBLE(13), CRC16_NIBBLE(14), CRC16_NIBBLE(15),
+};
+
+// Karl Malbrain's compact CRC-32. See "A compact CCITT crc16 and crc32 C implementation that balances processor cache usage against speed": http://www.geocities.com/malbrain/
+static uint32_t crc32_update(uint32_t crcu32, const uint8_t *ptr, int buf_len)
+{
+    while (buf_len--) {
+        uint8_t b = *ptr++;
+        crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b & 0xF)];
+        crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b >> 4)];
+    }
+    return crcu32;
+}
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *src, int len)
+{
+    while (len--) {
+        uint8_t b = *src++;
+        crc = ((crc << 4) | (b >> 4)) ^ s_crc16[crc >> 12];
+        crc = ((crc << 4) | (b & 0xF)) ^ s_crc16[crc >> 12];
+    }
+    return crc;
+}
+
+#else
+
+#if defined(CONFIG_UTILS_CRC_ENGINE_SLICE8)
+#define CRC32_SLICES    8
+#elif defined(CONFIG_UTILS_CRC_ENGINE_SLICE4)
+#define CRC32_SLICES    4
+#else
+#define CRC32_SLICES    1
+#endif
+
+enum crc32_basis {
+    CRC32_BASIS(0, 1),
+#if CRC32_SLICES > 1
+    CRC32_BASIS(1, CRC32_B0_0),
+    CRC32_BASIS(2, CRC32_B1_0),
+    CRC32_BASIS(3, CRC32_B2_0),
+#endif
+#if CRC32_SLICES > 4
+    CRC32_BASIS(4, CRC32_B3_0),
+    CRC32_BASIS(5, CRC32_B4_0),
+    CRC32_BASIS(6, CRC32_B5_0),
+    CRC32_BASIS(7, CRC32_B6_0),
+#endif
+};
+
+/* table k is crc of a byte followed by k zero bytes */
+static const uint32_t s_crc32[CRC32_SLICES][256] = {
+    CRC32_TABLE(0),
+#if CRC32_SLICES > 1
+    CRC32_TABLE(1),
+    CRC32_TABLE(2),
+    CRC32_TABLE(3),
+#endif
+#if CRC32_SLICES > 4
+    CRC32_TABLE(4),
+    CRC32_TABLE(5),
+    CRC32_TABLE(6),
+    CRC32_TABLE(7),
+#endif
+};
+
+enum crc16_basis {
+    CRC16_B0 = CRC16_STEP8(0x0100),
+    CRC16_B1 = CRC16_STEP8(0x0200),
+    CRC16_B2 = CRC16_STEP8(0x0400),
+    CRC16_B3 = CRC16_STEP8(0x0800),
+    CRC16_B4 = CRC16_STEP8(0x1000),
+    CRC16_B5 = CRC16_STEP8(0x2000),
+    CRC16_B6 = CRC16_STEP8(0x4000),
+    CRC16_B7 = CRC16_STEP8(0x8000),
+};
+
+static const uint16_t s_crc16[256] = {
+    CRC16_ROW(0x00), CRC16_ROW(0x10), CRC16_ROW(0x20), CRC16_ROW(0x30),
+    CRC16_ROW(0x40), CRC16_ROW(0x50), CRC16_ROW(0x60), CRC16_ROW(0x70),
+    CRC16_ROW(0x80), CRC16_ROW(0x90), CRC16_ROW(0xa0), CRC16_ROW(0xb0),
+    CRC16_ROW(0xc0), CRC16_ROW(0xd0), CRC16_ROW(0xe0), CRC16_ROW(0xf0),
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *ptr, int buf_len)
+{
+#if CRC32_SLICES > 1
+    uint32_t lo;
+
+    /* word loads below need an aligned pointer */
+    while (buf_len > 0 && ((uintptr_t)ptr & 3)) {
+        crc = (crc >> 8) ^ s_crc32[0][(crc ^ *ptr++) & 0xff];
+        buf_len--;
+    }
+
+#if CRC32_SLICES > 4
+    while (buf_len >= 8) {
+        uint32_t hi;
+
+        lo = crc ^ sys_le32_to_cpu(*(const uint32_t *)ptr);
+        hi = sys_le32_to_cpu(*(const uint32_t *)(ptr + 4));
+        crc = s_crc32[7][lo & 0xff] ^ s_crc32[6][(lo >> 8) & 0xff] ^
+              s_crc32[5][(lo >> 16) & 0xff] ^ s_crc32[4][lo >> 24] ^
+              s_crc32[3][hi & 0xff] ^ s_crc32[2][(hi >> 8) & 0xff] ^
+              s_crc32[1][(hi >> 16) & 0xff] ^ s_crc32[0][hi >> 24];
+        ptr += 8;
+        buf_len -= 8;
+    }
+#endif
+
+    while (buf_len >= 4) {
+        lo = crc ^ sys_le32_to_cpu(*(const uint32_t *)ptr);
+        crc = s_crc32[3][lo & 0xff] ^ s_crc32[2][(lo >> 8) & 0xff] ^
+              s_crc32[1][(lo >> 16) & 0xff] ^ s_crc32[0][lo >> 24];
+        ptr += 4;
+        buf_len -= 4;
+    }
+#endif
+
+    while (buf_len-- > 0)
+        crc = (crc >> 8) ^ s_crc32[0][(crc ^ *ptr++) & 0xff];
+
+    return crc;
+}
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *src, int len)
+{
+    while (len--)
+        crc = ((crc << 8) | *src++) ^ s_crc16[crc >> 8];
+    return crc;
+}
+
+#endif /* CONFIG_UTILS_CRC_ENGINE_NIBBLE */
+
+void utils_crc16_init(struct utils_crc16_ctx *ctx, uint16_t polynomial,
+		      uint16_t initial_value)
+{
+    ctx->crc = initial_value;
+    ctx->polynomial = polynomial;
+}
+
+void utils_crc16_update(struct utils_crc16_ctx *ctx, const uint8_t *src, int len)
 {
-    uint16_t crc = initial_value;
-    int padding = (pad != 0) ? sizeof(crc) : 0;
+    uint16_t crc = ctx->crc;
     int i, b;
 
-    /* src length + padding (if required) */
-    for (i = 0; i < len + padding; i++) {
+    if (len <= 0)
+        return;
+
+    /* only the ccitt polynomial has a table */
+    if (ctx->polynomial == CRC16_TABLE_POLY) {
+        ctx->crc = crc16_update(crc, src, len);
+        return;
+    }
+
+    for (i = 0; i < len; i++) {
 
         for (b = 0; b < 8; b++) {
             uint16_t divide = crc & 0x8000;
 
-            crc = (crc << 1);
-
-            /* choose input bytes or implicit trailing zeros */
-            if (i < len) {
-                crc |= !!(src[i] & (0x80 >> b));
-            }
+            crc = (crc << 1) | !!(src[i] & (0x80 >> b));
 
             if (divide) {
-                crc = crc ^ polynomial;
+                crc = crc ^ ctx->polynomial;
             }
         }
     }
 
-    return crc;
+    ctx->crc = crc;
 }
 
-static const uint32_t s_crc32[16] = { 0, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158,
-        0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
+uint16_t utils_crc16_final(struct utils_crc16_ctx *ctx, int pad)
+{
+    static const uint8_t zero[2];
+
+    /* implicit trailing zeros */
+    if (pad != 0)
+        utils_crc16_update(ctx, zero, sizeof(zero));
+
+    return ctx->crc;
+}
+
+uint16_t utils_crc16(const uint8_t *src, int len, uint16_t polynomial,
+		     uint16_t initial_value, int pad)
+{
+    struct utils_crc16_ctx ctx;
+
+    utils_crc16_init(&ctx, polynomial, initial_value);
+    utils_crc16_update(&ctx, src, len);
+
+    return utils_crc16_final(&ctx, pad);
+}
 
-// Karl Malbrain's compact CRC-32. See "A compact CCITT crc16 and crc32 C implementation that balances processor cache usage against speed": http://www.geocities.com/malbrain/
 uint32_t utils_crc32(uint32_t crc, const uint8_t *ptr, int buf_len)
 {
-    uint32_t crcu32 = crc;
-    crcu32 = ~crcu32;
-    while (buf_len--) {
-        uint8_t b = *ptr++;
-        crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b & 0xF)];
-        crcu32 = (crcu32 >> 4) ^ s_crc32[(crcu32 & 0xF) ^ (b >> 4)];
-    }
-    return ~crcu32;
+    if (buf_len <= 0)
+        return crc;
+
+    return ~crc32_update(~crc, ptr, buf_len);
+}
+
+void utils_crc32_init(struct utils_crc32_ctx *ctx)
+{
+    ctx->crc = ~0u;
+}
+
+void utils_crc32_update(struct utils_crc32_ctx *ctx, const uint8_t *buf, int len)
+{
+    if (len > 0)
+        ctx->crc = crc32_update(ctx->crc, buf, len);
 }
 
+uint32_t utils_crc32_final(struct utils_crc32_ctx *ctx)
+{
+    return ~ctx->crc;
+}
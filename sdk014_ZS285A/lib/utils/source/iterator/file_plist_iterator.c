@@ -10,6 +10,7 @@
 #include <fs_manager.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #define MAX_DIR_LEVEL 9
 #define FULL_PATH_LEN (MAX_URL_LEN + 2)
@@ -18,6 +19,11 @@
 #define MAX_SUPPORT_FILE_CNT 10000
 #define FAT16_FAR_CLUST 0xfffffff1
 
+/* empty folders keep their slot when full name or index need them */
+#if defined(CONFIG_SUPPORT_FILE_FULL_NAME) || defined(CONFIG_FILE_ITERATOR_INDEX)
+#define PLIST_KEEP_EMPTY_FOLDER 1
+#endif
+
 struct  folder_info_t {
 #if CONFIG_SUPPORT_FILE_FULL_NAME
 	u32_t far_cluster;		/*exfat direntry no farthor cluster*/
@@ -25,8 +31,70 @@ struct  folder_info_t {
 #endif
 	u32_t cur_cluster;		/*Current cluster*/
 	u16_t dir_file_count;	/*valid file count*/
+	u16_t file_base;		/*valid files in the folders before*/
 	u8_t dir_layer;	/*curent dir in disk layer */
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	u32_t rec_ofs;			/*first file record in index*/
+	u32_t entry_sum;		/*checksum of all direntries*/
+	u32_t subdir_sum;		/*checksum of sub folder direntries*/
+#endif
+};
+
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+#define PLIST_INDEX_MAGIC	0x58444950	/* "PIDX" */
+#define PLIST_INDEX_VERSION	2
+#define PLIST_INDEX_BUF_CNT	64
+#define PLIST_SUM_INIT		2166136261u
+
+/*
+ * Index file: head, CONFIG_PLIST_SUPPORT_FOLDER_CNT folder slots, then one
+ * record per file. Records of a folder are contiguous, a folder read again
+ * appends its records at the end. The head is written last.
+ */
+struct plist_index_head {
+	u32_t magic;
+	u16_t version;
+	u16_t folder_cnt;
+	u32_t vsn;				/*volume serial number*/
+	u32_t match_id;			/*topdir, max level and filter*/
+	u32_t rec_cnt;			/*file records, stale ones included*/
+	u16_t file_cnt;
+	u16_t csize;
+	u32_t check_sum;		/*head and folder table*/
+};
+
+struct plist_index_folder {
+	u32_t cur_cluster;
+	u32_t far_cluster;
+	u32_t blk_ofs;
+	u32_t rec_ofs;
+	u32_t entry_sum;
+	u32_t subdir_sum;
+	u16_t file_cnt;
+	u8_t dir_layer;
+	u8_t reserved;
+};
+
+struct plist_index_rec {
+	u32_t blk_ofs;			/*file direntry offset in folder*/
+	u32_t size;
+};
+
+struct plist_index_t {
+	fs_file_t fp;
+	u8_t opened;
+	u8_t valid;				/*records match the play list*/
+	u16_t buf_cnt;
+	u32_t rec_cnt;
+	u32_t vsn;
+	u32_t match_id;
+	struct plist_index_rec buf[PLIST_INDEX_BUF_CNT];
 };
+
+#define PLIST_INDEX_REC_OFS	(sizeof(struct plist_index_head) + \
+	CONFIG_PLIST_SUPPORT_FOLDER_CNT * sizeof(struct plist_index_folder))
+#endif
+
 struct play_list_t {
 	struct  folder_info_t *folder_info[CONFIG_PLIST_SUPPORT_FOLDER_CNT];
 	u16_t sum_file_count;	/*sum valid files in disk*/
@@ -39,6 +107,33 @@ struct play_list_t {
 	u16_t csize;			/* Cluster size [sectors] */
 	const char *topdir;
 	int (*match_fn)(const char *path, int is_dir);
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	struct plist_index_t *index;
+#endif
+};
+
+/* sub folder found by the scan, entered after the files of its parent */
+struct plist_scan_dir {
+	struct fs_dirent_pos pos;	/*direntry in parent folder*/
+	u16_t len;
+	char name[0];
+};
+
+struct plist_scan_level {
+	u16_t start;			/*first pending sub folder in name buffer*/
+	u16_t next;				/*next pending sub folder to enter*/
+	u16_t end;
+	u16_t dir_cnt;			/*sub folders queued, skipped when read again*/
+	u32_t cluster;			/*start cluster of the folder*/
+	u8_t overflow : 1;		/*name buffer was full, read sub folders again*/
+	u8_t reread : 1;
+};
+
+struct plist_scan_t {
+	struct fs_dirent *entries;
+	struct fs_dirent_pos *pos;
+	char *buf;
+	struct plist_scan_level level[MAX_DIR_LEVEL];
 };
 
 static struct play_list_t *play_list = NULL;
@@ -63,6 +158,12 @@ struct file_iterator_data {
 	int (*match_fn)(const char *path, int is_dir);
 
 	struct fs_dirent *dirent;
+
+	/* files resolved by peek, [0] previous and [1] next */
+	struct {
+		u16_t track_no;
+		char *path;
+	} peek[2];
 };
 
 static struct play_list_t *get_play_list(void)
@@ -70,6 +171,220 @@ static struct play_list_t *get_play_list(void)
 	return play_list;
 }
 
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+static u32_t plist_sum(u32_t sum, const void *buf, int len)
+{
+	const u8_t *p = buf;
+
+	while (len-- > 0) {
+		sum ^= *p++;
+		sum *= 16777619u;
+	}
+
+	return sum;
+}
+
+static int plist_is_index_file(const char *name)
+{
+	return !strcmp(name, CONFIG_FILE_ITERATOR_INDEX_NAME);
+}
+
+/* the direntry offset is summed too, a reused slot moves the file */
+static void plist_entry_sum(struct folder_info_t *info, struct fs_dirent *entry, u32_t blk_ofs)
+{
+	u32_t size = (u32_t)entry->size;
+	u8_t type = (u8_t)entry->type;
+	u32_t sum = PLIST_SUM_INIT;
+
+	sum = plist_sum(sum, entry->name, strlen(entry->name));
+	sum = plist_sum(sum, &type, sizeof(type));
+	sum = plist_sum(sum, &size, sizeof(size));
+	sum = plist_sum(sum, &blk_ofs, sizeof(blk_ofs));
+
+	info->entry_sum = plist_sum(info->entry_sum, &sum, sizeof(sum));
+	if (entry->type == FS_DIR_ENTRY_DIR)
+		info->subdir_sum = plist_sum(info->subdir_sum, &sum, sizeof(sum));
+}
+
+static int plist_index_open(struct plist_index_t *index, const char *topdir)
+{
+	char *path = NULL;
+	int len = strlen(topdir);
+	int res;
+
+	if (index->opened)
+		return 0;
+
+	path = mem_malloc(len + sizeof(CONFIG_FILE_ITERATOR_INDEX_NAME) + 1);
+	if (!path)
+		return -ENOMEM;
+
+	strcpy(path, topdir);
+	if (path[len - 1] != ':' && path[len - 1] != '/')
+		path[len++] = '/';
+	strcpy(path + len, CONFIG_FILE_ITERATOR_INDEX_NAME);
+
+	res = fs_open(&index->fp, path);
+	if (res) {
+		SYS_LOG_WRN("open %s failed (res=%d)\n", path, res);
+	} else {
+		index->opened = 1;
+	}
+
+	mem_free(path);
+	return res;
+}
+
+static void plist_index_close(struct play_list_t *plist)
+{
+	if (!plist->index)
+		return;
+
+	if (plist->index->opened)
+		fs_close(&plist->index->fp);
+
+	mem_free(plist->index);
+	plist->index = NULL;
+}
+
+static int plist_index_write(struct plist_index_t *index, off_t ofs, const void *buf, int len)
+{
+	if (fs_seek(&index->fp, ofs, FS_SEEK_SET) ||
+		fs_write(&index->fp, buf, len) != len) {
+		index->valid = 0;
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int plist_index_read(struct plist_index_t *index, u32_t rec_no, struct plist_index_rec *rec)
+{
+	if (fs_seek(&index->fp, PLIST_INDEX_REC_OFS + rec_no * sizeof(*rec), FS_SEEK_SET) ||
+		fs_read(&index->fp, rec, sizeof(*rec)) != sizeof(*rec))
+		return -EIO;
+
+	return 0;
+}
+
+static void plist_index_flush(struct plist_index_t *index)
+{
+	if (index->valid && index->buf_cnt) {
+		plist_index_write(index, PLIST_INDEX_REC_OFS +
+			(index->rec_cnt - index->buf_cnt) * sizeof(struct plist_index_rec),
+			index->buf, index->buf_cnt * sizeof(struct plist_index_rec));
+	}
+
+	index->buf_cnt = 0;
+}
+
+static void plist_index_add(struct plist_index_t *index, u32_t blk_ofs, u32_t size)
+{
+	if (!index || !index->valid)
+		return;
+
+	index->buf[index->buf_cnt].blk_ofs = blk_ofs;
+	index->buf[index->buf_cnt].size = size;
+	index->rec_cnt++;
+
+	if (++index->buf_cnt == PLIST_INDEX_BUF_CNT)
+		plist_index_flush(index);
+}
+
+/*
+ * the disk may be written while the play list is in use, so the direntry
+ * of a record may hold another file since. Checked on each use.
+ */
+static int plist_index_rec_match(struct play_list_t *plist, struct fs_dirent *entry,
+			const struct plist_index_rec *rec)
+{
+	if (entry->name[0] == 0 || entry->name[0] == '.' ||
+		entry->type != FS_DIR_ENTRY_FILE || plist_is_index_file(entry->name))
+		return 0;
+
+	if ((u32_t)entry->size != rec->size)
+		return 0;
+
+	return !plist->match_fn || plist->match_fn(entry->name, 0);
+}
+
+/* index does not match the disk, break its head so the next init scans */
+static void plist_index_drop(struct plist_index_t *index)
+{
+	u32_t magic = 0;
+
+	if (index->valid && !plist_index_write(index, 0, &magic, sizeof(magic)))
+		fs_sync(&index->fp);
+
+	index->valid = 0;
+}
+
+/* folder table is packed into the record buffer, head goes last */
+static int plist_index_save(struct play_list_t *plist)
+{
+	struct plist_index_t *index = plist->index;
+	struct plist_index_head head;
+	struct plist_index_folder folder;
+	struct folder_info_t *info;
+	u8_t *buf = (u8_t *)index->buf;
+	off_t ofs = sizeof(head);
+	int len = 0;
+	int i;
+
+	plist_index_flush(index);
+	if (!index->valid)
+		return -EIO;
+
+	memset(&head, 0, sizeof(head));
+	head.magic = PLIST_INDEX_MAGIC;
+	head.version = PLIST_INDEX_VERSION;
+	head.folder_cnt = plist->sum_folder_count + 1;
+	head.vsn = index->vsn;
+	head.match_id = index->match_id;
+	head.rec_cnt = index->rec_cnt;
+	head.file_cnt = plist->sum_file_count;
+	head.csize = plist->csize;
+	head.check_sum = PLIST_SUM_INIT;
+
+	for (i = 0; i <= plist->sum_folder_count; i++) {
+		info = plist->folder_info[i];
+		memset(&folder, 0, sizeof(folder));
+	#if CONFIG_SUPPORT_FILE_FULL_NAME
+		folder.far_cluster = info->far_cluster;
+		folder.blk_ofs = info->blk_ofs;
+	#endif
+		folder.cur_cluster = info->cur_cluster;
+		folder.rec_ofs = info->rec_ofs;
+		folder.entry_sum = info->entry_sum;
+		folder.subdir_sum = info->subdir_sum;
+		folder.file_cnt = info->dir_file_count;
+		folder.dir_layer = info->dir_layer;
+		head.check_sum = plist_sum(head.check_sum, &folder, sizeof(folder));
+
+		if (len + sizeof(folder) > sizeof(index->buf)) {
+			if (plist_index_write(index, ofs, buf, len))
+				return -EIO;
+			ofs += len;
+			len = 0;
+		}
+		memcpy(buf + len, &folder, sizeof(folder));
+		len += sizeof(folder);
+	}
+
+	if (plist_index_write(index, ofs, buf, len))
+		return -EIO;
+
+	head.check_sum = plist_sum(head.check_sum, &head, offsetof(struct plist_index_head, check_sum));
+
+	if (plist_index_write(index, 0, &head, sizeof(head)) || fs_sync(&index->fp))
+		return -EIO;
+
+	SYS_LOG_INF("index saved, %d folders %d files %d records\n",
+		head.folder_cnt, head.file_cnt, head.rec_cnt);
+	return 0;
+}
+#endif
+
 static int file_iterator_get_plist_info(struct iterator *iter, void *param)
 {
 	*(u16_t *)param = play_list->sum_file_count;
@@ -95,6 +410,11 @@ static int file_iterator_destroy(struct iterator *iter)
 	if (data->full_path)
 		mem_free(data->full_path);
 
+	for (i = 0; i < ARRAY_SIZE(data->peek); i++) {
+		if (data->peek[i].path)
+			mem_free(data->peek[i].path);
+	}
+
 	mem_free(data);
 
 	if (play_list) {
@@ -104,33 +424,62 @@ static int file_iterator_destroy(struct iterator *iter)
 				play_list->folder_info[i] = NULL;
 			}
 		}
+	#ifdef CONFIG_FILE_ITERATOR_INDEX
+		plist_index_close(play_list);
+	#endif
 		mem_free(play_list);
 		play_list = NULL;
 	}
 	return 0;
 }
 
-static void calc_track_no_playlist_info(struct play_list_t *plist, u16_t track_no)
+static void calc_file_base(struct play_list_t *plist)
 {
 	int i = 0;
-	u32_t sum_file = 0;
+	u16_t sum_file = 0;
+
+	for (i = 0; i <= plist->sum_folder_count; i++) {
+		plist->folder_info[i]->file_base = sum_file;
+		sum_file += plist->folder_info[i]->dir_file_count;
+	}
 
+	plist->sum_file_count = sum_file;
+}
+
+/*
+ * calc dir_file_seq_num and folder_seq_num by file_seq_num: the last folder
+ * whose file_base is below file_seq_num, empty folders are skipped.
+ */
+static int calc_folder_seq_num(struct play_list_t *plist)
+{
+	int low = 0;
+	int high = plist->sum_folder_count;
+	int mid;
+
+	if (plist->file_seq_num == 0 || plist->file_seq_num > plist->sum_file_count)
+		return -EINVAL;
+
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+		if (plist->folder_info[mid]->file_base < plist->file_seq_num)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	plist->folder_seq_num = low;
+	plist->dir_file_seq_num = plist->file_seq_num - plist->folder_info[low]->file_base;
+	return 0;
+}
+
+static void calc_track_no_playlist_info(struct play_list_t *plist, u16_t track_no)
+{
 	if (track_no == 0 || track_no > plist->sum_file_count)
 		return;
 
 	plist->file_seq_num = track_no;
 
-	/*calc dir_file_seq_num and folder_seq_num by file_seq_num*/
-	for (i = 0; i <= plist->sum_folder_count; i++) {
-		sum_file += plist->folder_info[i]->dir_file_count;
-		if (sum_file >= plist->file_seq_num) {
-			plist->dir_file_seq_num = plist->file_seq_num - (sum_file - plist->folder_info[i]->dir_file_count);
-			break;
-		}
-	}
-
-	if (i <= plist->sum_folder_count) {
-		plist->folder_seq_num = i;
+	if (!calc_folder_seq_num(plist)) {
 		SYS_LOG_INF("file seq num=%d,folder_seq_num=%d,cur_cluster=%d\n",
 			plist->file_seq_num, plist->folder_seq_num,
 			plist->folder_info[plist->folder_seq_num]->cur_cluster);
@@ -139,9 +488,6 @@ static void calc_track_no_playlist_info(struct play_list_t *plist, u16_t track_n
 
 static void calc_next_playlist_info(struct play_list_t *plist, u8_t add)
 {
-	int i = 0;
-	u32_t sum_file = 0;
-
 	if (add) {
 		if (plist->file_seq_num < plist->sum_file_count)
 			plist->file_seq_num++;
@@ -153,32 +499,21 @@ static void calc_next_playlist_info(struct play_list_t *plist, u8_t add)
 		else
 			plist->file_seq_num = plist->sum_file_count;
 	}
-	/*calc dir_file_seq_num and folder_seq_num by file_seq_num*/
-	for (i = 0; i <= plist->sum_folder_count; i++) {
-		sum_file += plist->folder_info[i]->dir_file_count;
-		if (sum_file >= plist->file_seq_num) {
-			plist->dir_file_seq_num = plist->file_seq_num - (sum_file - plist->folder_info[i]->dir_file_count);
-			break;
-		}
-	}
 
-	if (i <= plist->sum_folder_count) {
-		plist->folder_seq_num = i;
+	if (!calc_folder_seq_num(plist)) {
 		SYS_LOG_INF("file seq num=%d,folder_seq_num=%d,cur_cluster=%d\n",
 			plist->file_seq_num, plist->folder_seq_num,
 			plist->folder_info[plist->folder_seq_num]->cur_cluster);
 	#if CONFIG_SUPPORT_FILE_FULL_NAME
 		SYS_LOG_INF("far_cluster=%d,blk_ofs=%d\n",
-			plist->folder_info[i]->far_cluster, plist->folder_info[i]->blk_ofs);
+			plist->folder_info[plist->folder_seq_num]->far_cluster,
+			plist->folder_info[plist->folder_seq_num]->blk_ofs);
 	#endif
 	}
 }
 
 static void calc_next_folder_playlist_info(struct play_list_t *plist, u8_t add)
 {
-	int i = 0;
-	u32_t sum_file = 0;
-
 	if (add) {
 		plist->file_seq_num = plist->file_seq_num - plist->dir_file_seq_num
 			+ plist->folder_info[plist->folder_seq_num]->dir_file_count + 1;/*get next folder the 1st file*/
@@ -202,22 +537,77 @@ static void calc_next_folder_playlist_info(struct play_list_t *plist, u8_t add)
 			plist->file_seq_num++;/*start at the lst file of prev valid folder*/
 		}
 	}
-	/*calc dir_file_seq_num and folder_seq_num by file_seq_num*/
-	for (i = 0; i <= plist->sum_folder_count; i++) {
-		sum_file += plist->folder_info[i]->dir_file_count;
-		if (sum_file >= plist->file_seq_num) {
-			plist->dir_file_seq_num = plist->file_seq_num - (sum_file - plist->folder_info[i]->dir_file_count);
-			break;
-		}
-	}
 	/*filter invalidate bp*/
-	if (i <= plist->sum_folder_count) {
-		plist->folder_seq_num = i;
+	if (!calc_folder_seq_num(plist)) {
 		SYS_LOG_INF("file seq num=%d,folder_seq_num=%d,cur_cluster=%d\n",
 			plist->file_seq_num, plist->folder_seq_num,
 			plist->folder_info[plist->folder_seq_num]->cur_cluster);
 	}
 }
+/*
+ * get the dir_file_seq_num file of current folder, its size, direntry offset
+ * and name. The index gives the offset at once, a direntry not matching its
+ * record drops the index and the folder is read up to the file.
+ */
+static int file_entry_get(struct play_list_t *plist, fs_dir_t *zdp, struct fs_dirent *entry, u32_t *blk_ofs)
+{
+	struct folder_info_t *info = plist->folder_info[plist->folder_seq_num];
+	int res = -ENOENT;
+	u16_t times = 0;
+
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	if (plist->index && plist->index->valid) {
+		struct plist_index_rec rec;
+
+		res = plist_index_read(plist->index, info->rec_ofs + plist->dir_file_seq_num - 1, &rec);
+		if (!res)
+			res = fs_opendir_cluster(zdp, plist->topdir, info->cur_cluster, rec.blk_ofs);
+		if (!res) {
+			memset(entry, 0, sizeof(struct fs_dirent));
+			res = fs_readdir(zdp, entry);
+			fs_closedir(zdp);
+		}
+		if (!res && plist_index_rec_match(plist, entry, &rec)) {
+			*blk_ofs = rec.blk_ofs;
+			return 0;
+		}
+		SYS_LOG_WRN("index out of date (res=%d), read folder\n", res);
+		plist_index_drop(plist->index);
+	}
+#endif
+
+	res = fs_opendir_cluster(zdp, plist->topdir, info->cur_cluster, 0);
+	if (res) {
+		SYS_LOG_ERR("fs_opendir failed (res=%d)\n", res);
+		fs_closedir(zdp);
+		return res;
+	}
+
+	do {
+		memset(entry, 0, sizeof(struct fs_dirent));
+		res = fs_readdir(zdp, entry);
+		if (res || entry->name[0] == 0) {
+			SYS_LOG_ERR("fs_readdir failed (res=%d), skip this\n", res);
+			fs_closedir(zdp);
+			return res ? res : -ENOENT;
+		}
+		/* skipped by scan too */
+		if (entry->name[0] == '.')
+			continue;
+	#ifdef CONFIG_FILE_ITERATOR_INDEX
+		if (plist_is_index_file(entry->name))
+			continue;
+	#endif
+		/* filter out unmatch directory or file */
+		if (plist->match_fn && entry->type == FS_DIR_ENTRY_FILE && plist->match_fn(entry->name, 0))
+			times++;
+	} while (times < plist->dir_file_seq_num);
+
+	*blk_ofs = zdp->dp.blk_ofs;
+	fs_closedir(zdp);
+	return 0;
+}
+
 //source:SN60~B.MP3/SNA0~ROOTDI~1/,dest=SD:
 //SD:SNA0~ROOTDI~1/SN60~B.MP3
 #if CONFIG_SUPPORT_FILE_FULL_NAME
@@ -245,7 +635,7 @@ static int file_dirname_get(struct play_list_t *plist, struct iterator *iter)
 {
 	struct file_iterator_data *data = iter->data;
 	int res = -ENOENT;
-	u16_t times = 0;
+	u32_t blk_ofs = 0;
 	u8_t i = 0;
 	u8_t temp_folder_seq = 0;
 	char *path_buff = mem_malloc(FULL_PATH_LEN);
@@ -256,29 +646,13 @@ static int file_dirname_get(struct play_list_t *plist, struct iterator *iter)
 		goto exit;
 
 	/*read file name*/
-	res = fs_opendir_cluster(zdp, plist->topdir, plist->folder_info[plist->folder_seq_num]->cur_cluster, 0);
-	if (!res) {
-		do {
-			memset(entry, 0, sizeof(struct fs_dirent));
-			res = fs_readdir(zdp, entry);
-			if (res || entry->name[0] == 0) {
-				SYS_LOG_ERR("fs_readdir failed (res=%d), skip this\n", res);
-				fs_closedir(zdp);
-				goto exit;
-			}
-			/* filter out unmatch directory or file */
-			if (plist->match_fn && entry->type == FS_DIR_ENTRY_FILE && plist->match_fn(entry->name, 0))
-				times++;
-		} while (times < plist->dir_file_seq_num);
-		strcpy(path_buff + strlen(path_buff), entry->name);
-		path_buff[strlen(path_buff)] = '/';
-		SYS_LOG_DBG("file name:%s\n",path_buff);
-		fs_closedir(zdp);
-	} else {
-		SYS_LOG_ERR("fs_opendir failed (res=%d)\n", res);
-		fs_closedir(zdp);
+	res = file_entry_get(plist, zdp, entry, &blk_ofs);
+	if (res)
 		goto exit;
-	}
+
+	strcpy(path_buff + strlen(path_buff), entry->name);
+	path_buff[strlen(path_buff)] = '/';
+	SYS_LOG_DBG("file name:%s\n",path_buff);
 
 	/*gets all parent directory names*/
 	temp_folder_seq = plist->folder_seq_num;
@@ -355,8 +729,7 @@ static int file_dirname_get(struct play_list_t *plist, struct iterator *iter)
 {
 	struct file_iterator_data *data = iter->data;
 	int res = -ENOENT;
-	u16_t times = 0;
-	DIR* dp = NULL;
+	u32_t blk_ofs = 0;
 	fs_dir_t *zdp = mem_malloc(sizeof(fs_dir_t));
 	struct fs_dirent *entry = mem_malloc(sizeof(struct fs_dirent));
 
@@ -364,33 +737,14 @@ static int file_dirname_get(struct play_list_t *plist, struct iterator *iter)
 		goto exit;
 
 	/*read file name*/
-	dp = &(zdp->dp);
-	res = fs_opendir_cluster(zdp, plist->topdir, plist->folder_info[plist->folder_seq_num]->cur_cluster, 0);
-	if (!res) {
-		do {
-			memset(entry, 0, sizeof(struct fs_dirent));
-			res = fs_readdir(zdp, entry);
-			if (res || entry->name[0] == 0) {
-				SYS_LOG_ERR("fs_readdir failed (res=%d), skip this\n", res);
-				fs_closedir(zdp);
-				goto exit;
-			}
-			/* filter out unmatch directory or file */
-			if (plist->match_fn && entry->type == FS_DIR_ENTRY_FILE && plist->match_fn(entry->name, 0))
-				times++;
-		} while (times < plist->dir_file_seq_num);
-		SYS_LOG_INF("file name:%s\n", entry->name);
-		fs_closedir(zdp);
-	} else {
-		SYS_LOG_ERR("fs_opendir failed (res=%d)\n", res);
-		fs_closedir(zdp);
+	res = file_entry_get(plist, zdp, entry, &blk_ofs);
+	if (res)
 		goto exit;
-	}
 
 	/*get file path*/
 	memset(data->full_path, 0, FULL_PATH_LEN);
-	snprintf(data->full_path, FULL_PATH_LEN, "%s%s/%s%u/%zu/%zu", OPEN_MODE, plist->topdir, CLUSTER,
-		plist->folder_info[plist->folder_seq_num]->cur_cluster, dp->blk_ofs, entry->size);
+	snprintf(data->full_path, FULL_PATH_LEN, "%s%s/%s%u/%u/%zu", OPEN_MODE, plist->topdir, CLUSTER,
+		plist->folder_info[plist->folder_seq_num]->cur_cluster, blk_ofs, entry->size);
 
 	data->cursor.path = data->full_path;
 	iter->cursor = &data->cursor;
@@ -470,6 +824,45 @@ static const void *file_iterator_next_folder(struct iterator *iter, u16_t *track
 	return data->full_path;
 }
 
+/* move to the next or previous file of the play mode */
+static int plist_step(struct play_list_t *plist, u8_t add, bool force_switch)
+{
+	if (add) {
+		/*no cycle in mode 2*/
+		if (plist->mode == 2 && plist->file_seq_num == plist->sum_file_count && !force_switch)
+			return -ENOENT;
+		/*folder cycle in mode 3*/
+		if (plist->mode == 3 &&
+			plist->dir_file_seq_num >= plist->folder_info[plist->folder_seq_num]->dir_file_count)
+			plist->file_seq_num -= plist->dir_file_seq_num;
+	} else {
+		/*folder cycle in mode 3*/
+		if (plist->mode == 3 && plist->dir_file_seq_num == 1)
+			plist->file_seq_num += plist->folder_info[plist->folder_seq_num]->dir_file_count;
+	}
+
+	calc_next_playlist_info(plist, add);
+	return 0;
+}
+
+/* path of current file, taken from peek if it has resolved the file already */
+static int plist_path_get(struct play_list_t *plist, struct iterator *iter)
+{
+	struct file_iterator_data *data = iter->data;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(data->peek); i++) {
+		if (data->peek[i].track_no && data->peek[i].track_no == plist->file_seq_num) {
+			strcpy(data->full_path, data->peek[i].path);
+			data->cursor.path = data->full_path;
+			iter->cursor = &data->cursor;
+			return 0;
+		}
+	}
+
+	return file_dirname_get(plist, iter);
+}
+
 static const void *next(struct iterator *iter, bool force_switch, u16_t *track_no)
 {
 	struct file_iterator_data *data = iter->data;
@@ -477,17 +870,11 @@ static const void *next(struct iterator *iter, bool force_switch, u16_t *track_n
 
 	if (!plist || !plist->sum_file_count)
 		return NULL;
-	/*no cycle in mode 2*/
-	if (plist->mode == 2 && plist->file_seq_num == plist->sum_file_count && !force_switch)
-		return NULL;
-	/*folder cycle in mode 3*/
-	if (plist->mode == 3 &&
-		plist->dir_file_seq_num >= plist->folder_info[plist->folder_seq_num]->dir_file_count)
-		plist->file_seq_num -= plist->dir_file_seq_num;
 
-	calc_next_playlist_info(plist, 1);
+	if (plist_step(plist, 1, force_switch))
+		return NULL;
 
-	if (file_dirname_get(plist, iter))
+	if (plist_path_get(plist, iter))
 		return NULL;
 	if (track_no)
 		*(u16_t *)track_no = plist->file_seq_num;
@@ -534,13 +921,10 @@ static const void *prev(struct iterator *iter, u16_t *track_no)
 
 	if (!plist || !plist->sum_file_count)
 		return NULL;
-	/*folder cycle in mode 3*/
-	if (plist->mode == 3 && plist->dir_file_seq_num == 1)
-		plist->file_seq_num += plist->folder_info[plist->folder_seq_num]->dir_file_count;
 
-	calc_next_playlist_info(plist, 0);
+	plist_step(plist, 0, false);
 
-	if (file_dirname_get(plist, iter))
+	if (plist_path_get(plist, iter))
 		return NULL;
 	if (track_no)
 		*(u16_t *)track_no = plist->file_seq_num;
@@ -581,6 +965,59 @@ static const void *file_iterator_prev(struct iterator *iter, u16_t *track_no)
 	return prev(iter, track_no);
 }
 
+/*
+ * resolve the file next() or prev() would return without moving to it.
+ * The path is kept until the next peek in the same direction, so the
+ * move itself does not read the folder again.
+ */
+static const void *file_iterator_peek(struct iterator *iter, bool forward, u16_t *track_no)
+{
+	struct file_iterator_data *data = iter->data;
+	struct play_list_t *plist = get_play_list();
+	const void *cursor = iter->cursor;
+	u16_t file_seq_num, dir_file_seq_num;
+	u8_t folder_seq_num;
+	char *full_path;
+	int i = forward ? 1 : 0;
+	int res;
+
+	if (!plist || !plist->sum_file_count)
+		return NULL;
+
+	if (!data->peek[i].path) {
+		data->peek[i].path = mem_malloc(FULL_PATH_LEN);
+		if (!data->peek[i].path)
+			return NULL;
+	}
+
+	file_seq_num = plist->file_seq_num;
+	folder_seq_num = plist->folder_seq_num;
+	dir_file_seq_num = plist->dir_file_seq_num;
+
+	res = plist_step(plist, forward, false);
+	if (!res && data->peek[i].track_no != plist->file_seq_num) {
+		/* resolve into the peek buffer, the current path stays */
+		full_path = data->full_path;
+		data->full_path = data->peek[i].path;
+		res = file_dirname_get(plist, iter);
+		data->peek[i].path = data->full_path;
+		data->full_path = full_path;
+		data->cursor.path = full_path;
+		iter->cursor = cursor;
+
+		data->peek[i].track_no = res ? 0 : plist->file_seq_num;
+	}
+
+	if (track_no)
+		*track_no = plist->file_seq_num;
+
+	plist->file_seq_num = file_seq_num;
+	plist->folder_seq_num = folder_seq_num;
+	plist->dir_file_seq_num = dir_file_seq_num;
+
+	return res ? NULL : data->peek[i].path;
+}
+
 static int _back_to_topdir(struct file_iterator_data *data)
 {
 	int res = 0;
@@ -648,6 +1085,25 @@ static int file_iterator_playlist_init(struct play_list_t *plist, struct file_it
 
 	plist->folder_info[0]->dir_file_count = 0;
 	plist->folder_info[0]->dir_layer = 0;
+	plist->sum_file_count = 0;
+	plist->sum_folder_count = 0;
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	plist->folder_info[0]->rec_ofs = 0;
+	plist->folder_info[0]->entry_sum = PLIST_SUM_INIT;
+	plist->folder_info[0]->subdir_sum = PLIST_SUM_INIT;
+	if (plist->index) {
+		u32_t layout[2] = {data->max_level, CONFIG_PLIST_SUPPORT_FOLDER_CNT};
+		u32_t match_fn = (u32_t)(uintptr_t)plist->match_fn;
+		u32_t sum = PLIST_SUM_INIT;
+
+		/* the filter of another firmware may match other files */
+		sum = plist_sum(sum, plist->topdir, strlen(plist->topdir));
+		sum = plist_sum(sum, layout, sizeof(layout));
+		sum = plist_sum(sum, &match_fn, sizeof(match_fn));
+		plist->index->match_id = sum;
+		plist->index->vsn = dp->obj.fs->vsn;
+	}
+#endif
 	SYS_LOG_INF("fs info %s cur_cluster=%d,csize=%d\n",
 		data->full_path, plist->folder_info[0]->cur_cluster, plist->csize);
 	fs_closedir(zdp);
@@ -658,18 +1114,18 @@ exit:
 }
 
 #if CONFIG_SUPPORT_FILE_FULL_NAME
-static int updata_far_cluster_blkofs(struct play_list_t *plist, fs_dir_t *zdp, u8_t folder_index, const char *path)
+static int updata_far_cluster_blkofs(struct play_list_t *plist, const struct fs_dirent_pos *pos, u8_t folder_index, const char *path)
 {
-	DIR* dp = &zdp->dp;
+	DIR* dp = NULL;
 	int res = 0;
 	fs_dir_t *tempdp = NULL;
 	char *path_buff = NULL;
 	char *buf = NULL;
 
-	plist->folder_info[folder_index]->far_cluster = dp->clust;
-	plist->folder_info[folder_index]->blk_ofs = dp->blk_ofs;
+	plist->folder_info[folder_index]->far_cluster = pos->clust;
+	plist->folder_info[folder_index]->blk_ofs = pos->blk_ofs;
 
-	if (dp->blk_ofs >= plist->csize * 512) {/*Sector size 512*/
+	if (pos->blk_ofs >= plist->csize * 512) {/*Sector size 512*/
 		tempdp = mem_malloc(sizeof(fs_dir_t));
 		path_buff = mem_malloc(strlen(path) + 1);
 		if (!tempdp || !path_buff)
@@ -710,6 +1166,11 @@ static int file_iterator_playlist_set(struct play_list_t *plist, fs_dir_t *zdp,
 	plist->folder_info[folder_index]->cur_cluster = dp->clust;
 	plist->folder_info[folder_index]->dir_file_count = 0;
 	plist->folder_info[folder_index]->dir_layer = layer;
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	plist->folder_info[folder_index]->rec_ofs = plist->sum_file_count;
+	plist->folder_info[folder_index]->entry_sum = PLIST_SUM_INIT;
+	plist->folder_info[folder_index]->subdir_sum = PLIST_SUM_INIT;
+#endif
 	SYS_LOG_DBG("folder_index=%d,cur_cluster= %zu,layer=%d\n", folder_index, dp->clust, layer);
 	return 0;
 }
@@ -760,118 +1221,434 @@ exit:
 
 }
 
-static const char *file_iterator_scan_disk(struct play_list_t *plist, struct iterator *iter, const void *param)
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+/*
+ * check the direntries of a folder against the index, the files of a
+ * changed folder are read again and their records appended.
+ * return 0 if not changed, 1 if the files are read again, or -ESTALE if
+ * the sub folders changed and the disk has to be scanned.
+ */
+static int plist_index_verify_folder(struct play_list_t *plist, struct fs_dirent *entry, u8_t folder_index)
 {
-	struct file_iterator_data *data = iter->data;
-	const struct file_iterator_param *iter_param = (struct file_iterator_param *)param;
-	const struct file_iterator_cursor *cursor = iter_param->cursor;
-	int res = -ENOENT;
-	u16_t len;
-	u8_t is_file_type = 1;
-#ifndef CONFIG_SUPPORT_FILE_FULL_NAME
-	u8_t is_null_folder = 1;
-#endif
-	u8_t has_sub_folder = 0;
-	u32_t cursor_cluster = 0;
-	u32_t cursor_blk_ofs = 0;
-	u32_t cursor_file_size = 0;
-	u32_t temp_cluster = 0;
-	DIR* dp = NULL;
-
-	iter->cursor = NULL;
-	if (data->level < 0)
-		return NULL;
+	struct folder_info_t *info = plist->folder_info[folder_index];
+	struct plist_index_t *index = plist->index;
+	u32_t entry_sum = info->entry_sum;
+	u32_t subdir_sum = info->subdir_sum;
+	u32_t rec_ofs = index->rec_cnt;
+	u16_t file_count = 0;
+	fs_dir_t *zdp = NULL;
+	int changed = 0;
+	int res;
 
-	if (cursor->path)
-		get_cursor_info(cursor->path, &cursor_cluster, &cursor_blk_ofs, &cursor_file_size);
+	zdp = mem_malloc(sizeof(fs_dir_t));
+	if (!zdp)
+		return -ENOMEM;
 
-	dp = &(data->dirs[data->level]->dp);
-	temp_cluster = dp->clust;
+	info->entry_sum = PLIST_SUM_INIT;
+	info->subdir_sum = PLIST_SUM_INIT;
 
+	/*checksum first, read files only if changed*/
 	do {
-		res = fs_readdir(data->dirs[data->level], data->dirent);
-		if (res)
-			SYS_LOG_ERR("fs_readdir failed (res=%d), skip this\n", res);
+		res = fs_opendir_cluster(zdp, plist->topdir, info->cur_cluster, 0);
+		while (!res) {
+			memset(entry, 0, sizeof(struct fs_dirent));
+			res = fs_readdir(zdp, entry);
+			if (res || entry->name[0] == 0)
+				break;
+			if (entry->name[0] == '.' || plist_is_index_file(entry->name))
+				continue;
 
-		/*
-		 * if fs_readdir failed or end-of-dir, skip this directory and
-		 * go up one level.
-		 *
-		 * name[0] == 0 means end-of-dir
-		 */
+			if (!changed) {
+				plist_entry_sum(info, entry, zdp->dp.blk_ofs);
+			} else if (entry->type == FS_DIR_ENTRY_FILE &&
+				(!plist->match_fn || plist->match_fn(entry->name, 0))) {
+				plist_index_add(index, zdp->dp.blk_ofs, (u32_t)entry->size);
+				file_count++;
+			}
+		}
+		fs_closedir(zdp);
 
-		if (res || data->dirent->name[0] == 0) {
-			fs_closedir(data->dirs[data->level]);
+		if (res || info->entry_sum == entry_sum || changed)
+			break;
 
-			if (data->level == 0 && (is_file_type == 0 || has_sub_folder == 0)) {
-				data->level = -1;
-				return NULL;
-			}
+		if (info->subdir_sum != subdir_sum) {
+			res = -ESTALE;
+			break;
+		}
+		changed = 1;
+	} while (1);
 
-			if (is_file_type && has_sub_folder) {
-				is_file_type = 0;
-				has_sub_folder = 0;
-				/*remove file name*/
-				data->full_len -= data->fname_len;
-				data->full_path[data->full_len] = 0;
-				data->fname_len = 0;
-				if (data->full_path[data->full_len - 1] == '/')
-					data->full_path[data->full_len - 1] = 0;
-				SYS_LOG_DBG("repeat_opendir %s \n", data->full_path);
-				res = fs_opendir(data->dirs[data->level], data->full_path);
-				if (res) {
-					SYS_LOG_WRN("repeat_opendir %s failed (res=%d)\n", data->full_path, res);
-				}
-				if (data->full_path[data->full_len - 1] == 0)
-					data->full_path[data->full_len - 1] = '/';
+	mem_free(zdp);
+	if (res)
+		return res;
+
+	if (!changed)
+		return 0;
+
+	plist_index_flush(index);
+	if (!index->valid)
+		return -EIO;
+
+	SYS_LOG_INF("folder %d changed, %d files\n", folder_index, file_count);
+	info->rec_ofs = rec_ofs;
+	info->dir_file_count = file_count;
+	return 1;
+}
+
+static void plist_set_cursor(struct play_list_t *plist, u8_t folder_index, u16_t dir_file_seq_num)
+{
+	plist->folder_seq_num = folder_index;
+	plist->dir_file_seq_num = dir_file_seq_num;
+	plist->file_seq_num = plist->folder_info[folder_index]->file_base + dir_file_seq_num;
+	SYS_LOG_INF("cur file_seq_num=%d,dir_file_seq_num=%d,folder_seq_num=%d\n",
+		plist->file_seq_num, plist->dir_file_seq_num, plist->folder_seq_num);
+}
+
+/*
+ * find the cursor without scan: a cluster url is looked up in the records
+ * of its folder, a full path is looked up by name in its folder.
+ */
+static void plist_index_find_cursor(struct play_list_t *plist, struct fs_dirent *entry, const char *path)
+{
+	struct folder_info_t *info;
+	struct plist_index_rec rec;
+	u32_t cluster = 0;
+	u32_t blk_ofs = 0;
+	u32_t file_size = 0;
+	fs_dir_t *zdp = NULL;
+	char *dir = NULL;
+	char *name = NULL;
+	u16_t times = 0;
+	int i, j;
+
+	if (!get_cursor_info(path, &cluster, &blk_ofs, &file_size)) {
+		for (i = 0; i <= plist->sum_folder_count; i++) {
+			info = plist->folder_info[i];
+			if (info->cur_cluster != cluster)
 				continue;
+
+			for (j = 0; j < info->dir_file_count; j++) {
+				if (plist_index_read(plist->index, info->rec_ofs + j, &rec))
+					return;
+				if (rec.blk_ofs == blk_ofs && rec.size == file_size) {
+					plist_set_cursor(plist, i, j + 1);
+					return;
+				}
 			}
-			/* up one level to read dir*/
-			data->full_len -= data->fname_len + data->dname_len[data->level];
-			data->full_path[data->full_len] = 0;
-			data->fname_len = 0;
-			data->level--;
-			SYS_LOG_DBG("up to dir %s\n", data->full_path);
-			is_file_type = 0;
-			continue;
 		}
+		return;
+	}
 
-		/* FIXME: skip hidden diretory or file ? */
-		if (data->dirent->name[0] == '.')
-			continue;
+	zdp = mem_malloc(sizeof(fs_dir_t));
+	dir = mem_malloc(strlen(path) + 1);
+	if (!zdp || !dir)
+		goto exit;
 
-		/* manage the full path */
-		len = (u16_t)strlen(data->dirent->name);
-		data->full_len -= data->fname_len;
-		if (data->full_len + len >= FULL_PATH_LEN - 1) {
-			SYS_LOG_WRN("too long path, exceed %zu bytes (%s)\n",
-					data->full_len + len - sizeof(data->full_path), data->dirent->name);
-			data->full_len += data->fname_len;
+	strcpy(dir, path);
+	name = strrchr(dir, '/');
+	if (!name)
+		goto exit;
+	*name++ = 0;
+
+	if (fs_opendir(zdp, dir))
+		goto exit;
+	cluster = zdp->dp.clust;
+	fs_closedir(zdp);
+
+	for (i = 0; i <= plist->sum_folder_count; i++) {
+		if (plist->folder_info[i]->cur_cluster == cluster)
+			break;
+	}
+
+	if (i > plist->sum_folder_count ||
+		fs_opendir_cluster(zdp, plist->topdir, cluster, 0))
+		goto exit;
+
+	while (times < plist->folder_info[i]->dir_file_count) {
+		memset(entry, 0, sizeof(struct fs_dirent));
+		if (fs_readdir(zdp, entry) || entry->name[0] == 0)
+			break;
+		if (entry->type != FS_DIR_ENTRY_FILE || entry->name[0] == '.' ||
+			plist_is_index_file(entry->name) ||
+			(plist->match_fn && !plist->match_fn(entry->name, 0)))
 			continue;
+
+		times++;
+		if (!strcmp(entry->name, name)) {
+			plist_set_cursor(plist, i, times);
+			break;
 		}
+	}
+	fs_closedir(zdp);
 
-		memcpy(&data->full_path[data->full_len], data->dirent->name, len);
-		data->fname_len = len;
-		data->full_len += len;
-		data->full_path[data->full_len] = 0;
+exit:
+	if (zdp)
+		mem_free(zdp);
+	if (dir)
+		mem_free(dir);
+}
 
-		/* filter out unmatch directory or file */
-		if (data->match_fn && !data->match_fn(data->full_path,
-					data->dirent->type == FS_DIR_ENTRY_DIR)) {
-			SYS_LOG_DBG("filter out %s\n", data->full_path);
-			continue;
+/*
+ * load the play list from the index. The direntries of every folder are
+ * checked, a rename or a same size replacement keeps the free cluster
+ * count and is only seen this way. Only changed folders are read again.
+ */
+static int plist_index_load(struct play_list_t *plist, struct file_iterator_data *data,
+			const struct file_iterator_param *iter_param)
+{
+	struct plist_index_t *index = plist->index;
+	struct plist_index_head head;
+	struct plist_index_folder folder;
+	struct folder_info_t *info;
+	u32_t top_cluster = plist->folder_info[0]->cur_cluster;
+	u32_t check_sum = PLIST_SUM_INIT;
+	int changed = 0;
+	int res = -ENOENT;
+	int i;
+
+	if (!index || plist_index_open(index, iter_param->topdir))
+		return -ENOENT;
+
+	index->valid = 0;
+	index->buf_cnt = 0;
+
+	if (fs_seek(&index->fp, 0, FS_SEEK_SET) ||
+		fs_read(&index->fp, &head, sizeof(head)) != sizeof(head))
+		return -ENOENT;
+
+	if (head.magic != PLIST_INDEX_MAGIC || head.version != PLIST_INDEX_VERSION ||
+		head.vsn != index->vsn || head.match_id != index->match_id ||
+		head.csize != plist->csize || head.folder_cnt == 0 ||
+		head.folder_cnt > CONFIG_PLIST_SUPPORT_FOLDER_CNT ||
+		head.file_cnt > MAX_SUPPORT_FILE_CNT) {
+		SYS_LOG_INF("index not match\n");
+		return -ENOENT;
+	}
+
+	for (i = 0; i < head.folder_cnt; i++) {
+		if (fs_read(&index->fp, &folder, sizeof(folder)) != sizeof(folder))
+			return -EIO;
+		check_sum = plist_sum(check_sum, &folder, sizeof(folder));
+
+		info = plist->folder_info[i];
+	#if CONFIG_SUPPORT_FILE_FULL_NAME
+		info->far_cluster = folder.far_cluster;
+		info->blk_ofs = folder.blk_ofs;
+	#endif
+		info->cur_cluster = folder.cur_cluster;
+		info->rec_ofs = folder.rec_ofs;
+		info->entry_sum = folder.entry_sum;
+		info->subdir_sum = folder.subdir_sum;
+		info->dir_file_count = folder.file_cnt;
+		info->dir_layer = folder.dir_layer;
+	}
+
+	check_sum = plist_sum(check_sum, &head, offsetof(struct plist_index_head, check_sum));
+	if (check_sum != head.check_sum || plist->folder_info[0]->cur_cluster != top_cluster) {
+		SYS_LOG_INF("index broken\n");
+		return -ENOENT;
+	}
+
+	plist->sum_folder_count = head.folder_cnt - 1;
+	index->rec_cnt = head.rec_cnt;
+	index->valid = 1;
+
+	for (i = 0; i <= plist->sum_folder_count; i++) {
+		res = plist_index_verify_folder(plist, data->dirent, i);
+		if (res < 0) {
+			SYS_LOG_INF("folder %d verify failed (res=%d)\n", i, res);
+			index->valid = 0;
+			return res;
 		}
+		if (res > 0)
+			changed = 1;
+	}
+
+	calc_file_base(plist);
+
+	/* too many stale records or files, scan to rebuild */
+	if (plist->sum_file_count > MAX_SUPPORT_FILE_CNT ||
+		index->rec_cnt > 2 * plist->sum_file_count + PLIST_INDEX_BUF_CNT) {
+		index->valid = 0;
+		return -ESTALE;
+	}
+
+	if (changed && plist_index_save(plist))
+		SYS_LOG_WRN("index save failed\n");
+
+	if (iter_param->cursor && iter_param->cursor->path)
+		plist_index_find_cursor(plist, data->dirent, iter_param->cursor->path);
+
+	return 0;
+}
+
+/*
+ * the scan appends the records, fs_seek does not go beyond the end so
+ * head and folder table are zero filled first and saved at the end.
+ */
+static void plist_index_begin(struct play_list_t *plist, const char *topdir)
+{
+	struct plist_index_t *index = plist->index;
+	off_t ofs;
+	int len;
+
+	if (!index)
+		return;
+
+	index->valid = 0;
+	index->rec_cnt = 0;
+	index->buf_cnt = 0;
+
+	if (plist_index_open(index, topdir) || fs_truncate(&index->fp, 0))
+		return;
+
+	memset(index->buf, 0, sizeof(index->buf));
+	for (ofs = 0; ofs < PLIST_INDEX_REC_OFS; ofs += len) {
+		len = min(sizeof(index->buf), PLIST_INDEX_REC_OFS - ofs);
+		if (plist_index_write(index, ofs, index->buf, len))
+			return;
+	}
+
+	index->valid = 1;
+}
+
+static void plist_index_end(struct play_list_t *plist)
+{
+	if (!plist->index || !plist->index->valid)
+		return;
+
+	if (plist_index_save(plist))
+		SYS_LOG_WRN("index save failed\n");
+}
+#endif
+
+/* append the direntry name to the path of current level, 0 if too long */
+static int plist_scan_set_name(struct file_iterator_data *data, const char *name)
+{
+	u16_t len = (u16_t)strlen(name);
+
+	if (data->full_len + len >= FULL_PATH_LEN - 1) {
+		SYS_LOG_WRN("too long path, exceed %zu bytes (%s)\n",
+				data->full_len + len - sizeof(data->full_path), name);
+		return 0;
+	}
+
+	memcpy(&data->full_path[data->full_len], name, len + 1);
+	data->fname_len = len;
+	return 1;
+}
+
+static int plist_scan_match_dir(struct file_iterator_data *data, struct fs_dirent *entry)
+{
+	if (entry->type != FS_DIR_ENTRY_DIR || !plist_scan_set_name(data, entry->name))
+		return 0;
+
+	if (data->match_fn && !data->match_fn(data->full_path, 1)) {
+		SYS_LOG_DBG("filter out %s\n", data->full_path);
+		return 0;
+	}
+
+	if (data->level + 1 >= data->max_level) {
+		SYS_LOG_DBG("exceed max level (%u)\n", data->max_level);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int plist_scan_skip(struct fs_dirent *entry)
+{
+	/* FIXME: skip hidden diretory or file ? */
+	if (entry->name[0] == '.')
+		return 1;
+
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	if (plist_is_index_file(entry->name))
+		return 1;
+#endif
+	return 0;
+}
+
+static void plist_scan_push_dir(struct plist_scan_t *scan, struct plist_scan_level *lv,
+		struct fs_dirent *entry, struct fs_dirent_pos *pos)
+{
+	struct plist_scan_dir *dir = (struct plist_scan_dir *)&scan->buf[lv->end];
+	u16_t len = (u16_t)strlen(entry->name);
+	u16_t size = ROUND_UP(sizeof(*dir) + len + 1, 4);
+
+	if (lv->overflow || lv->end + size > CONFIG_FILE_ITERATOR_SCAN_BUF_SIZE) {
+		lv->overflow = 1;
+		return;
+	}
 
-		/* This is a file, file count ++ in file type mode */
-		if (data->dirent->type == FS_DIR_ENTRY_FILE && is_file_type) {
-			plist->folder_info[plist->sum_folder_count]->dir_file_count++;
+	dir->pos = *pos;
+	dir->len = len;
+	memcpy(dir->name, entry->name, len + 1);
+	lv->end += size;
+	lv->dir_cnt++;
+}
+
+/*
+ * read the files of the folder at current level in one pass, the sub
+ * folders are kept in the name buffer to be entered after the files.
+ * return 1 if the max file count is reached.
+ */
+static int plist_scan_folder(struct play_list_t *plist, struct file_iterator_data *data,
+		struct plist_scan_t *scan, const struct file_iterator_cursor *cursor)
+{
+	struct plist_scan_level *lv = &scan->level[data->level];
+	struct folder_info_t *info = plist->folder_info[plist->sum_folder_count];
+	struct fs_dirent *entry;
+	u32_t cursor_cluster = 0;
+	u32_t cursor_blk_ofs = 0;
+	u32_t cursor_file_size = 0;
+	int res = 0;
+	int i, num, err;
+
+	if (cursor && cursor->path)
+		get_cursor_info(cursor->path, &cursor_cluster, &cursor_blk_ofs, &cursor_file_size);
+
+	do {
+		num = fs_readdir_n(data->dirs[data->level], scan->entries, scan->pos,
+				CONFIG_FILE_ITERATOR_READDIR_NUM, &err);
+		if (err)
+			SYS_LOG_ERR("fs_readdir failed (res=%d), skip the rest\n", err);
+
+		for (i = 0; i < num; i++) {
+			entry = &scan->entries[i];
+			if (plist_scan_skip(entry))
+				continue;
+
+		#ifdef CONFIG_FILE_ITERATOR_INDEX
+			/*checksum all direntries*/
+			plist_entry_sum(info, entry, scan->pos[i].blk_ofs);
+		#endif
+
+			if (entry->type == FS_DIR_ENTRY_DIR) {
+				if (plist_scan_match_dir(data, entry))
+					plist_scan_push_dir(scan, lv, entry, &scan->pos[i]);
+				continue;
+			}
+
+			/* filter out unmatch file */
+			if (!plist_scan_set_name(data, entry->name))
+				continue;
+			if (data->match_fn && !data->match_fn(data->full_path, 0)) {
+				SYS_LOG_DBG("filter out %s\n", data->full_path);
+				continue;
+			}
+
+			info->dir_file_count++;
 			plist->sum_file_count++;
+		#ifdef CONFIG_FILE_ITERATOR_INDEX
+			plist_index_add(plist->index, scan->pos[i].blk_ofs, (u32_t)entry->size);
+		#endif
 
 			/*set cursor*/
-			if (cursor && cursor->path && 
-				((temp_cluster == cursor_cluster && dp->blk_ofs == cursor_blk_ofs && (u32_t)(data->dirent->size) == cursor_file_size)
+			if (cursor && cursor->path &&
+				((lv->cluster == cursor_cluster && scan->pos[i].blk_ofs == cursor_blk_ofs && (u32_t)(entry->size) == cursor_file_size)
 				|| !strcmp(cursor->path, data->full_path))) {
-				plist->dir_file_seq_num = plist->folder_info[plist->sum_folder_count]->dir_file_count;
+				plist->dir_file_seq_num = info->dir_file_count;
 				plist->file_seq_num = plist->sum_file_count;
 				plist->folder_seq_num = plist->sum_folder_count;
 				SYS_LOG_INF("cur file_seq_num=%d,dir_file_seq_num=%d,folder_seq_num=%d\n",
@@ -880,27 +1657,132 @@ static const char *file_iterator_scan_disk(struct play_list_t *plist, struct ite
 
 			if (plist->sum_file_count == MAX_SUPPORT_FILE_CNT) {
 				SYS_LOG_WRN("exceed max count\n");
+				res = 1;
 				break;
 			}
-		#ifndef CONFIG_SUPPORT_FILE_FULL_NAME
-			is_null_folder=0;
-		#endif
-			continue;
 		}
+	} while (num > 0 && !err && !res);
 
-		/* This is a file, file count no change in dir type mode */
-		if (data->dirent->type == FS_DIR_ENTRY_FILE && is_file_type == 0) {
-			continue;
+	fs_closedir(data->dirs[data->level]);
+	return res;
+}
+
+/*
+ * get the next sub folder of current level into the path, from the name
+ * buffer or, after the buffer was full, by reading the folder again.
+ */
+static int plist_scan_next_dir(struct play_list_t *plist, struct file_iterator_data *data,
+		struct plist_scan_t *scan, struct fs_dirent_pos *pos)
+{
+	struct plist_scan_level *lv = &scan->level[data->level];
+	struct plist_scan_dir *dir;
+	int num, err;
+
+	if (lv->next < lv->end) {
+		dir = (struct plist_scan_dir *)&scan->buf[lv->next];
+		lv->next += ROUND_UP(sizeof(*dir) + dir->len + 1, 4);
+		*pos = dir->pos;
+		plist_scan_set_name(data, dir->name);
+
+		/*name is in the path now, reuse the buffer*/
+		if (lv->next == lv->end)
+			lv->next = lv->end = lv->start;
+		return 1;
+	}
+
+	if (!lv->overflow)
+		return 0;
+
+	if (!lv->reread) {
+		SYS_LOG_DBG("repeat_opendir %s \n", data->full_path);
+		if (fs_opendir_cluster(data->dirs[data->level], plist->topdir, lv->cluster, 0)) {
+			SYS_LOG_WRN("repeat_opendir %s failed\n", data->full_path);
+			lv->overflow = 0;
+			return 0;
 		}
+		lv->reread = 1;
+	}
 
-		/* This is a dir, set had sub folder flag in file type mode */
-		if (data->dirent->type == FS_DIR_ENTRY_DIR && is_file_type) {
-			has_sub_folder = 1;
+	/* the dir object stays open while the sub folder is scanned */
+	do {
+		num = fs_readdir_n(data->dirs[data->level], scan->entries, pos, 1, &err);
+		if (num <= 0)
+			break;
+		if (plist_scan_skip(scan->entries) || !plist_scan_match_dir(data, scan->entries))
+			continue;
+		if (lv->dir_cnt) {
+			lv->dir_cnt--;
 			continue;
 		}
+		return 1;
+	} while (1);
+
+	fs_closedir(data->dirs[data->level]);
+	lv->overflow = 0;
+	lv->reread = 0;
+	return 0;
+}
+
+static int plist_scan_alloc(struct plist_scan_t *scan)
+{
+	scan->entries = mem_malloc(sizeof(struct fs_dirent) * CONFIG_FILE_ITERATOR_READDIR_NUM);
+	scan->pos = mem_malloc(sizeof(struct fs_dirent_pos) * CONFIG_FILE_ITERATOR_READDIR_NUM);
+	scan->buf = mem_malloc(CONFIG_FILE_ITERATOR_SCAN_BUF_SIZE);
+
+	return (scan->entries && scan->pos && scan->buf) ? 0 : -ENOMEM;
+}
+
+static void plist_scan_free(struct plist_scan_t *scan)
+{
+	if (scan->entries)
+		mem_free(scan->entries);
+	if (scan->pos)
+		mem_free(scan->pos);
+	if (scan->buf)
+		mem_free(scan->buf);
+}
+
+/*
+ * every folder is read once: its files are counted, then its sub folders
+ * are entered in direntry order, so the play list order is unchanged.
+ */
+static int file_iterator_scan_disk(struct play_list_t *plist, struct iterator *iter, const void *param)
+{
+	struct file_iterator_data *data = iter->data;
+	const struct file_iterator_param *iter_param = (struct file_iterator_param *)param;
+	struct plist_scan_t *scan = NULL;
+	struct plist_scan_level *lv;
+	struct fs_dirent_pos pos;
+	int res = -ENOMEM;
+	u16_t start;
+
+	if (data->level < 0)
+		return -ENOENT;
+
+	scan = mem_malloc(sizeof(*scan));
+	if (!scan || plist_scan_alloc(scan)) {
+		SYS_LOG_ERR("no memory to scan\n");
+		fs_closedir(data->dirs[data->level]);
+		goto exit;
+	}
+
+	memset(scan->level, 0, sizeof(scan->level));
+	scan->level[0].cluster = data->dirs[0]->dp.clust;
+	res = 0;
+
+	if (plist_scan_folder(plist, data, scan, iter_param->cursor))
+		goto exit;
+
+	do {
+		if (!plist_scan_next_dir(plist, data, scan, &pos)) {
+			if (data->level == 0)
+				break;
 
-		if (data->level + 1 >= data->max_level) {
-			SYS_LOG_DBG("exceed max level (%u)\n", data->max_level);
+			/* up one level to read dir*/
+			data->full_len -= data->dname_len[data->level];
+			data->full_path[data->full_len] = 0;
+			data->level--;
+			SYS_LOG_DBG("up to dir %s\n", data->full_path);
 			continue;
 		}
 
@@ -908,44 +1790,64 @@ static const char *file_iterator_scan_disk(struct play_list_t *plist, struct ite
 			SYS_LOG_INF("exceed max folder(%d)\n", CONFIG_PLIST_SUPPORT_FOLDER_CNT);
 			break;
 		}
+
 		/* This is directory, down one level if everthing ok */
 		res = fs_opendir(data->dirs[data->level + 1], data->full_path);
 		if (res) {
 			SYS_LOG_WRN("fs_opendir %s failed (res=%d)\n", data->full_path, res);
+			res = 0;
 			continue;
 		}
 
-		/*set playlist folder structor*/
-	#ifndef CONFIG_SUPPORT_FILE_FULL_NAME
-		if(is_null_folder == 0)
+		/*set playlist folder structor, an empty folder gives its slot away*/
+	#ifndef PLIST_KEEP_EMPTY_FOLDER
+		if (plist->folder_info[plist->sum_folder_count]->dir_file_count)
 			plist->sum_folder_count++;
-		is_null_folder = 1;
+	#else
+		plist->sum_folder_count++;
 	#endif
 	#if CONFIG_SUPPORT_FILE_FULL_NAME
-		plist->sum_folder_count++;
-		updata_far_cluster_blkofs(plist, data->dirs[data->level], plist->sum_folder_count, data->full_path);
+		updata_far_cluster_blkofs(plist, &pos, plist->sum_folder_count, data->full_path);
 	#endif
 
 		file_iterator_playlist_set(plist, data->dirs[data->level + 1], plist->sum_folder_count, data->level + 1);
-		/*read file first in a new dir*/
-		is_file_type = 1;
+
 		/* append a seperator */
+		data->full_len += data->fname_len;
 		data->full_path[data->full_len] = '/';
 		data->full_path[++data->full_len] = 0;
-		data->dname_len[++data->level] = data->fname_len + 1;
+		data->dname_len[data->level + 1] = data->fname_len + 1;
 		data->fname_len = 0;
 
-		/*open dir need to get cluster*/
-		dp = &(data->dirs[data->level]->dp);
-		temp_cluster = dp->clust;
+		/* sub folders of the new dir go above the pending ones */
+		start = scan->level[data->level].end;
+		lv = &scan->level[++data->level];
+		memset(lv, 0, sizeof(*lv));
+		lv->start = lv->next = lv->end = start;
+		lv->cluster = data->dirs[data->level]->dp.clust;
 
 		SYS_LOG_DBG("down to dir %s\n", data->full_path);
+		if (plist_scan_folder(plist, data, scan, iter_param->cursor))
+			break;
 	} while (1);
 
+exit:
+	/* folders of upper levels are still open when reading them again */
+	for (; data->level >= 0; data->level--) {
+		if (scan && scan->level[data->level].reread)
+			fs_closedir(data->dirs[data->level]);
+	}
+	data->fname_len = 0;
+
+	if (scan) {
+		plist_scan_free(scan);
+		mem_free(scan);
+	}
+
 	/* clear prev query flag */
 	data->has_query_prev = 0;
 
-	return data->full_path;
+	return res;
 }
 
 static int file_iterator_update_playlist(struct play_list_t *plist, struct iterator *iter, const void *param)
@@ -956,6 +1858,17 @@ static int file_iterator_update_playlist(struct play_list_t *plist, struct itera
 
 	file_iterator_playlist_init(plist, data, param);
 
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	if (!plist_index_load(plist, data, param)) {
+		SYS_LOG_INF("play list loaded from index\n");
+		return 0;
+	}
+
+	/* index may have overwritten the folder table */
+	file_iterator_playlist_init(plist, data, param);
+	plist_index_begin(plist, plist->topdir);
+#endif
+
 	res = _back_to_topdir(data);
 	if (res)
 		return res;
@@ -967,6 +1880,11 @@ static int file_iterator_update_playlist(struct play_list_t *plist, struct itera
 #if CONFIG_SYS_LOG_DEFAULT_LEVEL >= 3
 	SYS_LOG_INF("scan disk case %d us \n", (k_cycle_get_32() - begin)/24);
 #endif
+	calc_file_base(plist);
+
+#ifdef CONFIG_FILE_ITERATOR_INDEX
+	plist_index_end(plist);
+#endif
 
 	return res;
 }
@@ -1064,6 +1982,10 @@ static int file_iterator_init(struct iterator *iter, const void *param)
 			if (!play_list->folder_info[i])
 				goto err_out;
 		}
+	#ifdef CONFIG_FILE_ITERATOR_INDEX
+		/* without index the disk is scanned every time */
+		play_list->index = mem_malloc(sizeof(struct plist_index_t));
+	#endif
 	}
 
 	strcpy(data->full_path, iter_param->topdir);
@@ -1150,6 +2072,9 @@ err_out:
 				play_list->folder_info[i] = NULL;
 			}
 		}
+	#ifdef CONFIG_FILE_ITERATOR_INDEX
+		plist_index_close(play_list);
+	#endif
 
 		mem_free(play_list);
 		play_list = NULL;
@@ -1171,6 +2096,7 @@ static const struct iterator_ops file_iterator_ops = {
 	.set_track_no = file_iterator_set_track_no,
 	.set_mode = file_iterator_set_mode,
 	.get_plist_info = file_iterator_get_plist_info,
+	.peek = file_iterator_peek,
 };
 
 struct iterator *file_iterator_create(file_iterator_param_t *param)
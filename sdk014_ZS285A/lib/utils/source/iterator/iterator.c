@@ -133,3 +133,13 @@ int iterator_get_plist_info(struct iterator *iter, void *param)
 
 	return -ENOSYS;
 }
+
+const void *iterator_peek(struct iterator *iter, bool forward, u16_t *track_no)
+{
+	const void *res = NULL;
+
+	if (iter && iter->ops->peek)
+		res = iter->ops->peek(iter, forward, track_no);
+
+	return res;
+}
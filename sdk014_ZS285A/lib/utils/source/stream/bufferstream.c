@@ -34,24 +34,14 @@ int buffer_stream_open(io_stream_t handle, stream_mode mode)
 	return 0;
 }
 
-int buffer_stream_read(io_stream_t handle, unsigned char * buf, int num)
+/* copy out with info->lock held */
+static int _buffer_stream_read(io_stream_t handle, unsigned char *buf, int num)
 {
 	int brw = 0;
 	int read_len = 0;
 	int file_off = 0;
 	buffer_info_t *info = (buffer_info_t *)handle->data;
 
-	assert(info);
-
-	brw = os_mutex_lock(&info->lock, K_FOREVER);
-	if (brw < 0) {
-		SYS_LOG_ERR("lock failed %d \n",brw);
-		return -brw;
-	}
-	if(handle->state != STATE_OPEN) {
-		goto err_out;
-	}
-
 	if ((handle->mode & MODE_IN_OUT) == MODE_IN_OUT) {
 		file_off = handle->rofs % info->length;
 
@@ -83,6 +73,57 @@ int buffer_stream_read(io_stream_t handle, unsigned char * buf, int num)
 		handle->rofs += read_len;
 	}
 
+	return read_len;
+}
+
+int buffer_stream_read(io_stream_t handle, unsigned char * buf, int num)
+{
+	int brw = 0;
+	int read_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0) {
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return -brw;
+	}
+	if(handle->state != STATE_OPEN) {
+		goto err_out;
+	}
+
+	read_len = _buffer_stream_read(handle, buf, num);
+
+err_out:
+	os_mutex_unlock(&info->lock);
+	return read_len;
+}
+
+static int buffer_stream_readv(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, brw;
+	int read_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0) {
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return -brw;
+	}
+	if(handle->state != STATE_OPEN) {
+		goto err_out;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		brw = _buffer_stream_read(handle, iov[i].base, iov[i].len);
+		read_len += brw;
+		if (brw != iov[i].len)
+			break;
+	}
+
 err_out:
 	os_mutex_unlock(&info->lock);
 	return read_len;
@@ -104,21 +145,14 @@ int buffer_stream_tell(io_stream_t handle)
 	return handle->rofs;
 }
 
-int buffer_stream_write(io_stream_t handle, unsigned char * buf, int num)
+/* copy in with info->lock held */
+static int _buffer_stream_write(io_stream_t handle, unsigned char *buf, int num)
 {
 	int brw = 0;
 	int wirte_len = 0;
 	int file_off = 0;
 	buffer_info_t *info = (buffer_info_t *)handle->data;
 
-	assert(info);
-
-	brw = os_mutex_lock(&info->lock, K_FOREVER);
-	if (brw < 0) {
-		SYS_LOG_ERR("lock failed %d \n",brw);
-		return -brw;
-	}
-
 	file_off = handle->wofs % info->length;
 
 	if (file_off + num > info->length) {
@@ -137,10 +171,155 @@ int buffer_stream_write(io_stream_t handle, unsigned char * buf, int num)
 	handle->wofs += num;
 	wirte_len += num;
 
+	return wirte_len;
+}
+
+int buffer_stream_write(io_stream_t handle, unsigned char * buf, int num)
+{
+	int brw = 0;
+	int wirte_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0) {
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return -brw;
+	}
+
+	wirte_len = _buffer_stream_write(handle, buf, num);
+
+	os_mutex_unlock(&info->lock);
+	return wirte_len;
+}
+
+static int buffer_stream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, brw;
+	int wirte_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0) {
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return -brw;
+	}
+
+	for (i = 0; i < iovcnt; i++)
+		wirte_len += _buffer_stream_write(handle, iov[i].base, iov[i].len);
+
 	os_mutex_unlock(&info->lock);
 	return wirte_len;
 }
 
+/* contiguous data from rofs, with info->lock held */
+static int _buffer_stream_read_len(io_stream_t handle, int *file_off)
+{
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	if ((handle->mode & MODE_IN_OUT) == MODE_IN_OUT) {
+		*file_off = handle->rofs % info->length;
+		return min(info->length - *file_off, (int)(handle->wofs - handle->rofs));
+	}
+
+	*file_off = handle->rofs;
+	return info->length - *file_off;
+}
+
+/* contiguous space from wofs, with info->lock held */
+static int _buffer_stream_write_len(io_stream_t handle, int *file_off)
+{
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+	int len;
+
+	*file_off = handle->wofs % info->length;
+	len = info->length - *file_off;
+
+	/**never overwrite unread data of in_out stream */
+	if ((handle->mode & MODE_IN_OUT) == MODE_IN_OUT) {
+		len = min(len, info->length - (int)(handle->wofs - handle->rofs));
+	}
+
+	return len;
+}
+
+static int buffer_stream_read_claim(io_stream_t handle, unsigned char **buf, int num)
+{
+	int file_off = 0;
+	int claim_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	os_mutex_lock(&info->lock, K_FOREVER);
+
+	claim_len = _buffer_stream_read_len(handle, &file_off);
+	*buf = (unsigned char *)info->buffer_base + file_off;
+
+	os_mutex_unlock(&info->lock);
+	return min(num, claim_len);
+}
+
+static int buffer_stream_read_commit(io_stream_t handle, int num)
+{
+	int file_off = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	os_mutex_lock(&info->lock, K_FOREVER);
+
+	/**at most what read_claim can hand out */
+	if (num < 0 || num > _buffer_stream_read_len(handle, &file_off)) {
+		num = -EINVAL;
+	} else {
+		handle->rofs += num;
+	}
+
+	os_mutex_unlock(&info->lock);
+	return num;
+}
+
+static int buffer_stream_write_claim(io_stream_t handle, unsigned char **buf, int num)
+{
+	int file_off = 0;
+	int claim_len = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	os_mutex_lock(&info->lock, K_FOREVER);
+
+	claim_len = _buffer_stream_write_len(handle, &file_off);
+	*buf = (unsigned char *)info->buffer_base + file_off;
+
+	os_mutex_unlock(&info->lock);
+	return min(num, claim_len);
+}
+
+static int buffer_stream_write_commit(io_stream_t handle, int num)
+{
+	int file_off = 0;
+	buffer_info_t *info = (buffer_info_t *)handle->data;
+
+	assert(info);
+
+	os_mutex_lock(&info->lock, K_FOREVER);
+
+	/**at most what write_claim can hand out */
+	if (num < 0 || num > _buffer_stream_write_len(handle, &file_off)) {
+		num = -EINVAL;
+	} else {
+		handle->wofs += num;
+	}
+
+	os_mutex_unlock(&info->lock);
+	return num;
+}
+
 int buffer_stream_close(io_stream_t handle)
 {
 	int res;
@@ -207,9 +386,16 @@ const stream_ops_t buffer_stream_ops = {
     .write = buffer_stream_write,
     .close = buffer_stream_close,
 	.destroy = buffer_stream_destory,
+	.read_claim = buffer_stream_read_claim,
+	.read_commit = buffer_stream_read_commit,
+	.write_claim = buffer_stream_write_claim,
+	.write_commit = buffer_stream_write_commit,
+	.readv = buffer_stream_readv,
+	.writev = buffer_stream_writev,
 };
 
 io_stream_t buffer_stream_create(struct buffer_t *param)
 {
 	return stream_create(&buffer_stream_ops, param);
+
 }
\ No newline at end of file
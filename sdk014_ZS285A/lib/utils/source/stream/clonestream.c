@@ -113,6 +113,31 @@ static int clone_stream_write(io_stream_t handle, unsigned char *buf,int num)
 	return len;
 }
 
+static int clone_stream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	struct clone_stream_info *info = handle->data;
+	int len, left, i, j;
+
+	len = stream_writev(info->origin, iov, iovcnt);
+	if (len <= 0)
+		return len;
+
+	/* clone write data */
+	if (handle->mode & info->clone_mode) {
+		for (i = 0; i < ARRAY_SIZE(info->clones); i++) {
+			if (!info->clones[i])
+				break;
+
+			for (j = 0, left = len; j < iovcnt && left > 0; j++) {
+				info->clones[i]->ops->write(info->clones[i], iov[j].base, min(iov[j].len, left));
+				left -= iov[j].len;
+			}
+		}
+	}
+
+	return len;
+}
+
 static int clone_stream_seek(io_stream_t handle, int offset, seek_dir origin)
 {
 	/* FIXME: seek ops will make clone stream data disordered */
@@ -192,9 +217,11 @@ const stream_ops_t clone_stream_ops = {
 	.flush = clone_stream_flush,
 	.close = clone_stream_close,
 	.destroy = clone_stream_destroy,
+	.writev = clone_stream_writev,
 };
 
 io_stream_t clone_stream_create(struct clone_stream_info *info)
 {
 	return stream_create(&clone_stream_ops, info);
+
 }
\ No newline at end of file
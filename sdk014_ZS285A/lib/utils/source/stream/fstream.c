@@ -23,9 +23,46 @@ typedef struct {
 	fs_file_t fp;
 	/** mutex used for sync*/
 	os_mutex lock;
+	/** first bytes of file, read by file_stream_preload */
+	unsigned char *head;
+	int head_len;
 
 } file_stream_info_t;
 
+/* read at rofs, the preloaded head is copied instead of read */
+static int fstream_read_locked(io_stream_t handle, file_stream_info_t *info,
+				unsigned char *buf, int num)
+{
+	int len = 0;
+	int brw;
+
+	if (handle->rofs < info->head_len) {
+		len = info->head_len - handle->rofs;
+		if (len > num)
+			len = num;
+
+		memcpy(buf, info->head + handle->rofs, len);
+		handle->rofs += len;
+		if (len == num)
+			return len;
+
+		/* file is after the head unless seeked back into it */
+		brw = fs_seek(&info->fp, handle->rofs, FS_SEEK_SET);
+		if (brw)
+			return len;
+
+		buf += len;
+		num -= len;
+	}
+
+	brw = fs_read(&info->fp, buf, num);
+	if (brw < 0)
+		return len ? len : brw;
+
+	handle->rofs += brw;
+	return len + brw;
+}
+
 
 int fstream_open(io_stream_t handle, stream_mode mode)
 {
@@ -51,6 +88,12 @@ int fstream_open(io_stream_t handle, stream_mode mode)
 		handle->wofs = handle->total_size;
 	}
 
+#ifdef CONFIG_FILE_STREAM_EXTENT_RUNS
+	/* file does not grow, seek and read by the map */
+	if ((handle->mode & MODE_IN_OUT) == MODE_IN)
+		fs_extent_map(&info->fp, CONFIG_FILE_STREAM_EXTENT_RUNS);
+#endif
+
 	SYS_LOG_INF("handle %p total_size %d mode %x \n",handle, handle->total_size, mode);
 	return 0;
 }
@@ -76,14 +119,12 @@ int fstream_read(io_stream_t handle, unsigned char *buf,int num)
 		}
 	}
 
-	brw = fs_read(&info->fp, buf, num);
+	brw = fstream_read_locked(handle, info, buf, num);
 	if (brw < 0) {
 		SYS_LOG_ERR(" failed %d\n", brw);
 		goto err_out;
 	}
 
-	handle->rofs += brw;
-
 err_out:
 	os_mutex_unlock(&info->lock);
 	return brw;
@@ -147,6 +188,91 @@ err_out:
 	return brw;
 }
 
+static int fstream_readv(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, brw;
+	int read_len = 0;
+	file_stream_info_t *info = (file_stream_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0){
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return brw;
+	}
+
+	/* position once, the segments are consecutive in file */
+	if ((handle->mode & MODE_IN_OUT) == MODE_IN_OUT) {
+		brw = fs_seek(&info->fp, handle->rofs, FS_SEEK_SET);
+		if (brw) {
+			SYS_LOG_ERR("seek failed %d\n", brw);
+			goto err_out;
+		}
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		brw = fstream_read_locked(handle, info, iov[i].base, iov[i].len);
+		if (brw < 0) {
+			SYS_LOG_ERR(" failed %d\n", brw);
+			break;
+		}
+
+		read_len += brw;
+		if (brw != iov[i].len)
+			break;
+	}
+
+	brw = read_len ? read_len : brw;
+err_out:
+	os_mutex_unlock(&info->lock);
+	return brw;
+}
+
+static int fstream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, brw;
+	int write_len = 0;
+	file_stream_info_t *info = (file_stream_info_t *)handle->data;
+
+	assert(info);
+
+	brw = os_mutex_lock(&info->lock, K_FOREVER);
+	if (brw < 0) {
+		SYS_LOG_ERR("lock failed %d \n",brw);
+		return brw;
+	}
+
+	if ((handle->mode & MODE_IN_OUT) == MODE_IN_OUT) {
+		brw = fs_seek(&info->fp, handle->wofs, FS_SEEK_SET);
+		if (brw) {
+			SYS_LOG_ERR("seek failed %d\n", brw);
+			goto err_out;
+		}
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		brw = fs_write(&info->fp, iov[i].base, iov[i].len);
+		if (brw < 0) {
+			SYS_LOG_ERR("write %d \n", brw);
+			break;
+		}
+
+		handle->wofs += brw;
+		write_len += brw;
+		if (brw != iov[i].len)
+			break;
+	}
+
+	if (handle->wofs > handle->total_size)
+		handle->total_size = handle->wofs;
+
+	brw = write_len ? write_len : brw;
+err_out:
+	os_mutex_unlock(&info->lock);
+	return brw;
+}
+
 int fstream_seek(io_stream_t handle, int offset, seek_dir origin)
 {
 	int whence = FS_SEEK_SET;
@@ -194,6 +320,10 @@ int fstream_tell(io_stream_t handle)
 
 	assert(info);
 
+	/* file is not moved by reads of the head */
+	if (info->head)
+		return handle->rofs;
+
 	return fs_tell(&info->fp);
 }
 
@@ -257,6 +387,9 @@ int fstream_destroy(io_stream_t handle)
 
 	os_mutex_unlock(&info->lock);
 
+	if (info->head)
+		mem_free(info->head);
+
 	mem_free(info);
 	return res;
 }
@@ -334,6 +467,9 @@ int fstream_init(io_stream_t handle, void *param)
 		return -ENOMEM;
 	}
 
+	info->head = NULL;
+	info->head_len = 0;
+
 	if (file_name_has_cluster(file_name, &dir, &cluster, &blk_ofs)) {
 		res = fs_open_cluster(&info->fp, dir, cluster, blk_ofs);
 		if (res) {
@@ -368,9 +504,58 @@ const stream_ops_t file_stream_ops = {
 	.get_space = fstream_get_space,
 	.close = fstream_close,
 	.destroy = fstream_destroy,
+	.readv = fstream_readv,
+	.writev = fstream_writev,
 };
 
 io_stream_t file_stream_create(const char *param)
 {
 	return stream_create(&file_stream_ops, (void *)param);
 }
+
+int file_stream_preload(io_stream_t handle, int size)
+{
+	file_stream_info_t *info;
+	int res;
+
+	if (!handle || handle->ops != &file_stream_ops || handle->state != STATE_OPEN ||
+		(handle->mode & MODE_IN_OUT) != MODE_IN || size <= 0)
+		return -EINVAL;
+
+	info = (file_stream_info_t *)handle->data;
+	if (info->head)
+		return -EALREADY;
+
+	if (size > handle->total_size)
+		size = handle->total_size;
+	if (size == 0)
+		return 0;
+
+	info->head = mem_malloc(size);
+	if (!info->head)
+		return -ENOMEM;
+
+	res = os_mutex_lock(&info->lock, K_FOREVER);
+	if (res < 0) {
+		SYS_LOG_ERR("lock failed %d \n",res);
+		goto err_out;
+	}
+
+	res = fs_seek(&info->fp, 0, FS_SEEK_SET);
+	if (!res)
+		res = fs_read(&info->fp, info->head, size);
+	if (res > 0) {
+		info->head_len = res;
+		fs_seek(&info->fp, handle->rofs > res ? handle->rofs : res, FS_SEEK_SET);
+	}
+
+	os_mutex_unlock(&info->lock);
+	if (res > 0)
+		return res;
+
+	SYS_LOG_ERR("preload failed %d\n", res);
+err_out:
+	mem_free(info->head);
+	info->head = NULL;
+	return res ? res : -EIO;
+}
@@ -165,6 +165,11 @@ int loop_fstream_open(io_stream_t handle, stream_mode mode)
 		fs_seek(&info->fp, 0, FS_SEEK_SET);
 	}
 
+#ifdef CONFIG_FILE_STREAM_EXTENT_RUNS
+	/* every loop seeks back to the head */
+	fs_extent_map(&info->fp, CONFIG_FILE_STREAM_EXTENT_RUNS);
+#endif
+
 	lp.flen_remain = handle->total_size;
 	loop_fstream_clac_info(0, 0);
 
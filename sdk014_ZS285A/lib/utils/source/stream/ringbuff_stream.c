@@ -19,6 +19,8 @@
 typedef struct
 {
 	struct acts_ringbuf *buf;
+	/* single reader and single writer, access the ring buffer lock free */
+	u8_t spsc;
 } ringbuff_info_t;
 
 static int ringbuff_stream_open(io_stream_t handle,stream_mode mode)
@@ -41,7 +43,11 @@ static int ringbuff_stream_read(io_stream_t handle, unsigned char *buf, int len)
 	if (!info)
 		return -EACCES;
 
-	ret = acts_ringbuf_get(info->buf, buf, len);
+	if (info->spsc) {
+		ret = acts_ringbuf_get_n(info->buf, buf, len);
+	} else {
+		ret = acts_ringbuf_get(info->buf, buf, len);
+	}
 
 	if (ret != len) {
 		//SYS_LOG_WRN("want read %d bytes ,but only read  %d bytes \n",len,ret);
@@ -63,7 +69,10 @@ static int ringbuff_stream_write(io_stream_t handle, unsigned char *buf, int len
 
 	/**fill none when buf is NULL, allow user modify write offset only*/
 	if (!buf) {
-		ret = acts_ringbuf_fill_none(info->buf, len);
+		ret = info->spsc ? acts_ringbuf_fill_none_n(info->buf, len) :
+				acts_ringbuf_fill_none(info->buf, len);
+	} else if (info->spsc) {
+		ret = acts_ringbuf_put_n(info->buf, buf, len);
 	} else {
 		ret = acts_ringbuf_put(info->buf, buf, len);
 	}
@@ -77,6 +86,120 @@ static int ringbuff_stream_write(io_stream_t handle, unsigned char *buf, int len
 	return ret;
 }
 
+static int ringbuff_stream_readv(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+	uint32_t len = 0;
+	int i;
+
+	if (!info)
+		return -EACCES;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].len;
+
+	/* gather all segments or nothing, then release them in one go */
+	if (len > (info->spsc ? acts_ringbuf_length_n(info->buf) : acts_ringbuf_length(info->buf)))
+		return 0;
+
+	for (len = 0, i = 0; i < iovcnt; i++)
+		len += acts_ringbuf_peek_ofs(info->buf, len, iov[i].base, iov[i].len);
+
+	if (info->spsc) {
+		acts_ringbuf_drop_n(info->buf, len);
+	} else {
+		acts_ringbuf_drop(info->buf, len);
+	}
+
+	handle->rofs = info->buf->head;
+	handle->wofs = info->buf->tail;
+
+	return len;
+}
+
+static int ringbuff_stream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+	uint32_t len = 0;
+	int i;
+
+	if (!info)
+		return -EACCES;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].len;
+
+	if (len > (info->spsc ? acts_ringbuf_space_n(info->buf) : acts_ringbuf_space(info->buf)))
+		return 0;
+
+	/* scatter all segments behind tail, then publish them by one tail update */
+	for (len = 0, i = 0; i < iovcnt; i++)
+		len += acts_ringbuf_put_ofs(info->buf, len, iov[i].base, iov[i].len);
+
+	if (info->spsc) {
+		acts_ringbuf_fill_none_n(info->buf, len);
+	} else {
+		acts_ringbuf_fill_none(info->buf, len);
+	}
+
+	handle->rofs = info->buf->head;
+	handle->wofs = info->buf->tail;
+
+	return len;
+}
+
+static int ringbuff_stream_read_claim(io_stream_t handle, unsigned char **buf, int len)
+{
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+
+	if (!info)
+		return -EACCES;
+
+	return acts_ringbuf_get_claim(info->buf, (void **)buf, len);
+}
+
+static int ringbuff_stream_read_commit(io_stream_t handle, int len)
+{
+	int ret = 0;
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+
+	if (!info)
+		return -EACCES;
+
+	ret = acts_ringbuf_get_finish(info->buf, len);
+
+	handle->rofs = info->buf->head;
+	handle->wofs = info->buf->tail;
+
+	return ret ? ret : len;
+}
+
+static int ringbuff_stream_write_claim(io_stream_t handle, unsigned char **buf, int len)
+{
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+
+	if (!info)
+		return -EACCES;
+
+	return acts_ringbuf_put_claim(info->buf, (void **)buf, len);
+}
+
+static int ringbuff_stream_write_commit(io_stream_t handle, int len)
+{
+	int ret = 0;
+	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
+
+	if (!info)
+		return -EACCES;
+
+	ret = acts_ringbuf_put_finish(info->buf, len);
+
+	handle->rofs = info->buf->head;
+	handle->wofs = info->buf->tail;
+
+	return ret ? ret : len;
+}
+
 static int ringbuff_stream_get_length(io_stream_t handle)
 {
 	ringbuff_info_t *info = (ringbuff_info_t *)handle->data;
@@ -84,6 +207,9 @@ static int ringbuff_stream_get_length(io_stream_t handle)
 	if (!info)
 		return -EACCES;
 
+	if (info->spsc)
+		return acts_ringbuf_length_n(info->buf);
+
 	return acts_ringbuf_length(info->buf);
 }
 
@@ -94,6 +220,9 @@ static int ringbuff_stream_get_space(io_stream_t handle)
 	if (!info)
 		return -EACCES;
 
+	if (info->spsc)
+		return acts_ringbuf_space_n(info->buf);
+
 	return acts_ringbuf_space(info->buf);
 }
 
@@ -110,6 +239,11 @@ static int ringbuff_stream_flush(io_stream_t handle)
 	if (!info)
 		return -EACCES;
 
+	if (info->spsc) {
+		len = acts_ringbuf_length_n(info->buf);
+		return acts_ringbuf_drop_n(info->buf, len);
+	}
+
 	len = acts_ringbuf_length(info->buf);
 
 	return acts_ringbuf_drop(info->buf, len);
@@ -183,6 +317,12 @@ const stream_ops_t ringbuff_stream_ops = {
 	.close = ringbuff_stream_close,
 	.destroy = ringbuff_stream_destroy,
 	.get_ringbuffer = ringbuff_stream_get_ringbuf,
+	.read_claim = ringbuff_stream_read_claim,
+	.read_commit = ringbuff_stream_read_commit,
+	.write_claim = ringbuff_stream_write_claim,
+	.write_commit = ringbuff_stream_write_commit,
+	.readv = ringbuff_stream_readv,
+	.writev = ringbuff_stream_writev,
 };
 
 io_stream_t ringbuff_stream_create(struct acts_ringbuf *param)
@@ -190,6 +330,42 @@ io_stream_t ringbuff_stream_create(struct acts_ringbuf *param)
 	return stream_create(&ringbuff_stream_ops, param);
 }
 
+static int ringbuff_stream_init_spsc(io_stream_t handle, void *param)
+{
+	int ret = ringbuff_stream_init(handle, param);
+
+	if (!ret)
+		((ringbuff_info_t *)handle->data)->spsc = 1;
+
+	return ret;
+}
+
+const stream_ops_t ringbuff_stream_ops_spsc = {
+	.init = ringbuff_stream_init_spsc,
+	.open = ringbuff_stream_open,
+	.read = ringbuff_stream_read,
+	.seek = NULL,
+	.tell = ringbuff_stream_tell,
+	.flush = ringbuff_stream_flush,
+	.get_length = ringbuff_stream_get_length,
+	.get_space = ringbuff_stream_get_space,
+	.write = ringbuff_stream_write,
+	.close = ringbuff_stream_close,
+	.destroy = ringbuff_stream_destroy,
+	.get_ringbuffer = ringbuff_stream_get_ringbuf,
+	.read_claim = ringbuff_stream_read_claim,
+	.read_commit = ringbuff_stream_read_commit,
+	.write_claim = ringbuff_stream_write_claim,
+	.write_commit = ringbuff_stream_write_commit,
+	.readv = ringbuff_stream_readv,
+	.writev = ringbuff_stream_writev,
+};
+
+io_stream_t ringbuff_stream_create_spsc(struct acts_ringbuf *param)
+{
+	return stream_create(&ringbuff_stream_ops_spsc, param);
+}
+
 /**ringbff stream init param */
 struct ringbuff_stream_init_param_t
 {
@@ -239,6 +415,12 @@ const stream_ops_t ringbuff_stream_ops_ext = {
 	.close = ringbuff_stream_close,
 	.destroy = ringbuff_stream_destroy_ext,
 	.get_ringbuffer = ringbuff_stream_get_ringbuf,
+	.read_claim = ringbuff_stream_read_claim,
+	.read_commit = ringbuff_stream_read_commit,
+	.write_claim = ringbuff_stream_write_claim,
+	.write_commit = ringbuff_stream_write_commit,
+	.readv = ringbuff_stream_readv,
+	.writev = ringbuff_stream_writev,
 };
 
 io_stream_t ringbuff_stream_create_ext(void *ring_buff, u32_t ring_buff_size)
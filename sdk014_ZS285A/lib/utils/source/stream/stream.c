@@ -34,6 +34,182 @@ static bool _stream_check_handle_state(io_stream_t handle, uint8_t need_state)
 	return true;
 }
 
+/** bounce cache of claims for stream without native claim ops */
+typedef struct {
+	/** read bounce buffer */
+	unsigned char *rbuf;
+	/** size of read bounce buffer */
+	int rsize;
+	/** bytes already committed in read bounce buffer */
+	int rofs;
+	/** bytes valid in read bounce buffer */
+	int rlen;
+	/** write bounce buffer */
+	unsigned char *wbuf;
+	/** size of write bounce buffer */
+	int wsize;
+} stream_claim_cache_t;
+
+static int _stream_write_attached(io_stream_t handle, u8_t attach_mode, unsigned char *buf, int num)
+{
+	int i;
+	int brw = num;
+
+	if (!_is_in_isr()) {
+		os_mutex_lock(&handle->attach_lock, OS_FOREVER);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(handle->attach_stream); i++) {
+		if (handle->attach_mode[i] != attach_mode)
+			continue;
+
+		if (!handle->attach_stream[i])
+			continue;
+
+		brw = handle->attach_stream[i]->ops->write(handle->attach_stream[i], buf, num);
+		if (brw != num) {
+			break;
+		}
+	}
+
+	if (!_is_in_isr()) {
+		os_mutex_unlock(&handle->attach_lock);
+	}
+
+	return brw;
+}
+
+static void _stream_notify_observers(io_stream_t handle, stream_notify_type type, unsigned char *buf, int num)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(handle->observer_notify); i++) {
+		if (handle->observer_notify[i] && (handle->observer_type[i] & type)) {
+			handle->observer_notify[i](handle->observer[i], handle->rofs,
+				handle->wofs, handle->total_size, buf, num, type);
+		}
+	}
+}
+
+static int _stream_wait_data(io_stream_t handle, int num)
+{
+	int try_cnt = 0;
+
+	while (stream_get_length(handle) < num) {
+		if((handle->mode & MODE_BLOCK_TIMEOUT)){
+			if (try_cnt ++ > 20) {
+				SYS_LOG_INF("time out 1s");
+				handle->write_finished = 1;
+				return -ETIMEDOUT;
+			}
+		}
+		os_sem_take(handle->sync_sem, OS_MSEC(50));
+		if(!_stream_check_handle_state(handle,STATE_OPEN)) {
+			return -ENOSYS;
+		}
+		if (handle->write_finished) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static int _stream_wait_space(io_stream_t handle, int num)
+{
+	int try_cnt = 0;
+
+	while (stream_get_space(handle) < num) {
+		if ((handle->mode & MODE_BLOCK_TIMEOUT)) {
+			if (try_cnt ++ > 20) {
+				SYS_LOG_INF("time out 1s");
+				handle->write_finished = 1;
+				return -ETIMEDOUT;
+			}
+		}
+		os_sem_take(handle->sync_sem, OS_MSEC(50));
+		if(!_stream_check_handle_state(handle,STATE_OPEN)) {
+			return -ENOSYS;
+		}
+	}
+
+	return 0;
+}
+
+static int _stream_iov_length(const struct stream_iovec *iov, int iovcnt)
+{
+	int i;
+	int len = 0;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].len;
+
+	return len;
+}
+
+/* forward the first num bytes of segments to attached streams and observers */
+static int _stream_iov_done(io_stream_t handle, const struct stream_iovec *iov, int iovcnt,
+				int num, u8_t attach_mode, stream_notify_type type)
+{
+	int i, len, brw;
+
+	for (i = 0; i < iovcnt && num > 0; i++) {
+		len = min(iov[i].len, num);
+
+		brw = _stream_write_attached(handle, attach_mode, iov[i].base, len);
+		if (brw != len) {
+			return brw;
+		}
+
+		_stream_notify_observers(handle, type, iov[i].base, len);
+		num -= len;
+	}
+
+	return 0;
+}
+
+static stream_claim_cache_t *_stream_get_claim_cache(io_stream_t handle)
+{
+	if (!handle->claim_cache) {
+		handle->claim_cache = mem_malloc(sizeof(stream_claim_cache_t));
+	}
+
+	return handle->claim_cache;
+}
+
+static unsigned char *_stream_claim_cache_reserve(unsigned char **buf, int *size, int num)
+{
+	if (*size >= num) {
+		return *buf;
+	}
+
+	if (*buf) {
+		mem_free(*buf);
+	}
+
+	*buf = mem_malloc(num);
+	*size = *buf ? num : 0;
+	return *buf;
+}
+
+static void _stream_free_claim_cache(io_stream_t handle)
+{
+	stream_claim_cache_t *cache = handle->claim_cache;
+
+	if (!cache) {
+		return;
+	}
+
+	if (cache->rbuf)
+		mem_free(cache->rbuf);
+
+	if (cache->wbuf)
+		mem_free(cache->wbuf);
+
+	mem_free(cache);
+	handle->claim_cache = NULL;
+}
+
 io_stream_t stream_create(const stream_ops_t  *ops, void *init_param)
 {
 	int ret = 0;
@@ -105,9 +281,8 @@ int stream_open(io_stream_t handle, stream_mode mode)
 
 int stream_read(io_stream_t handle, unsigned char *buf,int num)
 {
-	int i;
+	int ret;
 	int brw;
-	int try_cnt = 0;
 
 	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
 		return -ENOSYS;
@@ -118,21 +293,9 @@ int stream_read(io_stream_t handle, unsigned char *buf,int num)
 	}
 
 	if ((handle->mode & MODE_READ_BLOCK)) {
-		while (stream_get_length(handle) < num) {
-			if((handle->mode & MODE_BLOCK_TIMEOUT)){
-				if (try_cnt ++ > 20) {
-					SYS_LOG_INF("time out 1s");
-					handle->write_finished = 1;
-					return 0;
-				}
-			}
-			os_sem_take(handle->sync_sem, OS_MSEC(50));
-			if(!_stream_check_handle_state(handle,STATE_OPEN)) {
-				return -ENOSYS;
-			}
-			if (handle->write_finished) {
-				break;
-			}
+		ret = _stream_wait_data(handle, num);
+		if (ret) {
+			return (ret == -ETIMEDOUT) ? 0 : ret;
 		}
 	}
 
@@ -147,44 +310,19 @@ int stream_read(io_stream_t handle, unsigned char *buf,int num)
 		os_sem_give(handle->sync_sem);
 	}
 
-	if (!_is_in_isr()) {
-		os_mutex_lock(&handle->attach_lock, OS_FOREVER);
-	}
-
 	/**data read to attached stream */
-	for (i = 0; i < ARRAY_SIZE(handle->attach_stream); i++) {
-		if (handle->attach_mode[i] != MODE_IN)
-			continue;
-
-		if (!handle->attach_stream[i])
-			continue;
-
-		brw = handle->attach_stream[i]->ops->write(handle->attach_stream[i], buf, num);
-		if (brw != num) {
-			if (!_is_in_isr()) {
-				os_mutex_unlock(&handle->attach_lock);
-			}
-			return brw;
-		}
-	}
-
-	if (!_is_in_isr()) {
-		os_mutex_unlock(&handle->attach_lock);
+	ret = _stream_write_attached(handle, MODE_IN, buf, num);
+	if (ret != num) {
+		return ret;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(handle->observer_notify); i++) {
-		if (handle->observer_notify[i] && (handle->observer_type[i] & STREAM_NOTIFY_READ)) {
-			handle->observer_notify[i](handle->observer[i], handle->rofs,
-				handle->wofs, handle->total_size, buf, brw, STREAM_NOTIFY_READ);
-		}
-	}
+	_stream_notify_observers(handle, STREAM_NOTIFY_READ, buf, brw);
 
 	return brw;
 }
 
 int stream_seek(io_stream_t handle, int offset,seek_dir origin)
 {
-	int i;
 	int brw = 0;
 	int target_off = offset;
 
@@ -230,12 +368,7 @@ int stream_seek(io_stream_t handle, int offset,seek_dir origin)
 		return brw;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(handle->observer_notify); i++) {
-		if (handle->observer_notify[i] && (handle->observer_type[i] & STREAM_NOTIFY_SEEK)) {
-			handle->observer_notify[i](handle->observer[i], handle->rofs,
-				handle->wofs, handle->total_size, NULL, 0, STREAM_NOTIFY_SEEK);
-		}
-	}
+	_stream_notify_observers(handle, STREAM_NOTIFY_SEEK, NULL, 0);
 
 	return brw;
 }
@@ -264,8 +397,6 @@ int stream_tell(io_stream_t handle)
 int stream_write(io_stream_t handle, unsigned char *buf, int num)
 {
 	int brw;
-	int i;
-	int try_cnt = 0;
 
 	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
 		return -ENOSYS;
@@ -276,27 +407,13 @@ int stream_write(io_stream_t handle, unsigned char *buf, int num)
 	}
 
 	if ((handle->mode & MODE_WRITE_BLOCK)) {
-		while (stream_get_space(handle) < num) {
-			if ((handle->mode & MODE_BLOCK_TIMEOUT)) {
-				if (try_cnt ++ > 20) {
-					SYS_LOG_INF("time out 1s");
-					handle->write_finished = 1;
-					return 0;
-				}
-			}
-			os_sem_take(handle->sync_sem, OS_MSEC(50));
-			if(!_stream_check_handle_state(handle,STATE_OPEN)) {
-				return -ENOSYS;
-			}
+		brw = _stream_wait_space(handle, num);
+		if (brw) {
+			return (brw == -ETIMEDOUT) ? 0 : brw;
 		}
 	}
 
-	for (i = 0; i < ARRAY_SIZE(handle->observer_notify); i++) {
-		if (handle->observer_notify[i] && (handle->observer_type[i] & STREAM_NOTIFY_PRE_WRITE)) {
-			handle->observer_notify[i](handle->observer[i], handle->rofs,
-				handle->wofs, handle->total_size, buf, num, STREAM_NOTIFY_PRE_WRITE);
-		}
-	}
+	_stream_notify_observers(handle, STREAM_NOTIFY_PRE_WRITE, buf, num);
 
 	brw = handle->ops->write(handle, buf, num);
 	if (brw != num) {
@@ -311,41 +428,324 @@ int stream_write(io_stream_t handle, unsigned char *buf, int num)
 	if (handle->sync_sem)
 		os_sem_give(handle->sync_sem);
 
+	/**data write to attached stream */
+	brw = _stream_write_attached(handle, MODE_OUT, buf, num);
+	if (brw != num) {
+		//SYS_LOG_ERR("Failed writing to stream [%d]\n", brw);
+		return brw;
+	}
 
-	if (!_is_in_isr()) {
-		os_mutex_lock(&handle->attach_lock, OS_FOREVER);
+	_stream_notify_observers(handle, STREAM_NOTIFY_WRITE, buf, num);
+	return brw;
+}
+
+int stream_readv(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, ret;
+	int brw = 0;
+	int num = _stream_iov_length(iov, iovcnt);
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
 	}
 
-	/**data write to attached stream */
-	for (i = 0; i < ARRAY_SIZE(handle->attach_stream); i++) {
-		if (handle->attach_mode[i] != MODE_OUT)
-			continue;
+	if (!(handle->mode & MODE_IN)) {
+		return -EPERM;
+	}
 
-		if (!handle->attach_stream[i])
-			continue;
+	if ((handle->mode & MODE_READ_BLOCK)) {
+		ret = _stream_wait_data(handle, num);
+		if (ret) {
+			return (ret == -ETIMEDOUT) ? 0 : ret;
+		}
+	}
 
-		brw = handle->attach_stream[i]->ops->write(handle->attach_stream[i], buf, num);
-		if (brw != num) {
-			//SYS_LOG_ERR("Failed writing to stream [%d]\n", brw);
-			if (!_is_in_isr()) {
-				os_mutex_unlock(&handle->attach_lock);
+	if (handle->ops->readv) {
+		brw = handle->ops->readv(handle, iov, iovcnt);
+	} else {
+		for (i = 0; i < iovcnt; i++) {
+			ret = handle->ops->read(handle, iov[i].base, iov[i].len);
+			if (ret < 0) {
+				brw = ret;
+				break;
 			}
-			return brw;
+
+			brw += ret;
+			if (ret != iov[i].len)
+				break;
 		}
 	}
 
-	if (!_is_in_isr()) {
-		os_mutex_unlock(&handle->attach_lock);
+	if (brw < 0) {
+		SYS_LOG_DBG("readv failed [%d]\n", brw);
+		return 0;
 	}
-	for (i = 0; i < ARRAY_SIZE(handle->observer_notify); i++) {
-		if (handle->observer_notify[i] && (handle->observer_type[i] & STREAM_NOTIFY_WRITE)) {
-			handle->observer_notify[i](handle->observer[i], handle->rofs,
-				handle->wofs, handle->total_size, buf, num, STREAM_NOTIFY_WRITE);
+
+	if (handle->sync_sem) {
+		os_sem_give(handle->sync_sem);
+	}
+
+	ret = _stream_iov_done(handle, iov, iovcnt, brw, MODE_IN, STREAM_NOTIFY_READ);
+	if (ret) {
+		return ret;
+	}
+
+	return brw;
+}
+
+int stream_writev(io_stream_t handle, const struct stream_iovec *iov, int iovcnt)
+{
+	int i, ret;
+	int brw = 0;
+	int num = _stream_iov_length(iov, iovcnt);
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
+	}
+
+	if (!(handle->mode & MODE_OUT)) {
+		return -EPERM;
+	}
+
+	if ((handle->mode & MODE_WRITE_BLOCK)) {
+		ret = _stream_wait_space(handle, num);
+		if (ret) {
+			return (ret == -ETIMEDOUT) ? 0 : ret;
+		}
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		_stream_notify_observers(handle, STREAM_NOTIFY_PRE_WRITE, iov[i].base, iov[i].len);
+	}
+
+	if (handle->ops->writev) {
+		brw = handle->ops->writev(handle, iov, iovcnt);
+	} else {
+		for (i = 0; i < iovcnt; i++) {
+			ret = handle->ops->write(handle, iov[i].base, iov[i].len);
+			if (ret < 0) {
+				brw = ret;
+				break;
+			}
+
+			brw += ret;
+			if (ret != iov[i].len)
+				break;
 		}
 	}
+
+	if (brw != num) {
+		return brw;
+	}
+
+	if (!num) {
+		handle->write_finished = 1;
+	}
+
+	if (handle->sync_sem)
+		os_sem_give(handle->sync_sem);
+
+	ret = _stream_iov_done(handle, iov, iovcnt, num, MODE_OUT, STREAM_NOTIFY_WRITE);
+	if (ret) {
+		return ret;
+	}
+
 	return brw;
 }
 
+int stream_read_claim(io_stream_t handle, unsigned char **buf, int num)
+{
+	int brw;
+	stream_claim_cache_t *cache;
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
+	}
+
+	if (!(handle->mode & MODE_IN)) {
+		return -EPERM;
+	}
+
+	if (handle->ops->read_claim) {
+		brw = handle->ops->read_claim(handle, buf, num);
+		handle->read_claim_ptr = (brw > 0) ? *buf : NULL;
+		return brw;
+	}
+
+	cache = _stream_get_claim_cache(handle);
+	if (!cache) {
+		return -ENOMEM;
+	}
+
+	/**return the left data of last claim first */
+	if (cache->rlen > cache->rofs) {
+		brw = min(num, cache->rlen - cache->rofs);
+		*buf = cache->rbuf + cache->rofs;
+		return brw;
+	}
+
+	brw = stream_get_length(handle);
+	if (brw >= 0 && brw < num) {
+		num = brw;
+	}
+
+	if (num <= 0) {
+		return 0;
+	}
+
+	if (!_stream_claim_cache_reserve(&cache->rbuf, &cache->rsize, num)) {
+		return -ENOMEM;
+	}
+
+	brw = stream_read(handle, cache->rbuf, num);
+	if (brw < 0) {
+		return brw;
+	}
+
+	cache->rofs = 0;
+	cache->rlen = brw;
+	*buf = cache->rbuf;
+	return brw;
+}
+
+int stream_read_commit(io_stream_t handle, int num)
+{
+	int ret;
+	stream_claim_cache_t *cache;
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
+	}
+
+	if (!handle->ops->read_claim) {
+		/**data already read by emulated claim, only drop it from bounce cache */
+		cache = handle->claim_cache;
+		if (!cache || num < 0 || num > cache->rlen - cache->rofs) {
+			return -EINVAL;
+		}
+
+		cache->rofs += num;
+		return num;
+	}
+
+	if (num <= 0) {
+		return 0;
+	}
+
+	if (!handle->read_claim_ptr) {
+		return -EINVAL;
+	}
+
+	ret = handle->ops->read_commit(handle, num);
+	if (ret < 0) {
+		SYS_LOG_DBG("read commit failed [%d]\n", ret);
+		return ret;
+	}
+
+	if (handle->sync_sem) {
+		os_sem_give(handle->sync_sem);
+	}
+
+	/**data read to attached stream */
+	ret = _stream_write_attached(handle, MODE_IN, handle->read_claim_ptr, num);
+	if (ret != num) {
+		return ret;
+	}
+
+	_stream_notify_observers(handle, STREAM_NOTIFY_READ, handle->read_claim_ptr, num);
+	handle->read_claim_ptr = NULL;
+
+	return num;
+}
+
+int stream_write_claim(io_stream_t handle, unsigned char **buf, int num)
+{
+	int brw;
+	stream_claim_cache_t *cache;
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
+	}
+
+	if (!(handle->mode & MODE_OUT)) {
+		return -EPERM;
+	}
+
+	if (handle->ops->write_claim) {
+		brw = handle->ops->write_claim(handle, buf, num);
+		handle->write_claim_ptr = (brw > 0) ? *buf : NULL;
+		return brw;
+	}
+
+	cache = _stream_get_claim_cache(handle);
+	if (!cache) {
+		return -ENOMEM;
+	}
+
+	brw = stream_get_space(handle);
+	if (brw >= 0 && brw < num) {
+		num = brw;
+	}
+
+	if (num <= 0) {
+		return 0;
+	}
+
+	if (!_stream_claim_cache_reserve(&cache->wbuf, &cache->wsize, num)) {
+		return -ENOMEM;
+	}
+
+	*buf = cache->wbuf;
+	handle->write_claim_ptr = cache->wbuf;
+	return num;
+}
+
+int stream_write_commit(io_stream_t handle, int num)
+{
+	int brw;
+
+	if (!_stream_check_handle_state(handle,STATE_OPEN)) {
+		return -ENOSYS;
+	}
+
+	if (num <= 0) {
+		return 0;
+	}
+
+	if (!handle->write_claim_ptr) {
+		return -EINVAL;
+	}
+
+	if (!handle->ops->write_claim) {
+		/**emulated claim, write out the bounce cache */
+		brw = stream_write(handle, handle->write_claim_ptr, num);
+		handle->write_claim_ptr = NULL;
+		return brw;
+	}
+
+	/**observer may process data in place before it is visible to reader */
+	_stream_notify_observers(handle, STREAM_NOTIFY_PRE_WRITE, handle->write_claim_ptr, num);
+
+	brw = handle->ops->write_commit(handle, num);
+	if (brw < 0) {
+		SYS_LOG_DBG("write commit failed [%d]\n", brw);
+		return brw;
+	}
+
+	if (handle->sync_sem)
+		os_sem_give(handle->sync_sem);
+
+	/**data write to attached stream */
+	brw = _stream_write_attached(handle, MODE_OUT, handle->write_claim_ptr, num);
+	if (brw != num) {
+		return brw;
+	}
+
+	_stream_notify_observers(handle, STREAM_NOTIFY_WRITE, handle->write_claim_ptr, num);
+	handle->write_claim_ptr = NULL;
+	return num;
+}
+
 int stream_flush(io_stream_t handle)
 {
 	int brw;
@@ -413,6 +813,8 @@ int stream_destroy(io_stream_t handle)
 	if (handle->sync_sem)
 		mem_free(handle->sync_sem);
 
+	_stream_free_claim_cache(handle);
+
 	mem_free(handle);
 	return res;
 }
@@ -27,6 +27,9 @@
 #include <string.h>
 
 #include <os_common_api.h>
+#ifdef CONFIG_TRACE_BINARY_LOG
+#include <linker/linker-defs.h>
+#endif
 
 #if defined(CONFIG_USB_UART_CONSOLE)
 #include <drivers/console/uart_usb.h>
@@ -523,6 +526,23 @@ int trace_dma_print_set(unsigned int dma_enable)
 	return old_dma_enable;
 }
 
+int trace_binary_log_set(unsigned int binary_enable)
+{
+#ifdef CONFIG_TRACE_BINARY_LOG
+	int old_binary_enable;
+
+	trace_ctx_t *trace_ctx = get_trace_ctx();
+
+	old_binary_enable = trace_ctx->binary_log;
+
+	trace_ctx->binary_log = (binary_enable != false);
+
+	return old_binary_enable;
+#else
+	return 0;
+#endif
+}
+
 void trace_sync(void)
 {
     int lock;
@@ -659,6 +679,40 @@ int vprintk(const char *fmt, va_list args)
         }
     }
 
+#ifdef CONFIG_TRACE_BINARY_LOG
+    /*
+     * cpu mode is used by sync and panic output, keep it readable. The
+     * decoder reads the format from the elf, a format built in ram
+     * (e.g. printk(buf)) is printed as text.
+     */
+    if (trace_ctx->binary_log && trace_ctx->trace_mode == TRACE_MODE_DMA
+        && fmt >= _image_rom_start && fmt < _image_rom_end) {
+        uint32_t flags;
+        va_list ap;
+
+        /* sequence follows the order in cbuf, space checked with the write */
+        flags = irq_lock();
+
+        va_copy(ap, args);
+        ret = trace_log_encode((uint8_t *)trans_buffer, sizeof(trans_buffer), fmt, ap);
+        va_end(ap);
+
+        if (ret > 0) {
+            /* a cut record can not be decoded, drop it whole */
+            if (ret <= cbuf_get_free_space(&trace_ctx->cbuf)) {
+                trace_output(trans_buffer, ret, trace_ctx);
+            } else {
+                trace_ctx->drop_bytes += ret;
+            }
+        }
+
+        irq_unlock(flags);
+
+        if (ret > 0)
+            return ret;
+    }
+#endif
+
 #ifdef CONFIG_TRACE_PERF_ENABLE
     uint32_t run_time = _timer_cycle_get_32();
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file trace binary log
+ *
+ * printk is recorded as format address, timestamp and raw arguments, the
+ * text is rendered on host by scripts/support/actions/trace_decode.py with
+ * the elf file. Arguments are taken the same way as trace_vsnprintf.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <kernel.h>
+#include <linker/sections.h>
+#include <cbuf.h>
+#include <trace_impl.h>
+
+#if defined(CONFIG_SOC_SERIES_WOODPECKER) || defined(CONFIG_SOC_SERIES_WOODPECKERFPGA)
+#define __TRACE_RAMFUNC
+#else
+#define __TRACE_RAMFUNC __ramfunc
+#endif
+
+static uint8_t trace_log_seq;
+
+static inline void _put_le32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+	p[2] = (uint8_t)(val >> 16);
+	p[3] = (uint8_t)(val >> 24);
+}
+
+__TRACE_RAMFUNC int trace_log_encode(uint8_t *buf, int size, const char *fmt, va_list ap)
+{
+	uint8_t *str = buf + TRACE_LOG_HEADER_SIZE;
+	uint8_t *end = buf + min(size, TRACE_LOG_MAX_SIZE);
+	const char *fmt_start = fmt;
+	int might_format = 0;
+	int long_ctr = 0;
+	uint32_t arg;
+	uint8_t checksum;
+	int i, len;
+
+	if (str > end)
+		return -1;
+
+	while (*fmt) {
+		if (!might_format) {
+			if (*fmt == '%') {
+				might_format = 1;
+				long_ctr = 0;
+			}
+			fmt++;
+			continue;
+		}
+
+		switch (*fmt) {
+		case '-':
+		case '0' ... '9':
+		case 'z':
+		case 'h':
+			break;
+		case 'l':
+			long_ctr++;
+			break;
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'p':
+		case 'x':
+		case 'X':
+		case 'c':
+			if (long_ctr == 0)
+				arg = va_arg(ap, unsigned int);
+			else if (long_ctr == 1)
+				arg = va_arg(ap, unsigned long);
+			else
+				arg = (uint32_t)va_arg(ap, unsigned long long);
+
+			if (str + 4 > end)
+				return -1;
+			_put_le32(str, arg);
+			str += 4;
+			might_format = 0;
+			break;
+		case 's': {
+			const char *s = va_arg(ap, const char *);
+
+			/* string may not live in the elf, copy it */
+			len = strlen(s);
+			if (len > end - str - 1)
+				len = end - str - 1;
+			if (len < 0)
+				return -1;
+			*str++ = (uint8_t)len;
+			memcpy(str, s, len);
+			str += len;
+			might_format = 0;
+			break;
+		}
+		default:
+			might_format = 0;
+			break;
+		}
+		fmt++;
+	}
+
+	len = str - buf;
+
+	buf[0] = TRACE_LOG_SYNC;
+	buf[1] = (uint8_t)len;
+	buf[2] = trace_log_seq++;
+	buf[3] = 0;
+	_put_le32(&buf[4], k_cycle_get_32());
+	_put_le32(&buf[8], (uint32_t)(uintptr_t)fmt_start);
+
+	checksum = 0;
+	for (i = 0; i < len; i++)
+		checksum += buf[i];
+	buf[3] = checksum;
+
+	return len;
+}
@@ -79,6 +79,7 @@ typedef enum
 {
     MEM_TRACE_MALLOC        = 0x601,
     MEM_TRACE_FREE          = 0x602,
+    MEM_TRACE_BUDDY         = 0x603,
 }trace_malloc_type_e;
 
 typedef struct
@@ -624,6 +625,24 @@ void _trace_free(uint32_t address, uint32_t caller)
     _trace_binary_write(current, buf, 8 + str_len, MEM_TRACE_FREE);        
 }
 
+void _trace_buddy(uint32_t info, uint32_t address, uint32_t size, uint32_t caller, uint32_t thread)
+{
+    uint32_t  buf[TRACE_PACKET_LENGTH / 4];
+    struct k_thread *current = k_current_get();
+
+    if(!_trace_is_active(current, MEM_TRACE_BUDDY)){
+        return;
+    }
+
+    buf[TRACE_PAYLOAD_START] = address;
+    buf[TRACE_PAYLOAD_START + 1] = size;
+    buf[TRACE_PAYLOAD_START + 2] = caller;
+    buf[TRACE_PAYLOAD_START + 3] = thread;
+    buf[TRACE_PAYLOAD_START + 4] = info;
+
+    _trace_binary_write(current, buf, 20, MEM_TRACE_BUDDY);
+}
+
 #endif
 
 
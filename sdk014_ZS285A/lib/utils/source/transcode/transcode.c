@@ -13,136 +13,246 @@
 #include <version.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <misc/util.h>
 
 #ifdef CONFIG_FILE_SYSTEM
 #include <fs.h>
 extern WCHAR ff_convert (WCHAR chr, UINT dir);
 #endif
+#include <transcode.h>
 
-int gbk_to_utf8(unsigned char *lpGBKStr, unsigned char *lpUTF8Str, int len)
+#define INT_MAX_LEN	0x7fffffff
+
+static inline uint16_t oem_to_unicode(uint16_t w)
 {
-	uint16_t w ;
-	uint16_t wchar ;
-	len = 0;
-	while (*lpGBKStr)
-	{
-		w = *lpGBKStr++;
-		w &= 0xFF;
-		if (((BYTE)(w) >= 0x81 && (BYTE)(w) <= 0xFE)) {
-			w = (w << 8) + *lpGBKStr++;
-		}
+#ifdef CONFIG_FILE_SYSTEM
+	return ff_convert(w, 1);/* Convert ANSI/OEM to Unicode */
+#else
+	return w;
+#endif
+}
 
+static inline uint16_t unicode_to_oem(uint16_t w)
+{
 #ifdef CONFIG_FILE_SYSTEM
-		wchar = ff_convert(w, 1);/* Convert ANSI/OEM to Unicode */
+	return ff_convert(w, 0);/* Convert Unicode to ANSI/OEM */
+#else
+	return 0;
 #endif
-	    if (wchar <= 0x7F )
-	    {
-	        lpUTF8Str[len] = (char)wchar;
-	        len++;
-	    }
-	    else if (wchar >=0x80 && wchar <= 0x7FF)
-	    {
-	        lpUTF8Str[len] = 0xc0 |((wchar >> 6)&0x1f);
-	        len++;
-	        lpUTF8Str[len] = 0x80 | (wchar & 0x3f);
-	        len++;
-	    }
-	    else if (wchar >=0x800 && wchar < 0xFFFF)
-	    {
-	        lpUTF8Str[len] = 0xe0 | ((wchar >> 12)&0x0f);
-	        len++;
-	        lpUTF8Str[len] = 0x80 | ((wchar >> 6) & 0x3f);
-	        len++;
-	        lpUTF8Str[len] = 0x80 | (wchar & 0x3f);
-	        len++;
-	    }
-	    else
-	    {
-	        return -1;
-	    }
+}
+
+/*
+ * Copy the leading run of 0x01 ~ 0x7F bytes, a word at a time.
+ * A word is plain ascii when no byte has bit 7 set, before or after
+ * subtracting 1 from every byte (0 borrows into bit 7).
+ */
+static int ascii_copy(unsigned char *dst, const unsigned char *src, int len)
+{
+	const unsigned char *p = src;
+	uint32_t w;
+
+	while (len >= 4) {
+		memcpy(&w, p, 4);
+		if ((w | (w - 0x01010101)) & 0x80808080)
+			break;
+		memcpy(dst, &w, 4);
+		dst += 4;
+		p += 4;
+		len -= 4;
+	}
 
+	while (len > 0 && *p && *p < 0x80) {
+		*dst++ = *p++;
+		len--;
 	}
-    lpUTF8Str[len]= 0;
-    return len;
+
+	return p - src;
 }
 
-int utf8_to_gbk(unsigned char *lpUTF8Str,unsigned char *lpGBKStr, int len)
+/* the terminator is not known, aligned words do not cross a page */
+static int ascii_widen(unsigned short *dst, const unsigned char *src)
 {
-	int outputSize = 0;
-	char * lpUTF8Str_start = lpUTF8Str;
-	char high, middle, low;
-	unsigned short unicode, gbkcode;
+	const unsigned char *p = src;
+	uint32_t w;
+
+	while (((uintptr_t)p & 3) && *p && *p < 0x80)
+		*dst++ = *p++;
+
+	for (;;) {
+		w = *(const uint32_t *)p;
+		if ((w | (w - 0x01010101)) & 0x80808080)
+			break;
+		dst[0] = p[0];
+		dst[1] = p[1];
+		dst[2] = p[2];
+		dst[3] = p[3];
+		dst += 4;
+		p += 4;
+	}
 
-	while (*lpUTF8Str && (lpUTF8Str <= (unsigned char *)(lpUTF8Str_start + len)))
-	{
-		if (*lpUTF8Str > 0x00 && *lpUTF8Str <= 0x7F)
-		{
-			*lpGBKStr++ = *lpUTF8Str++;
-			outputSize++;
+	while (*p && *p < 0x80)
+		*dst++ = *p++;
+
+	return p - src;
+}
+
+static int utf8_size(uint16_t wchar)
+{
+	if (wchar <= 0x7F)
+		return 1;
+	else if (wchar <= 0x7FF)
+		return 2;
+	else
+		return 3;
+}
+
+static int encode_utf8(unsigned char *s, unsigned short widechar);
+
+int gbk_to_utf8_n(const unsigned char *gbk, int gbk_len,
+		  unsigned char *utf8, int utf8_len)
+{
+	const unsigned char *end;
+	uint16_t w, wchar;
+	int len = 0, n;
+
+	if ((gbk == NULL) || (utf8 == NULL) || (gbk_len < 0) || (utf8_len <= 0)) {
+		return -1;
+	}
+
+	/* keep room for terminator */
+	utf8_len--;
+	end = gbk + gbk_len;
+
+	while (gbk < end) {
+		n = ascii_copy(&utf8[len], gbk, min(end - gbk, utf8_len - len));
+		if (n > 0) {
+			gbk += n;
+			len += n;
+			continue;
 		}
-		else if (((*lpUTF8Str) & 0xE0) == 0xC0)
-		{
-			char high = *lpUTF8Str++;
-			char low = *lpUTF8Str++;
-			if ((low & 0xC0) == 0x80) {
-				unicode = high&0xF;
-				unicode <<= 6;
-				unicode |= low&0x3F;
-			#ifdef CONFIG_FILE_SYSTEM
-				gbkcode = ff_convert(unicode, 0);
-			#endif
-				if (gbkcode != 0) {
-					high = (char)(gbkcode >> 8);
-					low = (char)gbkcode & 0xFF;
-				}
-			}
 
-			*lpGBKStr++ = high;
-			*lpGBKStr++ = low;
-			outputSize += 2;
+		w = *gbk;
+		if (w == 0) {
+			break;
 		}
-		else if (((*lpUTF8Str) & 0xF0) == 0xE0)
-		{
-			high = *lpUTF8Str++;
-			middle = *lpUTF8Str++;
-			low = *lpUTF8Str++;
-
-			if (((middle & 0xC0) == 0x80) && ((low & 0xC0) == 0x80))
-			{
-				unicode = high & 0xF;
-				unicode <<= 6;
-				unicode |= middle & 0x3F;
-				unicode <<= 6;
-				unicode |= low & 0x3F;
-			#ifdef CONFIG_FILE_SYSTEM
-				gbkcode = ff_convert(unicode, 0);
-			#endif
-				if (gbkcode != 0) {
-					*lpGBKStr++ = (char)(gbkcode >> 8);
-					*lpGBKStr++ = (char)(gbkcode & 0xFF);
-					outputSize += 2;
-					continue;
-				}
+
+		n = 1;
+		if (w >= 0x81 && w <= 0xFE) {
+			/* incomplete character */
+			if ((end - gbk < 2) || (gbk[1] == 0)) {
+				break;
 			}
+			w = (w << 8) + gbk[1];
+			n = 2;
+		}
+
+		wchar = oem_to_unicode(w);
+		if (wchar == 0xFFFF) {
+			return -1;
+		}
 
-			*lpGBKStr++ = high;
-			*lpGBKStr++ = middle;
-			*lpGBKStr++ = low;
-			outputSize += 3;
+		if (len + utf8_size(wchar) > utf8_len) {
+			break;
 		}
-		else
-		{
-			*lpGBKStr++ = *lpUTF8Str++;
-			outputSize++;
+
+		/* unmapped character is dropped */
+		if (wchar != 0) {
+			len += encode_utf8(&utf8[len], wchar);
 		}
+		gbk += n;
 	}
-	return outputSize;
+
+	utf8[len] = 0;
+	return len;
 }
+
+int gbk_to_utf8(unsigned char *lpGBKStr, unsigned char *lpUTF8Str, int len)
+{
+	return gbk_to_utf8_n(lpGBKStr, strlen((char *)lpGBKStr), lpUTF8Str, INT_MAX_LEN);
+}
+
+static int utf8_to_gbk_len(const unsigned char *utf8, int utf8_len,
+			   unsigned char *gbk, int gbk_len)
+{
+	const unsigned char *end = utf8 + utf8_len;
+	unsigned short unicode, gbkcode;
+	unsigned char c;
+	int len = 0, n;
+
+	while (utf8 < end) {
+		n = ascii_copy(&gbk[len], utf8, min(end - utf8, gbk_len - len));
+		if (n > 0) {
+			utf8 += n;
+			len += n;
+			continue;
+		}
+
+		c = *utf8;
+		if (c == 0) {
+			break;
+		}
+
+		n = 1;
+		if (((c & 0xE0) == 0xC0) && (end - utf8 >= 2) && ((utf8[1] & 0xC0) == 0x80)) {
+			unicode = ((c & 0x1F) << 6) | (utf8[1] & 0x3F);
+			n = 2;
+		} else if (((c & 0xF0) == 0xE0) && (end - utf8 >= 3) &&
+			   ((utf8[1] & 0xC0) == 0x80) && ((utf8[2] & 0xC0) == 0x80)) {
+			unicode = ((c & 0x0F) << 12) | ((utf8[1] & 0x3F) << 6) | (utf8[2] & 0x3F);
+			n = 3;
+		}
+
+		gbkcode = (n > 1) ? unicode_to_oem(unicode) : 0;
+		if (gbkcode > 0xFF) {
+			if (len + 2 > gbk_len) {
+				break;
+			}
+			gbk[len++] = (unsigned char)(gbkcode >> 8);
+			gbk[len++] = (unsigned char)(gbkcode & 0xFF);
+		} else if (gbkcode != 0) {
+			if (len + 1 > gbk_len) {
+				break;
+			}
+			gbk[len++] = (unsigned char)gbkcode;
+		} else {
+			/* invalid or unmapped sequence is copied as is */
+			if (len + n > gbk_len) {
+				break;
+			}
+			memcpy(&gbk[len], utf8, n);
+			len += n;
+		}
+		utf8 += n;
+	}
+
+	return len;
+}
+
+int utf8_to_gbk_n(const unsigned char *utf8, int utf8_len,
+		  unsigned char *gbk, int gbk_len)
+{
+	int len;
+
+	if ((utf8 == NULL) || (gbk == NULL) || (utf8_len < 0) || (gbk_len <= 0)) {
+		return -1;
+	}
+
+	len = utf8_to_gbk_len(utf8, utf8_len, gbk, gbk_len - 1);
+	gbk[len] = 0;
+
+	return len;
+}
+
+int utf8_to_gbk(unsigned char *lpUTF8Str,unsigned char *lpGBKStr, int len)
+{
+	return utf8_to_gbk_len(lpUTF8Str, len, lpGBKStr, INT_MAX_LEN);
+}
+
 int gbk_to_unicode(unsigned char *lpGBKStr, unsigned short *unicode, int *punicode_len)
 {
 	uint16_t w;
 	uint16_t wchar;
-	int len = 0;
+	int len = 0, n;
 
     if ((lpGBKStr == NULL) || (unicode == NULL) || (punicode_len == NULL)) {
         return -1;
@@ -150,17 +260,21 @@ int gbk_to_unicode(unsigned char *lpGBKStr, unsigned short *unicode, int *punico
 
 	while (*lpGBKStr)
 	{
+		n = ascii_widen(unicode, lpGBKStr);
+		if (n > 0) {
+			lpGBKStr += n;
+			unicode += n;
+			len += n * 2;
+			continue;
+		}
+
 		w = *lpGBKStr++;
 		w &= 0xFF;
-		if (((BYTE)(w) >= 0x81 && (BYTE)(w) <= 0xFE)) {
+		if (((BYTE)(w) >= 0x81 && (BYTE)(w) <= 0xFE) && *lpGBKStr) {
 			w = (w << 8) + *lpGBKStr++;
 		}
 
-#ifdef CONFIG_FILE_SYSTEM
-		wchar = ff_convert(w, 1);/* Convert ANSI/OEM to Unicode */
-#else
-		wchar = w;
-#endif
+		wchar = oem_to_unicode(w);
 		*unicode = wchar;
 		unicode++;
 		len += 2;
@@ -330,21 +444,27 @@ int mbcs_to_unicode(unsigned char *src_mbcs, unsigned short *dst_uni,
 	uint16_t w ;
 	uint16_t wchar ;
 	uint16_t unicode_num = 0;
-	int ret = 0;
+	int ret = 0, n;
 
     if ((src_mbcs == NULL) || (dst_uni == NULL) || (dst_len == NULL)) {
         return -1;
     }
 
 	while (*src_mbcs) {
+		n = ascii_widen(&dst_uni[unicode_num], src_mbcs);
+		if (n > 0) {
+			src_mbcs += n;
+			unicode_num += n;
+			continue;
+		}
+
 		w = *src_mbcs++;
 		w &= 0xFF;
-		if (((BYTE)(w) >= 0x81 && (BYTE)(w) <= 0xFE)) {
+		if (((BYTE)(w) >= 0x81 && (BYTE)(w) <= 0xFE) && *src_mbcs) {
 			w = (w << 8) + *src_mbcs++;
 		}
-	#ifdef CONFIG_FILE_SYSTEM
-		wchar = ff_convert(w, 1);/* Convert ANSI/OEM to Unicode */
-	#endif
+
+		wchar = oem_to_unicode(w);
 		dst_uni[unicode_num++] = wchar;
 	}
 
@@ -379,9 +499,7 @@ int unicod_to_mbcs(unsigned short *src_ucs, unsigned char *dst_mbcs,
             d_cnt++;
             num_bytes++;
         } else {
-		#ifdef CONFIG_FILE_SYSTEM
-            code = ff_convert(cu, 0);/* Convert Unicode to ANSI/OEM  */
-		#endif
+            code = unicode_to_oem(cu);
             if (code == 0) {
                 ret = 0;
                 code = 0x20;
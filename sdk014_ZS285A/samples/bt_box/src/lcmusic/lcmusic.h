@@ -234,4 +234,15 @@ int lcmusic_get_url_by_cluster(struct lcmusic_app_t *lcmusic);
 int lcmusic_get_cluster_by_url(struct lcmusic_app_t *lcmusic);
 void lcmusic_scan_disk(void);
 void lcmusic_display_track_no(u16_t track_no, int display_times);
+#ifdef CONFIG_LCMUSIC_PREFETCH
+const char *lcmusic_play_peek_url(bool forward, char *url, int len);
+void lcmusic_prefetch_init(void);
+void lcmusic_prefetch_exit(void);
+/* prefetch the tracks around the current one */
+void lcmusic_prefetch_request(void);
+/* drop prefetched tracks, e.g. when the iterator is destroyed */
+void lcmusic_prefetch_flush(void);
+/* opened stream of url if prefetched, the caller owns it */
+io_stream_t lcmusic_prefetch_take(const char *url);
+#endif
 #endif  /* _LCMUSIC_H */
@@ -312,8 +312,18 @@ static void _lcmusic_start_play(struct lcmusic_app_t *lcmusic, const char *url,
 #ifdef CONFIG_SOUNDBAR_SAMPLE_RATE_FILTER
 	play_param.min_sample_rate_khz = LCMUSIC_SOUNDBAR_MIN_SAMPLE_RATE;
 #endif
+#ifdef CONFIG_LCMUSIC_PREFETCH
+	play_param.file_stream = lcmusic_prefetch_take(url);
+#endif
 
 	lcmusic->lcplayer = mplayer_start_play(&play_param);
+#ifdef CONFIG_LCMUSIC_PREFETCH
+	/* not taken by the player */
+	if (play_param.file_stream) {
+		stream_close(play_param.file_stream);
+		stream_destroy(play_param.file_stream);
+	}
+#endif
 	if (!lcmusic->lcplayer) {
 		lcmusic->music_state = LCMUSIC_STATUS_ERROR;
 		if (lcmusic->mplayer_state != MPLAYER_STATE_NORMAL)
@@ -333,6 +343,9 @@ static void _lcmusic_start_play(struct lcmusic_app_t *lcmusic, const char *url,
 		thread_timer_start(&lcmusic->monitor_timer, 0, MONITOR_TIME_PERIOD);
 
 		_lcmusic_esd_save_bp_info(lcmusic, 1);
+	#ifdef CONFIG_LCMUSIC_PREFETCH
+		lcmusic_prefetch_request();
+	#endif
 	}
 }
 static void _lcmusic_switch_app_check(struct lcmusic_app_t *lcmusic)
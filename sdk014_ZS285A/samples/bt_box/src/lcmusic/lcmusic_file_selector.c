@@ -88,6 +88,9 @@ void lcmusic_exit_iterator(void)
 	if (iter)
 		iterator_destroy(iter);
 	iter = NULL;
+#ifdef CONFIG_LCMUSIC_PREFETCH
+	lcmusic_prefetch_flush();
+#endif
 	os_mutex_unlock(&iter_mutex);
 }
 
@@ -226,6 +229,26 @@ const char *lcmusic_play_set_track_no(struct lcmusic_app_t *lcmusic, u16_t track
 	return lcmusic->cur_url;
 }
 
+#ifdef CONFIG_LCMUSIC_PREFETCH
+const char *lcmusic_play_peek_url(bool forward, char *url, int len)
+{
+	const char *path = NULL;
+	u16_t track_no;
+
+	os_mutex_lock(&iter_mutex, OS_FOREVER);
+	if (iter)
+		path = iterator_peek(iter, forward, &track_no);
+
+	if (path) {
+		strncpy(url, path, len);
+		url[len - 1] = 0;
+		path = url;
+	}
+	os_mutex_unlock(&iter_mutex);
+	return path;
+}
+#endif
+
 int lcmusic_play_set_mode(struct lcmusic_app_t *lcmusic, u8_t mode)
 {
 	if (!iter) {
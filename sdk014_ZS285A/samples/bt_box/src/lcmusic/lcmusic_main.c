@@ -112,6 +112,10 @@ static int _lcmusic_init(const char *dir)
 
 	lcmusic_thread_timer_init(p_local_music);
 
+#ifdef CONFIG_LCMUSIC_PREFETCH
+	lcmusic_prefetch_init();
+#endif
+
 	SYS_LOG_INF("init ok\n");
 	return 0;
 }
@@ -129,6 +133,10 @@ void _lcmusic_exit(const char *dir)
 
 	lcmusic_stop_play(p_local_music, false);
 
+#ifdef CONFIG_LCMUSIC_PREFETCH
+	lcmusic_prefetch_exit();
+#endif
+
 	lcmusic_exit_iterator();
 
 	lcmusic_view_deinit();
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief lcmusic app track prefetch.
+ *
+ * After a track starts, the next and previous tracks are resolved by the
+ * iterator, their file streams are opened and the head is read in a low
+ * priority thread, so a track change does not wait for the disk.
+ */
+
+#include "lcmusic.h"
+
+#define PREFETCH_STACKSIZE	1536
+/* let the track just started fill its buffers first */
+#define PREFETCH_DELAY_MS	500
+
+struct lcmusic_prefetch_slot {
+	io_stream_t stream;
+	char url[MAX_URL_LEN + 1];
+};
+
+struct lcmusic_prefetch_t {
+	os_mutex lock;
+	os_sem req_sem;
+	os_sem exit_sem;
+	u8_t running : 1;
+	u8_t exit : 1;
+	/* changed by flush, streams opened before are dropped */
+	u32_t gen;
+	/* [0] previous track, [1] next track */
+	struct lcmusic_prefetch_slot slot[2];
+	/* used by the thread only */
+	char url[MAX_URL_LEN + 1];
+};
+
+static u8_t prefetch_stack[PREFETCH_STACKSIZE];
+static struct lcmusic_prefetch_t prefetch;
+
+static void _lcmusic_prefetch_close(io_stream_t stream)
+{
+	if (stream) {
+		stream_close(stream);
+		stream_destroy(stream);
+	}
+}
+
+static io_stream_t _lcmusic_prefetch_open(const char *url)
+{
+	io_stream_t stream;
+	int res;
+
+	stream = file_stream_create(url);
+	if (!stream) {
+		SYS_LOG_WRN("create failed (%s)\n", url);
+		return NULL;
+	}
+
+	if (stream_open(stream, MODE_IN)) {
+		SYS_LOG_WRN("open failed (%s)\n", url);
+		stream_destroy(stream);
+		return NULL;
+	}
+
+	res = file_stream_preload(stream, CONFIG_LCMUSIC_PREFETCH_SIZE);
+	if (res < 0) {
+		_lcmusic_prefetch_close(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+static void _lcmusic_prefetch_run(void)
+{
+	struct lcmusic_prefetch_slot *slot;
+	io_stream_t stream;
+	u32_t gen;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(prefetch.slot); i++) {
+		if (prefetch.exit)
+			return;
+
+		os_mutex_lock(&prefetch.lock, OS_FOREVER);
+		gen = prefetch.gen;
+		os_mutex_unlock(&prefetch.lock);
+
+		if (!lcmusic_play_peek_url(i, prefetch.url, sizeof(prefetch.url)))
+			continue;
+
+		slot = &prefetch.slot[i];
+		os_mutex_lock(&prefetch.lock, OS_FOREVER);
+		stream = (slot->stream && !strcmp(slot->url, prefetch.url)) ? slot->stream : NULL;
+		os_mutex_unlock(&prefetch.lock);
+		if (stream)
+			continue;
+
+		stream = _lcmusic_prefetch_open(prefetch.url);
+		if (!stream)
+			continue;
+
+		os_mutex_lock(&prefetch.lock, OS_FOREVER);
+		if (gen == prefetch.gen) {
+			io_stream_t old = slot->stream;
+
+			slot->stream = stream;
+			strcpy(slot->url, prefetch.url);
+			stream = old;
+		}
+		os_mutex_unlock(&prefetch.lock);
+
+		_lcmusic_prefetch_close(stream);
+		SYS_LOG_INF("%s %s\n", i ? "next" : "prev", prefetch.url);
+	}
+}
+
+static void _lcmusic_prefetch_thread(void *p1, void *p2, void *p3)
+{
+	while (1) {
+		os_sem_take(&prefetch.req_sem, OS_FOREVER);
+		if (prefetch.exit)
+			break;
+
+		os_sleep(PREFETCH_DELAY_MS);
+		_lcmusic_prefetch_run();
+	}
+
+	lcmusic_prefetch_flush();
+	os_sem_give(&prefetch.exit_sem);
+}
+
+void lcmusic_prefetch_init(void)
+{
+	if (prefetch.running)
+		return;
+
+	memset(&prefetch, 0, sizeof(prefetch));
+	os_mutex_init(&prefetch.lock);
+	os_sem_init(&prefetch.req_sem, 0, 1);
+	os_sem_init(&prefetch.exit_sem, 0, 1);
+	prefetch.running = 1;
+
+	os_thread_create(prefetch_stack, PREFETCH_STACKSIZE,
+		_lcmusic_prefetch_thread,
+		NULL, NULL, NULL,
+		CONFIG_APP_PRIORITY + 1, 0, 0);
+}
+
+void lcmusic_prefetch_exit(void)
+{
+	if (!prefetch.running)
+		return;
+
+	prefetch.exit = 1;
+	os_sem_give(&prefetch.req_sem);
+	os_sem_take(&prefetch.exit_sem, OS_FOREVER);
+	prefetch.running = 0;
+}
+
+void lcmusic_prefetch_request(void)
+{
+	if (prefetch.running)
+		os_sem_give(&prefetch.req_sem);
+}
+
+void lcmusic_prefetch_flush(void)
+{
+	io_stream_t stream[ARRAY_SIZE(prefetch.slot)];
+	int i;
+
+	if (!prefetch.running)
+		return;
+
+	os_mutex_lock(&prefetch.lock, OS_FOREVER);
+	prefetch.gen++;
+	for (i = 0; i < ARRAY_SIZE(prefetch.slot); i++) {
+		stream[i] = prefetch.slot[i].stream;
+		prefetch.slot[i].stream = NULL;
+	}
+	os_mutex_unlock(&prefetch.lock);
+
+	for (i = 0; i < ARRAY_SIZE(stream); i++)
+		_lcmusic_prefetch_close(stream[i]);
+}
+
+io_stream_t lcmusic_prefetch_take(const char *url)
+{
+	io_stream_t stream = NULL;
+	int i;
+
+	if (!prefetch.running)
+		return NULL;
+
+	os_mutex_lock(&prefetch.lock, OS_FOREVER);
+	for (i = 0; i < ARRAY_SIZE(prefetch.slot); i++) {
+		if (prefetch.slot[i].stream && !strcmp(prefetch.slot[i].url, url)) {
+			stream = prefetch.slot[i].stream;
+			prefetch.slot[i].stream = NULL;
+			break;
+		}
+	}
+	os_mutex_unlock(&prefetch.lock);
+
+	return stream;
+}
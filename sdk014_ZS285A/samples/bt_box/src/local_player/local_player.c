@@ -196,6 +196,13 @@ struct local_player_t *mplayer_start_play(struct lcplay_param *lcparam)
 	tts_manager_wait_finished(false);
 #endif
 
+	/* opened by prefetch */
+	if (lcparam->file_stream) {
+		lcplayer->file_stream = lcparam->file_stream;
+		lcparam->file_stream = NULL;
+		goto opened;
+	}
+
 #ifdef CONFIG_LOOP_FSTREAM
 	if (lcparam->play_mode == 1)
 		lcplayer->file_stream = loop_fstream_create((void *)lcparam->url);
@@ -214,6 +221,7 @@ struct local_player_t *mplayer_start_play(struct lcplay_param *lcparam)
 		goto err_exit;
 	}
 
+opened:
 	memset(&init_param, 0, sizeof(media_init_param_t));
 
 	init_param.type = MEDIA_SRV_TYPE_PLAYBACK;
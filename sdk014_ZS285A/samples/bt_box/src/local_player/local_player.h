@@ -65,6 +65,7 @@ struct lcplay_param {
 	media_breakpoint_info_t bp;
 	int seek_time;
 	u8_t play_mode;	/* 0-normal, 1-loopplay, others-reserved */
+	io_stream_t file_stream;	/* opened stream of url or NULL, cleared when the player takes it */
 #ifdef CONFIG_SOUNDBAR_SAMPLE_RATE_FILTER
 	int min_sample_rate_khz; /* <=0--disable, others--minius sample rate in kHz */
 #endif
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Heap allocation trace replay.
+ *
+ * Reads the records of CONFIG_BUDDY_ALLOC_TRACE, either the "buddy_trace"
+ * lines printed by the heap dump or the MEM_TRACE_BUDDY (0x603) packets of
+ * a binary trace capture, and replays them on the real rom_buddy allocator
+ * over a host page pool, following the policy of mem_buddy_malloc and
+ * mem_buddy_free.  Reports peak usage, the fragmentation over time and the
+ * largest allocation that failed, with its caller and thread.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "heap.h"
+
+#define BUDDYS_SIZE         (28)
+#define MAX_PAGES           (127)
+
+/* RAM_MPOOL0_MAX_NUM */
+#define RAM_POOL_PAGES      (28)
+
+#define SIZE2PAGE(size) ((size + PAGE_SIZE - 1) >> CONFIG_POOL_PAGE_SHIFT)
+#define PAGE2SIZE(page) (page << CONFIG_POOL_PAGE_SHIFT)
+
+#define TRACE_SYNC_CODE     (0x7E)
+#define TRACE_HEADER_LEN    (12)
+#define MEM_TRACE_BUDDY     (0x603)
+
+#define BUDDY_TRACE_MALLOC  (0)
+#define BUDDY_TRACE_FREE    (1)
+#define BUDDY_TRACE_FAIL    (2)
+
+struct trace_record
+{
+    uint32_t timestamp;
+    uint32_t thread;
+    uint32_t caller;
+    uint32_t addr;
+    uint32_t size;
+    int prio;
+    int type;
+    int buddy_no;
+};
+
+struct live_alloc
+{
+    uint32_t addr;
+    void *where;
+    int real;
+};
+
+struct failed_alloc
+{
+    uint32_t timestamp;
+    uint32_t thread;
+    uint32_t caller;
+    uint32_t size;
+    int prio;
+    int result;
+};
+
+static uint8_t *pool;
+static int pool_pages;
+static uint8_t page_used[MAX_PAGES];
+static uint8_t buddys[BUDDYS_SIZE];
+
+static struct live_alloc *lives;
+static int live_num, live_max;
+
+static int used_bytes, peak_used;
+static int used_pages, peak_pages;
+static int replay_fail_cnt, device_fail_cnt, unmatched_cnt;
+static float peak_frag;
+static struct failed_alloc largest_fail;
+
+static int host_printf(const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, fmt);
+    ret = vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    return ret;
+}
+
+static void halt(void)
+{
+    abort();
+}
+
+static void *convert_index_to_addr(unsigned char index)
+{
+    return pool + (index * PAGE_SIZE);
+}
+
+rom_buddy_data_t g_rom_buddy_data = {
+    .printf = host_printf,
+    .pagepool_convert_index_to_addr = convert_index_to_addr,
+    .halt = halt,
+};
+
+static int convert_addr_to_index(void *addr)
+{
+    return ((uint8_t *)addr - pool) / PAGE_SIZE;
+}
+
+/* first fit of contiguous pages, the device pool is not modelled further */
+static void *page_alloc(int page_num)
+{
+    int i, j;
+
+    for(i = 0; i + page_num <= pool_pages; i++)
+    {
+        for(j = 0; j < page_num; j++)
+        {
+            if(page_used[i + j])
+                break;
+        }
+
+        if(j == page_num)
+        {
+            memset(&page_used[i], 1, page_num);
+            used_pages += page_num;
+            if(used_pages > peak_pages)
+                peak_pages = used_pages;
+            return convert_index_to_addr(i);
+        }
+
+        i += j;
+    }
+
+    return NULL;
+}
+
+static void page_free(void *page, int page_num)
+{
+    memset(&page_used[convert_addr_to_index(page)], 0, page_num);
+    used_pages -= page_num;
+}
+
+static int largest_free_run(void)
+{
+    int i, run = 0, largest = 0;
+
+    for(i = 0; i < pool_pages; i++)
+    {
+        run = page_used[i] ? 0 : run + 1;
+        if(run > largest)
+            largest = run;
+    }
+
+    return largest;
+}
+
+/* mirror of mem_buddy_malloc, returns the error ret on failure */
+static int replay_malloc(int size, void **where, int *real)
+{
+    int i, page_num;
+    uint8_t page_no;
+    void *page, *addr;
+
+    *real = size;
+
+    if(size > get_buddy_max())
+    {
+        page_num = SIZE2PAGE(size);
+
+        if(buddys[BUDDYS_SIZE - 2] != (uint8_t)-1)
+            return 1;
+
+        page = page_alloc(page_num);
+        if(page == NULL)
+            return 2;
+
+        for(i = 0; i < BUDDYS_SIZE; i++)
+        {
+            if(buddys[i] == (uint8_t)-1)
+                break;
+        }
+        buddys[i] = convert_addr_to_index(page) | 0x80;
+        if(page_num > 1)
+            buddys[i + 1] = page_num | 0xc0;
+
+        *where = page;
+        *real = PAGE2SIZE(page_num);
+        return 0;
+    }
+
+    for(i = 0; i < BUDDYS_SIZE; i++)
+    {
+        if(buddys[i] == (uint8_t)-1)
+            break;
+        if(buddys[i] & 0x80)
+            continue;
+
+        addr = rom_buddy_alloc(buddys[i], real, &g_rom_buddy_data);
+        if(addr != NULL)
+        {
+            *where = addr;
+            return 0;
+        }
+    }
+
+    if(buddys[BUDDYS_SIZE - 1] != (uint8_t)-1)
+        return 4;
+
+    page = page_alloc(1);
+    if(page == NULL)
+        return 5;
+
+    page_no = rom_new_buddy_no(convert_addr_to_index(page), &g_rom_buddy_data);
+    *where = rom_buddy_alloc(page_no, real, &g_rom_buddy_data);
+    buddys[i] = page_no;
+    return 0;
+}
+
+static void del_buddy(int index, int nr)
+{
+    for(; index < BUDDYS_SIZE - nr; index++)
+        buddys[index] = buddys[index + nr];
+    for(nr--; nr >= 0; nr--)
+        buddys[index + nr] = (uint8_t)-1;
+}
+
+/* mirror of mem_buddy_free */
+static void replay_free(void *where)
+{
+    int i, page_num = 1;
+    uint8_t buddy_no = convert_addr_to_index(where);
+
+    for(i = 0; i < BUDDYS_SIZE; i++)
+    {
+        if(buddys[i] == buddy_no)
+        {
+            rom_buddy_free(buddy_no, where, NULL, &g_rom_buddy_data);
+            if(!rom_is_buddy_idled(buddy_no, &g_rom_buddy_data))
+                return;
+
+            del_buddy(i, 1);
+            page_free(convert_index_to_addr(buddy_no), 1);
+            return;
+        }
+
+        if(buddys[i] == (buddy_no | 0x80))
+        {
+            if(i + 1 < BUDDYS_SIZE && (buddys[i + 1] & 0xc0) == 0xc0
+                    && buddys[i + 1] != (uint8_t)-1)
+                page_num = buddys[i + 1] & 0x3f;
+
+            del_buddy(i, 1 + (page_num > 1));
+            page_free(where, page_num);
+            return;
+        }
+    }
+}
+
+static struct live_alloc *find_live(uint32_t addr)
+{
+    int i;
+
+    for(i = live_num - 1; i >= 0; i--)
+    {
+        if(lives[i].addr == addr)
+            return &lives[i];
+    }
+
+    return NULL;
+}
+
+static void record_fail(struct trace_record *record, int result)
+{
+    if(record->size <= largest_fail.size)
+        return;
+
+    largest_fail.timestamp = record->timestamp;
+    largest_fail.thread = record->thread;
+    largest_fail.caller = record->caller;
+    largest_fail.size = record->size;
+    largest_fail.prio = record->prio;
+    largest_fail.result = result;
+}
+
+/* 1 - largest allocatable / free bytes, free bytes of buddies included */
+static float fragmentation(void)
+{
+    struct buddy *self;
+    int i, largest, free_bytes;
+
+    free_bytes = (pool_pages - used_pages) * PAGE_SIZE;
+    largest = largest_free_run() * PAGE_SIZE;
+
+    for(i = 0; i < BUDDYS_SIZE && buddys[i] != (uint8_t)-1; i++)
+    {
+        if(buddys[i] & 0x80)
+            continue;
+
+        self = (struct buddy *)(convert_index_to_addr(buddys[i]) + PAGE_SIZE - SELF_SIZE);
+        free_bytes += self->freed * UNIT_SIZE;
+        if(getMax(self, 0) * UNIT_SIZE > largest)
+            largest = getMax(self, 0) * UNIT_SIZE;
+    }
+
+    if(free_bytes <= 0)
+        return 0;
+
+    return 1.0f - (float)largest / free_bytes;
+}
+
+static void replay(struct trace_record *record)
+{
+    struct live_alloc *live;
+    void *where;
+    int real, result;
+
+    switch(record->type)
+    {
+    case BUDDY_TRACE_FAIL:
+        device_fail_cnt++;
+        /* fall through, check whether the replayed heap fails as well */
+    case BUDDY_TRACE_MALLOC:
+        result = replay_malloc(record->size, &where, &real);
+        if(result)
+        {
+            replay_fail_cnt++;
+            record_fail(record, result);
+            break;
+        }
+
+        if(record->type == BUDDY_TRACE_FAIL)
+        {
+            replay_free(where);
+            break;
+        }
+
+        if(live_num == live_max)
+        {
+            live_max = live_max ? live_max * 2 : 256;
+            lives = realloc(lives, live_max * sizeof(*lives));
+            if(lives == NULL)
+                halt();
+        }
+
+        live = &lives[live_num++];
+        live->addr = record->addr;
+        live->where = where;
+        live->real = real;
+
+        used_bytes += real;
+        if(used_bytes > peak_used)
+            peak_used = used_bytes;
+        break;
+
+    case BUDDY_TRACE_FREE:
+        /* freed before the trace window or a record was lost */
+        live = find_live(record->addr);
+        if(live == NULL)
+        {
+            unmatched_cnt++;
+            break;
+        }
+
+        replay_free(live->where);
+        used_bytes -= live->real;
+        *live = lives[--live_num];
+        break;
+    }
+}
+
+static int parse_text(const char *line, struct trace_record *record)
+{
+    const char *p = strstr(line, "buddy_trace ");
+    char type;
+
+    if(p == NULL)
+        return 0;
+
+    if(sscanf(p, "buddy_trace %c %u %x %d %x %x %u %d", &type,
+            &record->timestamp, &record->thread, &record->prio,
+            &record->caller, &record->addr, &record->size,
+            &record->buddy_no) != 8)
+        return 0;
+
+    switch(type)
+    {
+    case 'a':
+        record->type = BUDDY_TRACE_MALLOC;
+        break;
+    case 'f':
+        record->type = BUDDY_TRACE_FREE;
+        break;
+    case 'e':
+        record->type = BUDDY_TRACE_FAIL;
+        break;
+    default:
+        return 0;
+    }
+
+    return 1;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* see _trace_binary_write, checksum skips its own byte */
+static int parse_packet(const uint8_t *p, int len, struct trace_record *record)
+{
+    uint8_t checksum = 0;
+    uint32_t info;
+    int i;
+
+    for(i = 0; i < len; i++)
+    {
+        if(i != 3)
+            checksum += p[i];
+    }
+
+    if(checksum != p[3] || get_le32(p + 8) != MEM_TRACE_BUDDY || len < TRACE_HEADER_LEN + 20)
+        return 0;
+
+    p += TRACE_HEADER_LEN;
+    info = get_le32(p + 16);
+
+    record->timestamp = get_le32(p - 8);
+    record->addr = get_le32(p);
+    record->size = get_le32(p + 4);
+    record->caller = get_le32(p + 8);
+    record->thread = get_le32(p + 12);
+    record->type = info & 0xff;
+    record->buddy_no = (info >> 8) & 0xff;
+    record->prio = (int8_t)(info >> 16);
+
+    return record->type <= BUDDY_TRACE_FAIL;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [-b] [-p pages] [-s interval] [-o csv] [trace]\n"
+        "  -b           trace is a binary capture of trace packets\n"
+        "  -p pages     pages in pool, default %d\n"
+        "  -s interval  records between fragmentation samples, default 1\n"
+        "  -o csv       write \"record,timestamp,used,pages,frag\" samples\n",
+        name, RAM_POOL_PAGES);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct trace_record record;
+    FILE *in = stdin, *csv = NULL;
+    uint8_t packet[256];
+    char line[512];
+    int binary = 0, interval = 1, count = 0;
+    float frag;
+    int opt, len;
+
+    pool_pages = RAM_POOL_PAGES;
+
+    while((opt = getopt(argc, argv, "bp:s:o:")) != -1)
+    {
+        switch(opt)
+        {
+        case 'b':
+            binary = 1;
+            break;
+        case 'p':
+            pool_pages = atoi(optarg);
+            break;
+        case 's':
+            interval = atoi(optarg);
+            break;
+        case 'o':
+            csv = fopen(optarg, "w");
+            if(csv == NULL)
+            {
+                perror(optarg);
+                return 1;
+            }
+            fprintf(csv, "record,timestamp,used,pages,frag\n");
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if(pool_pages <= 0 || pool_pages > MAX_PAGES || interval <= 0)
+        usage(argv[0]);
+
+    if(optind < argc)
+    {
+        in = fopen(argv[optind], binary ? "rb" : "r");
+        if(in == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    pool = aligned_alloc(PAGE_SIZE, pool_pages * PAGE_SIZE);
+    if(pool == NULL)
+        return 1;
+    memset(buddys, 0xff, sizeof(buddys));
+
+    for(;;)
+    {
+        if(binary)
+        {
+            /* resync on the sync code, the length follows it */
+            opt = fgetc(in);
+            if(opt == EOF)
+                break;
+            if(opt != TRACE_SYNC_CODE)
+                continue;
+
+            packet[0] = opt;
+            opt = fgetc(in);
+            if(opt == EOF)
+                break;
+
+            len = packet[1] = opt;
+            if(len < TRACE_HEADER_LEN || fread(packet + 2, 1, len - 2, in) != (size_t)(len - 2))
+                continue;
+
+            if(!parse_packet(packet, len, &record))
+                continue;
+        }
+        else
+        {
+            if(fgets(line, sizeof(line), in) == NULL)
+                break;
+
+            if(!parse_text(line, &record))
+                continue;
+        }
+
+        replay(&record);
+        count++;
+
+        frag = fragmentation();
+        if(frag > peak_frag)
+            peak_frag = frag;
+
+        if(csv && (count % interval) == 0)
+            fprintf(csv, "%d,%u,%d,%d,%.3f\n", count, record.timestamp,
+                used_bytes, used_pages, frag);
+    }
+
+    printf("records %d, pool %d pages of %lu bytes\n", count, pool_pages, PAGE_SIZE);
+    printf("peak used %d bytes, peak pages %d\n", peak_used, peak_pages);
+    printf("peak fragmentation %.1f%%\n", peak_frag * 100);
+    printf("failed %d (device %d), unmatched free %d\n", replay_fail_cnt,
+        device_fail_cnt, unmatched_cnt);
+
+    if(largest_fail.size)
+        printf("largest failed %u bytes ret %d, caller 0x%08x thread 0x%08x prio %d at %u\n",
+            largest_fail.size, largest_fail.result, largest_fail.caller,
+            largest_fail.thread, largest_fail.prio, largest_fail.timestamp);
+
+    if(csv)
+        fclose(csv);
+
+    return 0;
+}
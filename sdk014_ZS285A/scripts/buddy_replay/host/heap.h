@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host replacement of kernel/memory/include/heap.h, lets rom_buddy.c
+ * build natively against the host page pool of buddy_replay.c.
+ */
+
+#ifndef HEAP_H_
+#define HEAP_H_
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifndef CONFIG_POOL_PAGE_SHIFT
+#define CONFIG_POOL_PAGE_SHIFT  11
+#endif
+
+#define PAGE_SIZE   (1UL << CONFIG_POOL_PAGE_SHIFT)
+
+typedef int SYS_IRQ_FLAGS;
+
+static inline void sys_irq_lock(SYS_IRQ_FLAGS *flags) { (void)flags; }
+static inline void sys_irq_unlock(const SYS_IRQ_FLAGS *flags) { (void)flags; }
+
+#define printk  printf
+
+#define max(a, b)   (((a) > (b)) ? (a) : (b))
+
+#include "buddy_inner.h"
+
+#endif /* HEAP_H_ */
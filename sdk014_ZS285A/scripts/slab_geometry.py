@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Actions Semi Co., Inc.
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# Mem slab geometry tuner.
+#
+# Replays the allocation trace printed by CONFIG_SLAB_TRACE
+# ("slab_trace a <num_bytes> <ptr>" and "slab_trace f <ptr>" lines, other
+# log lines are ignored) and proposes the CONFIG_SLABn_BLOCK_SIZE and
+# CONFIG_SLABn_NUM_BLOCKS that hold the peak of the trace with the least RAM.
+#
+# Every request is served by the smallest class that fits it, so the blocks
+# needed by a class is the peak number of live requests falling into its
+# size range.  That peak is reached right after an allocation, so only the
+# live set before each free has to be kept.  Class boundaries are then
+# chosen by dynamic programming over the distinct (aligned) request sizes.
+#
+# With -c the current geometry of a .conf file is replayed as well, which
+# reports its RAM and the requests it fails to serve.
+
+import argparse
+import re
+import sys
+
+trace_re = re.compile(r'slab_trace ([af]) (?:(\d+) )?(\S+)')
+config_re = re.compile(r'^CONFIG_SLAB(\d+)_(BLOCK_SIZE|NUM_BLOCKS)=(\d+)')
+
+
+def read_trace(lines):
+    """Return the list of (size, ptr) events, size is None for free."""
+    events = []
+
+    for line in lines:
+        m = trace_re.search(line)
+        if not m:
+            continue
+
+        if m.group(1) == 'a':
+            events.append((int(m.group(2)), m.group(3)))
+        else:
+            events.append((None, m.group(3)))
+
+    return events
+
+
+def align_up(size, align):
+    return max(align, (size + align - 1) // align * align)
+
+
+def pick_candidates(sizes, max_candidates):
+    """Candidate block sizes, the biggest request is always a candidate."""
+    sizes = sorted(set(sizes))
+    if len(sizes) <= max_candidates:
+        return sizes
+
+    step = len(sizes) / max_candidates
+    picked = [sizes[int((i + 1) * step) - 1] for i in range(max_candidates)]
+    picked[-1] = sizes[-1]
+    return sorted(set(picked))
+
+
+def class_of(size, candidates):
+    for i, candidate in enumerate(candidates):
+        if candidate >= size:
+            return i
+    return len(candidates) - 1
+
+
+def live_peaks(events, candidates, align):
+    """Live count of each candidate before every free that follows mallocs."""
+    live = {}
+    count = [0] * len(candidates)
+    snapshots = set()
+    growing = False
+
+    for size, ptr in events:
+        if size is not None:
+            if ptr in ('0', '(nil)', '00000000', '0x0', '0x00000000'):
+                continue
+            index = class_of(align_up(size, align), candidates)
+            live[ptr] = index
+            count[index] += 1
+            growing = True
+        elif ptr in live:
+            if growing:
+                snapshots.add(tuple(count))
+                growing = False
+            count[live.pop(ptr)] -= 1
+
+    if growing:
+        snapshots.add(tuple(count))
+
+    return snapshots
+
+
+def propose(candidates, snapshots, classes):
+    """Pick at most classes ranges of candidates with the least RAM."""
+    n = len(candidates)
+    prefixes = []
+    for snapshot in snapshots:
+        prefix = [0]
+        for count in snapshot:
+            prefix.append(prefix[-1] + count)
+        prefixes.append(prefix)
+
+    # peak[j][i]: peak live requests with candidate index in [j, i]
+    peak = [[0] * n for _ in range(n)]
+    for prefix in prefixes:
+        for j in range(n):
+            row = peak[j]
+            base = prefix[j]
+            for i in range(j, n):
+                live = prefix[i + 1] - base
+                if live > row[i]:
+                    row[i] = live
+
+    inf = float('inf')
+    # best[k][i]: least RAM covering candidates [0, i] with k classes
+    best = [[inf] * n for _ in range(classes + 1)]
+    choice = [[-1] * n for _ in range(classes + 1)]
+    for i in range(n):
+        best[1][i] = candidates[i] * peak[0][i]
+    for k in range(2, classes + 1):
+        for i in range(n):
+            for j in range(1, i + 1):
+                cost = best[k - 1][j - 1] + candidates[i] * peak[j][i]
+                if cost < best[k][i]:
+                    best[k][i] = cost
+                    choice[k][i] = j
+
+    k = min(range(1, classes + 1), key=lambda k: best[k][n - 1])
+    geometry = []
+    i = n - 1
+    while k > 0:
+        j = choice[k][i] if k > 1 else 0
+        geometry.append((candidates[i], peak[j][i]))
+        i = j - 1
+        k -= 1
+
+    geometry.reverse()
+    return [g for g in geometry if g[1] > 0]
+
+
+def read_config(path):
+    geometry = {}
+
+    with open(path) as f:
+        for line in f:
+            m = config_re.match(line.strip())
+            if m:
+                geometry.setdefault(int(m.group(1)), {})[m.group(2)] = int(m.group(3))
+
+    return [(geometry[i].get('BLOCK_SIZE', 0), geometry[i].get('NUM_BLOCKS', 0))
+            for i in sorted(geometry)]
+
+
+def replay(events, geometry):
+    """Serve the trace first fit with spill like mem_slabs_malloc."""
+    free = [num for size, num in geometry]
+    live = {}
+    failed = 0
+
+    for size, ptr in events:
+        if size is not None:
+            for i, (block_size, num) in enumerate(geometry):
+                if block_size >= size and free[i] > 0:
+                    free[i] -= 1
+                    live[ptr] = i
+                    break
+            else:
+                failed += 1
+        elif ptr in live:
+            free[live.pop(ptr)] += 1
+
+    return failed
+
+
+def print_geometry(geometry, margin):
+    total = 0
+
+    for i, (size, num) in enumerate(geometry):
+        num = -(-num * (100 + margin) // 100)
+        total += size * num
+        print("CONFIG_SLAB%d_BLOCK_SIZE=%d" % (i, size))
+        print("CONFIG_SLAB%d_NUM_BLOCKS=%d" % (i, num))
+
+    return total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=
+            "Propose mem slab geometry from a slab_trace log")
+    parser.add_argument("trace", nargs='?', help="log with slab_trace lines, default stdin")
+    parser.add_argument("-c", "--config", help="app .conf to compare with")
+    parser.add_argument("-n", "--classes", type=int, default=9,
+            help="number of slab classes (CONFIG_SLAB_TOTAL_NUM), default 9")
+    parser.add_argument("-a", "--align", type=int, default=4,
+            help="block size alignment, default 4")
+    parser.add_argument("-m", "--margin", type=int, default=0,
+            help="headroom in percent added to each peak, default 0")
+    parser.add_argument("--max-candidates", type=int, default=48,
+            help="distinct block sizes considered, default 48")
+    args = parser.parse_args()
+
+    if args.trace:
+        with open(args.trace, errors='replace') as f:
+            events = read_trace(f)
+    else:
+        events = read_trace(sys.stdin)
+
+    sizes = [align_up(size, args.align) for size, ptr in events if size is not None]
+    if not sizes:
+        sys.exit("no slab_trace malloc found")
+
+    candidates = pick_candidates(sizes, args.max_candidates)
+    snapshots = live_peaks(events, candidates, args.align)
+    geometry = propose(candidates, snapshots, args.classes)
+
+    print("# %d mallocs, %d sizes, %d peaks" % (len(sizes), len(set(sizes)), len(snapshots)))
+    total = print_geometry(geometry, args.margin)
+    print("# proposed %d slabs, %d bytes" % (len(geometry), total))
+
+    if args.config:
+        current = read_config(args.config)
+        print("# current %d slabs, %d bytes, %d mallocs failed" %
+                (len(current), sum(size * num for size, num in current),
+                 replay(events, current)))
+
+
+if __name__ == '__main__':
+    main()
@@ -33,6 +33,30 @@ def is_windows():
     else:
         return 0
 
+SDFS_DIR_SIZE = 32
+SDFS_DIR_SORTED = 0x54524f53    # "SORT"
+
+def sort_sdfs_dir(sdfs_file):
+    # sort the directory entries like strncasecmp(), so a file is found by
+    # binary search. File data does not move and the checksums of header
+    # and directory are word sums, they are not changed by the new order.
+    with open(sdfs_file, 'rb+') as f:
+        data = bytearray(f.read())
+        if data[0:8] != b'sdfs.bin':
+            print('SDFS: invalid image %s' %sdfs_file)
+            sys.exit(1)
+
+        total = struct.unpack_from('<i', data, 12)[0]
+        entries = [bytes(data[SDFS_DIR_SIZE * (i + 1) : SDFS_DIR_SIZE * (i + 2)]) \
+            for i in range(total)]
+        entries.sort(key = lambda e: e[0:12].split(b'\0')[0].lower())
+
+        data[SDFS_DIR_SIZE : SDFS_DIR_SIZE * (total + 1)] = b''.join(entries)
+        struct.pack_into('<I', data, 20, SDFS_DIR_SORTED)
+
+        f.seek(0)
+        f.write(data)
+
 def main(argv):
     parser = argparse.ArgumentParser(
         description='Build sdfs image (sdfs)',
@@ -62,6 +86,8 @@ def main(argv):
         print(outmsg)
         sys.exit(1)
 
+    sort_sdfs_dir(args.output_file)
+
     print('SDFS: Generate sdfs file: %s.' %args.output_file)
 
 if __name__ == "__main__":
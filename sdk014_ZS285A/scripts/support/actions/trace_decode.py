@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+#
+# Decode Actions trace binary log
+#
+# Copyright (c) 2019 Actions Semiconductor Co., Ltd
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+import sys
+import struct
+import argparse
+
+TRACE_LOG_SYNC = 0xff
+TRACE_LOG_HEADER_SIZE = 12
+
+class ElfImage(object):
+    # just enough of elf32 to read the format strings: PROGBITS sections
+    # with an address, looked up by the format address in the record
+    def __init__(self, elf_file):
+        with open(elf_file, 'rb') as f:
+            data = f.read()
+
+        if data[0:4] != b'\x7fELF' or data[4] != 1:
+            print('TRACE: %s is not an elf32 file' %elf_file)
+            sys.exit(1)
+
+        endian = '<' if data[5] == 1 else '>'
+        (shoff,) = struct.unpack_from(endian + 'I', data, 0x20)
+        (shentsize, shnum) = struct.unpack_from(endian + 'HH', data, 0x2e)
+
+        self.sections = []
+        for i in range(shnum):
+            (sh_type, sh_flags, sh_addr, sh_offset, sh_size) = \
+                struct.unpack_from(endian + 'IIIII', data, shoff + i * shentsize + 4)
+            # SHT_PROGBITS
+            if sh_type == 1 and sh_addr != 0 and sh_size != 0:
+                self.sections.append((sh_addr, data[sh_offset : sh_offset + sh_size]))
+
+    def read_string(self, addr):
+        for (start, data) in self.sections:
+            if start <= addr < start + len(data):
+                off = addr - start
+                end = data.find(b'\0', off)
+                if end < 0:
+                    end = len(data)
+                return data[off:end].decode('latin-1')
+        return None
+
+def format_number(digits, padding, min_width, sign = ''):
+    # same padding rules as trace_vsnprintf
+    if padding == '0':
+        digits = digits.rjust(min_width - len(sign), '0')
+    elif padding == ' ':
+        digits = digits.rjust(min_width - len(sign), ' ')
+    elif padding == '-':
+        return (sign + digits).ljust(min_width, ' ')
+    return sign + digits
+
+def format_record(fmt, args):
+    out = []
+    might_format = False
+    pos = 0
+
+    for ch in fmt:
+        if not might_format:
+            if ch == '%':
+                might_format = True
+                padding = ''
+                min_width = -1
+            else:
+                out.append(ch)
+            continue
+
+        if ch == '-':
+            padding = '-'
+            continue
+        if ch == '0' and min_width < 0 and padding == '':
+            padding = '0'
+            continue
+        if ch.isdigit():
+            min_width = int(ch) if min_width < 0 else min_width * 10 + int(ch)
+            if padding == '':
+                padding = ' '
+            continue
+        if ch in 'lzh':
+            continue
+
+        might_format = False
+        if ch in 'diupxXc':
+            if pos + 4 > len(args):
+                out.append('<?>')
+                continue
+            (val,) = struct.unpack_from('<I', args, pos)
+            pos += 4
+            if ch in 'di':
+                sign = ''
+                if val & 0x80000000:
+                    sign = '-'
+                    val = 0x100000000 - val
+                out.append(format_number('%u' %val, padding, min_width, sign))
+            elif ch == 'u':
+                out.append(format_number('%u' %val, padding, min_width))
+            elif ch == 'p':
+                out.append('0x' + format_number('%x' %val, '0', 8))
+            elif ch in 'xX':
+                out.append(format_number('%x' %val, padding, min_width))
+            else:
+                out.append(chr(val & 0xff))
+        elif ch == 's':
+            if pos >= len(args):
+                out.append('<?>')
+                continue
+            slen = args[pos]
+            out.append(args[pos + 1 : pos + 1 + slen].decode('latin-1'))
+            pos += 1 + slen
+        elif ch == '%':
+            out.append('%')
+        else:
+            out.append('%' + ch)
+
+    return ''.join(out)
+
+def decode(data, elf, cycles_per_us, output):
+    # records are found by sync byte, length and checksum, anything else
+    # is text written in cpu mode (panic, before init) or a drop marker
+    i = 0
+    text_start = 0
+    last_seq = None
+
+    while i < len(data):
+        if data[i] != TRACE_LOG_SYNC or i + TRACE_LOG_HEADER_SIZE > len(data):
+            i += 1
+            continue
+
+        rec_len = data[i + 1]
+        if rec_len < TRACE_LOG_HEADER_SIZE or i + rec_len > len(data) or \
+           (sum(data[i : i + rec_len]) - data[i + 3]) & 0xff != data[i + 3]:
+            i += 1
+            continue
+
+        output.write(data[text_start:i].decode('latin-1'))
+
+        (seq, _, timestamp, fmt_addr) = struct.unpack_from('<BBII', data, i + 2)
+        if last_seq is not None and seq != (last_seq + 1) & 0xff:
+            output.write('<lost %d records>\n' %((seq - last_seq - 1) & 0xff))
+        last_seq = seq
+
+        us = timestamp // cycles_per_us
+        fmt = elf.read_string(fmt_addr)
+        if fmt is None:
+            text = '<unknown format 0x%08x>\n' %fmt_addr
+        else:
+            text = format_record(fmt, data[i + TRACE_LOG_HEADER_SIZE : i + rec_len])
+
+        output.write('[%d.%03d] %s' %(us // 1000, us % 1000, text))
+
+        i += rec_len
+        text_start = i
+
+    output.write(data[text_start:].decode('latin-1'))
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description='Decode trace binary log',
+    )
+    parser.add_argument('-e', dest = 'elf_file', required=True)
+    parser.add_argument('-i', dest = 'log_file', required=True)
+    parser.add_argument('-o', dest = 'output_file')
+    parser.add_argument('-c', dest = 'cycles_per_sec', type = int, default = 24000000)
+    args = parser.parse_args();
+
+    elf = ElfImage(args.elf_file)
+
+    with open(args.log_file, 'rb') as f:
+        data = f.read()
+
+    if args.output_file:
+        with open(args.output_file, 'w') as output:
+            decode(data, elf, args.cycles_per_sec // 1000000, output)
+    else:
+        decode(data, elf, args.cycles_per_sec // 1000000, sys.stdout)
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -32,6 +32,7 @@
 #define BT_BR_SIG_COUNT		(CONFIG_BT_MAX_BR_CONN*2)
 #define BT_BR_RESERVE_PKT	1		/* Avoid send data used all pkts */
 #define BT_LE_RESERVE_PKT	1		/* Avoid send data used all pkts */
+#define BT_CONN_HANDLE_SLOTS	(2 * (CONFIG_BT_MAX_CONN + CONFIG_BT_MAX_SCO_CONN))
 
 /* rfcomm */
 #if defined(CONFIG_BT_HCI_ACL_FLOW_CONTROL)
@@ -100,6 +101,7 @@ const struct bt_inner_value_t bt_inner_value = {
 	.avdtp_rx_mtu = BT_AVDTP_MAX_MTU,
 	.hf_features = BT_HFP_HF_SUPPORTED_FEATURES,
 	.ag_features = BT_HFP_AG_SUPPORTED_FEATURES,
+	.conn_handle_slots = BT_CONN_HANDLE_SLOTS,
 };
 
 BT_DATA_POOL_DEFINE(host_rx_pool, 1, CONFIG_BT_DATA_POOL_RX_SIZE, &continue_data_pool_opt);
@@ -130,6 +132,8 @@ struct bt_conn_tx conn_tx_link[BT_ACL_TX_MAX] __in_section_unique(bthost_bss);
 struct bt_conn conns[CONFIG_BT_MAX_CONN] __in_section_unique(bthost_bss);
 /* CONFIG_BT_MAX_SCO_CONN == CONFIG_BT_MAX_BR_CONN */
 struct bt_conn sco_conns[CONFIG_BT_MAX_SCO_CONN] __in_section_unique(bthost_bss);
+/* bt_conn_lookup_handle hash, twice the connections keeps probes short */
+struct bt_conn *conn_handle_index[BT_CONN_HANDLE_SLOTS] __in_section_unique(bthost_bss);
 
 /* hfp, Wait todo: Can use union to manager  hfp_hf_connection and hfp_ag_connection, for reduce memory */
 struct bt_hfp_hf hfp_hf_connection[CONFIG_BT_MAX_BR_CONN] __in_section_unique(bthost_bss);
@@ -25,6 +25,8 @@ struct bt_inner_value_t {
 	u16_t avdtp_rx_mtu;
 	u16_t hf_features;
 	u16_t ag_features;
+	/* after the fields read by libbt_stack.a, keep their offsets */
+	u8_t conn_handle_slots;
 };
 
 extern const struct bt_inner_value_t bt_inner_value;
@@ -38,6 +38,7 @@
 extern struct bt_conn_tx conn_tx_link[];
 extern struct bt_conn conns[];
 extern struct bt_conn sco_conns[];
+extern struct bt_conn *conn_handle_index[];
 extern struct net_buf_pool acl_tx_pool;
 
 #define DEFAULT_PIN_CODE		"0000"
@@ -48,6 +49,8 @@ extern struct net_buf_pool acl_tx_pool;
 #define SNIFF_WORK_INTERVAL		1000	/* 1000ms */
 #define SNIFF_ENTER_IDLE_CNT	5
 #define CONN_TX_PKT_RESERVE		2
+/* RX buffers one packet may hold, the rest stays for events */
+#define CONN_RX_MAX_FRAGS		max(CONFIG_BT_RX_BUF_COUNT / 2, 1)
 
 /* How long until we cancel HCI_LE_Create_Connection */
 #define CONN_TIMEOUT	K_SECONDS(3)
@@ -67,6 +70,38 @@ struct conn_tx_cb {
 #define conn_tx(buf) ((struct conn_tx_cb *)net_buf_user_data(buf))
 static sys_slist_t free_tx = SYS_SLIST_STATIC_INIT(&free_tx);
 
+#if defined(CONFIG_BT_CONN_TX_SLICE)
+/* The driver releases a slice before send returns, so a sending thread
+ * holds at most one.
+ */
+#define FRAG_SLICE_COUNT	2
+
+/* A slice has no data of its own, it points into the L2CAP buffer it
+ * was cut from and holds a reference on it.
+ */
+struct frag_slice {
+	/* shared with the buffer type, must be first */
+	struct conn_tx_cb tx;
+	struct net_buf *parent;
+};
+
+#define frag_slice(buf) ((struct frag_slice *)net_buf_user_data(buf))
+
+static void frag_slice_destroy(struct net_buf *buf)
+{
+	struct net_buf *parent = frag_slice(buf)->parent;
+
+	net_buf_destroy(buf);
+
+	if (parent) {
+		net_buf_unref(parent);
+	}
+}
+
+NET_BUF_POOL_DEFINE(frag_slice_pool, FRAG_SLICE_COUNT, 0,
+		    sizeof(struct frag_slice), frag_slice_destroy);
+#endif /* CONFIG_BT_CONN_TX_SLICE */
+
 #if defined(CONFIG_BT_BREDR)
 enum pairing_method {
 	LEGACY,			/* Legacy (pre-SSP) pairing */
@@ -1244,6 +1279,39 @@ static void bt_conn_reset_rx_state(struct bt_conn *conn)
 	conn->rx_len = 0;
 }
 
+static int rx_frags_count(struct net_buf *buf)
+{
+	int cnt = 0;
+
+	for (; buf; buf = buf->frags) {
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/* L2CAP parses contiguous data, copy a reassembled chain to one buffer */
+static struct net_buf *rx_linearize(struct net_buf *head)
+{
+	struct net_buf *buf, *frag;
+
+	/* Events come from the pool taking any length, the ACL pool of
+	 * flow control has fixed size buffers.
+	 */
+	buf = bt_buf_get_rx_len(BT_BUF_EVT, K_NO_WAIT, net_buf_frags_len(head));
+	if (buf) {
+		bt_buf_set_type(buf, BT_BUF_ACL_IN);
+
+		for (frag = head; frag; frag = frag->frags) {
+			net_buf_add_mem(buf, frag->data, frag->len);
+		}
+	}
+
+	net_buf_unref(head);
+
+	return buf;
+}
+
 void bt_conn_recv(struct bt_conn *conn, struct net_buf *buf, u8_t flags)
 {
 	struct bt_l2cap_hdr *hdr;
@@ -1264,6 +1332,15 @@ void bt_conn_recv(struct bt_conn *conn, struct net_buf *buf, u8_t flags)
 			bt_conn_reset_rx_state(conn);
 		}
 
+		/* no buffer takes it, drop now rather than pin the
+		 * fragments until the packet is complete
+		 */
+		if (sizeof(*hdr) + len > BT_BUF_RX_MAX_LEN - BT_HCI_ACL_HDR_SIZE) {
+			BT_ERR("L2CAP packet too long (%u)", len);
+			net_buf_unref(buf);
+			return;
+		}
+
 		conn->rx_len = (sizeof(*hdr) + len) - buf->len;
 		BT_DBG("rx_len %u", conn->rx_len);
 		if (conn->rx_len) {
@@ -1289,24 +1366,38 @@ void bt_conn_recv(struct bt_conn *conn, struct net_buf *buf, u8_t flags)
 
 		BT_DBG("Cont, len %u rx_len %u", buf->len, conn->rx_len);
 
-		if (buf->len > net_buf_tailroom(conn->rx)) {
-			BT_ERR("Not enough buffer space for L2CAP data");
+		/* Append while the first buffer has room, it is usually
+		 * allocated for the whole packet. Otherwise keep the
+		 * fragment and copy the chain once it is complete.
+		 */
+		if (!conn->rx->frags && buf->len <= net_buf_tailroom(conn->rx)) {
+			net_buf_add_mem(conn->rx, buf->data, buf->len);
+			conn->rx_len -= buf->len;
+			net_buf_unref(buf);
+		} else if (rx_frags_count(conn->rx) < CONN_RX_MAX_FRAGS) {
+			conn->rx_len -= buf->len;
+			net_buf_frag_add(conn->rx, buf);
+		} else {
+			BT_ERR("Too many L2CAP fragments");
 			bt_conn_reset_rx_state(conn);
 			net_buf_unref(buf);
 			return;
 		}
 
-		net_buf_add_mem(conn->rx, buf->data, buf->len);
-		conn->rx_len -= buf->len;
-		net_buf_unref(buf);
-
 		if (conn->rx_len) {
 			return;
 		}
 
 		buf = conn->rx;
 		conn->rx = NULL;
-		conn->rx_len = 0;
+
+		if (buf->frags) {
+			buf = rx_linearize(buf);
+			if (!buf) {
+				BT_ERR("Not enough buffer space for L2CAP data");
+				return;
+			}
+		}
 
 		break;
 	default:
@@ -1504,7 +1595,12 @@ static struct net_buf *create_frag(struct bt_conn *conn, struct net_buf *buf)
 	struct net_buf *frag;
 	u16_t frag_len;
 
+#if defined(CONFIG_BT_CONN_TX_SLICE)
+	frag = net_buf_alloc(&frag_slice_pool, K_FOREVER);
+	frag_slice(frag)->parent = NULL;
+#else
 	frag = bt_conn_create_pdu(NULL, 0);
+#endif
 
 	if (conn->state != BT_CONN_CONNECTED) {
 		net_buf_unref(frag);
@@ -1514,9 +1610,21 @@ static struct net_buf *create_frag(struct bt_conn *conn, struct net_buf *buf)
 	/* Fragments never have a TX completion callback */
 	conn_tx(frag)->cb = NULL;
 
+#if defined(CONFIG_BT_CONN_TX_SLICE)
+	/* The ACL header is pushed over the tail of the previous fragment,
+	 * which the driver has copied out already.
+	 */
+	frag_len = conn_mtu(conn);
+	frag_slice(frag)->parent = net_buf_ref(buf);
+	frag->__buf = buf->__buf;
+	frag->size = buf->size;
+	frag->data = buf->data;
+	frag->len = frag_len;
+#else
 	frag_len = min(conn_mtu(conn), net_buf_tailroom(frag));
 
 	net_buf_add_mem(frag, buf->data, frag_len);
+#endif
 	net_buf_pull(buf, frag_len);
 
 	return frag;
@@ -1770,6 +1878,55 @@ static void process_unack_tx(struct bt_conn *conn)
 	}
 }
 
+/* Connections with a valid handle are kept in conn_handle_index, an
+ * open addressing hash on the handle with linear probing.
+ */
+static inline bool conn_handle_valid(bt_conn_state_t state)
+{
+	return (state == BT_CONN_CONNECTED || state == BT_CONN_DISCONNECT);
+}
+
+static void conn_handle_index_add(struct bt_conn *conn)
+{
+	u8_t slots = bt_inner_value.conn_handle_slots;
+	u8_t i = conn->handle % slots;
+
+	while (conn_handle_index[i]) {
+		i = (i + 1) % slots;
+	}
+
+	conn_handle_index[i] = conn;
+}
+
+static void conn_handle_index_del(struct bt_conn *conn)
+{
+	u8_t slots = bt_inner_value.conn_handle_slots;
+	u8_t i = conn->handle % slots;
+	u8_t j, home;
+
+	while (conn_handle_index[i] != conn) {
+		if (!conn_handle_index[i]) {
+			BT_WARN("conn %p not indexed", conn);
+			return;
+		}
+
+		i = (i + 1) % slots;
+	}
+
+	/* Move back entries which probed past the freed slot */
+	for (j = (i + 1) % slots; conn_handle_index[j]; j = (j + 1) % slots) {
+		home = conn_handle_index[j]->handle % slots;
+		if ((i < j) ? (home > i && home <= j) : (home > i || home <= j)) {
+			continue;
+		}
+
+		conn_handle_index[i] = conn_handle_index[j];
+		i = j;
+	}
+
+	conn_handle_index[i] = NULL;
+}
+
 void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 {
 	bt_conn_state_t old_state;
@@ -1784,6 +1941,12 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 	old_state = conn->state;
 	conn->state = state;
 
+	if (!conn_handle_valid(old_state) && conn_handle_valid(state)) {
+		conn_handle_index_add(conn);
+	} else if (conn_handle_valid(old_state) && !conn_handle_valid(state)) {
+		conn_handle_index_del(conn);
+	}
+
 	/* Actions needed for exiting the old state */
 	switch (old_state) {
 	case BT_CONN_DISCONNECTED:
@@ -1889,41 +2052,18 @@ void bt_conn_set_state(struct bt_conn *conn, bt_conn_state_t state)
 
 struct bt_conn *bt_conn_lookup_handle(u16_t handle)
 {
-	int i;
-
-	for (i = 0; i < bt_inner_value.max_conn; i++) {
-		if (!atomic_get(&conns[i].ref)) {
-			continue;
-		}
-
-		/* We only care about connections with a valid handle */
-		if (conns[i].state != BT_CONN_CONNECTED &&
-		    conns[i].state != BT_CONN_DISCONNECT) {
-			continue;
-		}
-
-		if (conns[i].handle == handle) {
-			return bt_conn_ref(&conns[i]);
-		}
-	}
-
-#if defined(CONFIG_BT_BREDR)
-	for (i = 0; i < bt_inner_value.br_max_conn; i++) {
-		if (!atomic_get(&sco_conns[i].ref)) {
-			continue;
-		}
+	u8_t slots = bt_inner_value.conn_handle_slots;
+	u8_t i = handle % slots;
+	struct bt_conn *conn;
 
-		/* We only care about connections with a valid handle */
-		if (sco_conns[i].state != BT_CONN_CONNECTED &&
-		    sco_conns[i].state != BT_CONN_DISCONNECT) {
-			continue;
+	/* The table always has a free slot, a probe ends there */
+	while ((conn = conn_handle_index[i])) {
+		if (conn->handle == handle) {
+			return bt_conn_ref(conn);
 		}
 
-		if (sco_conns[i].handle == handle) {
-			return bt_conn_ref(&sco_conns[i]);
-		}
+		i = (i + 1) % slots;
 	}
-#endif
 
 	return NULL;
 }
@@ -2678,6 +2818,8 @@ static void bt_conn_env_init(void)
 #endif /* CONFIG_BT_SMP || CONFIG_BT_BREDR */
 
 	memset(conns, 0, (sizeof(struct bt_conn)*bt_inner_value.max_conn));
+	memset(conn_handle_index, 0,
+	       sizeof(struct bt_conn *)*bt_inner_value.conn_handle_slots);
 	callback_list = NULL;
 	memset(conn_tx_link, 0, (sizeof(struct bt_conn_tx)*bt_inner_value.acl_tx_max));
 	sys_slist_init(&free_tx);
@@ -50,6 +50,9 @@ struct bt_conn_le {
 
 	/* Delayed work for connection update and timeout handling */
 	struct k_delayed_work	update_work;
+
+	/* CCC cfg entries of this peer with a value set */
+	sys_slist_t		ccc_subs;
 };
 
 #if defined(CONFIG_BT_BREDR)
@@ -46,6 +46,10 @@ static const u16_t gap_appearance = CONFIG_BT_DEVICE_APPEARANCE;
 
 static sys_slist_t db;
 
+/* Services of db in handle order, -1 if they do not fit */
+static struct bt_gatt_service *db_index[CONFIG_BT_GATT_DB_INDEX_SIZE];
+static s8_t db_index_len;
+
 #if GATT_OPEN_BASE_SERVICE
 static ssize_t read_name(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 			 void *buf, u16_t len, u16_t offset)
@@ -95,6 +99,25 @@ static struct bt_gatt_attr gatt_attrs[] = {
 static struct bt_gatt_service gatt_svc = BT_GATT_SERVICE(gatt_attrs);
 #endif
 
+static void gatt_db_index_update(void)
+{
+	struct bt_gatt_service *svc;
+	int len = 0;
+
+	/* Handles increase along the list, see gatt_register() */
+	SYS_SLIST_FOR_EACH_CONTAINER(&db, svc, node) {
+		if (len == ARRAY_SIZE(db_index)) {
+			BT_WARN("Too many services for index");
+			db_index_len = -1;
+			return;
+		}
+
+		db_index[len++] = svc;
+	}
+
+	db_index_len = len;
+}
+
 static int gatt_register(struct bt_gatt_service *svc)
 {
 	struct bt_gatt_service *last;
@@ -132,6 +155,7 @@ populate:
 	}
 
 	sys_slist_append(&db, &svc->node);
+	gatt_db_index_update();
 
 	return 0;
 }
@@ -206,6 +230,7 @@ static void bt_gatt_env_init(void)
 #endif /* CONFIG_BT_GATT_CLIENT */
 
 	sys_slist_init(&db);
+	db_index_len = 0;
 
 #if GATT_OPEN_BASE_SERVICE
 	memset(&gatt_svc, 0, sizeof(gatt_svc));
@@ -316,6 +341,8 @@ int bt_gatt_service_unregister(struct bt_gatt_service *svc)
 		return -ENOENT;
 	}
 
+	gatt_db_index_update();
+
 #if GATT_OPEN_BASE_SERVICE
 	sc_indicate(&gatt_sc, svc->attrs[0].handle,
 		    svc->attrs[svc->attr_count - 1].handle);
@@ -459,27 +486,99 @@ ssize_t bt_gatt_attr_read_chrc(struct bt_conn *conn,
 	return bt_gatt_attr_read(conn, attr, buf, len, offset, &pdu, value_len);
 }
 
-void bt_gatt_foreach_attr(u16_t start_handle, u16_t end_handle,
-			  bt_gatt_attr_func_t func, void *user_data)
+static inline u16_t gatt_service_end(const struct bt_gatt_service *svc)
 {
-	struct bt_gatt_service *svc;
+	return svc->attrs[svc->attr_count - 1].handle;
+}
 
-	SYS_SLIST_FOR_EACH_CONTAINER(&db, svc, node) {
-		int i;
+/* Index of the first indexed service ending at or after handle */
+static int gatt_service_find(u16_t handle)
+{
+	int lo = 0, hi = db_index_len;
 
-		for (i = 0; i < svc->attr_count; i++) {
-			struct bt_gatt_attr *attr = &svc->attrs[i];
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
 
-			/* Check if attribute handle is within range */
-			if (attr->handle < start_handle ||
-			    attr->handle > end_handle) {
-				continue;
-			}
+		if (gatt_service_end(db_index[mid]) < handle) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/* Index of the first attribute of svc at or after handle */
+static int gatt_attr_find(const struct bt_gatt_service *svc, u16_t handle)
+{
+	int lo = 0, hi = svc->attr_count;
 
-			if (func(attr, user_data) == BT_GATT_ITER_STOP) {
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (svc->attrs[mid].handle < handle) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static u8_t gatt_foreach_service_attr(struct bt_gatt_service *svc,
+				      u16_t start_handle, u16_t end_handle,
+				      bt_gatt_attr_func_t func,
+				      void *user_data)
+{
+	int i;
+
+	if (gatt_service_end(svc) < start_handle) {
+		return BT_GATT_ITER_CONTINUE;
+	}
+
+	for (i = gatt_attr_find(svc, start_handle); i < svc->attr_count; i++) {
+		struct bt_gatt_attr *attr = &svc->attrs[i];
+
+		/* Handles are sorted, nothing after is within range */
+		if (attr->handle > end_handle) {
+			return BT_GATT_ITER_STOP;
+		}
+
+		if (func(attr, user_data) == BT_GATT_ITER_STOP) {
+			return BT_GATT_ITER_STOP;
+		}
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+void bt_gatt_foreach_attr(u16_t start_handle, u16_t end_handle,
+			  bt_gatt_attr_func_t func, void *user_data)
+{
+	struct bt_gatt_service *svc;
+	int i;
+
+	if (db_index_len < 0) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&db, svc, node) {
+			if (gatt_foreach_service_attr(svc, start_handle,
+						      end_handle, func,
+						      user_data) ==
+			    BT_GATT_ITER_STOP) {
 				return;
 			}
 		}
+
+		return;
+	}
+
+	for (i = gatt_service_find(start_handle); i < db_index_len; i++) {
+		if (gatt_foreach_service_attr(db_index[i], start_handle,
+					      end_handle, func, user_data) ==
+		    BT_GATT_ITER_STOP) {
+			return;
+		}
 	}
 }
 
@@ -548,6 +647,34 @@ static void gatt_ccc_changed(const struct bt_gatt_attr *attr,
 	}
 }
 
+/* Keep cfg in the subscriber list of conn while its value is set */
+static void gatt_ccc_sub_update(struct bt_conn *conn,
+				const struct bt_gatt_attr *attr,
+				struct bt_gatt_ccc_cfg *cfg)
+{
+	if (cfg->conn) {
+		sys_slist_find_and_remove(&cfg->conn->le.ccc_subs, &cfg->node);
+		cfg->conn = NULL;
+	}
+
+	if (cfg->value) {
+		cfg->conn = conn;
+		cfg->attr = attr;
+		sys_slist_append(&conn->le.ccc_subs, &cfg->node);
+	}
+}
+
+static void gatt_ccc_subs_clear(struct bt_conn *conn)
+{
+	struct bt_gatt_ccc_cfg *cfg;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&conn->le.ccc_subs, cfg, node) {
+		cfg->conn = NULL;
+	}
+
+	sys_slist_init(&conn->le.ccc_subs);
+}
+
 ssize_t bt_gatt_attr_write_ccc(struct bt_conn *conn,
 			       const struct bt_gatt_attr *attr, const void *buf,
 			       u16_t len, u16_t offset, u8_t flags)
@@ -599,6 +726,7 @@ ssize_t bt_gatt_attr_write_ccc(struct bt_conn *conn,
 	}
 
 	ccc->cfg[i].value = value;
+	gatt_ccc_sub_update(conn, attr, &ccc->cfg[i]);
 
 	BT_DBG("handle 0x%04x value %u", attr->handle, ccc->cfg[i].value);
 
@@ -801,7 +929,8 @@ static u8_t notify_cb(const struct bt_gatt_attr *attr, void *user_data)
 			continue;
 		}
 
-		conn = bt_conn_lookup_addr_le(&ccc->cfg[i].peer);
+		/* Set while the peer is connected */
+		conn = ccc->cfg[i].conn;
 		if (!conn) {
 #if GATT_OPEN_BASE_SERVICE
 			if (ccc->cfg == sc_ccc_cfg) {
@@ -812,10 +941,10 @@ static u8_t notify_cb(const struct bt_gatt_attr *attr, void *user_data)
 		}
 
 		if (conn->state != BT_CONN_CONNECTED) {
-			bt_conn_unref(conn);
 			continue;
 		}
 
+		bt_conn_ref(conn);
 		if (data->type == BT_GATT_CCC_INDICATE) {
 			err = gatt_indicate(conn, data->params);
 		} else {
@@ -930,6 +1059,7 @@ static u8_t connected_cb(const struct bt_gatt_attr *attr, void *user_data)
 		}
 
 		if (ccc->cfg[i].value) {
+			gatt_ccc_sub_update(conn, attr, &ccc->cfg[i]);
 			gatt_ccc_changed(attr, ccc);
 #if GATT_OPEN_BASE_SERVICE
 			if (ccc->cfg == sc_ccc_cfg) {
@@ -968,17 +1098,11 @@ static u8_t disconnected_cb(const struct bt_gatt_attr *attr, void *user_data)
 		}
 
 		if (bt_conn_addr_le_cmp(conn, &ccc->cfg[i].peer)) {
-			struct bt_conn *tmp;
+			struct bt_conn *tmp = ccc->cfg[i].conn;
 
 			/* Skip if there is another peer connected */
-			tmp = bt_conn_lookup_addr_le(&ccc->cfg[i].peer);
-			if (tmp) {
-				if (tmp->state == BT_CONN_CONNECTED) {
-					bt_conn_unref(tmp);
-					return BT_GATT_ITER_CONTINUE;
-				}
-
-				bt_conn_unref(tmp);
+			if (tmp && tmp->state == BT_CONN_CONNECTED) {
+				return BT_GATT_ITER_CONTINUE;
 			}
 		} else {
 			/* Clear value if not paired */
@@ -2384,6 +2508,7 @@ void bt_gatt_connected(struct bt_conn *conn)
 void bt_gatt_disconnected(struct bt_conn *conn)
 {
 	BT_DBG("conn %p", conn);
+	gatt_ccc_subs_clear(conn);
 	bt_gatt_foreach_attr(0x0001, 0xffff, disconnected_cb, conn);
 
 #if defined(CONFIG_BT_GATT_CLIENT)
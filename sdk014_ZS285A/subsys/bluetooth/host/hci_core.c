@@ -4919,7 +4919,7 @@ struct net_buf *bt_buf_get_rx_len(enum bt_buf_type type, s32_t timeout, int len)
 {
 	struct net_buf *buf;
 	u16_t alloc_len;
-	u16_t rx_max_len = L2CAP_BR_MAX_MTU_A2DP + BT_HCI_ACL_HDR_SIZE + BT_L2CAP_HDR_SIZE;
+	u16_t rx_max_len = BT_BUF_RX_MAX_LEN;
 
 	if (len > rx_max_len) {
 		BT_ERR("Too length %d(%d)\n", len, rx_max_len);
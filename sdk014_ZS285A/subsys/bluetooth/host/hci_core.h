@@ -16,6 +16,10 @@
 #define LMP_FEAT_PAGES_COUNT	1
 #endif
 
+/* largest ACL packet bt_buf_get_rx_len() takes, ACL header included */
+#define BT_BUF_RX_MAX_LEN	(L2CAP_BR_MAX_MTU_A2DP + BT_HCI_ACL_HDR_SIZE + \
+				 BT_L2CAP_HDR_SIZE)
+
 /* k_poll event tags */
 enum {
 	BT_EVENT_CMD_TX,
@@ -446,7 +446,8 @@ static u8_t app_key_set(u16_t net_idx, u16_t app_idx, const u8_t val[16],
 		keys = &key->keys[0];
 	}
 
-	if (bt_mesh_app_id(val, &keys->id)) {
+	if (bt_mesh_app_id(val, &keys->id) ||
+	    bt_mesh_aes_key_sched(val, &keys->sched)) {
 		if (update) {
 			key->updated = false;
 		}
@@ -2070,6 +2071,7 @@ static void net_key_del(struct bt_mesh_model *model,
 
 	memset(sub, 0, sizeof(*sub));
 	sub->net_idx = BT_MESH_KEY_UNUSED;
+	bt_mesh_net_nid_index_invalidate();
 
 	status = STATUS_SUCCESS;
 
@@ -2415,6 +2417,8 @@ static void node_reset(struct bt_mesh_model *model,
 		sub->net_idx = BT_MESH_KEY_UNUSED;
 	}
 
+	bt_mesh_net_nid_index_invalidate();
+
 	memset(labels, 0, sizeof(labels));
 
 	bt_mesh_reset();
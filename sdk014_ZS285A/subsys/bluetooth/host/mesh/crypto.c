@@ -201,155 +201,155 @@ int bt_mesh_id128(const u8_t n[16], const char *s, u8_t out[16])
 	return bt_mesh_k1(n, 16, salt, id128, out);
 }
 
-static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
-			       const u8_t *enc_msg, size_t msg_len,
-			       const u8_t *aad, size_t aad_len,
-			       u8_t *out_msg, size_t mic_size)
+int bt_mesh_aes_key_sched(const u8_t key[16],
+			  struct tc_aes_key_sched_struct *sched)
 {
-	u8_t msg[16], pmsg[16], cmic[16], cmsg[16], Xn[16], mic[16];
-	u16_t last_blk, blk_cnt;
-	size_t i, j;
-	int err;
-
-	if (msg_len < 1 || aad_len >= 0xff00) {
-		return -EINVAL;
+	if (tc_aes128_set_encrypt_key(sched, key) == TC_CRYPTO_FAIL) {
+		return -EIO;
 	}
 
-	/* C_mic = e(AppKey, 0x01 || nonce || 0x0000) */
-	pmsg[0] = 0x01;
-	memcpy(pmsg + 1, nonce, 13);
-	sys_put_be16(0x0000, pmsg + 14);
+	return 0;
+}
 
-	err = bt_encrypt_be(key, pmsg, cmic);
-	if (err) {
-		return err;
+static int ccm_aes(const struct tc_aes_key_sched_struct *sched,
+		   const u8_t in[16], u8_t out[16])
+{
+	/* the schedule is only read by tinycrypt */
+	if (tc_aes_encrypt(out, in, (TCAesKeySched_t)sched) == TC_CRYPTO_FAIL) {
+		return -EIO;
 	}
 
-	/* X_0 = e(AppKey, 0x09 || nonce || length) */
+	return 0;
+}
+
+/* X_0 = e(AppKey, 0x09 || nonce || length), then the AAD blocks */
+static int ccm_auth_start(const struct tc_aes_key_sched_struct *sched,
+			  const u8_t nonce[13], size_t msg_len,
+			  const u8_t *aad, size_t aad_len, size_t mic_size,
+			  u8_t Xn[16])
+{
+	size_t i, j;
+	int err;
+
 	if (mic_size == sizeof(u64_t)) {
-		pmsg[0] = 0x19 | (aad_len ? 0x40 : 0x00);
+		Xn[0] = 0x19 | (aad_len ? 0x40 : 0x00);
 	} else {
-		pmsg[0] = 0x09 | (aad_len ? 0x40 : 0x00);
+		Xn[0] = 0x09 | (aad_len ? 0x40 : 0x00);
 	}
 
-	memcpy(pmsg + 1, nonce, 13);
-	sys_put_be16(msg_len, pmsg + 14);
+	memcpy(Xn + 1, nonce, 13);
+	sys_put_be16(msg_len, Xn + 14);
 
-	err = bt_encrypt_be(key, pmsg, Xn);
-	if (err) {
+	err = ccm_aes(sched, Xn, Xn);
+	if (err || !aad_len) {
 		return err;
 	}
 
 	/* If AAD is being used to authenticate, include it here */
-	if (aad_len) {
-		sys_put_be16(aad_len, pmsg);
-
-		for (i = 0; i < sizeof(u16_t); i++) {
-			pmsg[i] = Xn[i] ^ pmsg[i];
-		}
+	Xn[0] ^= aad_len >> 8;
+	Xn[1] ^= aad_len & 0xff;
 
-		j = 0;
-		aad_len += sizeof(u16_t);
-		while (aad_len > 16) {
-			do {
-				pmsg[i] = Xn[i] ^ aad[j];
-				i++, j++;
-			} while (i < 16);
-
-			aad_len -= 16;
-			i = 0;
-
-			err = bt_encrypt_be(key, pmsg, Xn);
+	for (i = 2, j = 0; j < aad_len; j++) {
+		Xn[i++] ^= aad[j];
+		if (i == 16) {
+			err = ccm_aes(sched, Xn, Xn);
 			if (err) {
 				return err;
 			}
-		}
-
-		for (i = 0; i < aad_len; i++, j++) {
-			pmsg[i] = Xn[i] ^ aad[j];
-		}
 
-		for (i = aad_len; i < 16; i++) {
-			pmsg[i] = Xn[i];
+			i = 0;
 		}
+	}
 
-		err = bt_encrypt_be(key, pmsg, Xn);
-		if (err) {
-			return err;
-		}
+	if (i) {
+		err = ccm_aes(sched, Xn, Xn);
 	}
 
-	last_blk = msg_len % 16;
-	blk_cnt = (msg_len + 15) / 16;
-	if (!last_blk) {
-		last_blk = 16;
+	return err;
+}
+
+/* Counter mode and CBC-MAC over the payload in one pass. The MAC is
+ * always taken over the plaintext, which is the input when encrypting
+ * and the output when decrypting. in and out may be the same buffer.
+ */
+static int ccm_crypt(const struct tc_aes_key_sched_struct *sched,
+		     const u8_t nonce[13], const u8_t *in, size_t len,
+		     u8_t *out, bool encrypt, u8_t Xn[16], u8_t cmic[16])
+{
+	u8_t ctr[16], cmsg[16];
+	size_t i, blk_len;
+	u16_t j;
+	int err;
+
+	/* C_j = e(AppKey, 0x01 || nonce || j) */
+	ctr[0] = 0x01;
+	memcpy(ctr + 1, nonce, 13);
+	sys_put_be16(0x0000, ctr + 14);
+
+	err = ccm_aes(sched, ctr, cmic);
+	if (err) {
+		return err;
 	}
 
-	for (j = 0; j < blk_cnt; j++) {
-		if (j + 1 == blk_cnt) {
-			/* C_1 = e(AppKey, 0x01 || nonce || 0x0001) */
-			pmsg[0] = 0x01;
-			memcpy(pmsg + 1, nonce, 13);
-			sys_put_be16(j + 1, pmsg + 14);
+	for (j = 1; len; j++) {
+		blk_len = min(len, 16);
 
-			err = bt_encrypt_be(key, pmsg, cmsg);
-			if (err) {
-				return err;
-			}
+		sys_put_be16(j, ctr + 14);
 
-			/* Encrypted = Payload[0-15] ^ C_1 */
-			for (i = 0; i < last_blk; i++) {
-				msg[i] = enc_msg[(j * 16) + i] ^ cmsg[i];
-			}
+		err = ccm_aes(sched, ctr, cmsg);
+		if (err) {
+			return err;
+		}
 
-			memcpy(out_msg + (j * 16), msg, last_blk);
+		for (i = 0; i < blk_len; i++) {
+			u8_t c = in[i] ^ cmsg[i];
 
-			/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
-			for (i = 0; i < last_blk; i++) {
-				pmsg[i] = Xn[i] ^ msg[i];
-			}
+			Xn[i] ^= encrypt ? in[i] : c;
+			out[i] = c;
+		}
 
-			for (i = last_blk; i < 16; i++) {
-				pmsg[i] = Xn[i] ^ 0x00;
-			}
+		/* X_j = e(AppKey, X_j-1 ^ Payload) */
+		err = ccm_aes(sched, Xn, Xn);
+		if (err) {
+			return err;
+		}
 
-			err = bt_encrypt_be(key, pmsg, Xn);
-			if (err) {
-				return err;
-			}
+		in += blk_len;
+		out += blk_len;
+		len -= blk_len;
+	}
 
-			/* MIC = C_mic ^ X_1 */
-			for (i = 0; i < sizeof(mic); i++) {
-				mic[i] = cmic[i] ^ Xn[i];
-			}
-		} else {
-			/* C_1 = e(AppKey, 0x01 || nonce || 0x0001) */
-			pmsg[0] = 0x01;
-			memcpy(pmsg + 1, nonce, 13);
-			sys_put_be16(j + 1, pmsg + 14);
+	/* MIC = C_mic ^ X_n */
+	for (i = 0; i < 16; i++) {
+		cmic[i] ^= Xn[i];
+	}
 
-			err = bt_encrypt_be(key, pmsg, cmsg);
-			if (err) {
-				return err;
-			}
+	return 0;
+}
 
-			/* Encrypted = Payload[0-15] ^ C_1 */
-			for (i = 0; i < 16; i++) {
-				msg[i] = enc_msg[(j * 16) + i] ^ cmsg[i];
-			}
+static int bt_mesh_ccm_decrypt(const struct tc_aes_key_sched_struct *sched,
+			       const u8_t nonce[13],
+			       const u8_t *enc_msg, size_t msg_len,
+			       const u8_t *aad, size_t aad_len,
+			       u8_t *out_msg, size_t mic_size)
+{
+	u8_t Xn[16], mic[16];
+	int err;
 
-			memcpy(out_msg + (j * 16), msg, 16);
+	if (msg_len < 1 || aad_len >= 0xff00) {
+		return -EINVAL;
+	}
 
-			/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
-			for (i = 0; i < 16; i++) {
-				pmsg[i] = Xn[i] ^ msg[i];
-			}
+	err = ccm_auth_start(sched, nonce, msg_len, aad, aad_len, mic_size,
+			     Xn);
+	if (err) {
+		return err;
+	}
 
-			err = bt_encrypt_be(key, pmsg, Xn);
-			if (err) {
-				return err;
-			}
-		}
+	err = ccm_crypt(sched, nonce, enc_msg, msg_len, out_msg, false, Xn,
+			mic);
+	if (err) {
+		return err;
 	}
 
 	if (memcmp(mic, enc_msg + msg_len, mic_size)) {
@@ -359,17 +359,15 @@ static int bt_mesh_ccm_decrypt(const u8_t key[16], u8_t nonce[13],
 	return 0;
 }
 
-static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
+static int bt_mesh_ccm_encrypt(const struct tc_aes_key_sched_struct *sched,
+			       const u8_t nonce[13],
 			       const u8_t *msg, size_t msg_len,
 			       const u8_t *aad, size_t aad_len,
 			       u8_t *out_msg, size_t mic_size)
 {
-	u8_t pmsg[16], cmic[16], cmsg[16], mic[16], Xn[16];
-	u16_t blk_cnt, last_blk;
-	size_t i, j;
+	u8_t Xn[16], mic[16];
 	int err;
 
-	BT_DBG("key %s", bt_hex(key, 16));
 	BT_DBG("nonce %s", bt_hex(nonce, 13));
 	BT_DBG("msg (len %zu) %s", msg_len, bt_hex(msg, msg_len));
 	BT_DBG("aad_len %zu mic_size %zu", aad_len, mic_size);
@@ -379,141 +377,17 @@ static int bt_mesh_ccm_encrypt(const u8_t key[16], u8_t nonce[13],
 		return -EINVAL;
 	}
 
-	/* C_mic = e(AppKey, 0x01 || nonce || 0x0000) */
-	pmsg[0] = 0x01;
-	memcpy(pmsg + 1, nonce, 13);
-	sys_put_be16(0x0000, pmsg + 14);
-
-	err = bt_encrypt_be(key, pmsg, cmic);
+	err = ccm_auth_start(sched, nonce, msg_len, aad, aad_len, mic_size,
+			     Xn);
 	if (err) {
 		return err;
 	}
 
-	/* X_0 = e(AppKey, 0x09 || nonce || length) */
-	if (mic_size == sizeof(u64_t)) {
-		pmsg[0] = 0x19 | (aad_len ? 0x40 : 0x00);
-	} else {
-		pmsg[0] = 0x09 | (aad_len ? 0x40 : 0x00);
-	}
-
-	memcpy(pmsg + 1, nonce, 13);
-	sys_put_be16(msg_len, pmsg + 14);
-
-	err = bt_encrypt_be(key, pmsg, Xn);
+	err = ccm_crypt(sched, nonce, msg, msg_len, out_msg, true, Xn, mic);
 	if (err) {
 		return err;
 	}
 
-	/* If AAD is being used to authenticate, include it here */
-	if (aad_len) {
-		sys_put_be16(aad_len, pmsg);
-
-		for (i = 0; i < sizeof(u16_t); i++) {
-			pmsg[i] = Xn[i] ^ pmsg[i];
-		}
-
-		j = 0;
-		aad_len += sizeof(u16_t);
-		while (aad_len > 16) {
-			do {
-				pmsg[i] = Xn[i] ^ aad[j];
-				i++, j++;
-			} while (i < 16);
-
-			aad_len -= 16;
-			i = 0;
-
-			err = bt_encrypt_be(key, pmsg, Xn);
-			if (err) {
-				return err;
-			}
-		}
-
-		for (i = 0; i < aad_len; i++, j++) {
-			pmsg[i] = Xn[i] ^ aad[j];
-		}
-
-		for (i = aad_len; i < 16; i++) {
-			pmsg[i] = Xn[i];
-		}
-
-		err = bt_encrypt_be(key, pmsg, Xn);
-		if (err) {
-			return err;
-		}
-	}
-
-	last_blk = msg_len % 16;
-	blk_cnt = (msg_len + 15) / 16;
-	if (!last_blk) {
-		last_blk = 16;
-	}
-
-	for (j = 0; j < blk_cnt; j++) {
-		if (j + 1 == blk_cnt) {
-			/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
-			for (i = 0; i < last_blk; i++) {
-				pmsg[i] = Xn[i] ^ msg[(j * 16) + i];
-			}
-			for (i = last_blk; i < 16; i++) {
-				pmsg[i] = Xn[i] ^ 0x00;
-			}
-
-			err = bt_encrypt_be(key, pmsg, Xn);
-			if (err) {
-				return err;
-			}
-
-			/* MIC = C_mic ^ X_1 */
-			for (i = 0; i < sizeof(mic); i++) {
-				mic[i] = cmic[i] ^ Xn[i];
-			}
-
-			/* C_1 = e(AppKey, 0x01 || nonce || 0x0001) */
-			pmsg[0] = 0x01;
-			memcpy(pmsg + 1, nonce, 13);
-			sys_put_be16(j + 1, pmsg + 14);
-
-			err = bt_encrypt_be(key, pmsg, cmsg);
-			if (err) {
-				return err;
-			}
-
-			/* Encrypted = Payload[0-15] ^ C_1 */
-			for (i = 0; i < last_blk; i++) {
-				out_msg[(j * 16) + i] =
-					msg[(j * 16) + i] ^ cmsg[i];
-			}
-		} else {
-			/* X_1 = e(AppKey, X_0 ^ Payload[0-15]) */
-			for (i = 0; i < 16; i++) {
-				pmsg[i] = Xn[i] ^ msg[(j * 16) + i];
-			}
-
-			err = bt_encrypt_be(key, pmsg, Xn);
-			if (err) {
-				return err;
-			}
-
-			/* C_1 = e(AppKey, 0x01 || nonce || 0x0001) */
-			pmsg[0] = 0x01;
-			memcpy(pmsg + 1, nonce, 13);
-			sys_put_be16(j + 1, pmsg + 14);
-
-			err = bt_encrypt_be(key, pmsg, cmsg);
-			if (err) {
-				return err;
-			}
-
-			/* Encrypted = Payload[0-15] ^ C_N */
-			for (i = 0; i < 16; i++) {
-				out_msg[(j * 16) + i] =
-					msg[(j * 16) + i] ^ cmsg[i];
-			}
-
-		}
-	}
-
 	memcpy(out_msg + msg_len, mic, mic_size);
 
 	return 0;
@@ -574,20 +448,20 @@ static void create_net_nonce(u8_t nonce[13], const u8_t *pdu,
 }
 
 int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
-			  const u8_t privacy_key[16])
+			  const struct tc_aes_key_sched_struct *privacy_key)
 {
 	u8_t priv_rand[16] = { 0x00, 0x00, 0x00, 0x00, 0x00, };
 	u8_t tmp[16];
 	int err, i;
 
-	BT_DBG("IVIndex %u, PrivacyKey %s", iv_index, bt_hex(privacy_key, 16));
+	BT_DBG("IVIndex %u", iv_index);
 
 	sys_put_be32(iv_index, &priv_rand[5]);
 	memcpy(&priv_rand[9], &pdu[7], 7);
 
 	BT_DBG("PrivacyRandom %s", bt_hex(priv_rand, 16));
 
-	err = bt_encrypt_be(privacy_key, priv_rand, tmp);
+	err = ccm_aes(privacy_key, priv_rand, tmp);
 	if (err) {
 		return err;
 	}
@@ -599,15 +473,14 @@ int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
 	return 0;
 }
 
-int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
-			u32_t iv_index, bool proxy)
+int bt_mesh_net_encrypt(const struct tc_aes_key_sched_struct *key,
+			struct net_buf_simple *buf, u32_t iv_index, bool proxy)
 {
 	u8_t mic_len = NET_MIC_LEN(buf->data);
 	u8_t nonce[13];
 	int err;
 
-	BT_DBG("IVIndex %u EncKey %s mic_len %u", iv_index, bt_hex(key, 16),
-	       mic_len);
+	BT_DBG("IVIndex %u mic_len %u", iv_index, mic_len);
 	BT_DBG("PDU (len %u) %s", buf->len, bt_hex(buf->data, buf->len));
 
 #if defined(CONFIG_BT_MESH_PROXY)
@@ -631,15 +504,14 @@ int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
 	return err;
 }
 
-int bt_mesh_net_decrypt(const u8_t key[16], struct net_buf_simple *buf,
-			u32_t iv_index, bool proxy)
+int bt_mesh_net_decrypt(const struct tc_aes_key_sched_struct *key,
+			struct net_buf_simple *buf, u32_t iv_index, bool proxy)
 {
 	u8_t mic_len = NET_MIC_LEN(buf->data);
 	u8_t nonce[13];
 
 	BT_DBG("PDU (%u bytes) %s", buf->len, bt_hex(buf->data, buf->len));
-	BT_DBG("iv_index %u, key %s mic_len %u", iv_index, bt_hex(key, 16),
-	       mic_len);
+	BT_DBG("iv_index %u, mic_len %u", iv_index, mic_len);
 
 #if defined(CONFIG_BT_MESH_PROXY)
 	if (proxy) {
@@ -677,7 +549,8 @@ static void create_app_nonce(u8_t nonce[13], bool dev_key, u8_t aszmic,
 	sys_put_be32(iv_index, &nonce[9]);
 }
 
-int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_encrypt(const struct tc_aes_key_sched_struct *key,
+			bool dev_key, u8_t aszmic,
 			struct net_buf_simple *buf, const u8_t *ad,
 			u8_t mic_len, u16_t src, u16_t dst,
 			u32_t seq_num, u32_t iv_index)
@@ -685,7 +558,6 @@ int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
 	u8_t nonce[13];
 	int err;
 
-	BT_DBG("AppKey %s", bt_hex(key, 16));
 	BT_DBG("dev_key %u mic_len %u src 0x%04x dst 0x%04x", dev_key,
 	       mic_len, src, dst);
 	BT_DBG("seq_num 0x%08x iv_index 0x%08x", seq_num, iv_index);
@@ -705,7 +577,8 @@ int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
 	return err;
 }
 
-int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_decrypt(const struct tc_aes_key_sched_struct *key,
+			bool dev_key, u8_t aszmic,
 			struct net_buf_simple *buf, u8_t mic_len,
 			struct net_buf_simple *out, const u8_t *ad,
 			u16_t src, u16_t dst, u32_t seq_num,
@@ -718,7 +591,6 @@ int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
 
 	create_app_nonce(nonce, dev_key, aszmic, src, dst, seq_num, iv_index);
 
-	BT_DBG("AppKey %s", bt_hex(key, 16));
 	BT_DBG("Nonce  %s", bt_hex(nonce, 13));
 
 	err = bt_mesh_ccm_decrypt(key, nonce, buf->data, buf->len, ad,
@@ -848,7 +720,15 @@ int bt_mesh_prov_conf(const u8_t conf_key[16], const u8_t rand[16],
 int bt_mesh_prov_decrypt(const u8_t key[16], u8_t nonce[13],
 			 const u8_t data[25 + 8], u8_t out[25])
 {
-	return bt_mesh_ccm_decrypt(key, nonce, data, 25, NULL, 0, out, 8);
+	struct tc_aes_key_sched_struct sched;
+	int err;
+
+	err = bt_mesh_aes_key_sched(key, &sched);
+	if (err) {
+		return err;
+	}
+
+	return bt_mesh_ccm_decrypt(&sched, nonce, data, 25, NULL, 0, out, 8);
 }
 
 int bt_mesh_beacon_auth(const u8_t beacon_key[16], u8_t flags,
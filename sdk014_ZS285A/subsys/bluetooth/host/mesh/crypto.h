@@ -11,6 +11,8 @@ struct bt_mesh_sg {
 	size_t len;
 };
 
+struct tc_aes_key_sched_struct;
+
 int bt_mesh_aes_cmac(const u8_t key[16], struct bt_mesh_sg *sg,
 		     size_t sg_len, u8_t mac[16]);
 
@@ -118,21 +120,29 @@ static inline int bt_mesh_prov_salt(const u8_t conf_salt[16],
 	return bt_mesh_aes_cmac(prov_salt_key, sg, ARRAY_SIZE(sg), prov_salt);
 }
 
+/* Expands a key for the functions below. The network and application
+ * keys keep their schedule, so a PDU is processed without re-keying.
+ */
+int bt_mesh_aes_key_sched(const u8_t key[16],
+			  struct tc_aes_key_sched_struct *sched);
+
 int bt_mesh_net_obfuscate(u8_t *pdu, u32_t iv_index,
-			  const u8_t privacy_key[16]);
+			  const struct tc_aes_key_sched_struct *privacy_key);
 
-int bt_mesh_net_encrypt(const u8_t key[16], struct net_buf_simple *buf,
-			u32_t iv_index, bool proxy);
+int bt_mesh_net_encrypt(const struct tc_aes_key_sched_struct *key,
+			struct net_buf_simple *buf, u32_t iv_index, bool proxy);
 
-int bt_mesh_net_decrypt(const u8_t key[16], struct net_buf_simple *buf,
-			u32_t iv_index, bool proxy);
+int bt_mesh_net_decrypt(const struct tc_aes_key_sched_struct *key,
+			struct net_buf_simple *buf, u32_t iv_index, bool proxy);
 
-int bt_mesh_app_encrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_encrypt(const struct tc_aes_key_sched_struct *key,
+			bool dev_key, u8_t aszmic,
 			struct net_buf_simple *buf, const u8_t *ad,
 			u8_t mic_len, u16_t src, u16_t dst,
 			u32_t seq_num, u32_t iv_index);
 
-int bt_mesh_app_decrypt(const u8_t key[16], bool dev_key, u8_t aszmic,
+int bt_mesh_app_decrypt(const struct tc_aes_key_sched_struct *key,
+			bool dev_key, u8_t aszmic,
 			struct net_buf_simple *buf, u8_t mic_len,
 			struct net_buf_simple *out, const u8_t *ad,
 			u16_t src, u16_t dst, u32_t seq_num,
@@ -19,6 +19,7 @@
 #include "common/log.h"
 
 #include "test.h"
+#include "crypto.h"
 #include "adv.h"
 #include "prov.h"
 #include "net.h"
@@ -41,6 +42,11 @@ int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx,
 
 	BT_INFO("Primary Element: 0x%04x", addr);
 
+	err = bt_mesh_aes_key_sched(dev_key, &bt_mesh.dev_key_sched);
+	if (err) {
+		return err;
+	}
+
 	if (IS_ENABLED(CONFIG_BT_MESH_PB_GATT)) {
 		bt_mesh_proxy_prov_disable();
 	}
@@ -120,6 +126,7 @@ void bt_mesh_reset(void)
 	}
 
 	memset(bt_mesh.dev_key, 0, sizeof(bt_mesh.dev_key));
+	memset(&bt_mesh.dev_key_sched, 0, sizeof(bt_mesh.dev_key_sched));
 
 	memset(bt_mesh.rpl, 0, sizeof(bt_mesh.rpl));
 
@@ -63,8 +63,31 @@
 static struct bt_mesh_friend_cred friend_cred[FRIEND_CRED_COUNT];
 #endif
 
-static u64_t msg_cache[CONFIG_BT_MESH_MSG_CACHE_SIZE];
-static u16_t msg_cache_next;
+/* FIFO of recently seen values. The index is an open-addressed hash
+ * table, twice the FIFO size, holding FIFO position + 1 (0 if free), so
+ * a lookup does not scan the FIFO. The oldest value is still the one
+ * replaced.
+ */
+struct net_cache {
+	u64_t *val;
+	u16_t *idx;
+	u32_t  idx_size;
+	u16_t  size;
+	u16_t  next;
+	u16_t  len;
+};
+
+#define NET_CACHE_DEFINE(_name, _size)					\
+	static u64_t _name##_val[_size];				\
+	static u16_t _name##_idx[2 * (_size)];				\
+	static struct net_cache _name = {				\
+		.val = _name##_val,					\
+		.idx = _name##_idx,					\
+		.idx_size = 2 * (_size),				\
+		.size = (_size),					\
+	}
+
+NET_CACHE_DEFINE(msg_cache, CONFIG_BT_MESH_MSG_CACHE_SIZE);
 
 /* Singleton network context (the implementation only supports one) */
 struct bt_mesh_net bt_mesh = {
@@ -81,25 +104,106 @@ struct bt_mesh_net bt_mesh = {
 	},
 };
 
-static u32_t dup_cache[4];
-static int   dup_cache_next;
+NET_CACHE_DEFINE(dup_cache, 4);
+
+static u32_t net_cache_home(const struct net_cache *cache, u64_t val)
+{
+	u32_t h = (u32_t)val ^ (u32_t)(val >> 32);
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+
+	return h % cache->idx_size;
+}
+
+static bool net_cache_has(const struct net_cache *cache, u64_t val)
+{
+	u32_t i = net_cache_home(cache, val);
+
+	while (cache->idx[i]) {
+		if (cache->val[cache->idx[i] - 1] == val) {
+			return true;
+		}
+
+		if (++i == cache->idx_size) {
+			i = 0;
+		}
+	}
+
+	return false;
+}
+
+/* Backward shift deletion, so that probing never needs tombstones */
+static void net_cache_idx_del(struct net_cache *cache, u16_t pos)
+{
+	u32_t i, j, home;
+
+	i = net_cache_home(cache, cache->val[pos]);
+	while (cache->idx[i] != pos + 1) {
+		if (++i == cache->idx_size) {
+			i = 0;
+		}
+	}
+
+	for (j = i;;) {
+		if (++j == cache->idx_size) {
+			j = 0;
+		}
+
+		if (!cache->idx[j]) {
+			break;
+		}
+
+		home = net_cache_home(cache, cache->val[cache->idx[j] - 1]);
+		if ((i <= j) ? (home <= i || home > j) :
+			       (home <= i && home > j)) {
+			cache->idx[i] = cache->idx[j];
+			i = j;
+		}
+	}
+
+	cache->idx[i] = 0;
+}
+
+static void net_cache_add(struct net_cache *cache, u64_t val)
+{
+	u32_t i;
+
+	if (cache->len == cache->size) {
+		net_cache_idx_del(cache, cache->next);
+	} else {
+		cache->len++;
+	}
+
+	cache->val[cache->next] = val;
+
+	i = net_cache_home(cache, val);
+	while (cache->idx[i]) {
+		if (++i == cache->idx_size) {
+			i = 0;
+		}
+	}
+
+	cache->idx[i] = cache->next + 1;
+
+	if (++cache->next == cache->size) {
+		cache->next = 0;
+	}
+}
 
 static bool check_dup(struct net_buf_simple *data)
 {
 	const u8_t *tail = net_buf_simple_tail(data);
 	u32_t val;
-	int i;
 
 	val = sys_get_be32(tail - 4) ^ sys_get_be32(tail - 8);
 
-	for (i = 0; i < ARRAY_SIZE(dup_cache); i++) {
-		if (dup_cache[i] == val) {
-			return true;
-		}
+	if (net_cache_has(&dup_cache, val)) {
+		return true;
 	}
 
-	dup_cache[dup_cache_next++] = val;
-	dup_cache_next %= ARRAY_SIZE(dup_cache);
+	net_cache_add(&dup_cache, val);
 
 	return false;
 }
@@ -122,21 +226,12 @@ static u64_t msg_hash(struct net_buf_simple *pdu)
 
 static void msg_cache_add(u64_t new_hash)
 {
-	msg_cache[msg_cache_next++] = new_hash;
-	msg_cache_next %= ARRAY_SIZE(msg_cache);
+	net_cache_add(&msg_cache, new_hash);
 }
 
 static bool msg_is_known(u64_t hash)
 {
-	u16_t i;
-
-	for (i = 0; i < ARRAY_SIZE(msg_cache); i++) {
-		if (msg_cache[i] == hash) {
-			return true;
-		}
-	}
-
-	return false;
+	return net_cache_has(&msg_cache, hash);
 }
 
 static inline u32_t net_seq(struct net_buf_simple *buf)
@@ -163,6 +258,32 @@ struct bt_mesh_subnet *bt_mesh_subnet_get(u16_t net_idx)
 	return NULL;
 }
 
+/* EncKey and PrivacyKey are only kept expanded, so that a PDU is
+ * obfuscated and encrypted without setting up the AES key again.
+ */
+static int net_k2(const u8_t net_key[16], const u8_t *p, size_t p_len,
+		  u8_t *nid, struct tc_aes_key_sched_struct *enc,
+		  struct tc_aes_key_sched_struct *privacy)
+{
+	u8_t enc_key[16], privacy_key[16];
+	int err;
+
+	err = bt_mesh_k2(net_key, p, p_len, nid, enc_key, privacy_key);
+	if (err) {
+		return err;
+	}
+
+	BT_DBG("NID 0x%02x EncKey %s", *nid, bt_hex(enc_key, 16));
+	BT_DBG("PrivacyKey %s", bt_hex(privacy_key, 16));
+
+	err = bt_mesh_aes_key_sched(enc_key, enc);
+	if (err) {
+		return err;
+	}
+
+	return bt_mesh_aes_key_sched(privacy_key, privacy);
+}
+
 int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
 			    const u8_t key[16])
 {
@@ -170,7 +291,9 @@ int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
 	u8_t nid;
 	int err;
 
-	err = bt_mesh_k2(key, p, sizeof(p), &nid, keys->enc, keys->privacy);
+	bt_mesh_net_nid_index_invalidate();
+
+	err = net_k2(key, p, sizeof(p), &nid, &keys->enc, &keys->privacy);
 	if (err) {
 		BT_ERR("Unable to generate NID, EncKey & PrivacyKey");
 		return err;
@@ -180,9 +303,6 @@ int bt_mesh_net_keys_create(struct bt_mesh_subnet_keys *keys,
 
 	keys->nid = nid;
 
-	BT_DBG("NID 0x%02x EncKey %s", keys->nid, bt_hex(keys->enc, 16));
-	BT_DBG("PrivacyKey %s", bt_hex(keys->privacy, 16));
-
 	err = bt_mesh_k3(key, keys->net_id);
 	if (err) {
 		BT_ERR("Unable to generate Net ID");
@@ -244,17 +364,15 @@ int bt_mesh_friend_cred_set(struct bt_mesh_friend_cred *cred, u8_t idx,
 	sys_put_be16(cred->lpn_counter, p + 5);
 	sys_put_be16(cred->frnd_counter, p + 7);
 
-	err = bt_mesh_k2(net_key, p, sizeof(p), &cred->cred[idx].nid,
-			 cred->cred[idx].enc, cred->cred[idx].privacy);
+	bt_mesh_net_nid_index_invalidate();
+
+	err = net_k2(net_key, p, sizeof(p), &cred->cred[idx].nid,
+		     &cred->cred[idx].enc, &cred->cred[idx].privacy);
 	if (err) {
 		BT_ERR("Unable to generate NID, EncKey & PrivacyKey");
 		return err;
 	}
 
-	BT_DBG("Friend NID 0x%02x EncKey %s", cred->cred[idx].nid,
-	       bt_hex(cred->cred[idx].enc, 16));
-	BT_DBG("Friend PrivacyKey %s", bt_hex(cred->cred[idx].privacy, 16));
-
 	return 0;
 }
 
@@ -271,6 +389,8 @@ void bt_mesh_friend_cred_refresh(u16_t net_idx)
 			       sizeof(cred->cred[0]));
 		}
 	}
+
+	bt_mesh_net_nid_index_invalidate();
 }
 
 int bt_mesh_friend_cred_update(u16_t net_idx, u8_t idx, const u8_t net_key[16])
@@ -339,6 +459,8 @@ void bt_mesh_friend_cred_clear(struct bt_mesh_friend_cred *cred)
 	cred->lpn_counter = 0;
 	cred->frnd_counter = 0;
 	memset(cred->cred, 0, sizeof(cred->cred));
+
+	bt_mesh_net_nid_index_invalidate();
 }
 
 int bt_mesh_friend_cred_del(u16_t net_idx, u16_t addr)
@@ -358,7 +480,9 @@ int bt_mesh_friend_cred_del(u16_t net_idx, u16_t addr)
 }
 
 static int friend_cred_get(u16_t net_idx, u16_t addr, u8_t idx,
-			   u8_t *nid, const u8_t **enc, const u8_t **priv)
+			   u8_t *nid,
+			   const struct tc_aes_key_sched_struct **enc,
+			   const struct tc_aes_key_sched_struct **priv)
 {
 	int i;
 
@@ -380,11 +504,11 @@ static int friend_cred_get(u16_t net_idx, u16_t addr, u8_t idx,
 		}
 
 		if (enc) {
-			*enc = cred->cred[idx].enc;
+			*enc = &cred->cred[idx].enc;
 		}
 
 		if (priv) {
-			*priv = cred->cred[idx].privacy;
+			*priv = &cred->cred[idx].privacy;
 		}
 
 		return 0;
@@ -394,8 +518,9 @@ static int friend_cred_get(u16_t net_idx, u16_t addr, u8_t idx,
 }
 #else
 static inline int friend_cred_get(u16_t net_idx, u16_t addr, u8_t idx,
-				  u8_t *nid, const u8_t **enc,
-				  const u8_t **priv)
+				  u8_t *nid,
+				  const struct tc_aes_key_sched_struct **enc,
+				  const struct tc_aes_key_sched_struct **priv)
 {
 	return -ENOENT;
 }
@@ -478,6 +603,7 @@ void bt_mesh_net_revoke_keys(struct bt_mesh_subnet *sub)
 	BT_DBG("idx 0x%04x", sub->net_idx);
 
 	memcpy(&sub->keys[0], &sub->keys[1], sizeof(sub->keys[0]));
+	bt_mesh_net_nid_index_invalidate();
 
 	for (i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
 		struct bt_mesh_app_key *key = &bt_mesh.app_keys[i];
@@ -642,7 +768,7 @@ do_update:
 int bt_mesh_net_resend(struct bt_mesh_subnet *sub, struct net_buf *buf,
 		       bool new_key, bool friend_cred, bt_mesh_adv_func_t cb)
 {
-	const u8_t *enc, *priv;
+	const struct tc_aes_key_sched_struct *enc, *priv;
 	int err;
 
 	BT_DBG("net_idx 0x%04x, len %u", sub->net_idx, buf->len);
@@ -654,8 +780,8 @@ int bt_mesh_net_resend(struct bt_mesh_subnet *sub, struct net_buf *buf,
 			return err;
 		}
 	} else {
-		enc = sub->keys[new_key].enc;
-		priv = sub->keys[new_key].privacy;
+		enc = &sub->keys[new_key].enc;
+		priv = &sub->keys[new_key].privacy;
 	}
 
 	err = bt_mesh_net_obfuscate(buf->data, BT_MESH_NET_IVI_TX, priv);
@@ -713,7 +839,7 @@ int bt_mesh_net_encode(struct bt_mesh_net_tx *tx, struct net_buf_simple *buf,
 {
 	const bool ctl = (tx->ctx->app_idx == BT_MESH_KEY_UNUSED);
 	u8_t nid;
-	const u8_t *enc, *priv;
+	const struct tc_aes_key_sched_struct *enc, *priv;
 	u8_t *seq;
 	int err;
 
@@ -752,8 +878,8 @@ int bt_mesh_net_encode(struct bt_mesh_net_tx *tx, struct net_buf_simple *buf,
 			}
 		} else {
 			nid = tx->sub->keys[1].nid;
-			enc = tx->sub->keys[1].enc;
-			priv = tx->sub->keys[1].privacy;
+			enc = &tx->sub->keys[1].enc;
+			priv = &tx->sub->keys[1].privacy;
 		}
 	} else {
 		if (tx->ctx->friend_cred) {
@@ -765,8 +891,8 @@ int bt_mesh_net_encode(struct bt_mesh_net_tx *tx, struct net_buf_simple *buf,
 			}
 		} else {
 			nid = tx->sub->keys[0].nid;
-			enc = tx->sub->keys[0].enc;
-			priv = tx->sub->keys[0].privacy;
+			enc = &tx->sub->keys[0].enc;
+			priv = &tx->sub->keys[0].privacy;
 		}
 	}
 
@@ -889,19 +1015,112 @@ struct bt_mesh_subnet *bt_mesh_subnet_find(const u8_t net_id[8], u8_t flags,
 	return NULL;
 }
 
+/* Subnet keys, and friendship credentials with another NID, that can
+ * decrypt a PDU, sorted by NID. Rebuilt on first use after any change
+ * to the subnets, their keys or the friendship credentials.
+ */
+#if FRIEND_CRED_COUNT > 0
+#define NID_INDEX_SIZE (4 * CONFIG_BT_MESH_SUBNET_COUNT)
+#else
+#define NID_INDEX_SIZE (2 * CONFIG_BT_MESH_SUBNET_COUNT)
+#endif
+
+static struct nid_entry {
+	u8_t nid;
+	u8_t idx;
+	struct bt_mesh_subnet *sub;
+} nid_index[NID_INDEX_SIZE];
+static u16_t nid_index_len;
+static bool nid_index_valid;
+
+void bt_mesh_net_nid_index_invalidate(void)
+{
+	nid_index_valid = false;
+}
+
+static void nid_index_add(u8_t nid, struct bt_mesh_subnet *sub, u8_t idx)
+{
+	u16_t i;
+
+	/* Equal NIDs keep subnet order, which is the order they are tried */
+	for (i = nid_index_len; i > 0 && nid_index[i - 1].nid > nid; i--) {
+		nid_index[i] = nid_index[i - 1];
+	}
+
+	nid_index[i].nid = nid;
+	nid_index[i].idx = idx;
+	nid_index[i].sub = sub;
+	nid_index_len++;
+}
+
+static void nid_index_build(void)
+{
+	int i;
+	u8_t idx, nid;
+
+	nid_index_len = 0;
+
+	for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
+		struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
+
+		if (sub->net_idx == BT_MESH_KEY_UNUSED) {
+			continue;
+		}
+
+		for (idx = 0; idx < 2; idx++) {
+			if (idx && sub->kr_phase == BT_MESH_KR_NORMAL) {
+				break;
+			}
+
+			nid_index_add(sub->keys[idx].nid, sub, idx);
+
+			if (!friend_cred_get(sub->net_idx,
+					     BT_MESH_ADDR_UNASSIGNED, idx,
+					     &nid, NULL, NULL) &&
+			    nid != sub->keys[idx].nid) {
+				nid_index_add(nid, sub, idx);
+			}
+		}
+	}
+
+	nid_index_valid = true;
+}
+
+static struct nid_entry *nid_index_find(u8_t nid)
+{
+	u16_t lo = 0, hi;
+
+	if (!nid_index_valid) {
+		nid_index_build();
+	}
+
+	hi = nid_index_len;
+	while (lo < hi) {
+		u16_t mid = (lo + hi) / 2;
+
+		if (nid_index[mid].nid < nid) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return &nid_index[lo];
+}
+
 static int net_decrypt(struct bt_mesh_subnet *sub, u8_t idx, const u8_t *data,
 		       size_t data_len, struct bt_mesh_net_rx *rx,
 		       struct net_buf_simple *buf)
 {
-	const u8_t *enc, *priv;
+	const struct tc_aes_key_sched_struct *enc, *priv;
 
 	BT_DBG("NID 0x%02x, PDU NID 0x%02x net_idx 0x%04x idx %u",
 	       sub->keys[idx].nid, NID(data), sub->net_idx, idx);
 
 	if (NID(data) == sub->keys[idx].nid) {
 		rx->ctx.friend_cred = false;
-		enc = sub->keys[idx].enc;
-		priv = sub->keys[idx].privacy;
+		enc = &sub->keys[idx].enc;
+		priv = &sub->keys[idx].privacy;
 		rx->ctx.friend_cred = 0;
 	} else {
 		u8_t nid;
@@ -954,34 +1173,19 @@ static int net_find_and_decrypt(const u8_t *data, size_t data_len,
 				struct bt_mesh_net_rx *rx,
 				struct net_buf_simple *buf)
 {
-	int i;
+	struct nid_entry *entry, *end;
 
 	BT_DBG("");
 
-	for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
-		struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
-		int err;
-
-		if (sub->net_idx == BT_MESH_KEY_UNUSED) {
-			continue;
-		}
-
-		err = net_decrypt(sub, 0, data, data_len, rx, buf);
-		if (!err) {
-			rx->ctx.net_idx = sub->net_idx;
-			rx->sub = sub;
-			return true;
-		}
-
-		if (sub->kr_phase == BT_MESH_KR_NORMAL) {
-			continue;
-		}
+	entry = nid_index_find(NID(data));
+	end = &nid_index[nid_index_len];
 
-		err = net_decrypt(sub, 1, data, data_len, rx, buf);
-		if (!err) {
-			rx->ctx.net_idx = sub->net_idx;
-			rx->sub = sub;
-			rx->new_key = 1;
+	for (; entry < end && entry->nid == NID(data); entry++) {
+		if (!net_decrypt(entry->sub, entry->idx, data, data_len, rx,
+				 buf)) {
+			rx->ctx.net_idx = entry->sub->net_idx;
+			rx->sub = entry->sub;
+			rx->new_key = entry->idx;
 			return true;
 		}
 	}
@@ -992,7 +1196,7 @@ static int net_find_and_decrypt(const u8_t *data, size_t data_len,
 static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
 			      struct bt_mesh_net_rx *rx)
 {
-	const u8_t *enc, *priv;
+	const struct tc_aes_key_sched_struct *enc, *priv;
 	struct net_buf *buf;
 	u8_t nid, transmit;
 
@@ -1029,8 +1233,8 @@ static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
 				goto done;
 			}
 		} else {
-			enc = rx->sub->keys[1].enc;
-			priv = rx->sub->keys[1].privacy;
+			enc = &rx->sub->keys[1].enc;
+			priv = &rx->sub->keys[1].privacy;
 			nid = rx->sub->keys[1].nid;
 		}
 	} else {
@@ -1042,8 +1246,8 @@ static void bt_mesh_net_relay(struct net_buf_simple *sbuf,
 				goto done;
 			}
 		} else  {
-			enc = rx->sub->keys[0].enc;
-			priv = rx->sub->keys[0].privacy;
+			enc = &rx->sub->keys[0].enc;
+			priv = &rx->sub->keys[0].privacy;
 			nid = rx->sub->keys[0].nid;
 		}
 	}
@@ -6,6 +6,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <tinycrypt/aes.h>
+
 #define BT_MESH_NET_FLAG_KR       BIT(0)
 #define BT_MESH_NET_FLAG_IVU      BIT(1)
 
@@ -24,6 +26,7 @@ struct bt_mesh_app_key {
 	struct bt_mesh_app_keys {
 		u8_t id;
 		u8_t val[16];
+		struct tc_aes_key_sched_struct sched; /* val expanded */
 	} keys[2];
 };
 
@@ -37,8 +40,8 @@ struct bt_mesh_friend_cred {
 
 	struct {
 		u8_t nid;         /* NID */
-		u8_t enc[16];     /* EncKey */
-		u8_t privacy[16]; /* PrivacyKey */
+		struct tc_aes_key_sched_struct enc;     /* EncKey */
+		struct tc_aes_key_sched_struct privacy; /* PrivacyKey */
 	} cred[2];
 };
 
@@ -63,12 +66,12 @@ struct bt_mesh_subnet {
 	struct bt_mesh_subnet_keys {
 		u8_t net[16];       /* NetKey */
 		u8_t nid;           /* NID */
-		u8_t enc[16];       /* EncKey */
+		struct tc_aes_key_sched_struct enc; /* EncKey */
 		u8_t net_id[8];     /* Network ID */
 #if defined(CONFIG_BT_MESH_GATT_PROXY)
 		u8_t identity[16];  /* IdentityKey */
 #endif
-		u8_t privacy[16];   /* PrivacyKey */
+		struct tc_aes_key_sched_struct privacy; /* PrivacyKey */
 		u8_t beacon[16];    /* BeaconKey */
 	} keys[2];
 };
@@ -182,6 +185,7 @@ struct bt_mesh_net {
 	struct k_delayed_work ivu_complete;
 
 	u8_t dev_key[16];
+	struct tc_aes_key_sched_struct dev_key_sched;
 
 	struct bt_mesh_app_key app_keys[CONFIG_BT_MESH_APP_KEY_COUNT];
 
@@ -247,6 +251,9 @@ bool bt_mesh_kr_update(struct bt_mesh_subnet *sub, u8_t new_kr, bool new_key);
 
 void bt_mesh_net_revoke_keys(struct bt_mesh_subnet *sub);
 
+/* To be called when a subnet is added or deleted, or its keys change */
+void bt_mesh_net_nid_index_invalidate(void);
+
 int bt_mesh_net_beacon_update(struct bt_mesh_subnet *sub);
 
 void bt_mesh_rpl_reset(void);
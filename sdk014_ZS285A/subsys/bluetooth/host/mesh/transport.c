@@ -352,7 +352,7 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
 		       bt_mesh_cb_t cb, void *cb_data)
 {
 	bool seg = (msg->len > 11 || cb);
-	const u8_t *key;
+	const struct tc_aes_key_sched_struct *key;
 	u8_t mic_len, aid, aszmic;
 	u8_t *ad;
 	int err;
@@ -362,7 +362,7 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
 	BT_DBG("len %u: %s", msg->len, bt_hex(msg->data, msg->len));
 
 	if (tx->ctx->app_idx == BT_MESH_KEY_DEV) {
-		key = bt_mesh.dev_key;
+		key = &bt_mesh.dev_key_sched;
 		aid = 0;
 	} else {
 		struct bt_mesh_app_key *app_key;
@@ -374,10 +374,10 @@ int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, struct net_buf_simple *msg,
 
 		if (tx->sub->kr_phase == BT_MESH_KR_PHASE_2 &&
 		    app_key->updated) {
-			key = app_key->keys[1].val;
+			key = &app_key->keys[1].sched;
 			aid = app_key->keys[1].id;
 		} else {
-			key = app_key->keys[0].val;
+			key = &app_key->keys[0].sched;
 			aid = app_key->keys[0].id;
 		}
 	}
@@ -475,8 +475,8 @@ static int sdu_recv(struct bt_mesh_net_rx *rx, u8_t hdr, u8_t mic_size,
 
 	if (!AKF(&hdr)) {
 		net_buf_simple_init(sdu, 0);
-		err = bt_mesh_app_decrypt(bt_mesh.dev_key, true, aszmic, buf,
-					  mic_size, sdu, ad, rx->ctx.addr,
+		err = bt_mesh_app_decrypt(&bt_mesh.dev_key_sched, true, aszmic,
+					  buf, mic_size, sdu, ad, rx->ctx.addr,
 					  rx->dst, rx->seq,
 					  BT_MESH_NET_IVI_RX(rx));
 		if (err) {
@@ -510,7 +510,7 @@ static int sdu_recv(struct bt_mesh_net_rx *rx, u8_t hdr, u8_t mic_size,
 		}
 
 		net_buf_simple_init(sdu, 0);
-		err = bt_mesh_app_decrypt(keys->val, false, aszmic, buf,
+		err = bt_mesh_app_decrypt(&keys->sched, false, aszmic, buf,
 					  mic_size, sdu, ad, rx->ctx.addr,
 					  rx->dst, rx->seq,
 					  BT_MESH_NET_IVI_RX(rx));
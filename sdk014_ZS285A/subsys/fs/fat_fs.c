@@ -87,9 +87,56 @@ int fs_close(fs_file_t *zfp)
 
 	res = f_close(&zfp->fp);
 
+#if _USE_FASTSEEK
+	if (zfp->fp.cltbl) {
+		mem_free(zfp->fp.cltbl);
+		zfp->fp.cltbl = NULL;
+	}
+#endif
+
 	return translate_error(res);
 }
 
+int fs_extent_map(fs_file_t *zfp, int max_runs)
+{
+#if _USE_FASTSEEK
+	FRESULT res;
+	DWORD *tbl, *map;
+	/* size and terminator, then length and start cluster of each run */
+	int len = 2 + max_runs * 2;
+
+	if (zfp->fp.cltbl)
+		return (zfp->fp.cltbl[0] - 2) / 2;
+
+	tbl = mem_malloc(len * sizeof(DWORD));
+	if (!tbl)
+		return -ENOMEM;
+
+	tbl[0] = len;
+	zfp->fp.cltbl = tbl;
+	res = f_lseek(&zfp->fp, CREATE_LINKMAP);
+	zfp->fp.cltbl = NULL;
+	if (res != FR_OK) {
+		mem_free(tbl);
+		return translate_error(res);
+	}
+
+	/* keep only the used part */
+	len = tbl[0];
+	map = mem_malloc(len * sizeof(DWORD));
+	if (map) {
+		memcpy(map, tbl, len * sizeof(DWORD));
+		mem_free(tbl);
+		tbl = map;
+	}
+
+	zfp->fp.cltbl = tbl;
+	return (len - 2) / 2;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 int fs_unlink(const char *path)
 {
 	FRESULT res;
@@ -326,6 +373,47 @@ int fs_readdir(fs_dir_t *zdp, struct fs_dirent *entry)
 	return translate_error(res);
 }
 
+struct readdir_batch {
+	struct fs_dirent *entries;
+	struct fs_dirent_pos *pos;
+};
+
+static void readdir_n_entry(DIR *dp, FILINFO *fno, UINT idx, void *arg)
+{
+	struct readdir_batch *batch = arg;
+
+	batch->entries[idx].type = ((fno->fattrib & AM_DIR) ?
+				    FS_DIR_ENTRY_DIR : FS_DIR_ENTRY_FILE);
+	strcpy(batch->entries[idx].name, fno->fname);
+	batch->entries[idx].size = fno->fsize;
+	if (batch->pos) {
+		batch->pos[idx].clust = dp->clust;
+		batch->pos[idx].blk_ofs = dp->blk_ofs;
+	}
+}
+
+/* one f_readdir_n() call and one FILINFO for a batch of entries */
+int fs_readdir_n(fs_dir_t *zdp, struct fs_dirent *entries,
+		 struct fs_dirent_pos *pos, int num, int *err)
+{
+	struct readdir_batch batch = { entries, pos };
+	FRESULT res;
+	UINT cnt = 0;
+	FILINFO *fno = mem_malloc(sizeof(FILINFO));
+	if (!fno) {
+		*err = -ENOMEM;
+		return 0;
+	}
+
+	res = f_readdir_n(&zdp->dp, fno, num, &cnt, readdir_n_entry, &batch);
+
+	mem_free(fno);
+
+	/* entries read before an error are valid, return both */
+	*err = translate_error(res);
+	return cnt;
+}
+
 int fs_closedir(fs_dir_t *zdp)
 {
 	FRESULT res;
@@ -631,6 +631,75 @@ static int shell_cmd_threadblock(int argc, char *argv[])
 
 #endif
 
+#ifdef CONFIG_CPU_SCHED_HIST
+/* threads beyond this are left out of the dump */
+#define SCHED_HIST_DUMP_THREADS	32
+
+static int shell_cmd_schedhist_dump(int argc, char *argv[])
+{
+	void *buf;
+	int size, len;
+
+	size = sizeof(struct cpuload_hist_head) +
+		SCHED_HIST_DUMP_THREADS * sizeof(struct cpuload_hist_thread);
+
+	buf = mem_malloc(size);
+	if (!buf)
+		return -ENOMEM;
+
+	len = cpuload_hist_dump(buf, size);
+	if (len > 0) {
+#ifdef CONFIG_CMD_SAVE_MEM
+		if (argc > 2)
+			dbg_save_mem_to_file(buf, len, argv[2]);
+		else
+#endif
+			print_buffer(buf, 1, len, 16, 0);
+	}
+
+	mem_free(buf);
+
+	return 0;
+}
+
+/*
+ * cmd: schedhist
+ *   start
+ *   stop
+ *   show
+ *   dump [file]
+ */
+static int shell_cmd_schedhist(int argc, char *argv[])
+{
+	if (argc < 2) {
+		goto show_schedhist_usage;
+	}
+
+	if (!strncmp(argv[1], "start", sizeof("start"))) {
+		printk("Start cpu scheduling histogram\n");
+		cpuload_hist_start();
+	} else if (!strncmp(argv[1], "stop", sizeof("stop"))) {
+		printk("Stop cpu scheduling histogram\n");
+		cpuload_hist_stop();
+	} else if (!strncmp(argv[1], "show", sizeof("show"))) {
+		cpuload_hist_show();
+	} else if (!strncmp(argv[1], "dump", sizeof("dump"))) {
+		return shell_cmd_schedhist_dump(argc, argv);
+	} else {
+		show_schedhist_usage:
+		printk("usage:\n");
+		printk("  schedhist start\n");
+		printk("  schedhist stop\n");
+		printk("  schedhist show\n");
+		printk("  schedhist dump [file]\n");
+
+		return -EINVAL;
+	}
+
+	return 0;
+}
+#endif	/* CONFIG_CPU_SCHED_HIST */
+
 
 #if defined(CONFIG_SPICACHE_PROFILE)
 
@@ -1028,6 +1097,10 @@ const struct shell_cmd kernel_commands[] = {
     { "threadblock", shell_cmd_threadblock, "thread block time statistic" },
 #endif
 
+#if defined(CONFIG_CPU_SCHED_HIST)
+    { "schedhist", shell_cmd_schedhist, "thread run, ready latency and isr histogram" },
+#endif
+
 #if defined(CONFIG_MEMORY)
     { "meminfo", shell_cmd_printk_meminfo, "sdk heap memory statistic" },
 #endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Actions Semi Co., Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief Measure mem_malloc/mem_free with and without slab magazine
+ */
+
+#include <zephyr.h>
+#include <mem_manager.h>
+#include <tc_util.h>
+
+#define THREAD_NUM	3
+#define THREAD_PRIO	5
+#define STACK_SIZE	1024
+#define LOOP_NUM	2000
+#define LIVE_NUM	4
+
+static const u16_t alloc_size[] = { 12, 24, 48, 100, 24, 200, 12, 60 };
+
+static K_THREAD_STACK_ARRAY_DEFINE(bench_stack, THREAD_NUM, STACK_SIZE);
+static struct k_thread bench_thread[THREAD_NUM];
+static K_SEM_DEFINE(done_sem, 0, THREAD_NUM);
+
+static bool use_magazine;
+static u32_t bench_cycles[THREAD_NUM];
+static u32_t bench_failed;
+
+static void bench_entry(void *p1, void *p2, void *p3)
+{
+	int id = (int)p1;
+	void *live[LIVE_NUM] = { NULL };
+	u32_t start, cycles = 0;
+	int i, slot;
+
+	if (use_magazine) {
+		mem_magazine_attach(k_current_get());
+	}
+
+	for (i = 0; i < LOOP_NUM; i++) {
+		slot = i % LIVE_NUM;
+
+		start = k_cycle_get_32();
+		if (live[slot]) {
+			mem_free(live[slot]);
+		}
+		live[slot] = mem_malloc(alloc_size[(i + id) % ARRAY_SIZE(alloc_size)]);
+		cycles += k_cycle_get_32() - start;
+
+		if (!live[slot]) {
+			bench_failed++;
+		}
+
+		/* interleave with the other threads */
+		k_yield();
+	}
+
+	for (slot = 0; slot < LIVE_NUM; slot++) {
+		if (live[slot]) {
+			mem_free(live[slot]);
+		}
+	}
+
+	if (use_magazine) {
+		mem_magazine_detach(k_current_get());
+	}
+
+	bench_cycles[id] = cycles;
+	k_sem_give(&done_sem);
+}
+
+static u32_t run_bench(bool magazine)
+{
+	u32_t cycles = 0;
+	int i;
+
+	use_magazine = magazine;
+
+	for (i = 0; i < THREAD_NUM; i++) {
+		k_thread_create(&bench_thread[i], bench_stack[i], STACK_SIZE,
+				bench_entry, (void *)i, NULL, NULL,
+				K_PRIO_PREEMPT(THREAD_PRIO), 0, K_NO_WAIT);
+	}
+
+	for (i = 0; i < THREAD_NUM; i++) {
+		k_sem_take(&done_sem, K_FOREVER);
+	}
+
+	for (i = 0; i < THREAD_NUM; i++) {
+		cycles += bench_cycles[i];
+	}
+
+	return cycles / (THREAD_NUM * LOOP_NUM);
+}
+
+void main(void)
+{
+	u32_t shared_cycles, magazine_cycles;
+
+	TC_START("Mem slab magazine");
+
+	TC_PRINT("Mem slab magazine benchmark: %d threads, %d loops\n",
+		 THREAD_NUM, LOOP_NUM);
+
+	shared_cycles = run_bench(false);
+	TC_PRINT("shared slab : %u cycles per malloc/free\n", shared_cycles);
+
+	magazine_cycles = run_bench(true);
+	TC_PRINT("magazine    : %u cycles per malloc/free\n", magazine_cycles);
+
+	mem_manager_dump();
+
+	TC_END_RESULT(bench_failed ? TC_FAIL : TC_PASS);
+	TC_END_REPORT(bench_failed ? TC_FAIL : TC_PASS);
+}
@@ -0,0 +1,789 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CONFIG_BT_CONN				1
+#define CONFIG_BT_BREDR				1
+#define CONFIG_BT_MAX_CONN			3
+#define CONFIG_BT_MAX_BR_CONN			2
+#define CONFIG_BT_MAX_SCO_CONN			2
+#define CONFIG_BT_L2CAP_TX_MTU			672
+#define CONFIG_BT_HCI_RESERVE			1
+#define CONFIG_BT_RX_BUF_COUNT			8
+#define CONFIG_BT_HCI_TX_PRIO			7
+#define CONFIG_BT_CONN_TX_SLICE			1
+
+#define CONN_HANDLE_SLOTS	(2 * (CONFIG_BT_MAX_CONN + CONFIG_BT_MAX_SCO_CONN))
+#define ACL_TX_MAX		4
+#define BENCH_ROUNDS		20000
+
+/* BT_ASSERT ends in k_oops() */
+#define _NANO_ERR_KERNEL_OOPS			5
+static int _default_esf;
+void _NanoFatalErrorHandler(unsigned int reason, const int *esf)
+{
+	ztest_test_fail();
+}
+
+unsigned int irq_lock(void)
+{
+	return 0;
+}
+
+void irq_unlock(unsigned int key)
+{
+}
+
+/* collect the pools in one section, as the linker script does */
+#undef __in_section
+#define __in_section(a, b, c)	__attribute__((section("net_buf_pools")))
+#define _net_buf_pool_list	__start_net_buf_pools
+#define _net_buf_pool_list_end	__stop_net_buf_pools
+
+#include <kernel/atomic_c.c>
+#include <net/buf.c>
+#include <subsys/bluetooth/host/conn.c>
+
+const struct bt_inner_value_t bt_inner_value = {
+	.max_conn = CONFIG_BT_MAX_CONN,
+	.br_max_conn = CONFIG_BT_MAX_BR_CONN,
+	.conn_handle_slots = CONN_HANDLE_SLOTS,
+	.acl_tx_max = ACL_TX_MAX,
+};
+
+struct bt_dev_core bt_dev;
+struct bt_conn_tx conn_tx_link[ACL_TX_MAX];
+struct bt_conn conns[CONFIG_BT_MAX_CONN];
+struct bt_conn sco_conns[CONFIG_BT_MAX_SCO_CONN];
+struct bt_conn *conn_handle_index[CONN_HANDLE_SLOTS];
+struct k_work_q k_sys_work_q;
+
+/* single threaded, the queues never wait */
+void k_queue_init(struct k_queue *queue)
+{
+	sys_slist_init(&queue->data_q);
+}
+
+void *k_queue_get(struct k_queue *queue, s32_t timeout)
+{
+	return sys_slist_get(&queue->data_q);
+}
+
+void k_queue_append(struct k_queue *queue, void *data)
+{
+	sys_slist_append(&queue->data_q, data);
+}
+
+void k_queue_append_list(struct k_queue *queue, void *head, void *tail)
+{
+	sys_slist_append_list(&queue->data_q, head, tail);
+}
+
+void k_queue_prepend(struct k_queue *queue, void *data)
+{
+	sys_slist_prepend(&queue->data_q, data);
+}
+
+int k_queue_cnt_sum(struct k_queue *queue)
+{
+	sys_snode_t *node;
+	int cnt = 0;
+
+	SYS_SLIST_FOR_EACH_NODE(&queue->data_q, node) {
+		cnt++;
+	}
+
+	return cnt;
+}
+
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+int k_poll_signal(struct k_poll_signal *signal, int result) { return 0; }
+void k_poll_signal_init(struct k_poll_signal *signal) {}
+void k_poll_event_init(struct k_poll_event *event, u32_t type,
+		       int mode, void *obj) {}
+void k_delayed_work_init(struct k_delayed_work *work,
+			 k_work_handler_t handler) {}
+int k_delayed_work_cancel(struct k_delayed_work *work) { return 0; }
+int k_delayed_work_submit_to_queue(struct k_work_q *work_q,
+				   struct k_delayed_work *work,
+				   s32_t delay) { return 0; }
+k_tid_t k_current_get(void) { return NULL; }
+int k_thread_priority_get(k_tid_t thread) { return 0; }
+void k_yield(void) {}
+void k_sleep(s32_t duration) {}
+
+struct net_buf *bt_hci_cmd_create(u16_t opcode, u8_t param_len) { return NULL; }
+int bt_hci_cmd_send(u16_t opcode, struct net_buf *buf) { return 0; }
+int bt_hci_cmd_send_sync(u16_t opcode, struct net_buf *buf,
+			 struct net_buf **rsp) { return 0; }
+void bt_l2cap_init(void) {}
+void bt_l2cap_connected(struct bt_conn *conn) {}
+void bt_l2cap_disconnected(struct bt_conn *conn) {}
+struct net_buf *bt_l2cap_create_pdu(struct net_buf_pool *pool,
+				    size_t reserve) { return NULL; }
+int bt_l2cap_update_conn_param(struct bt_conn *conn,
+			       const struct bt_le_conn_param *param) { return 0; }
+void bt_l2cap_br_connectionless_send(struct bt_conn *conn,
+				     struct net_buf *buf) {}
+bool bt_le_conn_params_valid(const struct bt_le_conn_param *param) { return true; }
+int bt_le_scan_update(bool fast_scan) { return 0; }
+int bt_smp_init(void) { return 0; }
+
+/* the scan bt_conn_lookup_handle did before the index */
+static struct bt_conn *lookup_handle_scan(u16_t handle)
+{
+	int i;
+
+	for (i = 0; i < bt_inner_value.max_conn; i++) {
+		if (!atomic_get(&conns[i].ref)) {
+			continue;
+		}
+
+		if (conns[i].state != BT_CONN_CONNECTED &&
+		    conns[i].state != BT_CONN_DISCONNECT) {
+			continue;
+		}
+
+		if (conns[i].handle == handle) {
+			return bt_conn_ref(&conns[i]);
+		}
+	}
+
+	for (i = 0; i < bt_inner_value.br_max_conn; i++) {
+		if (!atomic_get(&sco_conns[i].ref)) {
+			continue;
+		}
+
+		if (sco_conns[i].state != BT_CONN_CONNECTED &&
+		    sco_conns[i].state != BT_CONN_DISCONNECT) {
+			continue;
+		}
+
+		if (sco_conns[i].handle == handle) {
+			return bt_conn_ref(&sco_conns[i]);
+		}
+	}
+
+	return NULL;
+}
+
+static struct bt_conn *conn_connect(struct bt_conn *conn, u16_t handle)
+{
+	conn->handle = handle;
+	bt_conn_set_state(conn, BT_CONN_CONNECT);
+	bt_conn_set_state(conn, BT_CONN_CONNECTED);
+	return conn;
+}
+
+static struct bt_conn *acl_connect(u16_t handle, u8_t id)
+{
+	bt_addr_t peer = { { id, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+
+	return conn_connect(bt_conn_add_br(&peer), handle);
+}
+
+static struct bt_conn *sco_connect(u16_t handle, u8_t id)
+{
+	bt_addr_t peer = { { id, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+
+	return conn_connect(bt_conn_add_sco(&peer, BT_HCI_ESCO), handle);
+}
+
+/* as hci disconn_complete, the slot is free once the last ref is gone */
+static void conn_disconnect(struct bt_conn *conn, bool local)
+{
+	if (local)
+		bt_conn_set_state(conn, BT_CONN_DISCONNECT);
+	bt_conn_set_state(conn, BT_CONN_DISCONNECTED);
+	conn->handle = 0;
+	atomic_set(&conn->ref, 0);
+}
+
+static void check_lookup(u16_t handle)
+{
+	struct bt_conn *conn = bt_conn_lookup_handle(handle);
+	struct bt_conn *ref = lookup_handle_scan(handle);
+
+	zassert_equal(conn, ref, "lookup differs from scan");
+	if (conn) {
+		bt_conn_unref(conn);
+		bt_conn_unref(ref);
+	}
+}
+
+static bool handle_in_use(u16_t handle)
+{
+	struct bt_conn *conn = lookup_handle_scan(handle);
+
+	if (conn) {
+		bt_conn_unref(conn);
+	}
+
+	return conn != NULL;
+}
+
+static void conn_reset(void)
+{
+	bt_conn_env_init();
+}
+
+void test_conn_handle_collide(void)
+{
+	struct bt_conn *c1, *c2, *c3, *s1, *s2;
+	u16_t h;
+
+	conn_reset();
+
+	/* 1, 11 and 21 share a slot, 9 and 19 wrap around the table */
+	c1 = acl_connect(1, 1);
+	c2 = acl_connect(11, 2);
+	c3 = acl_connect(9, 3);
+	s1 = sco_connect(21, 1);
+	s2 = sco_connect(19, 2);
+	zassert_equal(conn_handle_index[1], c1, NULL);
+	zassert_equal(conn_handle_index[0], s2, NULL);
+
+	for (h = 0; h < 32; h++)
+		check_lookup(h);
+
+	conn_disconnect(c2, true);
+	conn_disconnect(c3, false);
+	for (h = 0; h < 32; h++)
+		check_lookup(h);
+
+	c2 = acl_connect(31, 2);
+	conn_disconnect(s1, false);
+	for (h = 0; h < 32; h++)
+		check_lookup(h);
+
+	conn_disconnect(c1, false);
+	conn_disconnect(c2, false);
+	conn_disconnect(s2, false);
+	for (h = 0; h < CONN_HANDLE_SLOTS; h++)
+		zassert_is_null(conn_handle_index[h], NULL);
+}
+
+void test_conn_handle_random(void)
+{
+	struct bt_conn *acl[CONFIG_BT_MAX_CONN] = { NULL };
+	struct bt_conn *sco[CONFIG_BT_MAX_SCO_CONN] = { NULL };
+	u16_t h;
+	int i, n;
+
+	conn_reset();
+	srand(2019);
+
+	for (n = 0; n < 2000; n++) {
+		i = rand() % (CONFIG_BT_MAX_CONN + CONFIG_BT_MAX_SCO_CONN);
+		h = (rand() % 4) * 0x80 + rand() % 16;
+
+		if (i < CONFIG_BT_MAX_CONN) {
+			if (acl[i]) {
+				conn_disconnect(acl[i], rand() & 1);
+				acl[i] = NULL;
+			} else if (!handle_in_use(h)) {
+				acl[i] = acl_connect(h, i);
+			}
+		} else {
+			i -= CONFIG_BT_MAX_CONN;
+			if (sco[i]) {
+				conn_disconnect(sco[i], rand() & 1);
+				sco[i] = NULL;
+			} else if (acl[i] && !handle_in_use(h)) {
+				sco[i] = sco_connect(h, i);
+			}
+		}
+
+		for (h = 0; h < 0x200; h += 0x10)
+			check_lookup(h + (n & 0xf));
+	}
+}
+
+/* packet classes of the trace, by h4 packet type */
+#define H4_ACL		0x02
+#define H4_SCO		0x03
+#define H4_EVT		0x04
+
+/* phone and tws acl, a ble link, and the phone call on esco */
+#define PHONE_HANDLE	0x0080
+#define TWS_HANDLE	0x0081
+#define LE_HANDLE	0x0001
+#define ESCO_HANDLE	0x0100
+
+/* one 7.5 ms esco interval of a call forwarded to the tws slave */
+static const u8_t trace_interval[] = {
+	H4_SCO, H4_ACL, H4_EVT, H4_SCO, H4_ACL, H4_ACL, H4_EVT, H4_SCO,
+};
+
+static int trace_build(u8_t *trace, int size)
+{
+	struct bt_hci_evt_hdr *evt;
+	struct bt_hci_evt_num_completed_packets *ncp;
+	u16_t acl_handle;
+	int len = 0, n = 0;
+
+	while (len + 32 < size) {
+		u8_t type = trace_interval[n % ARRAY_SIZE(trace_interval)];
+
+		trace[len++] = type;
+		switch (type) {
+		case H4_SCO:
+			sys_put_le16(bt_acl_handle_pack(ESCO_HANDLE, 0), &trace[len]);
+			trace[len + 2] = 60;
+			len += 3;
+			break;
+		case H4_ACL:
+			/* avdtp/tws sync on the tws link, now and then ble */
+			acl_handle = (n % 29) ? TWS_HANDLE : LE_HANDLE;
+			if (!(n % 11))
+				acl_handle = PHONE_HANDLE;
+			sys_put_le16(bt_acl_handle_pack(acl_handle, 0x02), &trace[len]);
+			sys_put_le16(27, &trace[len + 2]);
+			len += 4;
+			break;
+		case H4_EVT:
+			evt = (void *)&trace[len];
+			evt->evt = BT_HCI_EVT_NUM_COMPLETED_PACKETS;
+			ncp = (void *)&trace[len + sizeof(*evt)];
+			ncp->num_handles = 2;
+			ncp->h[0].handle = sys_cpu_to_le16(TWS_HANDLE);
+			ncp->h[0].count = sys_cpu_to_le16(1);
+			ncp->h[1].handle = sys_cpu_to_le16(PHONE_HANDLE);
+			ncp->h[1].count = sys_cpu_to_le16(1);
+			evt->len = sizeof(*ncp) + 2 * sizeof(ncp->h[0]);
+			len += sizeof(*evt) + evt->len;
+			break;
+		}
+		n++;
+	}
+
+	return len;
+}
+
+/* dispatch as hci_acl, hci_sco and hci_num_completed_packets */
+static int trace_replay(const u8_t *trace, int len,
+			struct bt_conn *(*lookup)(u16_t handle))
+{
+	const struct bt_hci_evt_num_completed_packets *ncp;
+	struct bt_conn *conn;
+	int pos = 0, found = 0, i;
+
+	while (pos < len) {
+		switch (trace[pos++]) {
+		case H4_ACL:
+		case H4_SCO:
+			conn = lookup(bt_acl_handle(sys_get_le16(&trace[pos])));
+			if (conn) {
+				found++;
+				bt_conn_unref(conn);
+			}
+			pos += (trace[pos - 1] == H4_ACL) ? 4 : 3;
+			break;
+		case H4_EVT:
+			ncp = (void *)&trace[pos + sizeof(struct bt_hci_evt_hdr)];
+			for (i = 0; i < ncp->num_handles; i++) {
+				conn = lookup(sys_le16_to_cpu(ncp->h[i].handle));
+				if (conn) {
+					found++;
+					bt_conn_unref(conn);
+				}
+			}
+			pos += sizeof(struct bt_hci_evt_hdr) + trace[pos + 1];
+			break;
+		}
+	}
+
+	return found;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_conn_handle_bench(void)
+{
+	static u8_t trace[4096];
+	struct bt_conn *le;
+	bt_addr_le_t le_peer = { 0 };
+	long long start, scan_ns, index_ns;
+	int len, lookups, found, i;
+
+	conn_reset();
+	acl_connect(PHONE_HANDLE, 1);
+	acl_connect(TWS_HANDLE, 2);
+	le = bt_conn_add_le(&le_peer);
+	conn_connect(le, LE_HANDLE);
+	sco_connect(ESCO_HANDLE, 1);
+
+	len = trace_build(trace, sizeof(trace));
+	lookups = trace_replay(trace, len, bt_conn_lookup_handle);
+	zassert_equal(trace_replay(trace, len, lookup_handle_scan), lookups, NULL);
+
+	found = 0;
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		found += trace_replay(trace, len, lookup_handle_scan);
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		found -= trace_replay(trace, len, bt_conn_lookup_handle);
+	index_ns = now_ns() - start;
+	zassert_equal(found, 0, NULL);
+
+	PRINT("%d lookups per trace: scan %lld ns, index %lld ns per 100 lookups\n",
+	      lookups, scan_ns * 100 / BENCH_ROUNDS / lookups,
+	      index_ns * 100 / BENCH_ROUNDS / lookups);
+}
+
+/* largest packet the host takes, one A2DP media packet */
+#define LOOP_SDU_MAX		L2CAP_BR_MAX_MTU_A2DP
+#define LOOP_RX_COUNT		CONFIG_BT_RX_BUF_COUNT
+#define LOOP_FRAG_RX_SIZE	(BT_HCI_ACL_HDR_SIZE + 384)
+
+static int acl_tx_freed;
+
+static void acl_tx_destroy(struct net_buf *buf)
+{
+	acl_tx_freed++;
+	net_buf_destroy(buf);
+}
+
+NET_BUF_POOL_DEFINE(acl_tx_pool, 2, BT_L2CAP_BUF_SIZE(LOOP_SDU_MAX),
+		    BT_BUF_USER_DATA_MIN, acl_tx_destroy);
+/* the actions driver sizes a start fragment for the whole packet */
+NET_BUF_POOL_DEFINE(loop_pdu_pool, LOOP_RX_COUNT,
+		    BT_L2CAP_BUF_SIZE(LOOP_SDU_MAX),
+		    BT_BUF_USER_DATA_MIN, NULL);
+/* uart drivers take every fragment from fixed size buffers */
+NET_BUF_POOL_DEFINE(loop_frag_pool, LOOP_RX_COUNT, LOOP_FRAG_RX_SIZE,
+		    BT_BUF_USER_DATA_MIN, NULL);
+
+/* loopback HCI, the controller copies a packet out as btdrv_send does
+ * and hands it back as ACL data received on the same link
+ */
+static struct {
+	struct bt_conn *conn;
+	bool presize;
+	u8_t air[BT_HCI_ACL_HDR_SIZE + LOOP_SDU_MAX];
+	int frags;
+	/* last l2cap packet received */
+	u8_t pdu[BT_L2CAP_HDR_SIZE + LOOP_SDU_MAX];
+	int pdu_len;
+	int pdus;
+} loop;
+
+struct net_buf *bt_buf_get_rx_len(enum bt_buf_type type, s32_t timeout, int len)
+{
+	struct net_buf *buf;
+
+	if (len > BT_L2CAP_HDR_SIZE + LOOP_SDU_MAX) {
+		return NULL;
+	}
+
+	buf = net_buf_alloc(&loop_pdu_pool, timeout);
+	if (buf) {
+		bt_buf_set_type(buf, type);
+	}
+
+	return buf;
+}
+
+static void loop_recv(u16_t handle, const u8_t *data, u16_t len)
+{
+	u8_t flags = bt_acl_flags(handle);
+	struct bt_l2cap_hdr *hdr = (void *)data;
+	struct net_buf *buf;
+
+	/* the receiving controller reports a start as flushable */
+	if (flags == BT_ACL_START_NO_FLUSH) {
+		flags = BT_ACL_START;
+	}
+
+	if (loop.presize && flags == BT_ACL_START) {
+		buf = net_buf_alloc(&loop_pdu_pool, K_NO_WAIT);
+		zassert_true(sys_le16_to_cpu(hdr->len) + sizeof(*hdr) <=
+			     net_buf_tailroom(buf), NULL);
+	} else {
+		buf = net_buf_alloc(&loop_frag_pool, K_NO_WAIT);
+	}
+	zassert_not_null(buf, "rx pool empty");
+
+	bt_buf_set_type(buf, BT_BUF_ACL_IN);
+	net_buf_add_mem(buf, data, len);
+	bt_conn_recv(loop.conn, buf, flags);
+}
+
+int bt_send(struct net_buf *buf)
+{
+	struct bt_hci_acl_hdr *hdr = (void *)buf->data;
+	u16_t handle = sys_le16_to_cpu(hdr->handle);
+	u16_t len = buf->len;
+	sys_snode_t *node;
+
+	zassert_equal(bt_buf_get_type(buf), BT_BUF_ACL_OUT, NULL);
+	zassert_equal(bt_acl_handle(handle), loop.conn->handle, NULL);
+	zassert_equal(sys_le16_to_cpu(hdr->len), len - sizeof(*hdr), NULL);
+	zassert_true(len - sizeof(*hdr) <= conn_mtu(loop.conn), NULL);
+
+	memcpy(loop.air, buf->data, len);
+	net_buf_unref(buf);
+	loop.frags++;
+
+	/* completed at once */
+	node = sys_slist_get(&loop.conn->tx_pending);
+	zassert_not_null(node, NULL);
+	tx_free(CONTAINER_OF(node, struct bt_conn_tx, node));
+
+	loop_recv(handle, loop.air + sizeof(*hdr), len - sizeof(*hdr));
+
+	return 0;
+}
+
+void bt_l2cap_recv(struct bt_conn *conn, struct net_buf *buf)
+{
+	zassert_is_null(buf->frags, "l2cap gets a chain");
+
+	memcpy(loop.pdu, buf->data, buf->len);
+	loop.pdu_len = buf->len;
+	loop.pdus++;
+	net_buf_unref(buf);
+}
+
+static void loop_init(u16_t mtu, bool presize)
+{
+	int i;
+
+	conn_reset();
+	sys_slist_init(&free_tx);
+	for (i = 0; i < ACL_TX_MAX; i++) {
+		sys_slist_prepend(&free_tx, &conn_tx_link[i].node);
+	}
+
+	bt_dev.br.mtu = mtu;
+	memset(&loop, 0, sizeof(loop));
+	loop.presize = presize;
+	loop.conn = acl_connect(PHONE_HANDLE, 1);
+	acl_tx_freed = 0;
+}
+
+static struct net_buf *sdu_create(const u8_t *data, u16_t len)
+{
+	struct bt_l2cap_hdr *hdr;
+	struct net_buf *buf;
+
+	buf = bt_conn_create_pdu(NULL, 0);
+	hdr = net_buf_add(buf, sizeof(*hdr));
+	hdr->len = sys_cpu_to_le16(len);
+	hdr->cid = sys_cpu_to_le16(BT_L2CAP_CID_BR_SIG);
+	net_buf_add_mem(buf, data, len);
+
+	return buf;
+}
+
+static void sdu_send(const u8_t *data, u16_t len)
+{
+	struct net_buf *buf = sdu_create(data, len);
+
+	/* as bt_conn_process_tx */
+	if (!send_buf(loop.conn, buf)) {
+		net_buf_unref(buf);
+	}
+}
+
+/* the fragmentation send_buf did before the slices */
+static struct net_buf *copy_frag(struct bt_conn *conn, struct net_buf *buf)
+{
+	struct net_buf *frag;
+	u16_t frag_len;
+
+	frag = bt_conn_create_pdu(NULL, 0);
+	conn_tx(frag)->cb = NULL;
+
+	frag_len = min(conn_mtu(conn), net_buf_tailroom(frag));
+	net_buf_add_mem(frag, buf->data, frag_len);
+	net_buf_pull(buf, frag_len);
+
+	return frag;
+}
+
+static void sdu_send_copy(const u8_t *data, u16_t len)
+{
+	struct net_buf *buf = sdu_create(data, len);
+	struct bt_conn *conn = loop.conn;
+	u8_t flags = BT_ACL_START_NO_FLUSH;
+
+	while (buf->len > conn_mtu(conn)) {
+		send_frag(conn, copy_frag(conn, buf), flags, true);
+		flags = BT_ACL_CONT;
+	}
+
+	send_frag(conn, buf, flags, true);
+}
+
+static void check_pdu(const u8_t *data, u16_t len)
+{
+	zassert_equal(loop.pdu_len, BT_L2CAP_HDR_SIZE + len, NULL);
+	zassert_equal(sys_get_le16(loop.pdu), len, NULL);
+	zassert_true(!memcmp(loop.pdu + BT_L2CAP_HDR_SIZE, data, len), NULL);
+}
+
+static void check_pools(void)
+{
+	struct net_buf *bufs[FRAG_SLICE_COUNT];
+	int i;
+
+	for (i = 0; i < FRAG_SLICE_COUNT; i++) {
+		bufs[i] = net_buf_alloc(&frag_slice_pool, K_NO_WAIT);
+		zassert_not_null(bufs[i], "slice leaked");
+		frag_slice(bufs[i])->parent = NULL;
+	}
+
+	for (i = 0; i < FRAG_SLICE_COUNT; i++)
+		net_buf_unref(bufs[i]);
+
+	zassert_is_null(loop.conn->rx, NULL);
+	zassert_equal(loop.conn->rx_len, 0, NULL);
+}
+
+void test_conn_frag_tx(void)
+{
+	static const u16_t mtus[] = { 27, 256, 339, 1021 };
+	static u8_t data[LOOP_SDU_MAX];
+	int i, len, sent, frags;
+
+	srand(2019);
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = rand();
+
+	for (i = 0; i < ARRAY_SIZE(mtus); i++) {
+		loop_init(mtus[i], true);
+		sent = 0;
+		frags = 0;
+
+		for (len = 0; len <= LOOP_SDU_MAX; len += 1 + rand() % 97) {
+			sdu_send(data + LOOP_SDU_MAX - len, len);
+			check_pdu(data + LOOP_SDU_MAX - len, len);
+			sent++;
+			frags += (BT_L2CAP_HDR_SIZE + len + mtus[i] - 1) / mtus[i];
+		}
+
+		zassert_equal(loop.pdus, sent, NULL);
+		zassert_equal(loop.frags, frags, NULL);
+		zassert_equal(acl_tx_freed, sent, "l2cap buffer leaked");
+		check_pools();
+		conn_disconnect(loop.conn, false);
+	}
+}
+
+void test_conn_frag_rx_chain(void)
+{
+	static u8_t data[LOOP_SDU_MAX];
+	int i, len;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+
+	/* fragments from buffers too small to take the packet */
+	loop_init(339, false);
+	for (len = 0; len <= LOOP_SDU_MAX; len += 61) {
+		sdu_send(data, len);
+		check_pdu(data, len);
+	}
+	zassert_equal(acl_tx_freed, loop.pdus, NULL);
+	check_pools();
+
+	/* a continuation beyond the packet length still drops it */
+	loop.pdus = 0;
+	loop_recv(bt_acl_handle_pack(PHONE_HANDLE, BT_ACL_START),
+		  (const u8_t []){ 0x04, 0x00, 0x01, 0x00, 0xaa, 0xbb }, 6);
+	loop_recv(bt_acl_handle_pack(PHONE_HANDLE, BT_ACL_CONT),
+		  (const u8_t []){ 0xcc, 0xdd, 0xee }, 3);
+	zassert_equal(loop.pdus, 0, NULL);
+	check_pools();
+
+	/* too long for any buffer, dropped at the start fragment */
+	loop_recv(bt_acl_handle_pack(PHONE_HANDLE, BT_ACL_START),
+		  (const u8_t []){ 0xfc, 0xff, 0x01, 0x00, 0xaa, 0xbb }, 6);
+	check_pools();
+	loop_recv(bt_acl_handle_pack(PHONE_HANDLE, BT_ACL_CONT),
+		  (const u8_t []){ 0xcc, 0xdd, 0xee }, 3);
+	zassert_equal(loop.pdus, 0, NULL);
+	check_pools();
+	conn_disconnect(loop.conn, false);
+
+	/* a chain may hold half of the rx buffers only */
+	loop_init(200, false);
+	sdu_send(data, 4 * 200 - BT_L2CAP_HDR_SIZE);
+	check_pdu(data, 4 * 200 - BT_L2CAP_HDR_SIZE);
+	loop.pdus = 0;
+	sdu_send(data, LOOP_SDU_MAX);
+	zassert_equal(loop.pdus, 0, "chain not limited");
+	zassert_equal(acl_tx_freed, 2, NULL);
+	check_pools();
+	conn_disconnect(loop.conn, false);
+}
+
+void test_conn_frag_bench(void)
+{
+	static u8_t data[LOOP_SDU_MAX];
+	long long start, copy_ns, slice_ns;
+	int i;
+
+	/* a2dp media packets over the 3-DH5 acl mtu of the controller */
+	loop_init(339, true);
+	memset(data, 0x5a, sizeof(data));
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		sdu_send_copy(data, 800);
+	copy_ns = now_ns() - start;
+	check_pdu(data, 800);
+	zassert_equal(loop.pdus, BENCH_ROUNDS, NULL);
+	/* a buffer for every fragment */
+	zassert_equal(acl_tx_freed, loop.frags, NULL);
+
+	loop.frags = 0;
+	acl_tx_freed = 0;
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		sdu_send(data, 800);
+	slice_ns = now_ns() - start;
+	check_pdu(data, 800);
+	zassert_equal(loop.pdus, 2 * BENCH_ROUNDS, NULL);
+	zassert_equal(loop.frags, 3 * BENCH_ROUNDS, NULL);
+	/* only the l2cap buffer */
+	zassert_equal(acl_tx_freed, BENCH_ROUNDS, NULL);
+	check_pools();
+	conn_disconnect(loop.conn, false);
+
+	PRINT("800 byte packets over loopback: copy %lld ns, slice %lld ns "
+	      "per packet\n", copy_ns / BENCH_ROUNDS, slice_ns / BENCH_ROUNDS);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(bt_conn_handle,
+			 ztest_unit_test(test_conn_handle_collide),
+			 ztest_unit_test(test_conn_handle_random),
+			 ztest_unit_test(test_conn_handle_bench));
+	ztest_run_test_suite(bt_conn_handle);
+
+	ztest_test_suite(bt_conn_frag,
+			 ztest_unit_test(test_conn_frag_tx),
+			 ztest_unit_test(test_conn_frag_rx_chain),
+			 ztest_unit_test(test_conn_frag_bench));
+	ztest_run_test_suite(bt_conn_frag);
+}
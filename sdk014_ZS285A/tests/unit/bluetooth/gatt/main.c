@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CONFIG_BT_CONN				1
+#define CONFIG_BT_LE_ATT			1
+#define CONFIG_BT_MAX_CONN			3
+#define CONFIG_BT_MAX_BR_CONN			1
+#define CONFIG_BT_MAX_PAIRED			3
+#define CONFIG_BT_MAX_BR_PAIRED			1
+#define CONFIG_BT_L2CAP_TX_MTU			672
+#define CONFIG_BT_RX_BUF_LEN			264
+#define CONFIG_BT_GATT_DB_INDEX_SIZE		8
+
+#define BENCH_ROUNDS		20000
+
+#include <subsys/bluetooth/host/uuid.c>
+#include <subsys/bluetooth/host/gatt.c>
+
+static u8_t pdu_data[64];
+static struct net_buf pdu_buf;
+static int sent_cnt[2];
+static u16_t sent_handle;
+static struct bt_conn conn_pool[2];
+static bt_addr_le_t bonded;
+
+struct net_buf *bt_att_create_pdu(struct bt_conn *conn, u8_t op, size_t len)
+{
+	pdu_buf.data = pdu_data;
+	pdu_buf.len = 0;
+	return &pdu_buf;
+}
+
+void *net_buf_simple_add(struct net_buf_simple *buf, size_t len)
+{
+	u8_t *tail = buf->data + buf->len;
+
+	buf->len += len;
+	return tail;
+}
+
+void bt_l2cap_send_cb(struct bt_conn *conn, u16_t cid, struct net_buf *buf,
+		      bt_conn_tx_cb_t cb)
+{
+	sent_cnt[conn - conn_pool]++;
+	sent_handle = sys_get_le16(buf->data);
+}
+
+void net_buf_unref(struct net_buf *buf) {}
+u16_t bt_att_get_mtu(struct bt_conn *conn) { return 23; }
+int bt_att_send(struct bt_conn *conn, struct net_buf *buf) { return 0; }
+int bt_att_req_send(struct bt_conn *conn, struct bt_att_req *req) { return 0; }
+int bt_le_conn_ready_send_data(struct bt_conn *conn) { return 1; }
+
+struct bt_conn *bt_conn_ref(struct bt_conn *conn)
+{
+	atomic_inc(&conn->ref);
+	return conn;
+}
+
+void bt_conn_unref(struct bt_conn *conn)
+{
+	atomic_dec(&conn->ref);
+}
+
+int bt_conn_addr_le_cmp(const struct bt_conn *conn, const bt_addr_le_t *peer)
+{
+	return bt_addr_le_cmp(peer, &conn->le.dst);
+}
+
+bool bt_addr_le_is_bonded(const bt_addr_le_t *addr)
+{
+	return !bt_addr_le_cmp(addr, &bonded);
+}
+
+atomic_val_t atomic_inc(atomic_t *target)
+{
+	return (*target)++;
+}
+
+atomic_val_t atomic_dec(atomic_t *target)
+{
+	return (*target)--;
+}
+
+static ssize_t read_value(struct bt_conn *conn,
+			  const struct bt_gatt_attr *attr, void *buf,
+			  u16_t len, u16_t offset)
+{
+	return 0;
+}
+
+static void ccc_changed(const struct bt_gatt_attr *attr, u16_t value)
+{
+}
+
+#define TEST_CHRC(_uuid, _props)					\
+	BT_GATT_CHARACTERISTIC(_uuid, _props),				\
+	BT_GATT_DESCRIPTOR(_uuid, BT_GATT_PERM_READ, read_value, NULL, NULL)
+
+#define TEST_NOTIFY_CHRC(_uuid, _cfg)					\
+	TEST_CHRC(_uuid, BT_GATT_CHRC_NOTIFY),				\
+	BT_GATT_CCC(_cfg, ccc_changed)
+
+static struct bt_gatt_ccc_cfg bas_ccc[BT_GATT_CCC_MAX];
+static struct bt_gatt_ccc_cfg ota_ccc[2][BT_GATT_CCC_MAX];
+static struct bt_gatt_ccc_cfg gma_ccc[2][BT_GATT_CCC_MAX];
+static struct bt_gatt_ccc_cfg spp_ccc[BT_GATT_CCC_MAX];
+
+static struct bt_gatt_attr dis_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DIS),
+	TEST_CHRC(BT_UUID_DIS_MODEL_NUMBER, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_SERIAL_NUMBER, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_FIRMWARE_REVISION, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_HARDWARE_REVISION, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_SOFTWARE_REVISION, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_MANUFACTURER_NAME, BT_GATT_CHRC_READ),
+	TEST_CHRC(BT_UUID_DIS_PNP_ID, BT_GATT_CHRC_READ),
+};
+
+static struct bt_gatt_attr bas_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_BAS),
+	TEST_NOTIFY_CHRC(BT_UUID_BAS_BATTERY_LEVEL, bas_ccc),
+};
+
+static struct bt_gatt_attr ota_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_16(0xfff0)),
+	TEST_CHRC(BT_UUID_DECLARE_16(0xfff1), BT_GATT_CHRC_WRITE),
+	TEST_NOTIFY_CHRC(BT_UUID_DECLARE_16(0xfff2), ota_ccc[0]),
+	TEST_NOTIFY_CHRC(BT_UUID_DECLARE_16(0xfff3), ota_ccc[1]),
+};
+
+static struct bt_gatt_attr gma_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_16(0xfeb3)),
+	TEST_CHRC(BT_UUID_DECLARE_16(0xfed4), BT_GATT_CHRC_READ),
+	TEST_NOTIFY_CHRC(BT_UUID_DECLARE_16(0xfed5), gma_ccc[0]),
+	TEST_CHRC(BT_UUID_DECLARE_16(0xfed6), BT_GATT_CHRC_WRITE),
+	TEST_CHRC(BT_UUID_DECLARE_16(0xfed7), BT_GATT_CHRC_WRITE),
+	TEST_NOTIFY_CHRC(BT_UUID_DECLARE_16(0xfed8), gma_ccc[1]),
+};
+
+static struct bt_gatt_attr spp_attrs[] = {
+	BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_16(0xffe0)),
+	TEST_CHRC(BT_UUID_DECLARE_16(0xffe1), BT_GATT_CHRC_WRITE),
+	TEST_NOTIFY_CHRC(BT_UUID_DECLARE_16(0xffe2), spp_ccc),
+};
+
+static struct bt_gatt_service test_svcs[] = {
+	BT_GATT_SERVICE(dis_attrs),
+	BT_GATT_SERVICE(bas_attrs),
+	BT_GATT_SERVICE(ota_attrs),
+	BT_GATT_SERVICE(gma_attrs),
+	BT_GATT_SERVICE(spp_attrs),
+};
+
+/* services beyond the index, with handles set by the application */
+static struct bt_gatt_attr extra_attrs[4][3] = {
+	[0 ... 3] = {
+		BT_GATT_PRIMARY_SERVICE(BT_UUID_DECLARE_16(0xfe00)),
+		TEST_CHRC(BT_UUID_DECLARE_16(0xfe01), BT_GATT_CHRC_READ),
+	},
+};
+
+static struct bt_gatt_service extra_svcs[4];
+
+#define SPP_TX_VALUE	(&spp_attrs[4])
+#define SPP_TX_CCC	(&spp_attrs[5])
+
+/* the walk bt_gatt_foreach_attr did before the index */
+static void foreach_attr_scan(u16_t start_handle, u16_t end_handle,
+			      bt_gatt_attr_func_t func, void *user_data)
+{
+	struct bt_gatt_service *svc;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&db, svc, node) {
+		int i;
+
+		for (i = 0; i < svc->attr_count; i++) {
+			struct bt_gatt_attr *attr = &svc->attrs[i];
+
+			if (attr->handle < start_handle ||
+			    attr->handle > end_handle) {
+				continue;
+			}
+
+			if (func(attr, user_data) == BT_GATT_ITER_STOP) {
+				return;
+			}
+		}
+	}
+}
+
+struct visit {
+	const struct bt_gatt_attr *attr[64];
+	int cnt;
+	int max;
+};
+
+static u8_t visit_cb(const struct bt_gatt_attr *attr, void *user_data)
+{
+	struct visit *v = user_data;
+
+	v->attr[v->cnt++] = attr;
+
+	return (v->cnt == v->max) ? BT_GATT_ITER_STOP : BT_GATT_ITER_CONTINUE;
+}
+
+static void check_range(u16_t start, u16_t end, int max)
+{
+	struct visit idx = { .max = max }, scan = { .max = max };
+
+	bt_gatt_foreach_attr(start, end, visit_cb, &idx);
+	foreach_attr_scan(start, end, visit_cb, &scan);
+
+	zassert_equal(idx.cnt, scan.cnt, "range visits differ");
+	zassert_true(!memcmp(idx.attr, scan.attr, idx.cnt * sizeof(idx.attr[0])),
+		     "range visits differ");
+}
+
+static void check_ranges(void)
+{
+	u16_t start, end;
+
+	for (start = 0; start < 0x130; start += 3) {
+		for (end = start; end < 0x130; end += 7) {
+			check_range(start, end, 64);
+			check_range(start, end, 1);
+		}
+		check_range(start, 0xffff, 2);
+	}
+}
+
+static void gatt_db_reset(void)
+{
+	int i;
+
+	bt_gatt_init();
+	for (i = 0; i < ARRAY_SIZE(test_svcs); i++)
+		zassert_equal(bt_gatt_service_register(&test_svcs[i]), 0, NULL);
+}
+
+void test_gatt_db_index(void)
+{
+	int i;
+
+	gatt_db_reset();
+	zassert_equal(db_index_len, ARRAY_SIZE(test_svcs), NULL);
+	check_ranges();
+
+	zassert_equal(bt_gatt_attr_next(&dis_attrs[0]), &dis_attrs[1], NULL);
+	zassert_equal(bt_gatt_attr_next(&dis_attrs[ARRAY_SIZE(dis_attrs) - 1]),
+		      &bas_attrs[0], NULL);
+	zassert_is_null(bt_gatt_attr_next(SPP_TX_CCC), NULL);
+
+	/* more services than the index holds, with handle gaps */
+	for (i = 0; i < ARRAY_SIZE(extra_svcs); i++) {
+		extra_attrs[i][0].handle = 0x100 + i * 0x10;
+		extra_svcs[i].attrs = extra_attrs[i];
+		extra_svcs[i].attr_count = ARRAY_SIZE(extra_attrs[i]);
+		zassert_equal(bt_gatt_service_register(&extra_svcs[i]), 0, NULL);
+	}
+	zassert_equal(db_index_len, -1, NULL);
+	check_ranges();
+
+	zassert_equal(bt_gatt_service_unregister(&extra_svcs[0]), 0, NULL);
+	zassert_equal(bt_gatt_service_unregister(&test_svcs[2]), 0, NULL);
+	zassert_equal(db_index_len, ARRAY_SIZE(test_svcs) + 2, NULL);
+	check_ranges();
+}
+
+static struct bt_conn *conn_connect(int id)
+{
+	struct bt_conn *conn = &conn_pool[id];
+
+	memset(conn, 0, sizeof(*conn));
+	conn->type = BT_CONN_TYPE_LE;
+	conn->state = BT_CONN_CONNECTED;
+	conn->le.dst.type = BT_ADDR_LE_RANDOM;
+	conn->le.dst.a.val[0] = id + 1;
+	bt_gatt_connected(conn);
+
+	return conn;
+}
+
+static void ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+		      u16_t value)
+{
+	u8_t buf[2];
+
+	sys_put_le16(value, buf);
+	zassert_equal(bt_gatt_attr_write_ccc(conn, attr, buf, 2, 0, 0), 2, NULL);
+}
+
+static int notify_spp(void)
+{
+	u8_t data[4] = { 0 };
+
+	memset(sent_cnt, 0, sizeof(sent_cnt));
+	sent_handle = 0;
+	return bt_gatt_notify(NULL, SPP_TX_VALUE, data, sizeof(data));
+}
+
+void test_gatt_ccc_subscribers(void)
+{
+	struct bt_conn *c1, *c2;
+
+	gatt_db_reset();
+	memset(spp_ccc, 0, sizeof(spp_ccc));
+	c1 = conn_connect(0);
+	c2 = conn_connect(1);
+
+	zassert_equal(notify_spp(), -ENOTCONN, NULL);
+
+	ccc_write(c1, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	zassert_equal(notify_spp(), 0, NULL);
+	zassert_equal(sent_cnt[0], 1, NULL);
+	zassert_equal(sent_cnt[1], 0, NULL);
+	zassert_equal(sent_handle, SPP_TX_VALUE->handle, NULL);
+
+	/* written twice it is still one subscription */
+	ccc_write(c2, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	ccc_write(c2, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	zassert_equal(notify_spp(), 0, NULL);
+	zassert_equal(sent_cnt[0], 1, NULL);
+	zassert_equal(sent_cnt[1], 1, NULL);
+
+	ccc_write(c1, SPP_TX_CCC, 0);
+	notify_spp();
+	zassert_equal(sent_cnt[0], 0, NULL);
+	zassert_equal(sent_cnt[1], 1, NULL);
+
+	bt_gatt_disconnected(c2);
+	zassert_equal(notify_spp(), -ENOTCONN, NULL);
+	zassert_true(sys_slist_is_empty(&c2->le.ccc_subs), NULL);
+
+	/* a bonded peer is subscribed again when it reconnects */
+	bonded = c1->le.dst;
+	ccc_write(c1, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	bt_gatt_disconnected(c1);
+	zassert_equal(notify_spp(), -ENOTCONN, NULL);
+	c1 = conn_connect(0);
+	zassert_equal(notify_spp(), 0, NULL);
+	zassert_equal(sent_cnt[0], 1, NULL);
+
+	/* an unbonded peer is not */
+	bt_gatt_disconnected(c1);
+	c2 = conn_connect(1);
+	ccc_write(c2, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	bt_gatt_disconnected(c2);
+	c2 = conn_connect(1);
+	zassert_equal(notify_spp(), -ENOTCONN, NULL);
+
+	bt_gatt_disconnected(c2);
+	memset(&bonded, 0, sizeof(bonded));
+}
+
+static u8_t find_cb(const struct bt_gatt_attr *attr, void *user_data)
+{
+	*(const struct bt_gatt_attr **)user_data = attr;
+
+	return BT_GATT_ITER_STOP;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_gatt_bench(void)
+{
+	const struct bt_gatt_attr *attr;
+	struct notify_data nfy;
+	struct bt_conn *c1;
+	long long start, scan_ns, index_ns;
+	u16_t h, last;
+	int i;
+
+	gatt_db_reset();
+	memset(spp_ccc, 0, sizeof(spp_ccc));
+	c1 = conn_connect(0);
+	ccc_write(c1, SPP_TX_CCC, BT_GATT_CCC_NOTIFY);
+	last = SPP_TX_CCC->handle;
+
+	/* single handle lookups, as att read requests */
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		for (h = 1; h <= last; h++)
+			foreach_attr_scan(h, h, find_cb, &attr);
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		for (h = 1; h <= last; h++)
+			bt_gatt_foreach_attr(h, h, find_cb, &attr);
+	index_ns = now_ns() - start;
+
+	PRINT("%u attributes, handle lookup: scan %lld ns, index %lld ns\n",
+	      last, scan_ns / BENCH_ROUNDS / last, index_ns / BENCH_ROUNDS / last);
+
+	/* notification on the last service, as bt_gatt_notify walks it */
+	memset(&nfy, 0, sizeof(nfy));
+	nfy.attr = SPP_TX_VALUE;
+	nfy.type = BT_GATT_CCC_NOTIFY;
+	nfy.data = &h;
+	nfy.len = sizeof(h);
+
+	memset(sent_cnt, 0, sizeof(sent_cnt));
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		foreach_attr_scan(SPP_TX_VALUE->handle, 0xffff, notify_cb, &nfy);
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		bt_gatt_notify(NULL, SPP_TX_VALUE, &h, sizeof(h));
+	index_ns = now_ns() - start;
+	zassert_equal(sent_cnt[0], 2 * BENCH_ROUNDS, NULL);
+
+	PRINT("notify last characteristic: scan %lld ns, index %lld ns\n",
+	      scan_ns / BENCH_ROUNDS, index_ns / BENCH_ROUNDS);
+
+	bt_gatt_disconnected(c1);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(bt_gatt_db,
+			 ztest_unit_test(test_gatt_db_index),
+			 ztest_unit_test(test_gatt_ccc_subscribers),
+			 ztest_unit_test(test_gatt_bench));
+	ztest_run_test_suite(bt_gatt_db);
+}
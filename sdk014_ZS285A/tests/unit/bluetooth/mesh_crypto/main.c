@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CONFIG_BT_MESH_PROXY			1
+#define CONFIG_BT_MESH_MODEL_KEY_COUNT		1
+#define CONFIG_BT_MESH_MODEL_GROUP_COUNT	1
+
+#define BENCH_ROUNDS		20000
+
+#include <ext/lib/crypto/tinycrypt/source/utils.c>
+#include <ext/lib/crypto/tinycrypt/source/aes_encrypt.c>
+#include <ext/lib/crypto/tinycrypt/source/cmac_mode.c>
+#include <subsys/bluetooth/host/mesh/crypto.c>
+
+/* Mesh Profile specification, sample data 8.3.1 and 8.3.6 */
+static const u8_t net_key[16] = {
+	0x7d, 0xd7, 0x36, 0x4c, 0xd8, 0x42, 0xad, 0x18,
+	0xc1, 0x7c, 0x2b, 0x82, 0x0c, 0x84, 0xc3, 0xd6,
+};
+static const u8_t enc_key[16] = {
+	0x09, 0x53, 0xfa, 0x93, 0xe7, 0xca, 0xac, 0x96,
+	0x38, 0xf5, 0x88, 0x20, 0x22, 0x0a, 0x39, 0x8e,
+};
+static const u8_t privacy_key[16] = {
+	0x8b, 0x84, 0xee, 0xde, 0xc1, 0x00, 0x06, 0x7d,
+	0x67, 0x09, 0x71, 0xdd, 0x2a, 0xa7, 0x00, 0xcf,
+};
+static const u8_t dev_key[16] = {
+	0x9d, 0x6d, 0xd0, 0xe9, 0x6e, 0xb2, 0x5d, 0xc1,
+	0x9a, 0x40, 0xed, 0x99, 0x14, 0xf8, 0xf0, 0x3f,
+};
+
+#define IV_INDEX		0x12345678
+
+/* message #1: IVI/NID, CTL/TTL, SEQ 000001, SRC 1201, DST fffd, PDU */
+static const u8_t msg1_clear[] = {
+	0x68, 0x80, 0x00, 0x00, 0x01, 0x12, 0x01, 0xff, 0xfd,
+	0x03, 0x4b, 0x50, 0x05, 0x7e, 0x40, 0x00, 0x00, 0x01, 0x00, 0x00,
+};
+static const u8_t msg1_net_pdu[] = {
+	0x68, 0xec, 0xa4, 0x87, 0x51, 0x67, 0x65, 0xb5, 0xe5, 0xbf,
+	0xda, 0xcb, 0xaf, 0x6c, 0xb7, 0xfb, 0x6b, 0xff, 0x87, 0x1f,
+	0x03, 0x54, 0x44, 0xce, 0x83, 0xa6, 0x70, 0xdf,
+};
+
+/* message #6: DevKey, SEQ 3129ab, SRC 0003, DST 1201 */
+static const u8_t msg6_access[] = {
+	0x00, 0x56, 0x34, 0x12, 0x63, 0x96, 0x47, 0x71, 0x73, 0x4f,
+	0xbd, 0x76, 0xe3, 0xb4, 0x05, 0x19, 0xd1, 0xd9, 0x4a, 0x48,
+};
+static const u8_t msg6_enc[] = {
+	0xee, 0x9d, 0xdd, 0xfd, 0x21, 0x69, 0x32, 0x6d, 0x23, 0xf3,
+	0xaf, 0xdf, 0xcf, 0xdc, 0x18, 0xc5, 0x2f, 0xde, 0xf7, 0x72,
+	0xe0, 0xe1, 0x73, 0x08,
+};
+
+void *net_buf_simple_add(struct net_buf_simple *buf, size_t len)
+{
+	u8_t *tail = buf->data + buf->len;
+
+	buf->len += len;
+	return tail;
+}
+
+static void buf_set(struct net_buf_simple *buf, u8_t *data, size_t size,
+		    const u8_t *src, size_t len)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->data = data;
+	buf->size = size;
+	buf->len = len;
+	memcpy(data, src, len);
+}
+
+static void test_mesh_net_pdu(void)
+{
+	struct tc_aes_key_sched_struct enc, priv;
+	u8_t enc_out[16], priv_out[16], nid;
+	u8_t data[32];
+	struct net_buf_simple buf;
+
+	zassert_equal(bt_mesh_k2(net_key, (u8_t *)"", 1, &nid, enc_out,
+				 priv_out), 0, NULL);
+	zassert_equal(nid, 0x68, NULL);
+	zassert_true(!memcmp(enc_out, enc_key, 16), NULL);
+	zassert_true(!memcmp(priv_out, privacy_key, 16), NULL);
+
+	zassert_equal(bt_mesh_aes_key_sched(enc_key, &enc), 0, NULL);
+	zassert_equal(bt_mesh_aes_key_sched(privacy_key, &priv), 0, NULL);
+
+	buf_set(&buf, data, sizeof(data), msg1_clear, sizeof(msg1_clear));
+	zassert_equal(bt_mesh_net_encrypt(&enc, &buf, IV_INDEX, false), 0,
+		      NULL);
+	zassert_equal(bt_mesh_net_obfuscate(buf.data, IV_INDEX, &priv), 0,
+		      NULL);
+	zassert_equal(buf.len, sizeof(msg1_net_pdu), NULL);
+	zassert_true(!memcmp(buf.data, msg1_net_pdu, buf.len), NULL);
+
+	zassert_equal(bt_mesh_net_obfuscate(buf.data, IV_INDEX, &priv), 0,
+		      NULL);
+	zassert_equal(bt_mesh_net_decrypt(&enc, &buf, IV_INDEX, false), 0,
+		      NULL);
+	zassert_equal(buf.len, sizeof(msg1_clear), NULL);
+	zassert_true(!memcmp(buf.data, msg1_clear, buf.len), NULL);
+
+	/* a flipped bit fails the NetMIC */
+	buf_set(&buf, data, sizeof(data), msg1_net_pdu, sizeof(msg1_net_pdu));
+	bt_mesh_net_obfuscate(buf.data, IV_INDEX, &priv);
+	data[12] ^= 0x01;
+	zassert_equal(bt_mesh_net_decrypt(&enc, &buf, IV_INDEX, false),
+		      -EBADMSG, NULL);
+}
+
+static void test_mesh_app_pdu(void)
+{
+	struct tc_aes_key_sched_struct dev;
+	u8_t data[32], out_data[32];
+	struct net_buf_simple buf, out;
+
+	zassert_equal(bt_mesh_aes_key_sched(dev_key, &dev), 0, NULL);
+
+	buf_set(&buf, data, sizeof(data), msg6_access, sizeof(msg6_access));
+	zassert_equal(bt_mesh_app_encrypt(&dev, true, 0, &buf, NULL, 4, 0x0003,
+					  0x1201, 0x3129ab, IV_INDEX), 0,
+		      NULL);
+	zassert_equal(buf.len, sizeof(msg6_enc), NULL);
+	zassert_true(!memcmp(buf.data, msg6_enc, buf.len), NULL);
+
+	buf.len -= 4;
+	memset(&out, 0, sizeof(out));
+	out.data = out_data;
+	out.size = sizeof(out_data);
+	zassert_equal(bt_mesh_app_decrypt(&dev, true, 0, &buf, 4, &out, NULL,
+					  0x0003, 0x1201, 0x3129ab, IV_INDEX),
+		      0, NULL);
+	zassert_equal(out.len, sizeof(msg6_access), NULL);
+	zassert_true(!memcmp(out.data, msg6_access, out.len), NULL);
+}
+
+/* CCM the way it was done before the keys were cached: one
+ * bt_encrypt_be(), so one key expansion, per AES block.
+ */
+int bt_encrypt_be(const u8_t key[16], const u8_t plaintext[16],
+		  u8_t enc_data[16])
+{
+	struct tc_aes_key_sched_struct s;
+
+	if (tc_aes128_set_encrypt_key(&s, key) == TC_CRYPTO_FAIL ||
+	    tc_aes_encrypt(enc_data, plaintext, &s) == TC_CRYPTO_FAIL) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void rekey_ccm_encrypt(const u8_t key[16], const u8_t nonce[13],
+			      u8_t *msg, size_t msg_len, size_t mic_size)
+{
+	u8_t pmsg[16], cmic[16], cmsg[16], Xn[16];
+	size_t i, j, blk_len;
+
+	pmsg[0] = 0x01;
+	memcpy(pmsg + 1, nonce, 13);
+	sys_put_be16(0x0000, pmsg + 14);
+	bt_encrypt_be(key, pmsg, cmic);
+
+	pmsg[0] = (mic_size == sizeof(u64_t)) ? 0x19 : 0x09;
+	sys_put_be16(msg_len, pmsg + 14);
+	bt_encrypt_be(key, pmsg, Xn);
+
+	for (j = 0; j * 16 < msg_len; j++) {
+		blk_len = min(msg_len - j * 16, 16);
+
+		for (i = 0; i < 16; i++) {
+			pmsg[i] = Xn[i] ^ (i < blk_len ? msg[j * 16 + i] : 0);
+		}
+		bt_encrypt_be(key, pmsg, Xn);
+
+		pmsg[0] = 0x01;
+		memcpy(pmsg + 1, nonce, 13);
+		sys_put_be16(j + 1, pmsg + 14);
+		bt_encrypt_be(key, pmsg, cmsg);
+
+		for (i = 0; i < blk_len; i++) {
+			msg[j * 16 + i] ^= cmsg[i];
+		}
+	}
+
+	for (i = 0; i < mic_size; i++) {
+		msg[msg_len + i] = cmic[i] ^ Xn[i];
+	}
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void test_mesh_crypto_bench(void)
+{
+	struct tc_aes_key_sched_struct enc, priv;
+	struct net_buf_simple buf;
+	u8_t data[32], priv_rand[16], tmp[16], nonce[13];
+	long long start, rekey_ns, cached_ns;
+	int i, k;
+
+	bt_mesh_aes_key_sched(enc_key, &enc);
+	bt_mesh_aes_key_sched(privacy_key, &priv);
+
+	/* relaying message #1: deobfuscate, decrypt, encrypt, obfuscate */
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		memcpy(data, msg1_net_pdu, sizeof(msg1_net_pdu));
+		for (k = 0; k < 2; k++) {
+			memset(priv_rand, 0, 5);
+			sys_put_be32(IV_INDEX, &priv_rand[5]);
+			memcpy(&priv_rand[9], &data[7], 7);
+			bt_encrypt_be(privacy_key, priv_rand, tmp);
+			create_net_nonce(nonce, data, IV_INDEX);
+			rekey_ccm_encrypt(enc_key, nonce, &data[7],
+					  sizeof(msg1_clear) - 7, 8);
+		}
+	}
+	rekey_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		buf_set(&buf, data, sizeof(data), msg1_net_pdu,
+			sizeof(msg1_net_pdu));
+		bt_mesh_net_obfuscate(buf.data, IV_INDEX, &priv);
+		zassert_equal(bt_mesh_net_decrypt(&enc, &buf, IV_INDEX, false),
+			      0, NULL);
+		bt_mesh_net_encrypt(&enc, &buf, IV_INDEX, false);
+		bt_mesh_net_obfuscate(buf.data, IV_INDEX, &priv);
+	}
+	cached_ns = now_ns() - start;
+	zassert_true(!memcmp(data, msg1_net_pdu, sizeof(msg1_net_pdu)), NULL);
+
+	PRINT("relay network PDU: re-keying %lld ns, cached key %lld ns\n",
+	      rekey_ns / BENCH_ROUNDS, cached_ns / BENCH_ROUNDS);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(bt_mesh_crypto,
+			 ztest_unit_test(test_mesh_net_pdu),
+			 ztest_unit_test(test_mesh_app_pdu),
+			 ztest_unit_test(test_mesh_crypto_bench));
+	ztest_run_test_suite(bt_mesh_crypto);
+}
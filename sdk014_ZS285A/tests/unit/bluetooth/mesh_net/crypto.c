@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* mesh headers have no include guards, so crypto.c is built apart */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define CONFIG_BT_MESH_MODEL_KEY_COUNT		1
+#define CONFIG_BT_MESH_MODEL_GROUP_COUNT	1
+
+#include <ext/lib/crypto/tinycrypt/source/utils.c>
+#include <ext/lib/crypto/tinycrypt/source/aes_encrypt.c>
+#include <ext/lib/crypto/tinycrypt/source/cmac_mode.c>
+#include <subsys/bluetooth/host/mesh/crypto.c>
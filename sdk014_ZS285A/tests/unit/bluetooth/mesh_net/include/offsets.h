@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* unit test stub: generated by the kernel build, bt log.h only includes it */
+
+#ifndef __OFFSETS_STUB_H__
+#define __OFFSETS_STUB_H__
+
+#endif /* __OFFSETS_STUB_H__ */
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CONFIG_BT_MESH				1
+#define CONFIG_BT_MESH_MODEL_KEY_COUNT		1
+#define CONFIG_BT_MESH_MODEL_GROUP_COUNT	1
+#define CONFIG_BT_MESH_APP_KEY_COUNT		1
+#define CONFIG_BT_MESH_SUBNET_COUNT		16
+#define CONFIG_BT_MESH_CRPL			10
+#define CONFIG_BT_MESH_MSG_CACHE_SIZE		256
+#define CONFIG_BT_MESH_ADV_BUF_COUNT		6
+#define CONFIG_BT_MESH_RX_SEG_MAX		3
+#define CONFIG_BT_MESH_TX_SEG_MAX		3
+#define CONFIG_BT_MESH_RX_SDU_MAX		72
+#define CONFIG_BT_MAX_CONN			1
+#define CONFIG_BT_RX_BUF_LEN			76
+#define CONFIG_BT_L2CAP_TX_MTU			65
+
+#define BENCH_ROUNDS		20000
+
+unsigned int irq_lock(void)
+{
+	return 0;
+}
+
+void irq_unlock(unsigned int key)
+{
+}
+
+#include <kernel/atomic_c.c>
+#include <net/buf.c>
+#include <subsys/bluetooth/host/mesh/net.c>
+
+struct net_buf_pool _net_buf_pool_list[1];
+struct k_work_q k_sys_work_q;
+
+/* only reached by sending and relaying, not by decoding */
+void k_queue_init(struct k_queue *queue) {}
+void *k_queue_get(struct k_queue *queue, s32_t timeout) { return NULL; }
+void k_queue_append(struct k_queue *queue, void *data) {}
+void k_queue_append_list(struct k_queue *queue, void *head, void *tail) {}
+void k_queue_prepend(struct k_queue *queue, void *data) {}
+void k_delayed_work_init(struct k_delayed_work *work,
+			 k_work_handler_t handler) {}
+int k_delayed_work_cancel(struct k_delayed_work *work) { return 0; }
+int k_delayed_work_submit_to_queue(struct k_work_q *work_q,
+				   struct k_delayed_work *work,
+				   s32_t delay) { return 0; }
+s64_t k_uptime_get(void) { return 0; }
+void k_sleep(s32_t duration) {}
+struct net_buf *bt_mesh_adv_create(enum bt_mesh_adv_type type,
+				   u8_t xmit_count, u8_t xmit_int,
+				   s32_t timeout) { return NULL; }
+void bt_mesh_adv_send(struct net_buf *buf, bt_mesh_adv_func_t sent) {}
+void bt_mesh_beacon_ivu_initiator(bool enable) {}
+u8_t bt_mesh_relay_get(void) { return BT_MESH_RELAY_DISABLED; }
+u8_t bt_mesh_relay_retransmit_get(void) { return 0; }
+u8_t bt_mesh_default_ttl_get(void) { return 7; }
+struct bt_mesh_elem *bt_mesh_elem_find(u16_t addr) { return NULL; }
+bool bt_mesh_fixed_group_match(u16_t addr) { return false; }
+bool bt_mesh_is_provisioned(void) { return true; }
+bool bt_mesh_tx_in_progress(void) { return false; }
+int bt_mesh_trans_recv(struct net_buf_simple *buf,
+		       struct bt_mesh_net_rx *rx) { return 0; }
+
+/* Mesh Profile specification, sample data 8.3.1 */
+static const u8_t net_key[16] = {
+	0x7d, 0xd7, 0x36, 0x4c, 0xd8, 0x42, 0xad, 0x18,
+	0xc1, 0x7c, 0x2b, 0x82, 0x0c, 0x84, 0xc3, 0xd6,
+};
+
+#define IV_INDEX		0x12345678
+
+/* message #1: SEQ 000001, SRC 1201, DST fffd */
+static const u8_t msg1_net_pdu[] = {
+	0x68, 0xec, 0xa4, 0x87, 0x51, 0x67, 0x65, 0xb5, 0xe5, 0xbf,
+	0xda, 0xcb, 0xaf, 0x6c, 0xb7, 0xfb, 0x6b, 0xff, 0x87, 0x1f,
+	0x03, 0x54, 0x44, 0xce, 0x83, 0xa6, 0x70, 0xdf,
+};
+
+static void subnets_setup(int count)
+{
+	u8_t key[16];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
+		struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
+
+		memset(sub, 0, sizeof(*sub));
+		sub->net_idx = BT_MESH_KEY_UNUSED;
+		if (i >= count) {
+			continue;
+		}
+
+		memset(key, i + 1, sizeof(key));
+		zassert_equal(bt_mesh_net_keys_create(&sub->keys[0], key), 0,
+			      NULL);
+		sub->net_idx = i;
+	}
+
+	bt_mesh.iv_index = IV_INDEX;
+}
+
+/* NET_BUF_SIMPLE() does not set __buf here */
+static u8_t data_mem[29], buf_mem[29];
+static struct net_buf_simple data = {
+	.size = sizeof(data_mem),
+	.__buf = data_mem,
+};
+static struct net_buf_simple buf = {
+	.size = sizeof(buf_mem),
+	.__buf = buf_mem,
+};
+
+static int decode(const u8_t *pdu, size_t len, struct bt_mesh_net_rx *rx)
+{
+	net_buf_simple_init(&data, 0);
+	net_buf_simple_add_mem(&data, pdu, len);
+	memset(rx, 0, sizeof(*rx));
+
+	return bt_mesh_net_decode(&data, BT_MESH_NET_IF_ADV, rx, &buf, NULL);
+}
+
+static void test_net_cache(void)
+{
+	u64_t fifo[4], val;
+	int len = 0, next = 0;
+	int i, j;
+	bool found;
+
+	/* small values collide in the 8 entry index, compare against a
+	 * plain FIFO
+	 */
+	NET_CACHE_DEFINE(cache, 4);
+
+	srand(1);
+	for (i = 0; i < 20000; i++) {
+		val = rand() % 12;
+
+		found = false;
+		for (j = 0; j < len; j++) {
+			found |= (fifo[j] == val);
+		}
+
+		zassert_equal(net_cache_has(&cache, val), found, NULL);
+
+		if (!found) {
+			net_cache_add(&cache, val);
+			fifo[next] = val;
+			next = (next + 1) % ARRAY_SIZE(fifo);
+			if (len < ARRAY_SIZE(fifo)) {
+				len++;
+			}
+		}
+	}
+}
+
+static void test_nid_index(void)
+{
+	struct bt_mesh_net_rx rx;
+	struct bt_mesh_subnet *sub;
+
+	subnets_setup(4);
+
+	/* the sample key on subnet 2, a foreign NID on the others */
+	sub = &bt_mesh.sub[2];
+	zassert_equal(bt_mesh_net_keys_create(&sub->keys[0], net_key), 0,
+		      NULL);
+	zassert_equal(sub->keys[0].nid, 0x68, NULL);
+
+	zassert_equal(decode(msg1_net_pdu, sizeof(msg1_net_pdu), &rx), 0,
+		      NULL);
+	zassert_equal_ptr(rx.sub, sub, NULL);
+	zassert_equal(rx.ctx.net_idx, 2, NULL);
+	zassert_equal(rx.new_key, 0, NULL);
+	zassert_equal(rx.ctx.addr, 0x1201, NULL);
+	zassert_equal(rx.dst, 0xfffd, NULL);
+	zassert_equal(rx.seq, 1, NULL);
+
+	/* same advertising packet again, dropped by the dup cache */
+	zassert_equal(decode(msg1_net_pdu, sizeof(msg1_net_pdu), &rx),
+		      -EINVAL, NULL);
+
+	/* subnet 2 deleted, the sample key is the new key of subnet 3 */
+	memset(sub, 0, sizeof(*sub));
+	sub->net_idx = BT_MESH_KEY_UNUSED;
+	bt_mesh_net_nid_index_invalidate();
+
+	sub = &bt_mesh.sub[3];
+	zassert_equal(bt_mesh_net_keys_create(&sub->keys[1], net_key), 0,
+		      NULL);
+	sub->kr_phase = BT_MESH_KR_PHASE_2;
+
+	/* a fresh dup cache, the relay cache still knows the message */
+	memset(dup_cache_idx, 0, sizeof(dup_cache_idx));
+	dup_cache.len = 0;
+	zassert_equal(decode(msg1_net_pdu, sizeof(msg1_net_pdu), &rx),
+		      -ENOENT, NULL);
+
+	memset(msg_cache_idx, 0, sizeof(msg_cache_idx));
+	msg_cache.len = 0;
+	memset(dup_cache_idx, 0, sizeof(dup_cache_idx));
+	dup_cache.len = 0;
+	zassert_equal(decode(msg1_net_pdu, sizeof(msg1_net_pdu), &rx), 0,
+		      NULL);
+	zassert_equal_ptr(rx.sub, sub, NULL);
+	zassert_equal(rx.new_key, 1, NULL);
+
+	/* back in normal phase the new key is no longer tried */
+	sub->kr_phase = BT_MESH_KR_NORMAL;
+	bt_mesh_net_nid_index_invalidate();
+	memset(msg_cache_idx, 0, sizeof(msg_cache_idx));
+	msg_cache.len = 0;
+	memset(dup_cache_idx, 0, sizeof(dup_cache_idx));
+	dup_cache.len = 0;
+	zassert_equal(decode(msg1_net_pdu, sizeof(msg1_net_pdu), &rx),
+		      -ENOENT, NULL);
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool scan_is_known(u64_t hash)
+{
+	u16_t i;
+
+	for (i = 0; i < msg_cache.len; i++) {
+		if (msg_cache.val[i] == hash) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool scan_find_and_decrypt(const u8_t *data, size_t data_len,
+				  struct bt_mesh_net_rx *rx,
+				  struct net_buf_simple *buf)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bt_mesh.sub); i++) {
+		struct bt_mesh_subnet *sub = &bt_mesh.sub[i];
+
+		if (sub->net_idx == BT_MESH_KEY_UNUSED) {
+			continue;
+		}
+
+		if (!net_decrypt(sub, 0, data, data_len, rx, buf)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void test_net_bench(void)
+{
+	struct bt_mesh_net_rx rx;
+	long long start, scan_ns, index_ns;
+	u64_t hash;
+	int i, n = 0;
+
+	/* full relay cache, lookups of messages not seen yet */
+	for (i = 0; i < CONFIG_BT_MESH_MSG_CACHE_SIZE; i++) {
+		msg_cache_add(((u64_t)i << 24) | 0x68);
+	}
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		hash = ((u64_t)(i + 1000) << 24) | 0x68;
+		n += scan_is_known(hash);
+	}
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		hash = ((u64_t)(i + 1000) << 24) | 0x68;
+		n += msg_is_known(hash);
+	}
+	index_ns = now_ns() - start;
+	zassert_equal(n, 0, NULL);
+
+	PRINT("%u entry relay cache miss: scan %lld ns, hash %lld ns\n",
+	      CONFIG_BT_MESH_MSG_CACHE_SIZE, scan_ns / BENCH_ROUNDS,
+	      index_ns / BENCH_ROUNDS);
+
+	/* all subnets in use, a PDU of another network */
+	subnets_setup(CONFIG_BT_MESH_SUBNET_COUNT);
+	memset(&rx, 0, sizeof(rx));
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		n += scan_find_and_decrypt(msg1_net_pdu, sizeof(msg1_net_pdu),
+					   &rx, &buf);
+	}
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		n += net_find_and_decrypt(msg1_net_pdu, sizeof(msg1_net_pdu),
+					  &rx, &buf);
+	}
+	index_ns = now_ns() - start;
+	zassert_equal(n, 0, NULL);
+
+	PRINT("%u subnets, foreign NID: scan %lld ns, index %lld ns\n",
+	      CONFIG_BT_MESH_SUBNET_COUNT, scan_ns / BENCH_ROUNDS,
+	      index_ns / BENCH_ROUNDS);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(bt_mesh_net,
+			 ztest_unit_test(test_net_cache),
+			 ztest_unit_test(test_nid_index),
+			 ztest_unit_test(test_net_bench));
+	ztest_run_test_suite(bt_mesh_net);
+}
@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CONFIG_NVRAM_USER_REGION_SEGMENT_SIZE		0x8000
+#define CONFIG_NVRAM_FACTORY_REGION_SEGMENT_SIZE	0x1000
+#define CONFIG_NVRAM_HASH_INDEX				1
+#define CONFIG_NVRAM_USER_HASH_INDEX_SIZE		1024
+#define CONFIG_NVRAM_FACTORY_HASH_INDEX_SIZE		128
+#define CONFIG_NVRAM_WRITE_BACK				1
+#define CONFIG_NVRAM_WRITE_BACK_BUF_SIZE		1024
+#define CONFIG_NVRAM_WRITE_BACK_DELAY			3000
+#define CONFIG_NVRAM_BACKGROUND_GC			1
+#define CONFIG_NVRAM_GC_FREE_PERCENT			25
+#define CONFIG_NVRAM_GC_MAX_SEGMENTS			16
+#define CONFIG_NVRAM_CONFIG_INIT_PRIORITY		48
+
+static int find_lsb_set(u32_t op)
+{
+	return __builtin_ffs(op);
+}
+
+static void panic(const char *msg)
+{
+	ztest_test_fail();
+}
+
+/* delayed work runs only when the test fires it */
+static k_work_handler_t work_handler;
+static int work_pending;
+
+void k_delayed_work_init(struct k_delayed_work *work, k_work_handler_t handler)
+{
+	work_handler = handler;
+}
+
+int k_delayed_work_submit_to_queue(struct k_work_q *work_q,
+				   struct k_delayed_work *work, s32_t delay)
+{
+	work_pending = 1;
+	return 0;
+}
+
+s32_t _timeout_remaining_get(struct _timeout *timeout)
+{
+	return work_pending;
+}
+
+struct k_work_q k_sys_work_q;
+
+#include <drivers/nvram/nvram_config.c>
+
+#define FLASH_SIZE	(CONFIG_NVRAM_USER_REGION_SEGMENT_SIZE * 2)
+#define KEY_NUM		(500)
+#define GET_ROUNDS	(10)
+
+static u8_t flash[FLASH_SIZE];
+static int flash_read_cnt;
+static int flash_read_bytes;
+
+/* simulated flash region, reads are counted */
+int nvram_storage_read(struct device *dev, u32_t addr, void *buf, s32_t size)
+{
+	flash_read_cnt++;
+	flash_read_bytes += size;
+	memcpy(buf, &flash[addr], size);
+	return 0;
+}
+
+int nvram_storage_write(struct device *dev, u32_t addr, const void *buf, s32_t size)
+{
+	const u8_t *p = buf;
+	int i;
+
+	/* flash write only clears bits */
+	for (i = 0; i < size; i++)
+		flash[addr + i] &= p[i];
+
+	return 0;
+}
+
+int nvram_storage_erase(struct device *dev, u32_t addr, s32_t size)
+{
+	memset(&flash[addr], 0xff, size);
+	return 0;
+}
+
+struct device *nvram_storage_init(void)
+{
+	return (struct device *)-1;
+}
+
+const struct partition_entry *partition_get_part(u8_t file_id)
+{
+	return NULL;
+}
+
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+void k_busy_wait(u32_t usec_to_wait) {}
+
+static struct region_info *region = &user_nvram_region;
+
+static void key_name(char *name, int i)
+{
+	sprintf(name, "BT_CFG_KEY_%03d", i);
+}
+
+static void open_region(void)
+{
+	memset(flash, 0xff, sizeof(flash));
+
+	region->storage = nvram_storage_init();
+	region->base_addr = 0;
+	region->total_size = FLASH_SIZE;
+	region->seg_size = CONFIG_NVRAM_USER_REGION_SEGMENT_SIZE;
+	region->seg_seq_id = 0;
+	wb_used = 0;
+	zassert_equal(region_scan(region), 0, "scan failed");
+	k_delayed_work_init(&nvram_work, nvram_work_handler);
+}
+
+/* simulate reboot, index is rebuilt by scan */
+static void rescan_region(void)
+{
+	memset(region->item_index, 0xa5, region->item_index_size * sizeof(struct item_index_entry));
+	region->seg_seq_id = 0;
+	zassert_equal(region_scan(region), 0, "scan failed");
+}
+
+static void set_keys(int from, int to, u32_t salt)
+{
+	char name[32];
+	u32_t value;
+	int i;
+
+	for (i = from; i < to; i++) {
+		key_name(name, i);
+		value = i ^ salt;
+		zassert_equal(nvram_config_set(name, &value, sizeof(value)), 0, "set failed");
+	}
+
+	nvram_config_sync();
+}
+
+static void check_keys(int from, int to, u32_t salt)
+{
+	char name[32];
+	u32_t value;
+	int i;
+
+	for (i = from; i < to; i++) {
+		key_name(name, i);
+		zassert_equal(nvram_config_get(name, &value, sizeof(value)), sizeof(value),
+			      "get failed");
+		zassert_equal(value, i ^ salt, "wrong value");
+	}
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bench_get(const char *mode)
+{
+	long long start;
+	int i;
+
+	flash_read_cnt = 0;
+	flash_read_bytes = 0;
+	start = now_ns();
+
+	for (i = 0; i < GET_ROUNDS; i++)
+		check_keys(0, KEY_NUM, 0);
+
+	PRINT("%s: %d keys, per get %d flash reads %d bytes %lld ns\n", mode, KEY_NUM,
+	      flash_read_cnt / (KEY_NUM * GET_ROUNDS),
+	      flash_read_bytes / (KEY_NUM * GET_ROUNDS),
+	      (now_ns() - start) / (KEY_NUM * GET_ROUNDS));
+}
+
+void test_nvram_index_get(void)
+{
+	int index_reads;
+
+	open_region();
+	set_keys(0, KEY_NUM, 0);
+	zassert_equal(region->item_index_cnt, KEY_NUM, NULL);
+
+	bench_get("hash index");
+	index_reads = flash_read_cnt;
+
+	region->item_index_overflow = 1;
+	bench_get("segment scan");
+	region->item_index_overflow = 0;
+
+	/* header + name + data, a few more for 16-bit hash collisions */
+	zassert_true(index_reads <= (3 * KEY_NUM + KEY_NUM / 10) * GET_ROUNDS,
+		     "index lookup must not scan");
+}
+
+void test_nvram_index_update(void)
+{
+	char name[32];
+	u32_t value;
+	int i;
+
+	open_region();
+	set_keys(0, KEY_NUM, 0);
+
+	/* fill the segment several times, every purge rebuilds the index */
+	for (i = 1; i <= 4; i++)
+		set_keys(0, KEY_NUM, i);
+	check_keys(0, KEY_NUM, 4);
+	/* plus erase counter item saved by purge */
+	zassert_equal(region->item_index_cnt, KEY_NUM + 1, NULL);
+
+	/* delete odd keys */
+	for (i = 1; i < KEY_NUM; i += 2) {
+		key_name(name, i);
+		zassert_equal(nvram_config_set(name, NULL, 0), 0, NULL);
+	}
+	nvram_config_sync();
+	zassert_equal(region->item_index_cnt, KEY_NUM / 2 + 1, NULL);
+
+	for (i = 0; i < KEY_NUM; i++) {
+		key_name(name, i);
+		if (i & 1)
+			zassert_equal(nvram_config_get(name, &value, sizeof(value)), -ENOENT, NULL);
+		else
+			zassert_equal(nvram_config_get(name, &value, sizeof(value)), sizeof(value), NULL);
+	}
+
+	rescan_region();
+	zassert_equal(region->item_index_cnt, KEY_NUM / 2 + 1, NULL);
+	for (i = 0; i < KEY_NUM; i += 2) {
+		key_name(name, i);
+		zassert_equal(nvram_config_get(name, &value, sizeof(value)), sizeof(value), NULL);
+		zassert_equal(value, i ^ 4, NULL);
+	}
+}
+
+void test_nvram_index_overflow(void)
+{
+	int size = region->item_index_size;
+
+	open_region();
+
+	/* index of 64 entries holds 48 items, then falls back to scan */
+	region->item_index_size = 64;
+	set_keys(0, KEY_NUM, 0);
+	zassert_true(region->item_index_overflow, NULL);
+	check_keys(0, KEY_NUM, 0);
+
+	region->item_index_size = size;
+	rescan_region();
+	zassert_false(region->item_index_overflow, NULL);
+	check_keys(0, KEY_NUM, 0);
+}
+
+static void run_work(void)
+{
+	if (work_pending) {
+		work_pending = 0;
+		work_handler(NULL);
+	}
+}
+
+void test_nvram_write_back(void)
+{
+	u32_t flash_bytes, value;
+	int i;
+
+	open_region();
+	set_keys(0, 16, 0);
+
+	/* a burst of volume changes stays in the journal */
+	flash_bytes = region->flash_write_bytes;
+	for (i = 0; i < 100; i++) {
+		value = i;
+		zassert_equal(nvram_config_set("VOLUME", &value, sizeof(value)), 0, NULL);
+		zassert_equal(nvram_config_get("VOLUME", &value, sizeof(value)), sizeof(value), NULL);
+		zassert_equal(value, i, "journal must be read first");
+	}
+	zassert_equal(region->flash_write_bytes, flash_bytes, "set must not write flash");
+	zassert_true(work_pending, "flush not scheduled");
+
+	/* deleted key reads as missing before flush */
+	zassert_equal(nvram_config_set("BT_CFG_KEY_001", NULL, 0), 0, NULL);
+	zassert_equal(nvram_config_get("BT_CFG_KEY_001", &value, sizeof(value)), -ENOENT, NULL);
+
+	run_work();
+	PRINT("write back: 100 sets flushed as %d bytes, coalesced %d\n",
+	      region->flash_write_bytes - flash_bytes, wb_coalesce_cnt);
+	zassert_true(region->flash_write_bytes - flash_bytes < 2 * 32 + 2, "not coalesced");
+
+	/* reboot, only the last value is kept */
+	rescan_region();
+	zassert_equal(nvram_config_get("VOLUME", &value, sizeof(value)), sizeof(value), NULL);
+	zassert_equal(value, 99, NULL);
+	zassert_equal(nvram_config_get("BT_CFG_KEY_001", &value, sizeof(value)), -ENOENT, NULL);
+	check_keys(2, 16, 0);
+}
+
+/* 4 small segments to wrap many times */
+static void open_small_region(int seg_size, int total_size)
+{
+	open_region();
+	region->seg_size = seg_size;
+	region->total_size = total_size;
+	region->seg_erased = total_size;
+	memset(region->seg_erase_cnt, 0, region->seg_erase_cnt_num * sizeof(u32_t));
+	region_init_new_seg(region, 0);
+}
+
+void test_nvram_background_gc(void)
+{
+	u32_t purge_cnt, min_cnt, max_cnt;
+	int i, seg_num;
+
+	open_small_region(0x1000, 0x4000);
+	seg_num = region->total_size / region->seg_size;
+
+	for (i = 0; i < 200; i++) {
+		purge_cnt = region->purge_cnt;
+		set_keys(0, 16, i);
+		zassert_equal(region->purge_cnt, purge_cnt, "set must not purge");
+		run_work();
+	}
+	check_keys(0, 16, 199);
+
+	min_cnt = max_cnt = region->seg_erase_cnt[0];
+	for (i = 1; i < seg_num; i++) {
+		min_cnt = min(min_cnt, region->seg_erase_cnt[i]);
+		max_cnt = max(max_cnt, region->seg_erase_cnt[i]);
+	}
+	PRINT("background gc: purge %d, segment erase count %d ~ %d, write amplification %d%%\n",
+	      region->purge_cnt, min_cnt, max_cnt,
+	      (int)((u64_t)region->flash_write_bytes * 100 / region->app_write_bytes));
+	zassert_true(region->purge_cnt > 10, "gc not run");
+	zassert_true(max_cnt - min_cnt <= 1, "wear not leveled");
+
+	/* counters survive reboot */
+	min_cnt = region->seg_erase_cnt[0];
+	rescan_region();
+	zassert_equal(region->seg_erase_cnt[0], min_cnt, NULL);
+	check_keys(0, 16, 199);
+}
+
+void test_nvram_write_full(void)
+{
+	u8_t data[200], value[200];
+	char name[32];
+	int i, ok[40];
+
+	open_small_region(0x1000, 0x4000);
+
+	/* valid items need more than one segment */
+	for (i = 0; i < ARRAY_SIZE(ok); i++) {
+		key_name(name, i);
+		memset(data, i, sizeof(data));
+		ok[i] = !nvram_config_set(name, data, sizeof(data));
+		zassert_true(region->seg_write_offset <= region->seg_offset + region->seg_size,
+			     "write past segment end");
+	}
+
+	zassert_equal(nvram_config_sync(), -ENOSPC, "flush error lost");
+	zassert_true(wb_used > 0, "failed entries dropped");
+	zassert_true(region->seg_write_offset <= region->seg_offset + region->seg_size, NULL);
+
+	/* an accepted set is in flash or still in the journal */
+	for (i = 0; i < ARRAY_SIZE(ok); i++) {
+		if (!ok[i])
+			continue;
+		key_name(name, i);
+		zassert_equal(nvram_config_get(name, value, sizeof(value)), sizeof(value), NULL);
+		memset(data, i, sizeof(data));
+		zassert_true(!memcmp(value, data, sizeof(data)), NULL);
+	}
+}
+
+void test_nvram_gc_erase_ahead(void)
+{
+	u32_t cnt;
+
+	open_small_region(0x1000, 0x4000);
+	set_keys(0, 16, 0);
+
+	/* segment 2 is the least erased one */
+	region->seg_erase_cnt[1] = 5;
+	region->seg_erase_cnt[2] = 3;
+	region->seg_erase_cnt[3] = 5;
+	flash[0x2000 + 0x100] = 0;
+	flash[0x3000 + 0x100] = 0;
+
+	region_erase_next_seg(region);
+	zassert_equal(region->seg_erased, 0x2000, "ring next erased ahead");
+	zassert_equal(region->seg_erase_cnt[2], 4, NULL);
+	zassert_equal(region->seg_erase_cnt[3], 5, "other segment erased");
+
+	/* the purge takes it without erasing it again */
+	cnt = region->erase_cnt;
+	region_purge_seg(region, 0);
+	zassert_equal(region->seg_offset, 0x2000, NULL);
+	zassert_equal(region->erase_cnt, cnt, "erased inline");
+	zassert_equal(region->seg_erased, region->total_size, NULL);
+	check_keys(0, 16, 0);
+}
+
+void test_nvram_gc_many_segments(void)
+{
+	int cnt_num = region->seg_erase_cnt_num;
+	u32_t seg_offset;
+	int i;
+
+	/* more segments than erase counters, ring order */
+	region->seg_erase_cnt_num = 8;
+	open_small_region(0x1000, FLASH_SIZE);
+	zassert_false(region_wear_leveled(region), NULL);
+
+	for (i = 0; i < 100; i++) {
+		seg_offset = region->seg_offset;
+		set_keys(0, 16, i);
+		run_work();
+		if (region->seg_offset != seg_offset)
+			zassert_equal(region->seg_offset,
+				      (seg_offset + region->seg_size) % region->total_size,
+				      "not ring order");
+	}
+	zassert_true(region->purge_cnt > 16, "gc not run");
+	check_keys(0, 16, 99);
+	zassert_equal(region_get(region, NVRAM_ERASE_CNT_NAME, &i, sizeof(i)), -ENOENT, NULL);
+	region->seg_erase_cnt_num = cnt_num;
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_nvram_index,
+			 ztest_unit_test(test_nvram_index_get),
+			 ztest_unit_test(test_nvram_index_update),
+			 ztest_unit_test(test_nvram_index_overflow),
+			 ztest_unit_test(test_nvram_write_back),
+			 ztest_unit_test(test_nvram_background_gc),
+			 ztest_unit_test(test_nvram_write_full),
+			 ztest_unit_test(test_nvram_gc_erase_ahead),
+			 ztest_unit_test(test_nvram_gc_many_segments));
+	ztest_run_test_suite(test_nvram_index);
+}
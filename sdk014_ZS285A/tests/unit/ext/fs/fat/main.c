@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONFIG_FAT_FILESYSTEM_ELM			1
+#define CONFIG_FILE_SYSTEM_FAT				1
+#define CONFIG_LONG_FILE_NAME				1
+#define CONFIG_FAT_FASTSEEK				1
+#define CONFIG_DISKIO_CACHE				1
+#define CONFIG_DISKIO_CACHE_LINE_SIZE			1024
+#define CONFIG_DISKIO_CACHE_SETS			1
+#define CONFIG_DISKIO_CACHE_WAYS			2
+#define CONFIG_DISKIO_CACHE_READAHEAD			1
+#define CONFIG_DISKIO_CACHE_READAHEAD_LINES		1
+#define CONFIG_DISK_RAM_VOLUME_SIZE			16384
+#define CONFIG_NUM_PREEMPT_PRIORITIES			15
+#define CONFIG_RTC_0_NAME				"RTC_0"
+#define CONFIG_APPLICATION_INIT_PRIORITY		90
+#define CONFIG_KERNEL_INIT_PRIORITY_DEFAULT		40
+#define STACK_ALIGN					4
+
+/* FatFs needs 32-bit DWORD, host long is 64-bit */
+#define LONG						int
+#define DWORD						unsigned int
+
+#include <ext/fs/fat/ff.c>
+#include <ext/fs/fat/option/unicode.c>
+#include <ext/fs/fat/option/syscall.c>
+#undef SYS_LOG_DOMAIN
+#undef SYS_LOG_LEVEL
+#include <ext/fs/fat/diskio.c>
+#undef SYS_LOG_DOMAIN
+#undef SYS_LOG_LEVEL
+#include <ext/fs/fat/diskio_cache.c>
+#include <subsys/disk/disk_access_ram.c>
+/* both define a static translate_error */
+#define translate_error fs_translate_error
+#include <subsys/fs/fat_fs.c>
+#undef translate_error
+
+void *mem_malloc(unsigned int num_bytes)
+{
+	return calloc(1, num_bytes);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+/* only nor flash files are mapped */
+FRESULT f_map(FIL *fp, void **addr)
+{
+	return FR_DENIED;
+}
+
+void k_mutex_init(struct k_mutex *mutex) {}
+int k_mutex_lock(struct k_mutex *mutex, s32_t timeout) { return 0; }
+void k_mutex_unlock(struct k_mutex *mutex) {}
+void k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit) {}
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+void k_queue_init(struct k_queue *queue) {}
+
+/* no cache thread, requests are served in place */
+void k_queue_append(struct k_queue *queue, void *data)
+{
+	_diskio_cache_handle_req(data);
+}
+
+void *k_queue_get(struct k_queue *queue, s32_t timeout)
+{
+	return NULL;
+}
+
+int os_thread_create(char *stack, size_t stack_size,
+		     void (*entry)(void *, void *, void *),
+		     void *p1, void *p2, void *p3,
+		     int prio, u32_t options, s32_t delay)
+{
+	return 0;
+}
+
+static int rtc_get(struct device *dev, struct rtc_time *tm)
+{
+	memset(tm, 0, sizeof(*tm));
+	tm->tm_year = 119;
+	return 0;
+}
+
+static const struct rtc_driver_api rtc_api = {
+	.get_time = rtc_get,
+};
+
+static struct device rtc_dev = {
+	.driver_api = &rtc_api,
+};
+
+struct device *device_get_binding(const char *name)
+{
+	return &rtc_dev;
+}
+
+#define FILE_NUM	(12)
+#define FILE_SIZE	(200 * 1024 + 123)
+#define CHUNK_SIZE	(16 * 1024)
+#define FRAME_SIZE	(1044)
+
+static FATFS fatfs;
+static u8_t work_buf[_MAX_SS];
+static u8_t frame_buf[CHUNK_SIZE];
+
+static int read_req_cnt;
+static int read_sector_cnt;
+
+/* ram disk with counted reads */
+static int count_disk_read(struct disk_info *disk, u8_t *buff, u32_t sector, u32_t count)
+{
+	read_req_cnt++;
+	read_sector_cnt += count;
+	return ram_disk_access_read(disk, buff, sector, count);
+}
+
+static struct diskio_cache_req *race_req;
+
+/* a readahead queued before the write lands is served while it is in flight */
+static int count_disk_write(struct disk_info *disk, const u8_t *buff, u32_t sector, u32_t count)
+{
+	if (race_req) {
+		_diskio_cache_handle_req(race_req);
+		race_req = NULL;
+	}
+
+	return ram_disk_access_write(disk, buff, sector, count);
+}
+
+static const struct disk_operation count_disk_operation = {
+	.init		= ram_disk_access_init,
+	.get_status	= ram_disk_access_status,
+	.read		= count_disk_read,
+	.write		= count_disk_write,
+	.ioctl		= ram_disk_access_ioctl,
+};
+
+static struct disk_info count_disk = {
+	.name		= "NOR",
+	.sector_size	= RAMDISK_SECTOR_SIZE,
+	.sector_cnt	= RAMDISK_VOLUME_SIZE / RAMDISK_SECTOR_SIZE,
+	.op		= &count_disk_operation,
+};
+
+static void fill_frame(u8_t *buf, int len, int file, int offset)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (u8_t)(file * 31 + (offset + i) * 7 + ((offset + i) >> 9));
+}
+
+static void check_frame(const u8_t *buf, int len, int file, int offset)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != (u8_t)(file * 31 + (offset + i) * 7 + ((offset + i) >> 9)))
+			break;
+	}
+	zassert_equal(i, len, "data mismatch");
+}
+
+/* a mounted volume is not mounted again, unmount first */
+static void mount_disk(void)
+{
+	f_mount(NULL, "NOR:", 0);
+	zassert_equal(f_mount(&fatfs, "NOR:", 1), FR_OK, "mount failed");
+}
+
+/* files are written two at a time, so their cluster chains interleave */
+static void make_music_folder(void)
+{
+	FIL fil[2];
+	char path[300];
+	UINT bw;
+	int i, j, offset, len;
+
+	zassert_equal(f_mkfs("NOR:", FM_FAT | FM_SFD, 2048, work_buf, sizeof(work_buf)),
+		      FR_OK, "mkfs failed");
+	mount_disk();
+	zassert_equal(f_mkdir("NOR:/MUSIC"), FR_OK, NULL);
+
+	for (i = 0; i < FILE_NUM; i += 2) {
+		for (j = 0; j < 2; j++) {
+			sprintf(path, "NOR:/MUSIC/SONG%02d.MP3", i + j);
+			zassert_equal(f_open(&fil[j], path, FA_CREATE_ALWAYS | FA_WRITE), FR_OK, NULL);
+		}
+
+		for (offset = 0; offset < FILE_SIZE; offset += CHUNK_SIZE) {
+			len = min(CHUNK_SIZE, FILE_SIZE - offset);
+			for (j = 0; j < 2; j++) {
+				fill_frame(frame_buf, len, i + j, offset);
+				zassert_equal(f_write(&fil[j], frame_buf, len, &bw), FR_OK, NULL);
+				zassert_equal(bw, len, NULL);
+			}
+		}
+
+		for (j = 0; j < 2; j++)
+			zassert_equal(f_close(&fil[j]), FR_OK, NULL);
+	}
+}
+
+/* list the folder and decode every song frame by frame */
+static int play_music_folder(void)
+{
+	DIR dir;
+	FILINFO fno;
+	FIL fil;
+	char path[300];
+	UINT br;
+	int file, offset, songs = 0;
+
+	zassert_equal(f_opendir(&dir, "NOR:/MUSIC"), FR_OK, NULL);
+	while (f_readdir(&dir, &fno) == FR_OK && fno.fname[0]) {
+		zassert_equal(sscanf(fno.fname, "SONG%02d.MP3", &file), 1, NULL);
+		zassert_equal(fno.fsize, FILE_SIZE, NULL);
+
+		sprintf(path, "NOR:/MUSIC/%s", fno.fname);
+		zassert_equal(f_open(&fil, path, FA_READ), FR_OK, NULL);
+		for (offset = 0; offset < FILE_SIZE; offset += br) {
+			zassert_equal(f_read(&fil, frame_buf, FRAME_SIZE, &br), FR_OK, NULL);
+			zassert_true(br > 0, NULL);
+			check_frame(frame_buf, br, file, offset);
+		}
+		f_close(&fil);
+		songs++;
+	}
+	f_closedir(&dir);
+
+	return songs;
+}
+
+void test_diskio_cache_playback(void)
+{
+	int uncached_reqs, uncached_sectors;
+	struct diskio_cache_stat *stat = &diskio_cache.stat;
+	u32_t fat_total;
+
+	system_disks[0] = &count_disk;
+	diskio_cache_init(NULL);
+
+	/* uncached baseline */
+	diskio_cache.inited = 0;
+	make_music_folder();
+	read_req_cnt = read_sector_cnt = 0;
+	zassert_equal(play_music_folder(), FILE_NUM, NULL);
+	uncached_reqs = read_req_cnt;
+	uncached_sectors = read_sector_cnt;
+
+	diskio_cache_init(NULL);
+	mount_disk();
+	memset(stat, 0, sizeof(*stat));
+	read_req_cnt = read_sector_cnt = 0;
+	zassert_equal(play_music_folder(), FILE_NUM, NULL);
+
+	PRINT("playback of %d songs: no cache %d reads %d sectors, cache %d reads %d sectors\n",
+	      FILE_NUM, uncached_reqs, uncached_sectors, read_req_cnt, read_sector_cnt);
+	PRINT("hit/miss data %d/%d dir %d/%d fat %d/%d, bypass %d, prefetch %d used %d\n",
+	      stat->hit_cnt[CACHE_CLASS_DATA], stat->miss_cnt[CACHE_CLASS_DATA],
+	      stat->hit_cnt[CACHE_CLASS_DIR], stat->miss_cnt[CACHE_CLASS_DIR],
+	      stat->hit_cnt[CACHE_CLASS_FAT], stat->miss_cnt[CACHE_CLASS_FAT],
+	      stat->bypass_cnt, stat->prefetch_cnt, stat->prefetch_hit_cnt);
+
+	fat_total = stat->hit_cnt[CACHE_CLASS_FAT] + stat->miss_cnt[CACHE_CLASS_FAT];
+	zassert_true(fat_total > 0, "fat not classified");
+	zassert_true(stat->hit_cnt[CACHE_CLASS_FAT] * 100 / fat_total >= 90, "fat thrashed");
+	zassert_true(stat->prefetch_hit_cnt * 100 / stat->prefetch_cnt >= 80, "readahead wasted");
+	zassert_true(read_req_cnt * 2 < uncached_reqs, "cache does not save reads");
+}
+
+void test_diskio_cache_write_back(void)
+{
+	struct diskio_cache_stat *stat = &diskio_cache.stat;
+
+	system_disks[0] = &count_disk;
+	diskio_cache_init(NULL);
+
+	make_music_folder();
+	diskio_cache_flush(&count_disk);
+	PRINT("write back %d lines in %d writes\n", stat->write_back_cnt, stat->write_req_cnt);
+	zassert_true(stat->write_req_cnt < stat->write_back_cnt, "write back not coalesced");
+
+	/* all on disk after flush, read back without cache */
+	diskio_cache.inited = 0;
+	mount_disk();
+	zassert_equal(play_music_folder(), FILE_NUM, NULL);
+}
+
+void test_diskio_cache_write_bypass(void)
+{
+	struct diskio_cache_req *req = mem_malloc(sizeof(*req));
+	u32_t line_sectors = _diskio_line_sectors(&count_disk);
+	u32_t sector = 4 * line_sectors;
+	int len = CONFIG_DISKIO_CACHE_LINE_SIZE;
+
+	system_disks[0] = &count_disk;
+	diskio_cache_init(NULL);
+
+	fill_frame(frame_buf, len, 1, 0);
+	zassert_equal(diskio_cache_write(&count_disk, 0, frame_buf, sector, line_sectors), 0, NULL);
+
+	/* the line is loaded with the old data while the new one is written */
+	req->req_disk = &count_disk;
+	req->req_type = REQ_PREFETCH;
+	req->req_need_free = 1;
+	req->req_sector = sector;
+	req->req_count = 1;
+	race_req = req;
+
+	fill_frame(frame_buf, len, 2, 0);
+	zassert_equal(diskio_cache_write(&count_disk, 0, frame_buf, sector, line_sectors), 0, NULL);
+	zassert_is_null(race_req, "no write through");
+
+	memset(frame_buf, 0, len);
+	zassert_equal(diskio_cache_read(&count_disk, 0, frame_buf, sector, line_sectors), 0, NULL);
+	check_frame(frame_buf, len, 2, 0);
+}
+
+/* seek to every frame from the end, then read the song in chunks */
+static void play_song_seek(const char *path, int file, int map)
+{
+	fs_file_t zfp;
+	int offset, len;
+
+	zassert_equal(fs_open(&zfp, path), 0, NULL);
+	if (map)
+		zassert_true(fs_extent_map(&zfp, 64) > 1, "not fragmented");
+
+	for (offset = FILE_SIZE - FRAME_SIZE; offset > 0; offset -= 7 * FRAME_SIZE) {
+		zassert_equal(fs_seek(&zfp, offset, FS_SEEK_SET), 0, NULL);
+		zassert_equal(fs_read(&zfp, frame_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+		check_frame(frame_buf, FRAME_SIZE, file, offset);
+	}
+
+	zassert_equal(fs_seek(&zfp, 0, FS_SEEK_SET), 0, NULL);
+	for (offset = 0; offset < FILE_SIZE; offset += len) {
+		len = fs_read(&zfp, frame_buf, CHUNK_SIZE);
+		zassert_true(len > 0, NULL);
+		check_frame(frame_buf, len, file, offset);
+	}
+	zassert_equal(fs_close(&zfp), 0, NULL);
+}
+
+void test_fastseek_extent_map(void)
+{
+	int chain_reqs, chain_sectors;
+	fs_file_t zfp;
+
+	system_disks[0] = &count_disk;
+	diskio_cache.inited = 0;
+	make_music_folder();
+
+	read_req_cnt = read_sector_cnt = 0;
+	play_song_seek("NOR:/MUSIC/SONG05.MP3", 5, 0);
+	chain_reqs = read_req_cnt;
+	chain_sectors = read_sector_cnt;
+
+	read_req_cnt = read_sector_cnt = 0;
+	play_song_seek("NOR:/MUSIC/SONG05.MP3", 5, 1);
+	PRINT("seek and read a song: cluster chain %d reads %d sectors, extent map %d reads %d sectors\n",
+	      chain_reqs, chain_sectors, read_req_cnt, read_sector_cnt);
+	zassert_true(read_req_cnt * 2 < chain_reqs, "map does not save reads");
+
+	/* a file of more runs is not mapped */
+	zassert_equal(fs_open(&zfp, "NOR:/MUSIC/SONG05.MP3"), 0, NULL);
+	zassert_equal(fs_extent_map(&zfp, 4), -ENOMEM, NULL);
+	zassert_is_null(zfp.fp.cltbl, NULL);
+	zassert_equal(fs_close(&zfp), 0, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_diskio_cache,
+			 ztest_unit_test(test_diskio_cache_playback),
+			 ztest_unit_test(test_diskio_cache_write_back),
+			 ztest_unit_test(test_diskio_cache_write_bypass),
+			 ztest_unit_test(test_fastseek_extent_map));
+	ztest_run_test_suite(test_diskio_cache);
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FILE_NUM	(256)
+#define FILE_SIZE	(300)
+#define IMAGE_SIZE	(32 * (FILE_NUM + 1) + FILE_NUM * FILE_SIZE)
+
+static u8_t sdfs_image[IMAGE_SIZE] __aligned(4);
+static int flash_read_cnt;
+static int flash_read_bytes;
+
+/* count every read of the mapped flash */
+static void *flash_memcpy(void *dst, const void *src, size_t n)
+{
+	if ((u8_t *)src >= sdfs_image && (u8_t *)src < sdfs_image + IMAGE_SIZE) {
+		flash_read_cnt++;
+		flash_read_bytes += n;
+	}
+	return memcpy(dst, src, n);
+}
+
+#define CONFIG_MEMORY				1
+#define CONFIG_SD_FS				1
+#define CONFIG_SD_FS_VADDR_START		((int)(uintptr_t)sdfs_image)
+#define CONFIG_SD_FS_LOOKUP_CACHE_NUM		8
+#define memcpy_flash_data			flash_memcpy
+
+int partition_file_mapping(u8_t file_id, u32_t vaddr)
+{
+	return 0;
+}
+
+unsigned int irq_lock(void) { return 0; }
+void irq_unlock(unsigned int key) {}
+
+#include <ext/fs/sdfs/sdfs.c>
+#include <lib/utils/source/stream/stream.c>
+#include <lib/utils/source/stream/bufferstream.c>
+
+void *mem_malloc(unsigned int num_bytes)
+{
+	return calloc(1, num_bytes);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+void k_mutex_init(struct k_mutex *mutex) {}
+int k_mutex_lock(struct k_mutex *mutex, s32_t timeout) { return 0; }
+void k_mutex_unlock(struct k_mutex *mutex) {}
+void k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit) {}
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+
+struct image_dir {
+	char fname[12];
+	int offset;
+	int size;
+	unsigned int reserved[2];
+	unsigned int checksum;
+};
+
+static char names[FILE_NUM][13];
+
+static int cmp_dir(const void *a, const void *b)
+{
+	return strncasecmp(((const struct image_dir *)a)->fname,
+			   ((const struct image_dir *)b)->fname, 12);
+}
+
+/* file i holds bytes i, i + 1, ..., names in a shuffled order like make_sdfs */
+static void make_image(int sorted)
+{
+	struct image_dir *dir = (struct image_dir *)sdfs_image;
+	int i, j, data = 32 * (FILE_NUM + 1);
+
+	memset(sdfs_image, 0, sizeof(sdfs_image));
+	memcpy(dir[0].fname, "sdfs.bin", 8);
+	dir[0].offset = FILE_NUM;
+	dir[0].size = IMAGE_SIZE;
+
+	for (i = 0; i < FILE_NUM; i++) {
+		j = (i * 97) % FILE_NUM;
+		sprintf(names[i], (i & 1) ? "tts%03d.mp3" : "KEY_%03d.PCM", j);
+		memcpy(dir[i + 1].fname, names[i], strlen(names[i]));
+		dir[i + 1].offset = data;
+		dir[i + 1].size = FILE_SIZE;
+		for (j = 0; j < FILE_SIZE; j++)
+			sdfs_image[data + j] = (u8_t)(i + j);
+		data += FILE_SIZE;
+	}
+
+	if (sorted) {
+		qsort(&dir[1], FILE_NUM, sizeof(*dir), cmp_dir);
+		dir[0].reserved[0] = SDFS_DIR_SORTED;
+	}
+
+	sd_lookup_cache_num = 0;
+}
+
+static int lookup_reads(void)
+{
+	int i, len;
+	void *addr;
+
+	flash_read_cnt = 0;
+	for (i = 0; i < FILE_NUM; i++) {
+		sd_lookup_cache_num = 0;
+		zassert_equal(sd_fmap(names[i], &addr, &len), 0, "file not found");
+		zassert_equal(len, FILE_SIZE, NULL);
+		zassert_equal(*(u8_t *)addr, (u8_t)i, "wrong file");
+	}
+
+	return flash_read_cnt / FILE_NUM;
+}
+
+void test_sdfs_lookup(void)
+{
+	int linear_reads, sorted_reads;
+	char upper[13];
+	int i;
+
+	make_image(0);
+	linear_reads = lookup_reads();
+
+	make_image(1);
+	sorted_reads = lookup_reads();
+
+	PRINT("%d files, directory reads per lookup: linear %d, binary search %d\n",
+	      FILE_NUM, linear_reads, sorted_reads);
+	zassert_true(sorted_reads <= 11, "lookup is not O(log n)");
+
+	/* names are matched without case, missing names are not found */
+	for (i = 0; i < FILE_NUM; i++) {
+		strcpy(upper, names[i]);
+		upper[0] ^= 0x20;
+		zassert_equal(sd_fsize(upper), FILE_SIZE, NULL);
+	}
+	zassert_equal(sd_fsize("AAA.MP3"), -EINVAL, NULL);
+	zassert_equal(sd_fsize("ZZZ.MP3"), -EINVAL, NULL);
+	zassert_equal(sd_fsize("tts.mp3"), -EINVAL, NULL);
+}
+
+void test_sdfs_lookup_cache(void)
+{
+	void *addr;
+	int i, len;
+
+	make_image(1);
+
+	/* a played prompt is opened again without reading the directory */
+	zassert_equal(sd_fmap(names[5], &addr, &len), 0, NULL);
+	flash_read_cnt = 0;
+	zassert_equal(sd_fmap(names[5], &addr, &len), 0, NULL);
+	zassert_equal(flash_read_cnt, 0, "not cached");
+
+	/* least recently used is replaced */
+	for (i = 0; i < CONFIG_SD_FS_LOOKUP_CACHE_NUM; i++)
+		zassert_equal(sd_fmap(names[10 + i], &addr, &len), 0, NULL);
+	flash_read_cnt = 0;
+	zassert_equal(sd_fmap(names[5], &addr, &len), 0, NULL);
+	zassert_true(flash_read_cnt > 0, "must be replaced");
+	zassert_equal(*(u8_t *)addr, 5, NULL);
+}
+
+void test_sdfs_read(void)
+{
+	struct sd_file *fd;
+	u8_t buf[FILE_SIZE];
+	int i;
+
+	make_image(1);
+	fd = sd_fopen(names[7]);
+	zassert_not_null(fd, NULL);
+
+	/* one copy for the whole file */
+	flash_read_cnt = 0;
+	zassert_equal(sd_fread(fd, buf, sizeof(buf) + 10), FILE_SIZE, NULL);
+	zassert_equal(flash_read_cnt, 1, NULL);
+	for (i = 0; i < FILE_SIZE; i++)
+		zassert_equal(buf[i], (u8_t)(7 + i), NULL);
+	zassert_equal(sd_fread(fd, buf, 1), 0, NULL);
+
+	zassert_equal(sd_fseek(fd, -10, FS_SEEK_END), 0, NULL);
+	zassert_equal(sd_fread(fd, buf, sizeof(buf)), 10, NULL);
+	zassert_equal(buf[0], (u8_t)(7 + FILE_SIZE - 10), NULL);
+	sd_fclose(fd);
+}
+
+void test_sdfs_stream(void)
+{
+	struct buffer_t buffer;
+	io_stream_t stream;
+	unsigned char *ptr;
+	int len, done = 0;
+
+	make_image(1);
+	zassert_true(sd_fmap("NONE.MP3", (void **)&buffer.base, &buffer.length) != 0, NULL);
+
+	/* tts opens the mapped file as a buffer stream */
+	zassert_equal(sd_fmap(names[9], (void **)&buffer.base, &buffer.length), 0, NULL);
+	zassert_equal(buffer.length, FILE_SIZE, NULL);
+	buffer.cache_size = 0;
+	stream = buffer_stream_create(&buffer);
+	zassert_not_null(stream, NULL);
+	zassert_equal(stream_open(stream, MODE_IN), 0, NULL);
+
+	/* decoder reads the mapped file in place */
+	flash_read_cnt = 0;
+	while ((len = stream_read_claim(stream, &ptr, 64)) > 0) {
+		zassert_equal(*ptr, (u8_t)(9 + done), NULL);
+		zassert_equal(stream_read_commit(stream, len), len, NULL);
+		done += len;
+	}
+	zassert_equal(done, FILE_SIZE, NULL);
+	zassert_equal(flash_read_cnt, 0, "claim must not copy");
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_sdfs,
+			 ztest_unit_test(test_sdfs_lookup),
+			 ztest_unit_test(test_sdfs_lookup_cache),
+			 ztest_unit_test(test_sdfs_read),
+			 ztest_unit_test(test_sdfs_stream));
+	ztest_run_test_suite(test_sdfs);
+}
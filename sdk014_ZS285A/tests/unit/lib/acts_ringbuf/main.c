@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdlib.h>
+/* zephyr include dir shadows the host <pthread.h>, use C11 threads */
+#include <threads.h>
+#include <time.h>
+
+#include <lib/utils/source/acts_ringbuf/acts_ringbuf.c>
+
+void *mem_malloc(unsigned int num_bytes)
+{
+	return calloc(1, num_bytes);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+#define RING_SIZE	(4096)
+#define STRESS_BYTES	(64 * 1024 * 1024)
+#define BENCH_BYTES	(256 * 1024 * 1024)
+#define MAX_BATCH	(512)
+
+static u8_t ring_data[RING_SIZE];
+static struct acts_ringbuf ring;
+
+/* mutex used by the locked reference path, as callers do today */
+static mtx_t ring_lock;
+
+struct xfer_ctx {
+	/* use lock-free put_n/get_n instead of locked put/get */
+	int spsc;
+	/* batch size, 0 for random batches */
+	int batch;
+	/* total bytes to transfer */
+	u32_t total;
+	/* sequence errors found by consumer */
+	u32_t errors;
+};
+
+static u32_t ring_put(struct xfer_ctx *ctx, const void *data, u32_t size)
+{
+	u32_t ret;
+
+	if (ctx->spsc)
+		return acts_ringbuf_put_n(&ring, data, size);
+
+	mtx_lock(&ring_lock);
+	ret = acts_ringbuf_put(&ring, data, size);
+	mtx_unlock(&ring_lock);
+	return ret;
+}
+
+static u32_t ring_get(struct xfer_ctx *ctx, void *data, u32_t size)
+{
+	u32_t ret;
+
+	if (ctx->spsc)
+		return acts_ringbuf_get_n(&ring, data, size);
+
+	mtx_lock(&ring_lock);
+	ret = acts_ringbuf_get(&ring, data, size);
+	mtx_unlock(&ring_lock);
+	return ret;
+}
+
+static u32_t next_batch(struct xfer_ctx *ctx, unsigned int *seed, u32_t left)
+{
+	u32_t len = ctx->batch ? ctx->batch : (rand_r(seed) % MAX_BATCH) + 1;
+
+	return (len < left) ? len : left;
+}
+
+static int producer(void *arg)
+{
+	struct xfer_ctx *ctx = arg;
+	unsigned int seed = 1;
+	u8_t data[MAX_BATCH];
+	u32_t done = 0;
+	u32_t len, i;
+
+	while (done < ctx->total) {
+		len = next_batch(ctx, &seed, ctx->total - done);
+		for (i = 0; i < len; i++)
+			data[i] = (u8_t)(done + i);
+
+		while (!ring_put(ctx, data, len))
+			thrd_yield();
+
+		done += len;
+	}
+
+	return 0;
+}
+
+static int consumer(void *arg)
+{
+	struct xfer_ctx *ctx = arg;
+	unsigned int seed = 2;
+	u8_t data[MAX_BATCH];
+	u32_t done = 0;
+	u32_t len, i;
+
+	while (done < ctx->total) {
+		len = next_batch(ctx, &seed, ctx->total - done);
+
+		while (!ring_get(ctx, data, len))
+			thrd_yield();
+
+		for (i = 0; i < len; i++) {
+			if (data[i] != (u8_t)(done + i))
+				ctx->errors++;
+		}
+
+		done += len;
+	}
+
+	return 0;
+}
+
+static double run_xfer(struct xfer_ctx *ctx)
+{
+	thrd_t tx, rx;
+	struct timespec start, end;
+
+	acts_ringbuf_init(&ring, ring_data, RING_SIZE);
+	ctx->errors = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	thrd_create(&rx, consumer, ctx);
+	thrd_create(&tx, producer, ctx);
+	thrd_join(tx, NULL);
+	thrd_join(rx, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void test_spsc_stress(void)
+{
+	struct xfer_ctx ctx = {
+		.spsc = 1,
+		.batch = 0,
+		.total = STRESS_BYTES,
+	};
+
+	run_xfer(&ctx);
+
+	zassert_equal(ctx.errors, 0, "data corrupted");
+	zassert_true(acts_ringbuf_is_empty(&ring), "ring not drained");
+	zassert_equal(ring.head, STRESS_BYTES, NULL);
+}
+
+void test_spsc_non_pow2_stress(void)
+{
+	struct xfer_ctx ctx = {
+		.spsc = 1,
+		.batch = 0,
+		.total = STRESS_BYTES / 4,
+	};
+	thrd_t tx, rx;
+
+	/* modulo arithmetic path */
+	acts_ringbuf_init(&ring, ring_data, RING_SIZE - 3);
+	thrd_create(&rx, consumer, &ctx);
+	thrd_create(&tx, producer, &ctx);
+	thrd_join(tx, NULL);
+	thrd_join(rx, NULL);
+
+	zassert_equal(ctx.errors, 0, "data corrupted");
+	zassert_true(acts_ringbuf_is_empty(&ring), "ring not drained");
+}
+
+void test_spsc_bounds(void)
+{
+	u8_t data[RING_SIZE + 1];
+
+	acts_ringbuf_init(&ring, ring_data, RING_SIZE);
+
+	zassert_equal(acts_ringbuf_get_n(&ring, data, 1), 0, "read from empty ring");
+	zassert_equal(acts_ringbuf_put_n(&ring, data, RING_SIZE + 1), 0, "overflow");
+	zassert_equal(acts_ringbuf_put_n(&ring, data, RING_SIZE), RING_SIZE, NULL);
+	zassert_equal(acts_ringbuf_space_n(&ring), 0, NULL);
+	zassert_equal(acts_ringbuf_put_n(&ring, data, 1), 0, "write to full ring");
+	zassert_equal(acts_ringbuf_length_n(&ring), RING_SIZE, NULL);
+	zassert_equal(acts_ringbuf_get_n(&ring, data, RING_SIZE), RING_SIZE, NULL);
+	zassert_true(acts_ringbuf_is_empty(&ring), NULL);
+}
+
+void test_throughput(void)
+{
+	static const int batches[] = { 64, 256, 512 };
+	struct xfer_ctx ctx = {
+		.total = BENCH_BYTES,
+	};
+	double locked, spsc;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(batches); i++) {
+		ctx.batch = batches[i];
+
+		ctx.spsc = 0;
+		locked = run_xfer(&ctx);
+		zassert_equal(ctx.errors, 0, "data corrupted");
+
+		ctx.spsc = 1;
+		spsc = run_xfer(&ctx);
+		zassert_equal(ctx.errors, 0, "data corrupted");
+
+		PRINT("batch %3d: locked put/get %7.1f MB/s, lock-free put_n/get_n %7.1f MB/s\n",
+			batches[i], BENCH_BYTES / locked / 1e6, BENCH_BYTES / spsc / 1e6);
+	}
+}
+
+void test_main(void)
+{
+	mtx_init(&ring_lock, mtx_plain);
+
+	ztest_test_suite(test_acts_ringbuf_spsc,
+			 ztest_unit_test(test_spsc_bounds),
+			 ztest_unit_test(test_spsc_stress),
+			 ztest_unit_test(test_spsc_non_pow2_stress),
+			 ztest_unit_test(test_throughput));
+	ztest_run_test_suite(test_acts_ringbuf_spsc);
+}
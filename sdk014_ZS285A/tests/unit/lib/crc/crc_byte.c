@@ -0,0 +1,10 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define CONFIG_UTILS_CRC_ENGINE_BYTE	1
+#define CRC_ENGINE			byte
+
+#include "crc_engine.h"
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* build crc.c with the engine selected by the includer, prefixed by CRC_ENGINE */
+
+#define _CRC_FN(engine, fn)	engine##_##fn
+#define CRC_FN(engine, fn)	_CRC_FN(engine, fn)
+
+#define utils_crc16		CRC_FN(CRC_ENGINE, crc16)
+#define utils_crc16_init	CRC_FN(CRC_ENGINE, crc16_init)
+#define utils_crc16_update	CRC_FN(CRC_ENGINE, crc16_update)
+#define utils_crc16_final	CRC_FN(CRC_ENGINE, crc16_final)
+#define utils_crc32		CRC_FN(CRC_ENGINE, crc32)
+#define utils_crc32_init	CRC_FN(CRC_ENGINE, crc32_init)
+#define utils_crc32_update	CRC_FN(CRC_ENGINE, crc32_update)
+#define utils_crc32_final	CRC_FN(CRC_ENGINE, crc32_final)
+
+#include <lib/utils/source/crc/crc.c>
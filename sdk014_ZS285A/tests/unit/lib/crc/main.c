@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <crc.h>
+
+#define BENCH_SIZE	(64 * 1024)
+#define BENCH_ROUNDS	(64)
+
+struct crc_engine {
+	const char *name;
+	uint16_t (*crc16)(const uint8_t *src, int len, uint16_t polynomial,
+			  uint16_t initial_value, int pad);
+	void (*crc16_init)(struct utils_crc16_ctx *ctx, uint16_t polynomial,
+			   uint16_t initial_value);
+	void (*crc16_update)(struct utils_crc16_ctx *ctx, const uint8_t *src, int len);
+	uint16_t (*crc16_final)(struct utils_crc16_ctx *ctx, int pad);
+	uint32_t (*crc32)(uint32_t crc, const uint8_t *buf, int len);
+	void (*crc32_init)(struct utils_crc32_ctx *ctx);
+	void (*crc32_update)(struct utils_crc32_ctx *ctx, const uint8_t *buf, int len);
+	uint32_t (*crc32_final)(struct utils_crc32_ctx *ctx);
+};
+
+#define CRC_ENGINE_DECLARE(e) \
+	uint16_t e##_crc16(const uint8_t *, int, uint16_t, uint16_t, int); \
+	void e##_crc16_init(struct utils_crc16_ctx *, uint16_t, uint16_t); \
+	void e##_crc16_update(struct utils_crc16_ctx *, const uint8_t *, int); \
+	uint16_t e##_crc16_final(struct utils_crc16_ctx *, int); \
+	uint32_t e##_crc32(uint32_t, const uint8_t *, int); \
+	void e##_crc32_init(struct utils_crc32_ctx *); \
+	void e##_crc32_update(struct utils_crc32_ctx *, const uint8_t *, int); \
+	uint32_t e##_crc32_final(struct utils_crc32_ctx *)
+
+#define CRC_ENGINE(e) { #e, e##_crc16, e##_crc16_init, e##_crc16_update, \
+	e##_crc16_final, e##_crc32, e##_crc32_init, e##_crc32_update, e##_crc32_final }
+
+CRC_ENGINE_DECLARE(nibble);
+CRC_ENGINE_DECLARE(byte);
+CRC_ENGINE_DECLARE(slice4);
+CRC_ENGINE_DECLARE(slice8);
+
+static const struct crc_engine engines[] = {
+	CRC_ENGINE(nibble),
+	CRC_ENGINE(byte),
+	CRC_ENGINE(slice4),
+	CRC_ENGINE(slice8),
+};
+
+static uint8_t data[BENCH_SIZE + 8];
+
+/* bit serial references */
+static uint16_t ref_crc16(const uint8_t *src, int len, uint16_t polynomial,
+			  uint16_t initial_value, int pad)
+{
+	uint16_t crc = initial_value;
+	int padding = pad ? 2 : 0;
+	int i, b;
+
+	for (i = 0; i < len + padding; i++) {
+		for (b = 0; b < 8; b++) {
+			uint16_t divide = crc & 0x8000;
+
+			crc = (crc << 1);
+			if (i < len)
+				crc |= !!(src[i] & (0x80 >> b));
+			if (divide)
+				crc ^= polynomial;
+		}
+	}
+
+	return crc;
+}
+
+static uint32_t ref_crc32(const uint8_t *buf, int len)
+{
+	uint32_t crc = ~0u;
+	int b;
+
+	while (len--) {
+		crc ^= *buf++;
+		for (b = 0; b < 8; b++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+	}
+
+	return ~crc;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_crc_vectors(void)
+{
+	const uint8_t *check = (const uint8_t *)"123456789";
+	const struct crc_engine *e;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(engines); i++) {
+		e = &engines[i];
+		zassert_equal(e->crc32(0, check, 9), 0xcbf43926, e->name);
+		zassert_equal(e->crc32(0, check, 0), 0, e->name);
+		zassert_equal(e->crc32(e->crc32(0, check, 4), check + 4, 5), 0xcbf43926, e->name);
+		/* XMODEM and augmented CCITT */
+		zassert_equal(e->crc16(check, 9, 0x1021, 0, 1), 0x31c3, e->name);
+		zassert_equal(e->crc16(check, 9, 0x1021, 0xffff, 1), 0xe5cc, e->name);
+		/* untabled polynomial */
+		zassert_equal(e->crc16(check, 9, 0x8005, 0, 1),
+			      ref_crc16(check, 9, 0x8005, 0, 1), e->name);
+	}
+}
+
+void test_crc_cross_check(void)
+{
+	const struct crc_engine *e;
+	int i, n, ofs, len, pad;
+
+	srand(1);
+	for (n = 0; n < sizeof(data); n++)
+		data[n] = rand();
+
+	/* every alignment and tail length of the word loops */
+	for (n = 0; n < 2000; n++) {
+		ofs = rand() % 8;
+		len = (n < 64) ? n : rand() % 4096;
+		pad = n & 1;
+
+		for (i = 0; i < ARRAY_SIZE(engines); i++) {
+			e = &engines[i];
+			zassert_equal(e->crc32(0, data + ofs, len), ref_crc32(data + ofs, len), e->name);
+			zassert_equal(e->crc16(data + ofs, len, 0x1021, n, pad),
+				      ref_crc16(data + ofs, len, 0x1021, n, pad), e->name);
+			zassert_equal(e->crc16(data + ofs, len, 0x8005, n, pad),
+				      ref_crc16(data + ofs, len, 0x8005, n, pad), e->name);
+		}
+	}
+}
+
+void test_crc_stream(void)
+{
+	struct utils_crc16_ctx ctx16;
+	struct utils_crc32_ctx ctx32;
+	const struct crc_engine *e;
+	int i, pos, len;
+
+	for (i = 0; i < ARRAY_SIZE(engines); i++) {
+		e = &engines[i];
+		e->crc16_init(&ctx16, 0x1021, 0xffff);
+		e->crc32_init(&ctx32);
+
+		/* chunks like an ota image written packet by packet */
+		for (pos = 0; pos < 10000; pos += len) {
+			len = rand() % 300;
+			len = min(len, 10000 - pos);
+			e->crc16_update(&ctx16, data + pos, len);
+			e->crc32_update(&ctx32, data + pos, len);
+		}
+
+		zassert_equal(e->crc32_final(&ctx32), ref_crc32(data, 10000), e->name);
+		zassert_equal(e->crc16_final(&ctx16, 1), ref_crc16(data, 10000, 0x1021, 0xffff, 1),
+			      e->name);
+	}
+}
+
+void test_crc_bench(void)
+{
+	const struct crc_engine *e;
+	volatile uint32_t sink = 0;
+	long long start, ns32, ns16;
+	int i, n;
+
+	for (i = 0; i < ARRAY_SIZE(engines); i++) {
+		e = &engines[i];
+
+		start = now_ns();
+		for (n = 0; n < BENCH_ROUNDS; n++)
+			sink += e->crc32(0, data, BENCH_SIZE);
+		ns32 = now_ns() - start;
+
+		start = now_ns();
+		for (n = 0; n < BENCH_ROUNDS; n++)
+			sink += e->crc16(data, BENCH_SIZE, 0x1021, 0, 1);
+		ns16 = now_ns() - start;
+
+		PRINT("%-6s: crc32 %5lld MB/s, crc16 %5lld MB/s\n", e->name,
+		      (long long)BENCH_SIZE * BENCH_ROUNDS * 1000 / (ns32 + 1),
+		      (long long)BENCH_SIZE * BENCH_ROUNDS * 1000 / (ns16 + 1));
+	}
+
+	(void)sink;
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_crc,
+			 ztest_unit_test(test_crc_vectors),
+			 ztest_unit_test(test_crc_cross_check),
+			 ztest_unit_test(test_crc_stream),
+			 ztest_unit_test(test_crc_bench));
+	ztest_run_test_suite(test_crc);
+}
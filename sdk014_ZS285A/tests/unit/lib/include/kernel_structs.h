@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* unit test stub: stream code only needs to know whether it runs in isr */
+
+#ifndef __KERNEL_STRUCTS_STUB_H__
+#define __KERNEL_STRUCTS_STUB_H__
+
+#define _is_in_isr() (0)
+
+#endif /* __KERNEL_STRUCTS_STUB_H__ */
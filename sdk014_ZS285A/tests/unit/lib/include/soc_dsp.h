@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* unit test stub: no dsp on host */
+
+#ifndef __SOC_DSP_STUB_H__
+#define __SOC_DSP_STUB_H__
+
+#define mcu_to_dsp_data_address(addr) (UINT32_MAX)
+
+#endif /* __SOC_DSP_STUB_H__ */
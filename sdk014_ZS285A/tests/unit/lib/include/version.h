@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* unit test stub: version.h is generated by the kernel build */
+
+#ifndef __VERSION_STUB_H__
+#define __VERSION_STUB_H__
+
+#endif /* __VERSION_STUB_H__ */
@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONFIG_FAT_FILESYSTEM_ELM			1
+#define CONFIG_FILE_SYSTEM_FAT				1
+#define CONFIG_LONG_FILE_NAME				1
+#define CONFIG_DISK_RAM_VOLUME_SIZE			40960
+#define CONFIG_NUM_PREEMPT_PRIORITIES			15
+#define CONFIG_RTC_0_NAME				"RTC_0"
+#define CONFIG_APPLICATION_INIT_PRIORITY		90
+#define CONFIG_KERNEL_INIT_PRIORITY_DEFAULT		40
+#define CONFIG_FILE_ITERATOR				1
+#define CONFIG_PLIST_SUPPORT_FOLDER_CNT			100
+#define CONFIG_FILE_ITERATOR_INDEX			1
+#define CONFIG_FILE_ITERATOR_INDEX_NAME			"PLIST.IDX"
+#define CONFIG_FILE_ITERATOR_READDIR_NUM		4
+#define CONFIG_FILE_ITERATOR_SCAN_BUF_SIZE		512
+#define STACK_ALIGN					4
+
+/* FatFs needs 32-bit DWORD, host long is 64-bit */
+#define LONG						int
+#define DWORD						unsigned int
+
+#include <ext/fs/fat/ff.c>
+#include <ext/fs/fat/option/unicode.c>
+#include <ext/fs/fat/option/syscall.c>
+#undef SYS_LOG_DOMAIN
+#undef SYS_LOG_LEVEL
+#include <ext/fs/fat/diskio.c>
+#include <subsys/disk/disk_access_ram.c>
+/* both define a static translate_error */
+#define translate_error fs_translate_error
+#include <subsys/fs/fat_fs.c>
+#undef translate_error
+#include <lib/utils/source/iterator/iterator.c>
+#include <lib/utils/source/iterator/file_plist_iterator.c>
+
+void *mem_malloc(unsigned int num_bytes)
+{
+	return calloc(1, num_bytes);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+void k_mutex_init(struct k_mutex *mutex) {}
+int k_mutex_lock(struct k_mutex *mutex, s32_t timeout) { return 0; }
+void k_mutex_unlock(struct k_mutex *mutex) {}
+void k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit) {}
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+
+/* only nor flash files are mapped */
+FRESULT f_map(FIL *fp, void **addr)
+{
+	return FR_DENIED;
+}
+
+static int rtc_get(struct device *dev, struct rtc_time *tm)
+{
+	memset(tm, 0, sizeof(*tm));
+	tm->tm_year = 119;
+	return 0;
+}
+
+static const struct rtc_driver_api rtc_api = {
+	.get_time = rtc_get,
+};
+
+static struct device rtc_dev = {
+	.driver_api = &rtc_api,
+};
+
+struct device *device_get_binding(const char *name)
+{
+	return &rtc_dev;
+}
+
+#define FOLDER_NUM	(10)
+#define SONG_NUM	(30)
+#define MAX_SONGS	(512)
+
+static FATFS fatfs;
+static u8_t work_buf[_MAX_SS];
+
+static char songs[MAX_SONGS][64];
+static int song_cnt;
+static char urls[MAX_SONGS][64];
+static char tracks[MAX_SONGS][64];
+static int scan_level = 3;
+
+static int read_req_cnt;
+static int read_fail;
+
+/* ram disk with counted reads, always inserted */
+static int count_disk_read(struct disk_info *disk, u8_t *buff, u32_t sector, u32_t count)
+{
+	if (read_fail)
+		return -EIO;
+
+	read_req_cnt++;
+	return ram_disk_access_read(disk, buff, sector, count);
+}
+
+static int count_disk_write(struct disk_info *disk, const u8_t *buff, u32_t sector, u32_t count)
+{
+	return ram_disk_access_write(disk, buff, sector, count);
+}
+
+static int count_disk_ioctl(struct disk_info *disk, u8_t cmd, void *buff)
+{
+	if (cmd == DISK_IOCTL_HW_DETECT) {
+		*(u8_t *)buff = STA_DISK_OK;
+		return 0;
+	}
+
+	return ram_disk_access_ioctl(disk, cmd, buff);
+}
+
+static const struct disk_operation count_disk_operation = {
+	.init		= ram_disk_access_init,
+	.get_status	= ram_disk_access_status,
+	.read		= count_disk_read,
+	.write		= count_disk_write,
+	.ioctl		= count_disk_ioctl,
+};
+
+static struct disk_info count_disk = {
+	.name		= "NOR",
+	.sector_size	= RAMDISK_SECTOR_SIZE,
+	.sector_cnt	= RAMDISK_VOLUME_SIZE / RAMDISK_SECTOR_SIZE,
+	.op		= &count_disk_operation,
+};
+
+static int match_song(const char *path, int is_dir)
+{
+	const char *ext = strrchr(path, '.');
+
+	return is_dir || (ext && !strcmp(ext, ".MP3"));
+}
+
+/* the content of a file is its path, so an url can be checked */
+static void make_file(const char *path)
+{
+	FIL fil;
+	UINT bw;
+
+	zassert_equal(f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE), FR_OK, NULL);
+	zassert_equal(f_write(&fil, path, strlen(path), &bw), FR_OK, NULL);
+	zassert_equal(f_close(&fil), FR_OK, NULL);
+
+	if (match_song(path, 0)) {
+		zassert_true(song_cnt < MAX_SONGS, NULL);
+		strcpy(songs[song_cnt++], path);
+	}
+}
+
+static void make_folder(const char *dir, int num)
+{
+	char path[64];
+	int i;
+
+	if (strcmp(dir, "NOR:"))
+		zassert_equal(f_mkdir(dir), FR_OK, NULL);
+
+	for (i = 0; i < num; i++) {
+		sprintf(path, "%s/S%02d.MP3", dir, i);
+		make_file(path);
+	}
+
+	sprintf(path, "%s/INFO.TXT", dir);
+	make_file(path);
+}
+
+/* a mounted volume is not mounted again, unmount first */
+static void mount_disk(void)
+{
+	f_mount(NULL, "NOR:", 0);
+	zassert_equal(f_mount(&fatfs, "NOR:", 1), FR_OK, "mount failed");
+}
+
+static void make_music_disk_empty(void)
+{
+	system_disks[0] = &count_disk;
+	song_cnt = 0;
+
+	/* 512 byte clusters, FAT32 keeps the free cluster count in FSINFO */
+	zassert_equal(f_mkfs("NOR:", FM_FAT32 | FM_SFD, 512, work_buf, sizeof(work_buf)),
+		      FR_OK, "mkfs failed");
+	mount_disk();
+}
+
+static void make_music_disk(void)
+{
+	char dir[32];
+	int i;
+
+	make_music_disk_empty();
+	make_folder("NOR:", 5);
+	for (i = 0; i < FOLDER_NUM; i++) {
+		sprintf(dir, "NOR:/A%02d", i);
+		make_folder(dir, SONG_NUM);
+	}
+	make_folder("NOR:/A03/B0", 20);
+	make_folder("NOR:/A03/B1", 20);
+	make_folder("NOR:/EMPTY", 0);
+	make_folder("NOR:/EMPTY/F", 10);
+}
+
+static struct iterator *create_iterator(const char *cursor_path)
+{
+	file_iterator_cursor_t cursor = { .path = cursor_path };
+	file_iterator_param_t param = {
+		.max_level = scan_level,
+		.topdir = "NOR:",
+		.cursor = &cursor,
+		.match_fn = match_song,
+	};
+	struct iterator *iter;
+
+	/* like a card inserted again */
+	mount_disk();
+	read_req_cnt = 0;
+	iter = file_iterator_create(&param);
+	zassert_not_null(iter, "create failed");
+
+	return iter;
+}
+
+/* every url opens a song, every song once */
+static void check_tracks(struct iterator *iter)
+{
+	u8_t found[MAX_SONGS];
+	u32_t cluster, blk_ofs, size;
+	const char *url;
+	char buf[64];
+	FIL fil;
+	UINT br;
+	int i, j;
+
+	zassert_equal(play_list->sum_file_count, song_cnt, "wrong song count");
+	memset(found, 0, sizeof(found));
+
+	for (i = 1; i <= song_cnt; i++) {
+		url = iter->ops->set_track_no(iter, i);
+		zassert_not_null(url, NULL);
+		strcpy(urls[i - 1], url);
+		zassert_equal(get_cursor_info(url, &cluster, &blk_ofs, &size), 0, NULL);
+		zassert_equal(f_open_cluster(&fil, "NOR:", cluster, blk_ofs, FA_READ), FR_OK, NULL);
+		memset(buf, 0, sizeof(buf));
+		zassert_equal(f_read(&fil, buf, sizeof(buf) - 1, &br), FR_OK, NULL);
+		zassert_equal(br, size, NULL);
+		f_close(&fil);
+
+		for (j = 0; j < song_cnt; j++) {
+			if (!strcmp(songs[j], buf))
+				break;
+		}
+		zassert_true(j < song_cnt && !found[j], "wrong song");
+		found[j] = 1;
+		strcpy(tracks[i - 1], buf);
+	}
+}
+
+static int track_reads(struct iterator *iter)
+{
+	int i;
+
+	read_req_cnt = 0;
+	for (i = 1; i <= song_cnt; i++)
+		iter->ops->set_track_no(iter, i);
+
+	return read_req_cnt;
+}
+
+void test_plist_index_load(void)
+{
+	struct iterator *iter;
+	int scan_reads, load_reads, walk_reads;
+
+	make_music_disk();
+
+	/* first insert scans and writes the index */
+	iter = create_iterator(NULL);
+	scan_reads = read_req_cnt;
+	check_tracks(iter);
+	zassert_true(play_list->index->valid, "index not written");
+
+	play_list->index->valid = 0;
+	walk_reads = track_reads(iter);
+	iterator_destroy(iter);
+
+	iter = create_iterator(NULL);
+	load_reads = read_req_cnt;
+	zassert_true(play_list->index->valid, "index not loaded");
+	check_tracks(iter);
+
+	PRINT("%d songs in %d folders: scan %d reads, index %d reads\n",
+	      song_cnt, play_list->sum_folder_count + 1, scan_reads, load_reads);
+	PRINT("select every track: folder walk %d reads, index %d reads\n",
+	      walk_reads, track_reads(iter));
+	/* every folder is checked, the files are not read */
+	zassert_true(load_reads < scan_reads, "index load is not cheap");
+	iterator_destroy(iter);
+}
+
+void test_plist_index_incremental(void)
+{
+	struct iterator *iter;
+	char cursor[64];
+	int reads;
+
+	make_music_disk();
+	iterator_destroy(create_iterator(NULL));
+
+	/* new songs in one folder, only this folder is read again */
+	make_file("NOR:/A05/NEW0.MP3");
+	make_file("NOR:/A05/NEW1.MP3");
+	iter = create_iterator(NULL);
+	reads = read_req_cnt;
+	zassert_true(play_list->index->valid, "index not loaded");
+	check_tracks(iter);
+	/* old records of the folder stay until compaction */
+	zassert_equal(play_list->index->rec_cnt, song_cnt + SONG_NUM, NULL);
+	iterator_destroy(iter);
+
+	/* same order as a full scan */
+	zassert_equal(f_unlink("NOR:/" CONFIG_FILE_ITERATOR_INDEX_NAME), FR_OK, NULL);
+	iter = create_iterator(NULL);
+	PRINT("changed folder: verify %d reads, scan %d reads\n", reads, read_req_cnt);
+	/* every folder is checked, only the changed one is read again */
+	zassert_true(reads < read_req_cnt, "verify is not cheap");
+	zassert_equal(play_list->index->rec_cnt, song_cnt, NULL);
+	zassert_equal(strcmp(iter->ops->set_track_no(iter, 100), urls[99]), 0, NULL);
+	strcpy(cursor, urls[99]);
+	iterator_destroy(iter);
+
+	/* cursor is found in the records */
+	iter = create_iterator(cursor);
+	zassert_equal(play_list->file_seq_num, 100, "cursor not found");
+	iterator_destroy(iter);
+
+	/* new sub folder, the disk is scanned */
+	make_folder("NOR:/A10", 3);
+	iter = create_iterator(cursor);
+	zassert_equal(play_list->index->rec_cnt, song_cnt, NULL);
+	check_tracks(iter);
+	iterator_destroy(iter);
+}
+
+void test_plist_index_stale_entry(void)
+{
+	struct iterator *iter;
+	const char *url;
+	int i, track;
+
+	make_music_disk();
+	iter = create_iterator(NULL);
+	check_tracks(iter);
+	for (track = 1; track <= song_cnt; track++) {
+		if (!strcmp(tracks[track - 1], "NOR:/A05/S03.MP3"))
+			break;
+	}
+	iterator_destroy(iter);
+
+	/* same slot and size, written while the play list is in use */
+	iter = create_iterator(NULL);
+	zassert_true(play_list->index->valid, "index not loaded");
+	zassert_equal(f_unlink("NOR:/A05/S03.MP3"), FR_OK, NULL);
+	make_file("NOR:/A05/S03.TXT");
+	for (i = 0; i < song_cnt; i++) {
+		if (!strcmp(songs[i], "NOR:/A05/S03.MP3"))
+			strcpy(songs[i], songs[--song_cnt]);
+	}
+
+	url = iter->ops->set_track_no(iter, track);
+	zassert_not_null(url, NULL);
+	zassert_false(play_list->index->valid, "stale record used");
+	zassert_equal(strcmp(url, urls[track]), 0, "not the next song of the folder");
+	iterator_destroy(iter);
+
+	/* index is written again by a scan */
+	iter = create_iterator(NULL);
+	zassert_true(play_list->index->valid, NULL);
+	zassert_equal(play_list->index->rec_cnt, song_cnt, "index not rebuilt");
+	check_tracks(iter);
+	iterator_destroy(iter);
+
+	/* same slot, size and free count, the folder is read again at load */
+	zassert_equal(f_unlink("NOR:/A05/S04.MP3"), FR_OK, NULL);
+	make_file("NOR:/A05/S04.TXT");
+	for (i = 0; i < song_cnt; i++) {
+		if (!strcmp(songs[i], "NOR:/A05/S04.MP3"))
+			strcpy(songs[i], songs[--song_cnt]);
+	}
+
+	iter = create_iterator(NULL);
+	zassert_true(play_list->index->valid, "index not loaded");
+	check_tracks(iter);
+	iterator_destroy(iter);
+}
+
+/* the scan before single pass: files first, then the folder is read again */
+static int two_pass_scan(char *path, int level, char (*order)[64], int cnt)
+{
+	struct fs_dirent entry;
+	fs_dir_t zdir;
+	int len = strlen(path);
+	int pass;
+
+	for (pass = 0; pass < 2; pass++) {
+		zassert_equal(fs_opendir(&zdir, path), 0, NULL);
+		while (!fs_readdir(&zdir, &entry) && entry.name[0]) {
+			if (entry.name[0] == '.' || !strcmp(entry.name, CONFIG_FILE_ITERATOR_INDEX_NAME))
+				continue;
+
+			sprintf(path + len, "/%s", entry.name);
+			if (pass == 0 && entry.type == FS_DIR_ENTRY_FILE && match_song(path, 0))
+				strcpy(order[cnt++], path);
+			else if (pass == 1 && entry.type == FS_DIR_ENTRY_DIR && level + 1 < scan_level)
+				cnt = two_pass_scan(path, level + 1, order, cnt);
+			path[len] = 0;
+		}
+		fs_closedir(&zdir);
+	}
+
+	return cnt;
+}
+
+static void make_deep_folder(const char *dir, int depth)
+{
+	char path[64];
+	int i;
+
+	make_folder(dir, 4);
+	for (i = 0; depth > 1 && i < 2; i++) {
+		sprintf(path, "%s/D%d", dir, i);
+		make_deep_folder(path, depth - 1);
+	}
+}
+
+void test_plist_scan_deep(void)
+{
+	static char order[MAX_SONGS][64];
+	struct iterator *iter;
+	char path[64] = "NOR:";
+	char dir[64];
+	int two_pass_reads;
+	int i, cnt;
+
+	make_music_disk_empty();
+
+	/* 30 folders of long names do not fit the sub folder buffer */
+	for (i = 0; i < 30; i++) {
+		sprintf(dir, "NOR:/ALBUM WITH A LONG FOLDER NAME %02d", i);
+		make_folder(dir, 2);
+	}
+	make_deep_folder("NOR:/DEEP", 5);
+	scan_level = 6;
+
+	mount_disk();
+	read_req_cnt = 0;
+	cnt = two_pass_scan(path, 0, order, 0);
+	two_pass_reads = read_req_cnt;
+	zassert_equal(cnt, song_cnt, NULL);
+
+	iter = create_iterator(NULL);
+	PRINT("%d songs in %d folders: two pass scan %d reads, single pass scan %d reads\n",
+	      song_cnt, play_list->sum_folder_count + 1, two_pass_reads, read_req_cnt);
+	zassert_true(read_req_cnt < two_pass_reads, "scan reads not saved");
+
+	/* same order as the two pass scan */
+	check_tracks(iter);
+	for (i = 0; i < song_cnt; i++)
+		zassert_equal(strcmp(tracks[i], order[i]), 0, "wrong order");
+
+	iterator_destroy(iter);
+	scan_level = 3;
+}
+
+void test_plist_peek(void)
+{
+	struct iterator *iter;
+	const char *url;
+	u16_t track_no, peek_no;
+	int i, peek_reads;
+
+	make_music_disk();
+	iter = create_iterator(NULL);
+	check_tracks(iter);
+	/* files are found by reading their folder */
+	play_list->index->valid = 0;
+
+	zassert_not_null(iter->ops->set_track_no(iter, 50), NULL);
+	for (i = 0; i < 3; i++) {
+		read_req_cnt = 0;
+		url = iterator_peek(iter, true, &peek_no);
+		peek_reads = read_req_cnt;
+		zassert_not_null(url, NULL);
+		zassert_equal(peek_no, 51 + i, NULL);
+		zassert_equal(strcmp(url, urls[50 + i]), 0, NULL);
+		/* cursor does not move */
+		zassert_equal(play_list->file_seq_num, 50 + i, NULL);
+		zassert_not_null(iterator_peek(iter, false, &peek_no), NULL);
+		zassert_equal(peek_no, 49 + i, NULL);
+
+		read_req_cnt = 0;
+		url = iterator_next(iter, false, &track_no);
+		zassert_equal(read_req_cnt, 0, "next read the disk again");
+		zassert_equal(track_no, 51 + i, NULL);
+		zassert_equal(strcmp(url, urls[50 + i]), 0, NULL);
+	}
+	PRINT("peek %d reads, next after peek 0 reads\n", peek_reads);
+
+	/* back to the file peeked first */
+	zassert_not_null(iterator_peek(iter, false, &peek_no), NULL);
+	url = iterator_prev(iter, &track_no);
+	zassert_equal(track_no, 52, NULL);
+	zassert_equal(strcmp(url, urls[51]), 0, NULL);
+
+	/* no cycle in mode 2 */
+	iterator_set_mode(iter, 2);
+	zassert_not_null(iter->ops->set_track_no(iter, song_cnt), NULL);
+	zassert_is_null(iterator_peek(iter, true, &peek_no), NULL);
+	zassert_equal(play_list->file_seq_num, song_cnt, NULL);
+
+	/* folder cycle in mode 3, peek wraps like next */
+	iterator_set_mode(iter, 3);
+	zassert_not_null(iter->ops->set_track_no(iter, 5), NULL);
+	zassert_not_null(iterator_peek(iter, true, &peek_no), NULL);
+	zassert_equal(peek_no, 1, NULL);
+	iterator_next(iter, false, &track_no);
+	zassert_equal(track_no, 1, NULL);
+	zassert_not_null(iterator_peek(iter, false, &peek_no), NULL);
+	zassert_equal(peek_no, 5, NULL);
+
+	iterator_destroy(iter);
+}
+
+void test_readdir_n_error(void)
+{
+	struct fs_dirent entries[64];
+	fs_dir_t zdir;
+	int num, err;
+
+	make_music_disk();
+	mount_disk();
+
+	/* first sector of the folder is read, the next one fails */
+	zassert_equal(fs_opendir(&zdir, "NOR:/A00"), 0, NULL);
+	zassert_equal(fs_readdir_n(&zdir, entries, NULL, 1, &err), 1, NULL);
+	zassert_equal(err, 0, NULL);
+
+	read_fail = 1;
+	num = fs_readdir_n(&zdir, entries, NULL, ARRAY_SIZE(entries), &err);
+	read_fail = 0;
+	fs_closedir(&zdir);
+
+	/* the entries of the first sector and the error */
+	zassert_true(num > 0 && num < SONG_NUM, "batch not cut by the error");
+	zassert_equal(err, -EIO, "error dropped");
+	zassert_true(entries[num - 1].name[0] != 0, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_plist_index,
+			 ztest_unit_test(test_plist_index_load),
+			 ztest_unit_test(test_plist_index_incremental),
+			 ztest_unit_test(test_plist_index_stale_entry),
+			 ztest_unit_test(test_plist_scan_deep),
+			 ztest_unit_test(test_plist_peek),
+			 ztest_unit_test(test_readdir_n_error));
+	ztest_run_test_suite(test_plist_index);
+}
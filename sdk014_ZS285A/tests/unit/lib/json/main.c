@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+int snprintk(char *str, size_t size, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = vsnprintf(str, size, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+#include <lib/json/json.c>
+#include <lib/json/json_stream.c>
+
+#define MAX_DEVICES	128
+#define BENCH_ROUNDS	200
+/* one tcp segment at a time */
+#define CHUNK_SIZE	1460
+
+/* output of the encoder goes here */
+static char out[8192];
+static int out_len;
+static int write_cnt;
+
+int stream_write(io_stream_t handle, unsigned char *buf, int num)
+{
+	if (num > sizeof(out) - out_len)
+		return -ENOSPC;
+
+	memcpy(out + out_len, buf, num);
+	out_len += num;
+	write_cnt++;
+
+	return num;
+}
+
+/* tokens as text, to compare whole and chunked parsing */
+static char dump[8192];
+static int dump_len;
+
+static int dump_token(const struct json_stream_token *token, void *data)
+{
+	dump_len += snprintf(dump + dump_len, sizeof(dump) - dump_len, "%d%c%s%.*s ",
+			     token->depth, token->type, token->key ? "k:" : "",
+			     (int)token->len, token->start ? token->start : "");
+	return 0;
+}
+
+static int tokenize(const char *json, size_t len, size_t chunk)
+{
+	struct json_tokenizer tk;
+	char buf[64];
+	size_t pos, n;
+	int ret;
+
+	dump_len = 0;
+	dump[0] = '\0';
+	json_tokenizer_init(&tk, buf, sizeof(buf), dump_token, NULL);
+
+	for (pos = 0; pos < len; pos += n) {
+		n = min(chunk, len - pos);
+		ret = json_tokenizer_feed(&tk, json + pos, n);
+		if (ret < 0)
+			return ret;
+	}
+
+	return json_tokenizer_finish(&tk);
+}
+
+void test_json_tokenizer_chunks(void)
+{
+	static const char json[] =
+		"{\"name\" : \"speaker\", \"volume\":-12, \"gain\":1.5e3,"
+		" \"on\":true, \"off\":false, \"none\":null,"
+		" \"list\":[1, [\"a\\\"b\"], {}, []], \"empty\":\"\"}";
+	char whole[sizeof(dump)];
+	size_t chunk;
+
+	zassert_equal(tokenize(json, strlen(json), strlen(json)), 0, NULL);
+	strcpy(whole, dump);
+	zassert_true(!strcmp(whole, "0{ 1\"k:name 1\"speaker 1\"k:volume 10-12 "
+			     "1\"k:gain 101.5e3 1\"k:on 1t 1\"k:off 1f 1\"k:none 1n "
+			     "1\"k:list 1[ 201 2[ 3\"a\"b 2] 2{ 2} 2[ 2] 1] "
+			     "1\"k:empty 1\" 0} "), NULL);
+
+	/* a token may be cut anywhere */
+	for (chunk = 1; chunk < 16; chunk++) {
+		zassert_equal(tokenize(json, strlen(json), chunk), 0, NULL);
+		zassert_true(!strcmp(whole, dump), "chunked parse differs");
+	}
+
+	/* a top level number ends with the input */
+	zassert_equal(tokenize("-42", 3, 1), 0, NULL);
+	zassert_true(!strcmp(dump, "00-42 "), NULL);
+}
+
+void test_json_tokenizer_unescape(void)
+{
+	static const char json[] = "[\"t\\tn\\n\\u00e9\\u4e2d\\ud83d\\ude00\\/\"]";
+
+	zassert_equal(tokenize(json, strlen(json), 3), 0, NULL);
+	zassert_true(!strcmp(dump, "0[ 1\"t\tn\n\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80/ 0] "),
+		     NULL);
+}
+
+void test_json_tokenizer_errors(void)
+{
+	static const char *const bad[] = {
+		"{\"a\" 1}", "{\"a\":1,}", "[1,]", "{,}", "[1 2]", "tru", "nul!",
+		"[1] 2", "{\"a\":1]", "[\"a\\x\"]", "[\"\\u12g4\"]", "\"open", "{\"a\":",
+		"}", "{1:2}",
+	};
+	char deep[2 * JSON_STREAM_MAX_DEPTH + 3];
+	char long_str[80];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bad); i++) {
+		zassert_true(tokenize(bad[i], strlen(bad[i]), 1) < 0, bad[i]);
+		zassert_true(tokenize(bad[i], strlen(bad[i]), 64) < 0, bad[i]);
+	}
+
+	memset(deep, '[', JSON_STREAM_MAX_DEPTH + 1);
+	memset(deep + JSON_STREAM_MAX_DEPTH + 1, ']', JSON_STREAM_MAX_DEPTH + 1);
+	zassert_equal(tokenize(deep, 2 * JSON_STREAM_MAX_DEPTH + 2, 64), -ENOSPC, NULL);
+	zassert_equal(tokenize(deep + 1, 2 * JSON_STREAM_MAX_DEPTH, 64), 0, NULL);
+
+	/* longer than the scratch buffer: fine in one chunk, not if cut */
+	memset(long_str, 'x', sizeof(long_str));
+	long_str[0] = '"';
+	long_str[sizeof(long_str) - 1] = '"';
+	zassert_equal(tokenize(long_str, sizeof(long_str), sizeof(long_str)), 0, NULL);
+	zassert_equal(tokenize(long_str, sizeof(long_str), 40), -ENOSPC, NULL);
+}
+
+struct test_elt {
+	const char *name;
+	int height;
+};
+
+struct test_obj {
+	struct test_elt elts[4];
+	size_t elts_len;
+	bool ok;
+};
+
+static const struct json_obj_descr test_elt_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct test_elt, name, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct test_elt, height, JSON_TOK_NUMBER),
+};
+
+static const struct json_obj_descr test_obj_descr[] = {
+	JSON_OBJ_DESCR_OBJ_ARRAY(struct test_obj, elts, 4, elts_len,
+				 test_elt_descr, ARRAY_SIZE(test_elt_descr)),
+	JSON_OBJ_DESCR_PRIM(struct test_obj, ok, JSON_TOK_TRUE),
+};
+
+void test_json_encoder(void)
+{
+	struct test_obj obj = {
+		.elts = { { "a", 1 }, { "b", 2 } },
+		.elts_len = 2,
+		.ok = true,
+	};
+	struct json_encoder enc;
+	char name[200];
+
+	out_len = 0;
+	json_encoder_init(&enc, NULL);
+	json_encoder_object_start(&enc);
+	json_encoder_key(&enc, "str");
+	json_encoder_string(&enc, "q\"\\\n\x01");
+	json_encoder_key(&enc, "nums");
+	json_encoder_array_start(&enc);
+	json_encoder_number(&enc, 0);
+	json_encoder_number(&enc, -2147483647 - 1);
+	json_encoder_number(&enc, 2147483647);
+	json_encoder_array_end(&enc);
+	json_encoder_key(&enc, "flags");
+	json_encoder_array_start(&enc);
+	json_encoder_bool(&enc, true);
+	json_encoder_bool(&enc, false);
+	json_encoder_null(&enc);
+	json_encoder_array_start(&enc);
+	json_encoder_array_end(&enc);
+	json_encoder_array_end(&enc);
+	json_encoder_key(&enc, "obj");
+	json_encoder_obj(&enc, test_obj_descr, ARRAY_SIZE(test_obj_descr), &obj);
+	json_encoder_object_end(&enc);
+	zassert_equal(json_encoder_finish(&enc), 0, NULL);
+
+	out[out_len] = '\0';
+	zassert_true(!strcmp(out, "{\"str\":\"q\\\"\\\\\\n\\u0001\","
+			     "\"nums\":[0,-2147483648,2147483647],"
+			     "\"flags\":[true,false,null,[]],"
+			     "\"obj\":{\"elts\":[{\"name\":\"a\",\"height\":1},"
+			     "{\"name\":\"b\",\"height\":2}],\"ok\":true}}"), out);
+	zassert_equal(tokenize(out, out_len, 7), 0, NULL);
+
+	/* output goes out in buffer sized writes */
+	memset(name, 'n', sizeof(name) - 1);
+	name[sizeof(name) - 1] = '\0';
+	out_len = 0;
+	write_cnt = 0;
+	json_encoder_init(&enc, NULL);
+	json_encoder_string(&enc, name);
+	zassert_equal(json_encoder_finish(&enc), 0, NULL);
+	zassert_equal(out_len, sizeof(name) + 1, NULL);
+	zassert_equal(write_cnt, (out_len + JSON_ENCODER_BUF_SIZE - 1) / JSON_ENCODER_BUF_SIZE,
+		      NULL);
+
+	/* misuse is reported */
+	json_encoder_init(&enc, NULL);
+	json_encoder_object_start(&enc);
+	zassert_equal(json_encoder_number(&enc, 1), -EINVAL, "value without key");
+	json_encoder_init(&enc, NULL);
+	json_encoder_array_start(&enc);
+	zassert_equal(json_encoder_object_end(&enc), -EINVAL, NULL);
+	json_encoder_init(&enc, NULL);
+	json_encoder_array_start(&enc);
+	zassert_equal(json_encoder_finish(&enc), -EINVAL, "not closed");
+}
+
+/*
+ * cloud config document for the benchmark; json_obj_parse steps through
+ * arrays by fields rounded up to the struct alignment, so every field
+ * starts on a pointer boundary on a 64-bit host too
+ */
+struct device_config {
+	int id;
+	const char *name;
+	int volume;
+	const char *room;
+	bool muted;
+};
+
+struct cloud_config {
+	int version;
+	const char *region;
+	struct device_config devices[MAX_DEVICES];
+	size_t devices_len;
+	int timestamp;
+};
+
+static const struct json_obj_descr device_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct device_config, id, JSON_TOK_NUMBER),
+	JSON_OBJ_DESCR_PRIM(struct device_config, name, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct device_config, room, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_PRIM(struct device_config, volume, JSON_TOK_NUMBER),
+	JSON_OBJ_DESCR_PRIM(struct device_config, muted, JSON_TOK_TRUE),
+};
+
+static const struct json_obj_descr config_descr[] = {
+	JSON_OBJ_DESCR_PRIM(struct cloud_config, version, JSON_TOK_NUMBER),
+	JSON_OBJ_DESCR_PRIM(struct cloud_config, region, JSON_TOK_STRING),
+	JSON_OBJ_DESCR_OBJ_ARRAY(struct cloud_config, devices, MAX_DEVICES, devices_len,
+				 device_descr, ARRAY_SIZE(device_descr)),
+	JSON_OBJ_DESCR_PRIM(struct cloud_config, timestamp, JSON_TOK_NUMBER),
+};
+
+enum {
+	KEY_NONE,
+	KEY_VERSION,
+	KEY_REGION,
+	KEY_TIMESTAMP,
+	KEY_ID,
+	KEY_NAME,
+	KEY_ROOM,
+	KEY_VOLUME,
+	KEY_MUTED,
+};
+
+static const char *const key_names[] = {
+	"", "version", "region", "timestamp", "id", "name", "room", "volume", "muted",
+};
+
+struct config_parser {
+	struct cloud_config *cfg;
+	int key;
+	/* strings are copied, tokens do not outlive the callback */
+	char pool[8192];
+	size_t pool_used;
+};
+
+static int token_num(const struct json_stream_token *token)
+{
+	const char *p = token->start, *end = p + token->len;
+	int neg = (*p == '-');
+	int num = 0;
+
+	for (p += neg; p < end; p++)
+		num = num * 10 + *p - '0';
+
+	return neg ? -num : num;
+}
+
+static const char *token_str(struct config_parser *parser,
+			     const struct json_stream_token *token)
+{
+	char *str = parser->pool + parser->pool_used;
+
+	if (token->len + 1 > sizeof(parser->pool) - parser->pool_used)
+		return NULL;
+
+	memcpy(str, token->start, token->len);
+	str[token->len] = '\0';
+	parser->pool_used += token->len + 1;
+
+	return str;
+}
+
+static int config_token(const struct json_stream_token *token, void *data)
+{
+	struct config_parser *parser = data;
+	struct cloud_config *cfg = parser->cfg;
+	struct device_config *dev;
+	int i, key;
+
+	if (token->key) {
+		parser->key = KEY_NONE;
+		for (i = 1; i < ARRAY_SIZE(key_names); i++) {
+			if (token->len == strlen(key_names[i]) &&
+			    !memcmp(token->start, key_names[i], token->len)) {
+				parser->key = i;
+				break;
+			}
+		}
+		return 0;
+	}
+
+	if (token->type == JSON_TOK_OBJECT_START && token->depth == 2) {
+		if (cfg->devices_len == MAX_DEVICES)
+			return -ENOSPC;
+		cfg->devices_len++;
+		return 0;
+	}
+
+	/* containers are only walked through, values end the key */
+	if (token->type == JSON_TOK_OBJECT_START ||
+	    token->type == JSON_TOK_OBJECT_END ||
+	    token->type == JSON_TOK_LIST_START ||
+	    token->type == JSON_TOK_LIST_END)
+		return 0;
+
+	key = parser->key;
+	parser->key = KEY_NONE;
+	dev = cfg->devices_len ? &cfg->devices[cfg->devices_len - 1] : NULL;
+	if (key >= KEY_ID && !dev)
+		return -EINVAL;
+
+	switch (key) {
+	case KEY_VERSION:
+		cfg->version = token_num(token);
+		break;
+	case KEY_REGION:
+		cfg->region = token_str(parser, token);
+		break;
+	case KEY_TIMESTAMP:
+		cfg->timestamp = token_num(token);
+		break;
+	case KEY_ID:
+		dev->id = token_num(token);
+		break;
+	case KEY_NAME:
+		dev->name = token_str(parser, token);
+		break;
+	case KEY_ROOM:
+		dev->room = token_str(parser, token);
+		break;
+	case KEY_VOLUME:
+		dev->volume = token_num(token);
+		break;
+	case KEY_MUTED:
+		dev->muted = token->type == JSON_TOK_TRUE;
+		break;
+	}
+
+	return 0;
+}
+
+static int make_config(char *json, size_t size, int devices)
+{
+	int len, i;
+
+	len = snprintf(json, size, "{\"version\": 3, \"region\": \"cn-south-1\", \"devices\": [");
+	for (i = 0; i < devices; i++) {
+		len += snprintf(json + len, size - len,
+				"%s\n  {\"id\": %d, \"name\": \"speaker-%04d\", "
+				"\"room\": \"living room \\\"%d\\\"\", \"volume\": %d, \"muted\": %s}",
+				i ? "," : "", i, i, i % 7, i % 100, (i & 1) ? "true" : "false");
+	}
+	len += snprintf(json + len, size - len, "\n], \"timestamp\": 1570000000}");
+
+	return len;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_json_bench(void)
+{
+	static char json[MAX_DEVICES * 128];
+	static char work[sizeof(json)];
+	static struct cloud_config legacy, streamed;
+	static struct config_parser parser;
+	struct json_tokenizer tk;
+	char buf[64];
+	long long start, legacy_ns = 0, stream_ns = 0;
+	int len, i, pos, n, ret;
+
+	len = make_config(json, sizeof(json), MAX_DEVICES);
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		/* the parser writes into the buffer, keep the copy out */
+		memcpy(work, json, len);
+		memset(&legacy, 0, sizeof(legacy));
+		start = now_ns();
+		ret = json_obj_parse(work, len, config_descr, ARRAY_SIZE(config_descr), &legacy);
+		legacy_ns += now_ns() - start;
+		zassert_equal(ret, 0xf, NULL);
+	}
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		memset(&streamed, 0, sizeof(streamed));
+		parser.cfg = &streamed;
+		parser.pool_used = 0;
+		start = now_ns();
+		json_tokenizer_init(&tk, buf, sizeof(buf), config_token, &parser);
+		for (pos = 0; pos < len; pos += n) {
+			n = min(CHUNK_SIZE, len - pos);
+			zassert_equal(json_tokenizer_feed(&tk, json + pos, n), 0, NULL);
+		}
+		zassert_equal(json_tokenizer_finish(&tk), 0, NULL);
+		stream_ns += now_ns() - start;
+	}
+
+	/* same values; legacy strings are not unescaped */
+	zassert_equal(streamed.devices_len, legacy.devices_len, NULL);
+	zassert_equal(streamed.version, legacy.version, NULL);
+	zassert_equal(streamed.timestamp, legacy.timestamp, NULL);
+	zassert_true(!strcmp(streamed.region, legacy.region), NULL);
+	for (i = 0; i < MAX_DEVICES; i++) {
+		zassert_equal(streamed.devices[i].id, legacy.devices[i].id, NULL);
+		zassert_equal(streamed.devices[i].volume, legacy.devices[i].volume, NULL);
+		zassert_equal(streamed.devices[i].muted, legacy.devices[i].muted, NULL);
+		zassert_true(!strcmp(streamed.devices[i].name, legacy.devices[i].name), NULL);
+		zassert_equal(strlen(streamed.devices[i].room) + 2,
+			      strlen(legacy.devices[i].room), NULL);
+	}
+
+	PRINT("json %d bytes: json_obj_parse %lld us, buffer %d bytes; "
+	      "tokenizer %lld us, %d byte chunks, scratch %d bytes\n",
+	      len, legacy_ns / BENCH_ROUNDS / 1000, len,
+	      stream_ns / BENCH_ROUNDS / 1000, CHUNK_SIZE, (int)sizeof(buf));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_json_stream,
+			 ztest_unit_test(test_json_tokenizer_chunks),
+			 ztest_unit_test(test_json_tokenizer_unescape),
+			 ztest_unit_test(test_json_tokenizer_errors),
+			 ztest_unit_test(test_json_encoder),
+			 ztest_unit_test(test_json_bench));
+	ztest_run_test_suite(test_json_stream);
+}
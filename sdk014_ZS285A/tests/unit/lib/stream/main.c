@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define CONFIG_FILE_SYSTEM				1
+#define CONFIG_FAT_FILESYSTEM_ELM			1
+#define CONFIG_FILE_SYSTEM_FAT				1
+#define CONFIG_LONG_FILE_NAME				1
+
+static size_t copied_bytes;
+
+static void *test_memcpy(void *dst, const void *src, size_t n)
+{
+	copied_bytes += n;
+	return memmove(dst, src, n);
+}
+
+/* count every byte the stream layer copies */
+#define memcpy(d, s, n) test_memcpy(d, s, n)
+
+#include <lib/utils/source/acts_ringbuf/acts_ringbuf.c>
+#include <lib/utils/source/stream/stream.c>
+#include <lib/utils/source/stream/ringbuff_stream.c>
+#include <lib/utils/source/stream/bufferstream.c>
+
+#undef memcpy
+
+#undef SYS_LOG_DOMAIN
+#include <lib/utils/source/stream/fstream.c>
+
+void *mem_malloc(unsigned int num_bytes)
+{
+	return calloc(1, num_bytes);
+}
+
+void mem_free(void *ptr)
+{
+	free(ptr);
+}
+
+void k_mutex_init(struct k_mutex *mutex) {}
+int k_mutex_lock(struct k_mutex *mutex, s32_t timeout) { return 0; }
+void k_mutex_unlock(struct k_mutex *mutex) {}
+void k_sem_init(struct k_sem *sem, unsigned int initial_count, unsigned int limit) {}
+int k_sem_take(struct k_sem *sem, s32_t timeout) { return 0; }
+void k_sem_give(struct k_sem *sem) {}
+
+#define RING_SIZE	(4096)
+#define FRAME_SIZE	(512)
+#define FRAME_NUM	(64)
+
+static u8_t ring_data[RING_SIZE];
+static u8_t frame_buf[FRAME_SIZE];
+static u8_t out_buf[FRAME_SIZE];
+
+/* fake decoder, output one frame of pcm */
+static void decode_frame(u8_t *pcm, int len, int seq)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		pcm[i] = (u8_t)(seq + i);
+}
+
+static void check_frame(const u8_t *pcm, int len, int seq)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		zassert_equal(pcm[i], (u8_t)(seq + i), "pcm mismatch");
+}
+
+/* produce one frame through claim/commit, at most two claims on wrap */
+static void write_frame_claim(io_stream_t stream, int seq)
+{
+	unsigned char *ptr;
+	int done = 0;
+	int len;
+
+	while (done < FRAME_SIZE) {
+		len = stream_write_claim(stream, &ptr, FRAME_SIZE - done);
+		zassert_true(len > 0, "claim space failed");
+		decode_frame(ptr, len, seq + done);
+		zassert_equal(stream_write_commit(stream, len), len, "commit failed");
+		done += len;
+	}
+}
+
+static void read_frame_claim(io_stream_t stream, int seq)
+{
+	unsigned char *ptr;
+	int done = 0;
+	int len;
+
+	while (done < FRAME_SIZE) {
+		len = stream_read_claim(stream, &ptr, FRAME_SIZE - done);
+		zassert_true(len > 0, "claim data failed");
+		check_frame(ptr, len, seq + done);
+		zassert_equal(stream_read_commit(stream, len), len, "commit failed");
+		done += len;
+	}
+}
+
+static io_stream_t open_ring_stream(void)
+{
+	io_stream_t stream;
+
+	stream = ringbuff_stream_create_ext(ring_data, sizeof(ring_data));
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+	return stream;
+}
+
+void test_ringbuff_copy_per_frame(void)
+{
+	io_stream_t stream = open_ring_stream();
+	size_t copy_rw, copy_claim;
+	int i;
+
+	copied_bytes = 0;
+	for (i = 0; i < FRAME_NUM; i++) {
+		decode_frame(frame_buf, FRAME_SIZE, i);
+		zassert_equal(stream_write(stream, frame_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+		zassert_equal(stream_read(stream, out_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+		check_frame(out_buf, FRAME_SIZE, i);
+	}
+	copy_rw = copied_bytes / FRAME_NUM;
+
+	/* misalign the ring so that claims have to wrap */
+	zassert_equal(stream_write(stream, frame_buf, 100), 100, NULL);
+	zassert_equal(stream_read(stream, out_buf, 100), 100, NULL);
+
+	copied_bytes = 0;
+	for (i = 0; i < FRAME_NUM; i++) {
+		write_frame_claim(stream, i);
+		read_frame_claim(stream, i);
+	}
+	copy_claim = copied_bytes / FRAME_NUM;
+
+	PRINT("ringbuff stream copied bytes per frame: read/write %d, claim/commit %d\n",
+		(int)copy_rw, (int)copy_claim);
+
+	zassert_equal(copy_rw, 2 * FRAME_SIZE, "unexpected copy count");
+	zassert_equal(copy_claim, 0, "claim/commit must not copy");
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_ringbuff_claim_bounds(void)
+{
+	io_stream_t stream = open_ring_stream();
+	unsigned char *ptr;
+	int i;
+
+	/* nothing to read from empty stream */
+	zassert_equal(stream_read_claim(stream, &ptr, FRAME_SIZE), 0, NULL);
+
+	for (i = 0; i < RING_SIZE / FRAME_SIZE; i++)
+		write_frame_claim(stream, i * FRAME_SIZE);
+
+	/* no space left in full stream */
+	zassert_equal(stream_write_claim(stream, &ptr, FRAME_SIZE), 0, NULL);
+	zassert_equal(stream_get_length(stream), RING_SIZE, NULL);
+
+	/* commit more than claimed is rejected */
+	zassert_equal(stream_read_claim(stream, &ptr, 16), 16, NULL);
+	zassert_true(stream_read_commit(stream, RING_SIZE + 1) < 0, NULL);
+
+	for (i = 0; i < RING_SIZE / FRAME_SIZE; i++)
+		read_frame_claim(stream, i * FRAME_SIZE);
+
+	zassert_equal(stream_get_length(stream), 0, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_buffer_stream_claim(void)
+{
+	static u8_t base[FRAME_SIZE * 3];
+	struct buffer_t buffer = {
+		.length = sizeof(base),
+		.base = (char *)base,
+	};
+	io_stream_t stream;
+	unsigned char *ptr;
+	int i;
+
+	stream = buffer_stream_create(&buffer);
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+
+	copied_bytes = 0;
+	for (i = 0; i < FRAME_NUM; i++) {
+		write_frame_claim(stream, i);
+		read_frame_claim(stream, i);
+	}
+	zassert_equal(copied_bytes, 0, "claim/commit must not copy");
+
+	/* commit is bounded by what a claim can hand out */
+	zassert_equal(stream_write(stream, frame_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+	zassert_true(stream_read_claim(stream, &ptr, FRAME_SIZE * 2) > 0, NULL);
+	zassert_equal(stream_read_commit(stream, FRAME_SIZE * 2), -EINVAL, NULL);
+	zassert_equal(stream_get_length(stream), FRAME_SIZE, NULL);
+	zassert_true(stream_write_claim(stream, &ptr, sizeof(base)) > 0, NULL);
+	zassert_equal(stream_write_commit(stream, sizeof(base)), -EINVAL, NULL);
+	zassert_equal(stream_get_length(stream), FRAME_SIZE, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+/* stream with read/write ops only, claims are emulated by bounce cache */
+static int plain_stream_read(io_stream_t handle, unsigned char *buf, int num)
+{
+	return buffer_stream_read(handle, buf, num);
+}
+
+static int plain_stream_write(io_stream_t handle, unsigned char *buf, int num)
+{
+	return buffer_stream_write(handle, buf, num);
+}
+
+static const stream_ops_t plain_stream_ops = {
+	.init = buffer_stream_init,
+	.open = buffer_stream_open,
+	.read = plain_stream_read,
+	.write = plain_stream_write,
+	.close = buffer_stream_close,
+	.destroy = buffer_stream_destory,
+};
+
+void test_emulated_claim(void)
+{
+	static u8_t base[FRAME_SIZE * 3];
+	struct buffer_t buffer = {
+		.length = sizeof(base),
+		.base = (char *)base,
+	};
+	io_stream_t stream;
+	unsigned char *ptr;
+	int i;
+
+	stream = stream_create(&plain_stream_ops, &buffer);
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+
+	for (i = 0; i < FRAME_NUM; i++) {
+		write_frame_claim(stream, i);
+		read_frame_claim(stream, i);
+	}
+
+	/* uncommitted data is claimed again */
+	write_frame_claim(stream, 7);
+	zassert_equal(stream_read_claim(stream, &ptr, FRAME_SIZE), FRAME_SIZE, NULL);
+	zassert_equal(stream_read_commit(stream, 10), 10, NULL);
+	zassert_equal(stream_read_claim(stream, &ptr, FRAME_SIZE), FRAME_SIZE - 10, NULL);
+	check_frame(ptr, FRAME_SIZE - 10, 7 + 10);
+	zassert_equal(stream_read_commit(stream, FRAME_SIZE - 10), FRAME_SIZE - 10, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+#define HDR_SIZE	(4)
+
+/* header + payload of one frame, gathered by one writev and scattered by one readv */
+static void check_iov_stream(io_stream_t stream, int frames)
+{
+	u8_t hdr[HDR_SIZE], in_hdr[HDR_SIZE];
+	struct stream_iovec iov[2];
+	int i;
+
+	for (i = 0; i < frames; i++) {
+		memset(hdr, i, sizeof(hdr));
+		decode_frame(frame_buf, FRAME_SIZE, i);
+
+		iov[0].base = hdr;
+		iov[0].len = sizeof(hdr);
+		iov[1].base = frame_buf;
+		iov[1].len = FRAME_SIZE;
+		zassert_equal(stream_writev(stream, iov, 2), HDR_SIZE + FRAME_SIZE, NULL);
+
+		memset(in_hdr, 0xff, sizeof(in_hdr));
+		iov[0].base = in_hdr;
+		iov[1].base = out_buf;
+		zassert_equal(stream_readv(stream, iov, 2), HDR_SIZE + FRAME_SIZE, NULL);
+
+		zassert_true(!memcmp(hdr, in_hdr, sizeof(hdr)), "header mismatch");
+		check_frame(out_buf, FRAME_SIZE, i);
+	}
+}
+
+void test_ringbuff_iov(void)
+{
+	io_stream_t stream = open_ring_stream();
+	struct stream_iovec iov[2];
+	u8_t hdr[HDR_SIZE];
+
+	/* frames of HDR_SIZE + FRAME_SIZE walk over the wrap point */
+	check_iov_stream(stream, FRAME_NUM);
+
+	/* ringbuff gathers all or nothing */
+	iov[0].base = hdr;
+	iov[0].len = sizeof(hdr);
+	iov[1].base = ring_data;
+	iov[1].len = RING_SIZE;
+	zassert_equal(stream_writev(stream, iov, 2), 0, NULL);
+	zassert_equal(stream_get_length(stream), 0, NULL);
+
+	iov[1].base = frame_buf;
+	iov[1].len = FRAME_SIZE;
+	zassert_equal(stream_write(stream, frame_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+	zassert_equal(stream_readv(stream, iov, 2), 0, NULL);
+	zassert_equal(stream_get_length(stream), FRAME_SIZE, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_ringbuff_spsc(void)
+{
+	static struct acts_ringbuf ring;
+	io_stream_t stream;
+	int i;
+
+	acts_ringbuf_init(&ring, ring_data, sizeof(ring_data));
+	stream = ringbuff_stream_create_spsc(&ring);
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+
+	for (i = 0; i < FRAME_NUM; i++) {
+		decode_frame(frame_buf, FRAME_SIZE, i);
+		zassert_equal(stream_write(stream, frame_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+		zassert_equal(stream_get_length(stream), FRAME_SIZE, NULL);
+		zassert_equal(stream_read(stream, out_buf, FRAME_SIZE), FRAME_SIZE, NULL);
+		check_frame(out_buf, FRAME_SIZE, i);
+	}
+
+	/* published by the _n helpers, same all or nothing rule */
+	check_iov_stream(stream, FRAME_NUM);
+	zassert_equal(stream_get_space(stream), RING_SIZE, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_buffer_stream_iov(void)
+{
+	static u8_t base[FRAME_SIZE * 3];
+	struct buffer_t buffer = {
+		.length = sizeof(base),
+		.base = (char *)base,
+	};
+	io_stream_t stream;
+
+	stream = buffer_stream_create(&buffer);
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+
+	check_iov_stream(stream, FRAME_NUM);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_emulated_iov(void)
+{
+	static u8_t base[FRAME_SIZE * 3];
+	struct buffer_t buffer = {
+		.length = sizeof(base),
+		.base = (char *)base,
+	};
+	io_stream_t stream;
+
+	stream = stream_create(&plain_stream_ops, &buffer);
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+
+	check_iov_stream(stream, FRAME_NUM);
+
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+/* one file in memory, reads are counted */
+static u8_t file_data[16384];
+static int file_reads;
+
+int fs_open(fs_file_t *zfp, const char *file_name)
+{
+	zfp->fp.fptr = 0;
+	return 0;
+}
+
+int fs_open_cluster(fs_file_t *zfp, char *dir, u32_t cluster, u32_t blk_ofs)
+{
+	return -ENOENT;
+}
+
+int fs_close(fs_file_t *zfp)
+{
+	return 0;
+}
+
+ssize_t fs_read(fs_file_t *zfp, void *ptr, size_t size)
+{
+	if (size > sizeof(file_data) - zfp->fp.fptr)
+		size = sizeof(file_data) - zfp->fp.fptr;
+
+	memcpy(ptr, file_data + zfp->fp.fptr, size);
+	zfp->fp.fptr += size;
+	file_reads++;
+	return size;
+}
+
+ssize_t fs_write(fs_file_t *zfp, const void *ptr, size_t size)
+{
+	return -EPERM;
+}
+
+int fs_seek(fs_file_t *zfp, off_t offset, int whence)
+{
+	zfp->fp.fptr = (whence == FS_SEEK_END) ? sizeof(file_data) + offset : offset;
+	return 0;
+}
+
+int fs_sync(fs_file_t *zfp)
+{
+	return 0;
+}
+
+static void check_file_read(io_stream_t stream, int ofs, int len)
+{
+	static u8_t buf[4096];
+
+	zassert_equal(stream_read(stream, buf, len), len, "read failed");
+	zassert_equal(memcmp(buf, file_data + ofs, len), 0, "wrong data");
+	zassert_equal(stream_tell(stream), ofs + len, "wrong position");
+}
+
+void test_file_stream_preload(void)
+{
+	static u8_t head[1024];
+	struct stream_iovec iov[2] = {
+		{ .base = head, .len = 300 },
+		{ .base = head + 300, .len = 500 },
+	};
+	io_stream_t stream;
+	int i;
+
+	for (i = 0; i < sizeof(file_data); i++)
+		file_data[i] = (u8_t)(i * 7 + (i >> 8));
+
+	stream = file_stream_create("SD:/MUSIC.MP3");
+	zassert_not_null(stream, "create failed");
+	zassert_equal(stream_open(stream, MODE_IN), 0, "open failed");
+	zassert_equal(file_stream_preload(stream, 2048), 2048, "preload failed");
+	zassert_equal(file_stream_preload(stream, 2048), -EALREADY, NULL);
+
+	/* the decoder probes the head, then reads on */
+	file_reads = 0;
+	check_file_read(stream, 0, 512);
+	check_file_read(stream, 512, 1024);
+	zassert_equal(file_reads, 0, "head read from file");
+	check_file_read(stream, 1536, 1024);
+	zassert_equal(file_reads, 1, NULL);
+	check_file_read(stream, 2560, 1024);
+
+	/* seek back into the head */
+	zassert_equal(stream_seek(stream, 1000, SEEK_DIR_BEG), 0, NULL);
+	file_reads = 0;
+	check_file_read(stream, 1000, 2000);
+	zassert_equal(file_reads, 1, NULL);
+
+	zassert_equal(stream_seek(stream, 0, SEEK_DIR_BEG), 0, NULL);
+	file_reads = 0;
+	zassert_equal(stream_readv(stream, iov, 2), 800, NULL);
+	zassert_equal(memcmp(head, file_data, 800), 0, "wrong data");
+	zassert_equal(file_reads, 0, NULL);
+
+	stream_close(stream);
+	stream_destroy(stream);
+
+	/* a stream for writing has no head */
+	stream = file_stream_create("SD:/MUSIC.MP3");
+	zassert_equal(stream_open(stream, MODE_IN_OUT), 0, "open failed");
+	zassert_equal(file_stream_preload(stream, 2048), -EINVAL, NULL);
+	stream_close(stream);
+	stream_destroy(stream);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_stream_claim,
+			 ztest_unit_test(test_ringbuff_copy_per_frame),
+			 ztest_unit_test(test_ringbuff_claim_bounds),
+			 ztest_unit_test(test_buffer_stream_claim),
+			 ztest_unit_test(test_emulated_claim),
+			 ztest_unit_test(test_ringbuff_iov),
+			 ztest_unit_test(test_ringbuff_spsc),
+			 ztest_unit_test(test_buffer_stream_iov),
+			 ztest_unit_test(test_emulated_iov),
+			 ztest_unit_test(test_file_stream_preload));
+	ztest_run_test_suite(test_stream_claim);
+}
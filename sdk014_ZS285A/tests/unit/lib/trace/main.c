@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define CONFIG_TRACE_BINARY_LOG	1
+
+#define BENCH_ROUNDS	(200000)
+
+static uint32_t cycle_now;
+
+uint32_t _arch_k_cycle_get_32(void)
+{
+	return cycle_now;
+}
+
+#include <lib/utils/source/trace/trace_log.c>
+#include <lib/utils/source/trace/trace_vsnprintf.c>
+
+static int log_encode(uint8_t *buf, int size, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = trace_log_encode(buf, size, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+static int log_format(char *buf, int size, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = trace_vsnprintf(buf, size, LINESEP_FORMAT_WINDOWS, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t record_sum(const uint8_t *buf)
+{
+	uint8_t sum = 0;
+	int i;
+
+	for (i = 0; i < buf[1]; i++)
+		sum += (i == 3) ? 0 : buf[i];
+
+	return sum;
+}
+
+void test_trace_log_layout(void)
+{
+	static const char fmt[] = "a2dp %d %x %s\n";
+	uint8_t buf[TRACE_TEMP_BUF_SIZE];
+	uint8_t seq;
+	int len;
+
+	cycle_now = 0x12345678;
+	len = log_encode(buf, sizeof(buf), fmt, -5, 0xabcd, "sbc");
+	zassert_equal(len, TRACE_LOG_HEADER_SIZE + 4 + 4 + 1 + 3, NULL);
+
+	zassert_equal(buf[0], TRACE_LOG_SYNC, NULL);
+	zassert_equal(buf[1], len, NULL);
+	zassert_equal(buf[3], record_sum(buf), "bad checksum");
+	zassert_equal(get_le32(&buf[4]), 0x12345678, NULL);
+	zassert_equal(get_le32(&buf[8]), (uint32_t)(uintptr_t)fmt, NULL);
+	zassert_equal(get_le32(&buf[12]), (uint32_t)-5, NULL);
+	zassert_equal(get_le32(&buf[16]), 0xabcd, NULL);
+	zassert_equal(buf[20], 3, NULL);
+	zassert_true(!memcmp(&buf[21], "sbc", 3), NULL);
+
+	/* sequence counts every record */
+	seq = buf[2];
+	log_encode(buf, sizeof(buf), "no args\n");
+	zassert_equal(buf[2], (uint8_t)(seq + 1), NULL);
+	zassert_equal(buf[1], TRACE_LOG_HEADER_SIZE, NULL);
+}
+
+void test_trace_log_modifiers(void)
+{
+	uint8_t buf[TRACE_TEMP_BUF_SIZE];
+	int len;
+
+	/* modifiers and %% take no argument, long long is cut to 32 bits */
+	len = log_encode(buf, sizeof(buf), "%-8s|%08x|%ld|%lld|%c|100%%|%p\n",
+			 "ab", 0x1234, -7L, 0x100000002LL, 'z', (void *)0x1000);
+	zassert_equal(len, TRACE_LOG_HEADER_SIZE + 3 + 4 * 5, NULL);
+	zassert_equal(buf[12], 2, NULL);
+	zassert_equal(get_le32(&buf[15]), 0x1234, NULL);
+	zassert_equal(get_le32(&buf[19]), (uint32_t)-7, NULL);
+	zassert_equal(get_le32(&buf[23]), 2, NULL);
+	zassert_equal(get_le32(&buf[27]), 'z', NULL);
+	zassert_equal(get_le32(&buf[31]), 0x1000, NULL);
+	zassert_equal(buf[3], record_sum(buf), "bad checksum");
+}
+
+void test_trace_log_overflow(void)
+{
+	static const char name[] = "a very long file name for a short buffer";
+	uint8_t buf[TRACE_TEMP_BUF_SIZE];
+
+	zassert_equal(log_encode(buf, TRACE_LOG_HEADER_SIZE + 4, "%d", 1),
+		      TRACE_LOG_HEADER_SIZE + 4, NULL);
+	zassert_equal(log_encode(buf, TRACE_LOG_HEADER_SIZE + 3, "%d", 1), -1, NULL);
+	zassert_equal(log_encode(buf, TRACE_LOG_HEADER_SIZE - 1, "text"), -1, NULL);
+
+	/* strings are cut to fit, the record is still valid */
+	zassert_equal(log_encode(buf, TRACE_LOG_HEADER_SIZE + 8, "%s", name),
+		      TRACE_LOG_HEADER_SIZE + 8, NULL);
+	zassert_equal(buf[12], 7, NULL);
+	zassert_true(!memcmp(&buf[13], name, 7), NULL);
+	zassert_equal(buf[3], record_sum(buf), "bad checksum");
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_trace_log_bench(void)
+{
+	static const char fmt[] = "a2dp: seq %d ts %u len %d codec %s status 0x%08x\n";
+	uint8_t buf[TRACE_TEMP_BUF_SIZE];
+	long long start, text_ns, binary_ns;
+	int text_len = 0, binary_len = 0;
+	int i;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		text_len = log_format((char *)buf, sizeof(buf), fmt, i, i * 128, 660, "sbc", i);
+	text_ns = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		binary_len = log_encode(buf, sizeof(buf), fmt, i, i * 128, 660, "sbc", i);
+	binary_ns = now_ns() - start;
+
+	PRINT("trace text: %d bytes %lld ns, binary: %d bytes %lld ns per message\n",
+	      text_len, text_ns / BENCH_ROUNDS, binary_len, binary_ns / BENCH_ROUNDS);
+	zassert_true(binary_len < text_len, "binary record must be shorter");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_trace_log,
+			 ztest_unit_test(test_trace_log_layout),
+			 ztest_unit_test(test_trace_log_modifiers),
+			 ztest_unit_test(test_trace_log_overflow),
+			 ztest_unit_test(test_trace_log_bench));
+	ztest_run_test_suite(test_trace_log);
+}
@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define CONFIG_SUPPORT_GBK_DISPLAY	1
+#define CONFIG_LONG_FILE_NAME		1
+#define ff_convert			cc936_search_convert
+#define ff_wtoupper			cc936_search_wtoupper
+
+#include <ext/fs/fat/option/cc936.c>
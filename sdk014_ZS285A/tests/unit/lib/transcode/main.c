@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2019 Actions Semiconductor Co., Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CONFIG_FILE_SYSTEM		1
+#define CONFIG_FILE_SYSTEM_FAT		1
+#define CONFIG_FAT_FILESYSTEM_ELM	1
+#define CONFIG_SUPPORT_GBK_DISPLAY	1
+#define CONFIG_LONG_FILE_NAME		1
+
+/* FatFs needs 32-bit DWORD, host long is 64-bit */
+#define LONG				int
+#define DWORD				unsigned int
+
+#include <lib/utils/source/transcode/transcode.c>
+
+#define CORPUS_SIZE	(64 * 1024)
+#define BENCH_ROUNDS	(16)
+
+WCHAR cc936_search_convert(WCHAR chr, UINT dir);
+WCHAR cc936_page_convert(WCHAR chr, UINT dir);
+
+static int use_page_index;
+
+WCHAR ff_convert(WCHAR chr, UINT dir)
+{
+	return use_page_index ? cc936_page_convert(chr, dir) : cc936_search_convert(chr, dir);
+}
+
+static unsigned char gbk[CORPUS_SIZE + 1];
+static unsigned char utf8[CORPUS_SIZE * 2 + 1];
+static unsigned char back[CORPUS_SIZE + 1];
+static unsigned short wide[CORPUS_SIZE + 1];
+static unsigned short wide2[CORPUS_SIZE + 1];
+
+/* lyrics like text, ascii_percent of the characters are ascii words */
+static int make_corpus(int ascii_percent)
+{
+	int len = 0, i;
+
+	srand(1);
+	while (len < CORPUS_SIZE - 16) {
+		if (rand() % 100 < ascii_percent) {
+			for (i = rand() % 8 + 1; i > 0; i--)
+				gbk[len++] = 'a' + rand() % 26;
+			gbk[len++] = ' ';
+		} else {
+			/* GB2312 level 1 hanzi, row D7 is not full */
+			gbk[len++] = 0xB0 + rand() % 39;
+			gbk[len++] = 0xA1 + rand() % 94;
+		}
+	}
+	gbk[len] = 0;
+
+	return len;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void test_cc936_page_index(void)
+{
+	unsigned int c;
+
+	/* every code both ways, including unmapped ones */
+	for (c = 0; c < 0x10000; c++) {
+		zassert_equal(cc936_page_convert(c, 1), cc936_search_convert(c, 1), "oem");
+		zassert_equal(cc936_page_convert(c, 0), cc936_search_convert(c, 0), "uni");
+	}
+
+	zassert_equal(cc936_page_convert(0xB0A1, 1), 0x554A, NULL);
+	zassert_equal(cc936_page_convert(0x554A, 0), 0xB0A1, NULL);
+	zassert_equal(cc936_page_convert(0x0080, 1), 0x20AC, NULL);
+}
+
+void test_transcode_round_trip(void)
+{
+	int len, utf8_len, wide_len;
+
+	len = make_corpus(30);
+	utf8_len = gbk_to_utf8(gbk, utf8, 0);
+	zassert_true(utf8_len > len, NULL);
+	zassert_equal(strlen((char *)utf8), utf8_len, NULL);
+
+	zassert_equal(utf8_to_gbk(utf8, back, utf8_len), len, NULL);
+	zassert_equal(memcmp(gbk, back, len), 0, "round trip");
+
+	zassert_equal(gbk_to_unicode(gbk, wide, &wide_len), 0, NULL);
+	zassert_equal(utf8_to_unicode(utf8, utf8_len, wide2, &len), 0, NULL);
+	zassert_equal(wide_len, len, NULL);
+	zassert_equal(memcmp(wide, wide2, len), 0, NULL);
+
+	/* ascii only, every length and alignment of the word loop */
+	for (len = 0; len < 16; len++) {
+		memcpy(gbk, "0123456789abcdef", len);
+		gbk[len] = 0;
+		zassert_equal(gbk_to_utf8_n(gbk + 1, len, utf8, 64), len ? len - 1 : 0, NULL);
+		zassert_equal(gbk_to_unicode(gbk + (len & 3), wide, &wide_len), 0, NULL);
+		zassert_equal(wide_len, (len - (len & 3)) * 2, NULL);
+		if (len > 4)
+			zassert_equal(wide[len - (len & 3) - 1], gbk[len - 1], NULL);
+	}
+}
+
+void test_transcode_bounded(void)
+{
+	/* "ab" U+554A U+963F "c" */
+	const unsigned char text_gbk[] = { 'a', 'b', 0xB0, 0xA1, 0xB0, 0xA2, 'c', 0 };
+	const unsigned char text_utf8[] = "ab\xe5\x95\x8a\xe9\x98\xbf" "c";
+	unsigned char out[16];
+
+	zassert_equal(gbk_to_utf8_n(text_gbk, 7, out, sizeof(out)), 9, NULL);
+	zassert_equal(memcmp(out, text_utf8, 10), 0, NULL);
+
+	/* length bounds the input, no terminator needed */
+	zassert_equal(gbk_to_utf8_n(text_gbk, 4, out, sizeof(out)), 5, NULL);
+	zassert_equal(memcmp(out, "ab\xe5\x95\x8a", 6), 0, NULL);
+
+	/* half of a double byte character is dropped */
+	zassert_equal(gbk_to_utf8_n(text_gbk, 3, out, sizeof(out)), 2, NULL);
+	zassert_equal(out[2], 0, NULL);
+
+	/* output is cut at a character boundary */
+	memset(out, 0xff, sizeof(out));
+	zassert_equal(gbk_to_utf8_n(text_gbk, 7, out, 7), 5, NULL);
+	zassert_equal(out[5], 0, NULL);
+	zassert_equal(out[6], 0xff, "overflow");
+
+	zassert_equal(utf8_to_gbk_n(text_utf8, 9, out, sizeof(out)), 7, NULL);
+	zassert_equal(memcmp(out, text_gbk, 8), 0, NULL);
+	zassert_equal(utf8_to_gbk_n(text_utf8, 4, out, sizeof(out)), 4, "partial copied as is");
+	memset(out, 0xff, sizeof(out));
+	zassert_equal(utf8_to_gbk_n(text_utf8, 9, out, 6), 4, NULL);
+	zassert_equal(out[4], 0, NULL);
+	zassert_equal(out[5], 0xff, "overflow");
+
+	zassert_equal(gbk_to_utf8_n(text_gbk, 7, out, 0), -1, NULL);
+	zassert_equal(utf8_to_gbk_n(NULL, 7, out, 16), -1, NULL);
+}
+
+static void bench(const char *name, int ascii_percent)
+{
+	long long start, ns_to, ns_from;
+	int len, utf8_len = 0, i;
+
+	len = make_corpus(ascii_percent);
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		utf8_len = gbk_to_utf8_n(gbk, len, utf8, sizeof(utf8));
+	ns_to = now_ns() - start;
+
+	start = now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++)
+		zassert_equal(utf8_to_gbk_n(utf8, utf8_len, back, sizeof(back)), len, NULL);
+	ns_from = now_ns() - start;
+
+	PRINT("%-14s %-8s: gbk to utf8 %4lld MB/s, utf8 to gbk %4lld MB/s\n", name,
+	      use_page_index ? "page" : "search",
+	      (long long)len * BENCH_ROUNDS * 1000 / (ns_to + 1),
+	      (long long)utf8_len * BENCH_ROUNDS * 1000 / (ns_from + 1));
+}
+
+void test_transcode_bench(void)
+{
+	for (use_page_index = 0; use_page_index < 2; use_page_index++) {
+		bench("chinese", 10);
+		bench("mixed", 50);
+		bench("ascii", 100);
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(test_transcode,
+			 ztest_unit_test(test_cc936_page_index),
+			 ztest_unit_test(test_transcode_round_trip),
+			 ztest_unit_test(test_transcode_bounded),
+			 ztest_unit_test(test_transcode_bench));
+	ztest_run_test_suite(test_transcode);
+}